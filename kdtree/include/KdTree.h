@@ -82,12 +82,16 @@ using std::min;
 //#include "Vector3.h"
 #include "SteerLib.h"
 #include "interfaces/AgentInterface.h"
+#include "util/ThreadedTaskManager.h"
 // #include "interfaces/ObstacleInterface.h"
 
 
 // class RVO2Agent;
 using namespace SteerLib;
 
+/// By default, refitting may let the agent tree's bounding boxes grow by half before it is rebuilt.
+#define DEFAULT_KDTREE_REBUILD_THRESHOLD 1.5f
+
 /**
  * \brief   Defines <i>k</i>d-trees for agents in the simulation.
  */
@@ -169,6 +173,51 @@ public:
 
 	void buildAgentTreeRecursive(size_t begin, size_t end, size_t node);
 
+	/**
+	 * \brief   Computes the bounding box of an agent tree node and, unless it is a leaf, partitions its agents.
+	 * \return  The index where the right child's agents begin, or end if the node is a leaf.
+	 */
+	size_t splitAgentTreeNode(size_t begin, size_t end, size_t node);
+
+	/**
+	 * \brief   Sets the number of threads used to build the trees; with one thread, they are built serially.
+	 */
+	void setBuildThreads(unsigned int numThreads);
+
+	/**
+	 * \brief   Brings the agent <i>k</i>d-tree up to date with the agents' current positions.
+	 *
+	 * Without refitting, this is the same as buildAgentTree().  With refitting, as long as the same agents
+	 * are enabled, the tree keeps its structure and only the node bounding boxes are recomputed; queries
+	 * stay exact because they only prune with those boxes.  Once the boxes, measured relative to the
+	 * root box, add up to more than rebuildThreshold_ times their size right after the last build, the
+	 * tree is rebuilt.
+	 */
+	void updateAgentTree();
+
+	/**
+	 * \brief   Enables or disables refitting in updateAgentTree().
+	 * \param   refit             True to refit instead of rebuilding whenever possible.
+	 * \param   rebuildThreshold  How much the total bounding box size may grow before a rebuild.
+	 */
+	void setAgentTreeRefit(bool refit, float rebuildThreshold);
+
+	/**
+	 * \brief   Recomputes the bounding boxes of node and everything below it.
+	 * \return  The sum of the half perimeters of those boxes.
+	 */
+	float refitAgentTreeRecursive(size_t node);
+
+	/**
+	 * \brief   Returns the sum of the half perimeters of the bounding boxes of node and everything below it.
+	 */
+	float agentTreeCostRecursive(size_t node) const;
+
+	/**
+	 * \brief   Returns the half perimeter of the root bounding box.
+	 */
+	float agentTreeRootSize() const;
+
 	/**
 	 * \brief      Builds an obstacle <i>k</i>d-tree.
 	 */
@@ -177,6 +226,21 @@ public:
 	ObstacleInterfaceTreeNode *buildObstacleTreeRecursive(const std::vector<ObstacleInterface *> &
 												 obstacles);
 
+	/**
+	 * \brief      Finds the best splitting obstacle among obstacles[begin, end), counting how many of all the obstacles
+	 *             would go to each side.
+	 * \param      minLeft, minRight   The sizes of the sides for the best split so far; updated when a better split is found.
+	 * \return     The index of the best split in [begin, end), or optimalSplit unchanged if none was better.
+	 */
+	size_t findObstacleSplit(const std::vector<ObstacleInterface *> & obstacles, size_t begin, size_t end,
+							 size_t optimalSplit, size_t & minLeft, size_t & minRight) const;
+
+	/**
+	 * \brief      Divides obstacles into those left and right of obstacles[split], splitting obstacles that cross it.
+	 */
+	void partitionObstacles(const std::vector<ObstacleInterface *> & obstacles, size_t split, size_t minLeft, size_t minRight,
+							std::vector<ObstacleInterface *> & leftObstacles, std::vector<ObstacleInterface *> & rightObstacles);
+
 	/**
 	 * \brief   Computes the agent neighbors of the specified agent.
 	 * \param   agent    A pointer to the agent for which agent neighbors are to be computed.
@@ -192,6 +256,16 @@ public:
 	 */
 	void computeObstacleNeighbors(SpatialDatabaseItemPtr agent, float rangeSq) const;
 
+	/**
+	 * \brief      Finds the (at most) k enabled agents nearest to a point, nearest first.
+	 * \param      neighbors       Filled with (squared distance, agent) pairs.
+	 * \param      position        The point to search around.
+	 * \param      k               The maximum number of agents to find.
+	 * \param      rangeSq         The squared range around the point.
+	 * \param      exclude         An agent to leave out, usually the one asking.
+	 */
+	void computeKNearestAgents(std::vector<std::pair<float, const SteerLib::AgentInterface *> > & neighbors, const Util::Point & position, unsigned int k, float rangeSq, SpatialDatabaseItemPtr exclude) const;
+
 	/**
 	 * \brief      Deletes the specified obstacle tree node.
 	 * \param      node            A pointer to the obstacle tree node to be
@@ -225,20 +299,68 @@ public:
 	void queryAgentTreeRecursive(SteerLib::AgentInterface *agent,
 									float &rangeSq, size_t node) const;
 
+	void queryKNearestAgentsRecursive(std::vector<std::pair<float, const SteerLib::AgentInterface *> > & neighbors, const Util::Point & position,
+									unsigned int k, float &rangeSq, SpatialDatabaseItemPtr exclude, size_t node) const;
+
 	std::vector<SteerLib::AgentInterface *> agents_;
 	std::vector<AgentInterfaceTreeNode> agentTree_;
+
+	bool refitAgentTree_;
+	float rebuildThreshold_;
+	/// agentTreeCostRecursive(0) right after the last build.
+	float builtAgentTreeCost_;
+	/// Sorted pointers used by updateAgentTree() to compare agents_ with the engine's enabled agents; kept to avoid allocating every frame.
+	std::vector<SteerLib::AgentInterface *> sortedTreeAgents_, sortedEnabledAgents_;
+	/// Counts and times every full build of the agent tree.
+	Util::PerformanceProfiler agentTreeBuildProfiler_;
+	/// Counts and times every refit of the agent tree, including refits that were followed by a rebuild.
+	Util::PerformanceProfiler agentTreeRefitProfiler_;
+
+	/// Worker threads for building the trees, or NULL to build them serially.
+	Util::ThreadedTaskManager * buildTaskManager_;
+	unsigned int numBuildThreads_;
+
+	/// An agent subtree or an obstacle subtree handed to a build task.
+	struct BuildTask {
+		KdTree * tree;
+		size_t begin, end, node;
+		std::vector<ObstacleInterface *> obstacles;
+		ObstacleInterfaceTreeNode ** obstacleNode;
+	};
+	/// A slice of the candidates of an obstacle split search handed to a build task.
+	struct SplitSearchTask {
+		const KdTree * tree;
+		const std::vector<ObstacleInterface *> * obstacles;
+		size_t begin, end;
+		size_t optimalSplit, minLeft, minRight;
+	};
+
+	/// Splits the top levels of the agent tree serially, adding the subtrees below them to tasks.
+	void splitAgentTreeTopLevels(size_t begin, size_t end, size_t node, size_t numSubtrees, std::vector<BuildTask> & tasks);
+	/// Builds the top levels of the obstacle tree, searching each split on all threads, and adds the smaller subtrees to tasks.
+	void buildObstacleTreeTopLevels(const std::vector<ObstacleInterface *> & obstacles, ObstacleInterfaceTreeNode ** result, std::vector<BuildTask> & tasks);
+	/// Runs each task on the worker threads and waits for all of them.
+	void runBuildTasks(std::vector<BuildTask> & tasks, Util::TaskFunctionPtr function);
+
+	static void _buildAgentSubtreeTask(unsigned int threadIndex, void * data);
+	static void _buildObstacleSubtreeTask(unsigned int threadIndex, void * data);
+	static void _searchObstacleSplitTask(unsigned int threadIndex, void * data);
 	ObstacleInterfaceTreeNode *obstacleTree_;
 	SteerLib::EngineInterface * sim_;
 
 	void setSimulator(SteerLib::EngineInterface * sim_);
 
-	friend class RVO2Agent;
-	friend class RVO2AIModule;
+	friend class RVO2DAgent;
+	friend class RVO2DAIModule;
 	friend class RVOSimulator;
 	friend class SpatialDataBaseInterface;
 
 
 	static const size_t MAX_LEAF_SIZE = 10;
+	/// Agent subtrees smaller than this are built by a single task.
+	static const size_t MIN_AGENTS_PER_BUILD_TASK = 2048;
+	/// Obstacle tree nodes with at least this many obstacles search for their split on all threads.
+	static const size_t MIN_OBSTACLES_FOR_PARALLEL_SPLIT = 256;
 	/**
 	 * \brief   Constructs a <i>k</i>d-tree instance.
 	 * \param   sim  The simulator instance.
@@ -43,6 +43,18 @@ namespace SteerLib
 
 		void buildObstacleTree();
 		void buildAgentTree();
+		/// Refits or rebuilds the agent tree, see KdTree::updateAgentTree().
+		void updateAgentTree();
+		/// Enables or disables refitting the agent tree instead of rebuilding it every frame.
+		void setAgentTreeRefit(bool refit, float rebuildThreshold);
+		/// Sets the number of threads used to build the agent and obstacle trees.
+		void setBuildThreads(unsigned int numThreads);
+		/// Counts and times the full builds of the agent tree.
+		Util::PerformanceProfiler & getAgentTreeBuildProfiler();
+		/// Counts and times the refits of the agent tree.
+		Util::PerformanceProfiler & getAgentTreeRefitProfiler();
+		/// Returns the kd-tree itself, so that AI modules can share it instead of building their own.
+		inline KdTree * getKdTree() { return _spatialDatabase; }
 
 		/// Returns the x value of the "top-left" corner of the database.
 		inline float getOriginX() { return _xOrigin; }
@@ -121,8 +133,15 @@ namespace SteerLib
 		 */
 		void computeObstacleNeighbors(SpatialDatabaseItemPtr agent, float rangeSq) const;
 
+		/// Finds the k nearest agents with a bounded walk of the agent tree; the tree must have been built this frame.
+		void getKNearestAgents(std::vector<std::pair<float, const AgentInterface *> > & neighbors, const Util::Point & position, unsigned int k, float maxRange, SpatialDatabaseItemPtr exclude);
+
 		/// Returns an STL set of objects in the specified range, culling agent objects to a hemisphere centered around the facingDirection.
 		void getItemsInVisualField(std::set<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude, const Util::Point & position, const Util::Vector & facingDirection, float radiusSquared) {}
+		/// Fills a reusable flat buffer with the enabled agent neighbors and obstacle neighbors of exclude, sorted by pointer.
+		void getItemsInRange(std::vector<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude);
+		/// Visual field queries are not supported by the kd-tree; always returns an empty buffer.
+		void getItemsInVisualField(std::vector<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude, const Util::Point & position, const Util::Vector & facingDirection, float radiusSquared) { neighborList.clear(); }
 		//@}
 
 		/// @name Ray tracing queries
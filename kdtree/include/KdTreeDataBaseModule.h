@@ -72,6 +72,10 @@ protected:
 
 	size_t _neighbour_size;
 
+	/// If true, the agent tree is refit each frame instead of rebuilt, see KdTree::updateAgentTree().
+	bool _refitAgentTree;
+	float _rebuildThreshold;
+
 	std::string _meshFileName;
 	SteerLib::KdTreeDataBase * _spatialDatabase;
 };
@@ -68,7 +68,8 @@
 
 using namespace Util;
 
-KdTree::KdTree(): obstacleTree_(NULL)
+KdTree::KdTree(): refitAgentTree_(false), rebuildThreshold_(DEFAULT_KDTREE_REBUILD_THRESHOLD), builtAgentTreeCost_(0.0f),
+	buildTaskManager_(NULL), numBuildThreads_(1), obstacleTree_(NULL)
 {
 
 }
@@ -76,10 +77,23 @@ KdTree::KdTree(): obstacleTree_(NULL)
 KdTree::~KdTree()
 {
 	deleteObstacleTree(obstacleTree_);
+	delete buildTaskManager_;
+}
+
+void KdTree::setBuildThreads(unsigned int numThreads)
+{
+	delete buildTaskManager_;
+	buildTaskManager_ = NULL;
+	numBuildThreads_ = std::max(numThreads, 1u);
+
+	if (numBuildThreads_ > 1) {
+		buildTaskManager_ = new Util::ThreadedTaskManager(numBuildThreads_);
+	}
 }
 
 void KdTree::buildAgentTree()
 {
+	agentTreeBuildProfiler_.start();
 	// agents_ =  (sim_->getAgents());
 	agents_.clear();
 	for(unsigned int i = agents_.size() ; i < sim_->getAgents().size(); i++)
@@ -97,9 +111,109 @@ void KdTree::buildAgentTree()
 	// std::cout << "There are this many agents: " << agents_.size() << std::endl;
 	if (!agents_.empty()) {
 		agentTree_.resize(2 * agents_.size() - 1);
-		buildAgentTreeRecursive(0, agents_.size(), 0);
+		if (buildTaskManager_ != NULL && agents_.size() >= 2 * MIN_AGENTS_PER_BUILD_TASK) {
+			// a few subtrees per thread, so that uneven subtrees still keep every thread busy.
+			std::vector<BuildTask> tasks;
+			splitAgentTreeTopLevels(0, agents_.size(), 0, 4 * numBuildThreads_, tasks);
+			runBuildTasks(tasks, _buildAgentSubtreeTask);
+		}
+		else {
+			buildAgentTreeRecursive(0, agents_.size(), 0);
+		}
+		builtAgentTreeCost_ = agentTreeCostRecursive(0) / std::max(agentTreeRootSize(), RVO_EPSILON);
 	}
 	// std::cout << "agent Tree size build: " << agentTree_.size() << std::endl;
+	agentTreeBuildProfiler_.stop();
+}
+
+void KdTree::updateAgentTree()
+{
+	// KdTreeDataBase::addObject() and removeObject() change agents_ without building, so first make sure the tree covers all of agents_.
+	if (!refitAgentTree_ || agents_.empty() || agentTree_.size() != 2 * agents_.size() - 1) {
+		buildAgentTree();
+		return;
+	}
+
+	// the tree can be refit as long as agents_ still holds exactly the enabled agents; the order does not matter
+	// for correctness, only for quality.  agents_ may point to agents the engine has destroyed since the last
+	// build, so only the engine's list is dereferenced and agents_ is compared by pointer.
+	const std::vector<SteerLib::AgentInterface*> & agents = sim_->getAgents();
+	sortedEnabledAgents_.clear();
+	for (size_t i = 0; i < agents.size(); ++i) {
+		if (agents[i]->enabled()) {
+			sortedEnabledAgents_.push_back(agents[i]);
+		}
+	}
+	bool sameAgents = (sortedEnabledAgents_.size() == agents_.size());
+	if (sameAgents) {
+		sortedTreeAgents_.assign(agents_.begin(), agents_.end());
+		std::sort(sortedTreeAgents_.begin(), sortedTreeAgents_.end());
+		std::sort(sortedEnabledAgents_.begin(), sortedEnabledAgents_.end());
+		sameAgents = (sortedTreeAgents_ == sortedEnabledAgents_);
+	}
+	if (!sameAgents) {
+		buildAgentTree();
+		return;
+	}
+
+	agentTreeRefitProfiler_.start();
+	// relative to the root box, so that a crowd that merely spreads out or contracts keeps its cost.
+	const float cost = refitAgentTreeRecursive(0) / std::max(agentTreeRootSize(), RVO_EPSILON);
+	agentTreeRefitProfiler_.stop();
+
+	if (cost > rebuildThreshold_ * builtAgentTreeCost_) {
+		buildAgentTree();
+	}
+}
+
+void KdTree::setAgentTreeRefit(bool refit, float rebuildThreshold)
+{
+	refitAgentTree_ = refit;
+	rebuildThreshold_ = rebuildThreshold;
+}
+
+float KdTree::refitAgentTreeRecursive(size_t node)
+{
+	AgentInterfaceTreeNode & treeNode = agentTree_[node];
+
+	if (treeNode.end - treeNode.begin > MAX_LEAF_SIZE) {
+		const float cost = refitAgentTreeRecursive(treeNode.left) + refitAgentTreeRecursive(treeNode.right);
+		const AgentInterfaceTreeNode & left = agentTree_[treeNode.left];
+		const AgentInterfaceTreeNode & right = agentTree_[treeNode.right];
+		treeNode.minX = std::min(left.minX, right.minX);
+		treeNode.maxX = std::max(left.maxX, right.maxX);
+		treeNode.minY = std::min(left.minY, right.minY);
+		treeNode.maxY = std::max(left.maxY, right.maxY);
+		return cost + (treeNode.maxX - treeNode.minX) + (treeNode.maxY - treeNode.minY);
+	}
+
+	const Util::Point first = agents_[treeNode.begin]->position();
+	treeNode.minX = treeNode.maxX = first.x;
+	treeNode.minY = treeNode.maxY = first.z;
+	for (size_t i = treeNode.begin + 1; i < treeNode.end; ++i) {
+		const Util::Point p = agents_[i]->position();
+		treeNode.maxX = std::max(treeNode.maxX, p.x);
+		treeNode.minX = std::min(treeNode.minX, p.x);
+		treeNode.maxY = std::max(treeNode.maxY, p.z);
+		treeNode.minY = std::min(treeNode.minY, p.z);
+	}
+	return (treeNode.maxX - treeNode.minX) + (treeNode.maxY - treeNode.minY);
+}
+
+float KdTree::agentTreeRootSize() const
+{
+	return (agentTree_[0].maxX - agentTree_[0].minX) + (agentTree_[0].maxY - agentTree_[0].minY);
+}
+
+float KdTree::agentTreeCostRecursive(size_t node) const
+{
+	const AgentInterfaceTreeNode & treeNode = agentTree_[node];
+	float cost = (treeNode.maxX - treeNode.minX) + (treeNode.maxY - treeNode.minY);
+
+	if (treeNode.end - treeNode.begin > MAX_LEAF_SIZE) {
+		cost += agentTreeCostRecursive(treeNode.left) + agentTreeCostRecursive(treeNode.right);
+	}
+	return cost;
 }
 /*
 void KdTree::buildAgentTree()
@@ -125,6 +239,48 @@ void KdTree::setSimulator(SteerLib::EngineInterface *sim_)
 }
 
 void KdTree::buildAgentTreeRecursive(size_t begin, size_t end, size_t node)
+{
+	const size_t left = splitAgentTreeNode(begin, end, node);
+
+	if (left != end) {
+		buildAgentTreeRecursive(begin, left, agentTree_[node].left);
+		buildAgentTreeRecursive(left, end, agentTree_[node].right);
+	}
+}
+
+/*
+ * Every subtree works on its own range of agents_ and its own range of agentTree_ (the nodes of a subtree with
+ * n agents are the 2n-1 entries starting at its root), so once the top levels are split, the subtrees can be
+ * built on separate threads.
+ */
+void KdTree::splitAgentTreeTopLevels(size_t begin, size_t end, size_t node, size_t numSubtrees, std::vector<BuildTask> &tasks)
+{
+	if (numSubtrees <= 1 || end - begin < 2 * MIN_AGENTS_PER_BUILD_TASK) {
+		BuildTask task;
+		task.tree = this;
+		task.begin = begin;
+		task.end = end;
+		task.node = node;
+		task.obstacleNode = NULL;
+		tasks.push_back(task);
+		return;
+	}
+
+	const size_t left = splitAgentTreeNode(begin, end, node);
+
+	if (left != end) {
+		splitAgentTreeTopLevels(begin, left, agentTree_[node].left, numSubtrees / 2, tasks);
+		splitAgentTreeTopLevels(left, end, agentTree_[node].right, numSubtrees - numSubtrees / 2, tasks);
+	}
+}
+
+void KdTree::_buildAgentSubtreeTask(unsigned int threadIndex, void *data)
+{
+	BuildTask *task = (BuildTask *)data;
+	task->tree->buildAgentTreeRecursive(task->begin, task->end, task->node);
+}
+
+size_t KdTree::splitAgentTreeNode(size_t begin, size_t end, size_t node)
 {
 	agentTree_[node].begin = begin;
 	agentTree_[node].end = end;
@@ -171,9 +327,10 @@ void KdTree::buildAgentTreeRecursive(size_t begin, size_t end, size_t node)
 		agentTree_[node].left = node + 1;
 		agentTree_[node].right = node + 2 * (left - begin);
 
-		buildAgentTreeRecursive(begin, left, agentTree_[node].left);
-		buildAgentTreeRecursive(left, end, agentTree_[node].right);
+		return left;
 	}
+
+	return end;
 }
 
 void KdTree::buildObstacleTree()
@@ -271,7 +428,15 @@ void KdTree::buildObstacleTree()
 		i1++;
 	}
 	// std::cout << "This many obstacles were created:" << obstacles_.size() << std::endl;
-	obstacleTree_ = buildObstacleTreeRecursive(obstacles_);
+	if (buildTaskManager_ != NULL && obstacles_.size() >= MIN_OBSTACLES_FOR_PARALLEL_SPLIT) {
+		obstacleTree_ = NULL;
+		std::vector<BuildTask> tasks;
+		buildObstacleTreeTopLevels(obstacles_, &obstacleTree_, tasks);
+		runBuildTasks(tasks, _buildObstacleSubtreeTask);
+	}
+	else {
+		obstacleTree_ = buildObstacleTreeRecursive(obstacles_);
+	}
 }
 
 KdTree::ObstacleInterfaceTreeNode *KdTree::buildObstacleTreeRecursive(const std::vector<ObstacleInterface *> &obstacles)
@@ -282,120 +447,223 @@ KdTree::ObstacleInterfaceTreeNode *KdTree::buildObstacleTreeRecursive(const std:
 	else {
 		ObstacleInterfaceTreeNode *const node = new ObstacleInterfaceTreeNode;
 
-		size_t optimalSplit = 0;
 		size_t minLeft = obstacles.size();
 		size_t minRight = obstacles.size();
-
-		for (size_t i = 0; i < obstacles.size(); ++i) {
-			size_t leftSize = 0;
-			size_t rightSize = 0;
-
-			const ObstacleInterface *const obstacleI1 = obstacles[i];
-			// std::cout << "So far i is: " << i << std::endl;
-			const ObstacleInterface *const obstacleI2 = obstacleI1->nextObstacle_;
-
-			/* Compute optimal split node. */
-			for (size_t j = 0; j < obstacles.size(); ++j) {
-				if (i == j) {
-					continue;
-				}
-
-				const ObstacleInterface *const obstacleJ1 = obstacles[j];
-				const ObstacleInterface *const obstacleJ2 = obstacleJ1->nextObstacle_;
-
-				const float j1LeftOfI = leftOf(obstacleI1->point_, obstacleI2->point_, obstacleJ1->point_);
-				const float j2LeftOfI = leftOf(obstacleI1->point_, obstacleI2->point_, obstacleJ2->point_);
-
-				if (j1LeftOfI >= -RVO_EPSILON && j2LeftOfI >= -RVO_EPSILON) {
-					++leftSize;
-				}
-				else if (j1LeftOfI <= RVO_EPSILON && j2LeftOfI <= RVO_EPSILON) {
-					++rightSize;
-				}
-				else {
-					++leftSize;
-					++rightSize;
-				}
-
-				if (std::make_pair(std::max(leftSize, rightSize), std::min(leftSize, rightSize)) >= std::make_pair(std::max(minLeft, minRight), std::min(minLeft, minRight))) {
-					break;
-				}
-			}
-
-			if (std::make_pair(std::max(leftSize, rightSize), std::min(leftSize, rightSize)) < std::make_pair(std::max(minLeft, minRight), std::min(minLeft, minRight))) {
-				minLeft = leftSize;
-				minRight = rightSize;
-				optimalSplit = i;
-			}
-		}
+		const size_t optimalSplit = findObstacleSplit(obstacles, 0, obstacles.size(), 0, minLeft, minRight);
 
 		/* Build split node. */
-		std::vector<ObstacleInterface *> leftObstacles(minLeft);
-		std::vector<ObstacleInterface *> rightObstacles(minRight);
+		std::vector<ObstacleInterface *> leftObstacles;
+		std::vector<ObstacleInterface *> rightObstacles;
+		partitionObstacles(obstacles, optimalSplit, minLeft, minRight, leftObstacles, rightObstacles);
 
-		size_t leftCounter = 0;
-		size_t rightCounter = 0;
-		const size_t i = optimalSplit;
+		node->obstacle = obstacles[optimalSplit];
+		node->left = buildObstacleTreeRecursive(leftObstacles);
+		node->right = buildObstacleTreeRecursive(rightObstacles);
+		return node;
+	}
+}
+
+size_t KdTree::findObstacleSplit(const std::vector<ObstacleInterface *> &obstacles, size_t begin, size_t end,
+								 size_t optimalSplit, size_t &minLeft, size_t &minRight) const
+{
+	for (size_t i = begin; i < end; ++i) {
+		size_t leftSize = 0;
+		size_t rightSize = 0;
 
 		const ObstacleInterface *const obstacleI1 = obstacles[i];
 		const ObstacleInterface *const obstacleI2 = obstacleI1->nextObstacle_;
 
+		/* Compute optimal split node. */
 		for (size_t j = 0; j < obstacles.size(); ++j) {
 			if (i == j) {
 				continue;
 			}
 
-			ObstacleInterface *const obstacleJ1 = obstacles[j];
-			ObstacleInterface *const obstacleJ2 = obstacleJ1->nextObstacle_;
+			const ObstacleInterface *const obstacleJ1 = obstacles[j];
+			const ObstacleInterface *const obstacleJ2 = obstacleJ1->nextObstacle_;
 
 			const float j1LeftOfI = leftOf(obstacleI1->point_, obstacleI2->point_, obstacleJ1->point_);
 			const float j2LeftOfI = leftOf(obstacleI1->point_, obstacleI2->point_, obstacleJ2->point_);
 
 			if (j1LeftOfI >= -RVO_EPSILON && j2LeftOfI >= -RVO_EPSILON) {
-				leftObstacles[leftCounter++] = obstacles[j];
+				++leftSize;
 			}
 			else if (j1LeftOfI <= RVO_EPSILON && j2LeftOfI <= RVO_EPSILON) {
-				rightObstacles[rightCounter++] = obstacles[j];
+				++rightSize;
 			}
 			else {
-				/* Split obstacle j. */
-				const float t = det(obstacleI2->point_ - obstacleI1->point_, obstacleJ1->point_ - obstacleI1->point_) / det(obstacleI2->point_ - obstacleI1->point_, obstacleJ1->point_ - obstacleJ2->point_);
+				++leftSize;
+				++rightSize;
+			}
 
-				const Util::Point splitpoint = obstacleJ1->point_ + t * (obstacleJ2->point_ - obstacleJ1->point_);
+			if (std::make_pair(std::max(leftSize, rightSize), std::min(leftSize, rightSize)) >= std::make_pair(std::max(minLeft, minRight), std::min(minLeft, minRight))) {
+				break;
+			}
+		}
 
-				ObstacleInterface *const newObstacle = new Obstacle();
-				newObstacle->point_ = splitpoint;
-				newObstacle->prevObstacle_ = obstacleJ1;
-				newObstacle->nextObstacle_ = obstacleJ2;
-				newObstacle->isConvex_ = true;
-				newObstacle->unitDir_ = obstacleJ1->unitDir_;
+		if (std::make_pair(std::max(leftSize, rightSize), std::min(leftSize, rightSize)) < std::make_pair(std::max(minLeft, minRight), std::min(minLeft, minRight))) {
+			minLeft = leftSize;
+			minRight = rightSize;
+			optimalSplit = i;
+		}
+	}
 
-				// newObstacle->id_ = sim_->obstacles_.size();
-				// TODO Possible point of error
-				// don't know why the agent is adding obstacles to the simulation
-				//sim_->obstacles_.push_back(newObstacle);
+	return optimalSplit;
+}
 
-				obstacleJ1->nextObstacle_ = newObstacle;
-				obstacleJ2->prevObstacle_ = newObstacle;
+void KdTree::partitionObstacles(const std::vector<ObstacleInterface *> &obstacles, size_t split, size_t minLeft, size_t minRight,
+								std::vector<ObstacleInterface *> &leftObstacles, std::vector<ObstacleInterface *> &rightObstacles)
+{
+	leftObstacles.resize(minLeft);
+	rightObstacles.resize(minRight);
 
-				if (j1LeftOfI > 0.0f) {
-					leftObstacles[leftCounter++] = obstacleJ1;
-					rightObstacles[rightCounter++] = newObstacle;
-				}
-				else {
-					rightObstacles[rightCounter++] = obstacleJ1;
-					leftObstacles[leftCounter++] = newObstacle;
-				}
+	size_t leftCounter = 0;
+	size_t rightCounter = 0;
+	const size_t i = split;
+
+	const ObstacleInterface *const obstacleI1 = obstacles[i];
+	const ObstacleInterface *const obstacleI2 = obstacleI1->nextObstacle_;
+
+	for (size_t j = 0; j < obstacles.size(); ++j) {
+		if (i == j) {
+			continue;
+		}
+
+		ObstacleInterface *const obstacleJ1 = obstacles[j];
+		ObstacleInterface *const obstacleJ2 = obstacleJ1->nextObstacle_;
+
+		const float j1LeftOfI = leftOf(obstacleI1->point_, obstacleI2->point_, obstacleJ1->point_);
+		const float j2LeftOfI = leftOf(obstacleI1->point_, obstacleI2->point_, obstacleJ2->point_);
+
+		if (j1LeftOfI >= -RVO_EPSILON && j2LeftOfI >= -RVO_EPSILON) {
+			leftObstacles[leftCounter++] = obstacles[j];
+		}
+		else if (j1LeftOfI <= RVO_EPSILON && j2LeftOfI <= RVO_EPSILON) {
+			rightObstacles[rightCounter++] = obstacles[j];
+		}
+		else {
+			/* Split obstacle j. */
+			const float t = det(obstacleI2->point_ - obstacleI1->point_, obstacleJ1->point_ - obstacleI1->point_) / det(obstacleI2->point_ - obstacleI1->point_, obstacleJ1->point_ - obstacleJ2->point_);
+
+			const Util::Point splitpoint = obstacleJ1->point_ + t * (obstacleJ2->point_ - obstacleJ1->point_);
+
+			ObstacleInterface *const newObstacle = new Obstacle();
+			newObstacle->point_ = splitpoint;
+			newObstacle->prevObstacle_ = obstacleJ1;
+			newObstacle->nextObstacle_ = obstacleJ2;
+			newObstacle->isConvex_ = true;
+			newObstacle->unitDir_ = obstacleJ1->unitDir_;
+
+			// newObstacle->id_ = sim_->obstacles_.size();
+			// TODO Possible point of error
+			// don't know why the agent is adding obstacles to the simulation
+			//sim_->obstacles_.push_back(newObstacle);
+
+			obstacleJ1->nextObstacle_ = newObstacle;
+			obstacleJ2->prevObstacle_ = newObstacle;
+
+			if (j1LeftOfI > 0.0f) {
+				leftObstacles[leftCounter++] = obstacleJ1;
+				rightObstacles[rightCounter++] = newObstacle;
+			}
+			else {
+				rightObstacles[rightCounter++] = obstacleJ1;
+				leftObstacles[leftCounter++] = newObstacle;
 			}
 		}
+	}
+}
 
-		node->obstacle = obstacleI1;
-		node->left = buildObstacleTreeRecursive(leftObstacles);
-		node->right = buildObstacleTreeRecursive(rightObstacles);
-		return node;
+/*
+ * The obstacles on either side of a split are disjoint, and building a subtree only changes the nextObstacle_ of
+ * its own obstacles and the prevObstacle_ of the obstacles that follow them, which no other subtree touches.
+ * Subtrees can therefore be built on separate threads, and the tree comes out the same as the serial build.
+ */
+void KdTree::buildObstacleTreeTopLevels(const std::vector<ObstacleInterface *> &obstacles, ObstacleInterfaceTreeNode **result, std::vector<BuildTask> &tasks)
+{
+	if (obstacles.size() < MIN_OBSTACLES_FOR_PARALLEL_SPLIT) {
+		BuildTask task;
+		task.tree = this;
+		task.obstacles = obstacles;
+		task.obstacleNode = result;
+		tasks.push_back(task);
+		return;
+	}
+
+	// each thread searches one slice of the candidates; merging the slices in order, keeping only strictly better
+	// splits, picks the same split as the serial search.
+	const size_t numObstacles = obstacles.size();
+	const size_t sliceSize = (numObstacles + numBuildThreads_ - 1) / numBuildThreads_;
+	std::vector<SplitSearchTask> searches(numBuildThreads_);
+	for (unsigned int t = 0; t < numBuildThreads_; ++t) {
+		searches[t].tree = this;
+		searches[t].obstacles = &obstacles;
+		searches[t].begin = std::min(t * sliceSize, numObstacles);
+		searches[t].end = std::min((t + 1) * sliceSize, numObstacles);
+		searches[t].optimalSplit = 0;
+		searches[t].minLeft = numObstacles;
+		searches[t].minRight = numObstacles;
+
+		Util::Task task;
+		task.function = _searchObstacleSplitTask;
+		task.data = &searches[t];
+		buildTaskManager_->addTask(task, false);
+	}
+	buildTaskManager_->wakeUpAllSleepingWorkerThreads();
+	buildTaskManager_->waitForAllTasksToComplete();
+
+	size_t optimalSplit = 0;
+	size_t minLeft = numObstacles;
+	size_t minRight = numObstacles;
+	for (unsigned int t = 0; t < numBuildThreads_; ++t) {
+		if (std::make_pair(std::max(searches[t].minLeft, searches[t].minRight), std::min(searches[t].minLeft, searches[t].minRight)) < std::make_pair(std::max(minLeft, minRight), std::min(minLeft, minRight))) {
+			minLeft = searches[t].minLeft;
+			minRight = searches[t].minRight;
+			optimalSplit = searches[t].optimalSplit;
+		}
 	}
+
+	ObstacleInterfaceTreeNode *const node = new ObstacleInterfaceTreeNode;
+	std::vector<ObstacleInterface *> leftObstacles;
+	std::vector<ObstacleInterface *> rightObstacles;
+	partitionObstacles(obstacles, optimalSplit, minLeft, minRight, leftObstacles, rightObstacles);
+
+	node->obstacle = obstacles[optimalSplit];
+	node->left = NULL;
+	node->right = NULL;
+	*result = node;
+
+	buildObstacleTreeTopLevels(leftObstacles, &node->left, tasks);
+	buildObstacleTreeTopLevels(rightObstacles, &node->right, tasks);
 }
 
+void KdTree::_searchObstacleSplitTask(unsigned int threadIndex, void *data)
+{
+	SplitSearchTask *search = (SplitSearchTask *)data;
+	search->optimalSplit = search->tree->findObstacleSplit(*search->obstacles, search->begin, search->end, search->optimalSplit, search->minLeft, search->minRight);
+}
+
+void KdTree::_buildObstacleSubtreeTask(unsigned int threadIndex, void *data)
+{
+	BuildTask *task = (BuildTask *)data;
+	*task->obstacleNode = task->tree->buildObstacleTreeRecursive(task->obstacles);
+}
+
+void KdTree::runBuildTasks(std::vector<BuildTask> &tasks, Util::TaskFunctionPtr function)
+{
+	if (tasks.empty()) {
+		return;
+	}
+
+	for (size_t i = 0; i < tasks.size(); ++i) {
+		Util::Task task;
+		task.function = function;
+		task.data = &tasks[i];
+		buildTaskManager_->addTask(task, false);
+	}
+	buildTaskManager_->wakeUpAllSleepingWorkerThreads();
+	buildTaskManager_->waitForAllTasksToComplete();
+}
 
 
 void KdTree::computeAgentNeighbors(SpatialDatabaseItemPtr agent, float rangeSq) const
@@ -403,6 +671,13 @@ void KdTree::computeAgentNeighbors(SpatialDatabaseItemPtr agent, float rangeSq)
 	queryAgentTreeRecursive(dynamic_cast<AgentInterface*>(agent), rangeSq, 0);
 }
 
+void KdTree::computeKNearestAgents(std::vector<std::pair<float, const SteerLib::AgentInterface *> > & neighbors, const Util::Point & position, unsigned int k, float rangeSq, SpatialDatabaseItemPtr exclude) const
+{
+	neighbors.clear();
+	if ((k == 0) || agentTree_.empty()) return;
+	queryKNearestAgentsRecursive(neighbors, position, k, rangeSq, exclude, 0);
+}
+
 void KdTree::computeObstacleNeighbors(SpatialDatabaseItemPtr agent, float rangeSq) const
 {
 	dynamic_cast<AgentInterface*>(agent)->obstacleNeighbors_.clear();
@@ -460,6 +735,42 @@ void KdTree::queryAgentTreeRecursive(SteerLib::AgentInterface  *agent, float &ra
 	}
 }
 
+void KdTree::queryKNearestAgentsRecursive(std::vector<std::pair<float, const SteerLib::AgentInterface *> > & neighbors, const Util::Point & position,
+									unsigned int k, float &rangeSq, SpatialDatabaseItemPtr exclude, size_t node) const
+{
+	if (agentTree_[node].end - agentTree_[node].begin <= MAX_LEAF_SIZE) {
+		for (size_t i = agentTree_[node].begin; i < agentTree_[node].end && (i < agents_.size()); ++i) {
+			if ((agents_[i] != exclude) && agents_[i]->enabled()) {
+				SteerLib::SpatialDataBaseInterface::insertNearestAgent(neighbors, k, (agents_[i]->position() - position).lengthSquared(), agents_[i], rangeSq);
+			}
+		}
+		return;
+	}
+
+	const AgentInterfaceTreeNode & left = agentTree_[agentTree_[node].left];
+	const AgentInterfaceTreeNode & right = agentTree_[agentTree_[node].right];
+	const float distSqLeft = sqr(std::max(0.0f, left.minX - position.x)) + sqr(std::max(0.0f, position.x - left.maxX)) + sqr(std::max(0.0f, left.minY - position.z)) + sqr(std::max(0.0f, position.z - left.maxY));
+	const float distSqRight = sqr(std::max(0.0f, right.minX - position.x)) + sqr(std::max(0.0f, position.x - right.maxX)) + sqr(std::max(0.0f, right.minY - position.z)) + sqr(std::max(0.0f, position.z - right.maxY));
+
+	// visit the nearer child first; rangeSq shrinks as the list fills up, which usually prunes the other one.
+	if (distSqLeft < distSqRight) {
+		if (distSqLeft < rangeSq) {
+			queryKNearestAgentsRecursive(neighbors, position, k, rangeSq, exclude, agentTree_[node].left);
+			if (distSqRight < rangeSq) {
+				queryKNearestAgentsRecursive(neighbors, position, k, rangeSq, exclude, agentTree_[node].right);
+			}
+		}
+	}
+	else {
+		if (distSqRight < rangeSq) {
+			queryKNearestAgentsRecursive(neighbors, position, k, rangeSq, exclude, agentTree_[node].right);
+			if (distSqLeft < rangeSq) {
+				queryKNearestAgentsRecursive(neighbors, position, k, rangeSq, exclude, agentTree_[node].left);
+			}
+		}
+	}
+}
+
 void KdTree::queryObstacleTreeRecursive(SteerLib::AgentInterface *agent, float rangeSq, const ObstacleInterfaceTreeNode *node) const
 {
 	if (node == NULL) {
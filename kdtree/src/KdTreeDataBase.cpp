@@ -20,6 +20,7 @@ using namespace SteerLib;
 #include "util/DrawLib.h"
 
 #include <vector>
+#include <algorithm>
 #include <cmath>
 #include <ctime>
 
@@ -77,6 +78,36 @@ void KdTreeDataBase::getItemsInRange(std::set<SpatialDatabaseItemPtr> & neighbor
 
 }
 
+void KdTreeDataBase::getItemsInRange(std::vector<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude)
+{
+	neighborList.clear();
+	AgentInterface * agent = dynamic_cast<AgentInterface*>(exclude);
+	if ( agent == NULL )
+	{
+		std::cout << "agent pointer is null for get neighbours" << std::endl;
+		return;
+	}
+
+	// sorted and made unique so that callers see the same items, in the same order, as with the STL set version.
+	this->_spatialDatabase->computeAgentNeighbors(agent, 10.0f );
+	for (size_t a=0; a < agent->agentNeighbors_.size(); a++)
+	{
+		if (const_cast<AgentInterface*>(agent->agentNeighbors_[a].second)->enabled())
+		{
+			neighborList.push_back(const_cast<AgentInterface*>(agent->agentNeighbors_[a].second));
+		}
+	}
+
+	this->_spatialDatabase->computeObstacleNeighbors(agent, 10.0f );
+	for (size_t a=0; a < agent->obstacleNeighbors_.size(); a++)
+	{
+		neighborList.push_back(const_cast<ObstacleInterface*>(agent->obstacleNeighbors_[a].second));
+	}
+
+	std::sort(neighborList.begin(), neighborList.end());
+	neighborList.erase(std::unique(neighborList.begin(), neighborList.end()), neighborList.end());
+}
+
 
 void KdTreeDataBase::draw()
 {
@@ -95,6 +126,31 @@ void KdTreeDataBase::buildAgentTree()
 	_spatialDatabase->buildAgentTree();
 }
 
+void KdTreeDataBase::updateAgentTree()
+{
+	_spatialDatabase->updateAgentTree();
+}
+
+void KdTreeDataBase::setAgentTreeRefit(bool refit, float rebuildThreshold)
+{
+	_spatialDatabase->setAgentTreeRefit(refit, rebuildThreshold);
+}
+
+void KdTreeDataBase::setBuildThreads(unsigned int numThreads)
+{
+	_spatialDatabase->setBuildThreads(numThreads);
+}
+
+Util::PerformanceProfiler & KdTreeDataBase::getAgentTreeBuildProfiler()
+{
+	return _spatialDatabase->agentTreeBuildProfiler_;
+}
+
+Util::PerformanceProfiler & KdTreeDataBase::getAgentTreeRefitProfiler()
+{
+	return _spatialDatabase->agentTreeRefitProfiler_;
+}
+
 Util::Point KdTreeDataBase::randomPositionWithoutCollisions(float radius, bool excludeAgents)
 {
 	srand (static_cast <unsigned> (time(0)));
@@ -270,6 +326,11 @@ void KdTreeDataBase::computeObstacleNeighbors(SpatialDatabaseItemPtr agent, floa
 }
 
 
+void KdTreeDataBase::getKNearestAgents(std::vector<std::pair<float, const AgentInterface *> > & neighbors, const Util::Point & position, unsigned int k, float maxRange, SpatialDatabaseItemPtr exclude)
+{
+	this->_spatialDatabase->computeKNearestAgents(neighbors, position, k, maxRange * maxRange, exclude);
+}
+
 void KdTreeDataBase::clearDatabase()
 {
 	this->_spatialDatabase->agents_.clear();
@@ -31,7 +31,8 @@ void KdTreeDataBaseModule::init( const SteerLib::OptionDictionary & options, Ste
 {
 
 	_engine = engineInfo;
-
+	_refitAgentTree = false;
+	_rebuildThreshold = DEFAULT_KDTREE_REBUILD_THRESHOLD;
 
 	// iterate over all the options
 	SteerLib::OptionDictionary::const_iterator optionIter;
@@ -42,6 +43,12 @@ void KdTreeDataBaseModule::init( const SteerLib::OptionDictionary & options, Ste
 		else if ((*optionIter).first == "saveGeometry") {
 			_meshFileName = (*optionIter).second;
 		}
+		else if ((*optionIter).first == "kdtree_refit") {
+			_refitAgentTree = Util::getBoolFromString((*optionIter).second);
+		}
+		else if ((*optionIter).first == "kdtree_rebuild_threshold") {
+			_rebuildThreshold = (float)atof((*optionIter).second.c_str());
+		}
 		else {
 			throw Util::GenericException("unrecognized option \"" + Util::toString((*optionIter).first) + "\" given to navmesh module.");
 		}
@@ -53,6 +60,9 @@ void KdTreeDataBaseModule::init( const SteerLib::OptionDictionary & options, Ste
 	float zmin = -(_engine->getOptions().gridDatabaseOptions.gridSizeZ / 2.0f);
 	float zmax = (_engine->getOptions().gridDatabaseOptions.gridSizeZ / 2.0f);
 	this->_spatialDatabase = new KdTreeDataBase(_engine, xmin, xmax, zmin, zmax);
+	this->_spatialDatabase->setAgentTreeRefit(_refitAgentTree, _rebuildThreshold);
+	// the trees are built between frames, while the engine's own worker threads are idle.
+	this->_spatialDatabase->setBuildThreads(_engine->getOptions().engineOptions.numThreads);
 
 	// this->_spatialDatabase->buildAgentTree();
 	std::cout << "KdTreeDataBaseModule inited: " << this->_spatialDatabase << std::endl;
@@ -73,7 +83,7 @@ void KdTreeDataBaseModule::preprocessFrame(float timeStamp, float dt, unsigned i
 		this->_spatialDatabase->buildObstacleTree();
 	}
 
-	this->_spatialDatabase->buildAgentTree();
+	this->_spatialDatabase->updateAgentTree();
 }
 
 void KdTreeDataBaseModule::postprocessFrame(float timeStamp, float dt, unsigned int frameNumber)
@@ -86,7 +96,10 @@ void KdTreeDataBaseModule::postprocessFrame(float timeStamp, float dt, unsigned
 
 void KdTreeDataBaseModule::postprocessSimulation()
 {
-
+	Util::PerformanceProfiler & buildProfiler = _spatialDatabase->getAgentTreeBuildProfiler();
+	Util::PerformanceProfiler & refitProfiler = _spatialDatabase->getAgentTreeRefitProfiler();
+	std::cout << "KdTreeDataBaseModule agent tree: " << buildProfiler.getNumTimesExecuted() << " builds (" << buildProfiler.getTotalTime() << " s), "
+		<< refitProfiler.getNumTimesExecuted() << " refits (" << refitProfiler.getTotalTime() << " s)" << std::endl;
 }
 
 
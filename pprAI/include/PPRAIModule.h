@@ -43,6 +43,9 @@ namespace PPRGlobals {
 	extern unsigned int gReactivePhaseInterval;
 	extern unsigned int gPerceptivePhaseInterval;
 	extern bool gUseDynamicPhaseScheduling;
+	extern bool gStaggerPhases;
+	extern unsigned int gLongTermPlanningPhaseBudget;
+	extern unsigned int gPredictivePhaseBudget;
 	extern bool gShowStats;
 	extern bool gShowAllStats;
 	extern bool dont_plan;
@@ -110,8 +113,23 @@ public:
 
 	void initializeSimulation();
 	void cleanupSimulation();
+	/// Hands out the per-frame budgets of the long-term planning and predictive phases, see _deferPhasesOverBudget().
+	void preprocessFrame(float timeStamp, float dt, unsigned int frameNumber);
 
 private:
+	/**
+	 * @brief Lets only the budget most overdue of the agents whose phase is due run it this frame.
+	 *
+	 * dueAgents holds, for each such agent, the frame the phase was scheduled for and the agent's index in the engine's agent list.
+	 * Agents that are left out keep their schedule, so they are more overdue than the ones that ran and go first next frame.
+	 * The other agents' allowed flags are cleared.
+	 */
+	void _deferPhasesOverBudget(std::vector< std::pair<unsigned int, unsigned int> > & dueAgents, unsigned int budget, bool PPRAgent::*allowed);
+
+	/// Reused between frames by preprocessFrame().
+	std::vector< std::pair<unsigned int, unsigned int> > _dueLongTermPlanningAgents;
+	std::vector< std::pair<unsigned int, unsigned int> > _duePredictiveAgents;
+
 	std::string logFilename;
 	Logger * _pprLogger;
 
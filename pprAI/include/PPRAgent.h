@@ -88,6 +88,7 @@ public:
 	void reset(const SteerLib::AgentInitialConditions & initialConditions, SteerLib::EngineInterface * engineInfo);
 	void updateAI(float timeStamp, float dt, unsigned int frameNumber);
 	void draw();
+	void receiveLongTermPlan(const Util::Point & goalLocation, const std::vector<Util::Point> & path, bool pathComplete);
 
 
 	bool enabled() const { return _enabled; }
@@ -146,6 +147,8 @@ protected:
 	// phases of AI computation; the ultimate output of these phases is a steering command.
 	void runCognitivePhase();
 	void runLongTermPlanningPhase();
+	// sets a waypoint every ped_next_waypoint_distance points along a long-term path, followed by the landmark target.
+	void setWaypointsFromLongTermPath(const std::vector<Util::Point> & longTermPath);
 	void runMidTermPlanningPhase();
 	void runShortTermPlanningPhase();
 	void runPerceptivePhase();
@@ -159,6 +162,8 @@ protected:
 	void doEulerStepWithForce(const Util::Vector & force); // updates _position, _velocity, and _currentSpeed
 	
 	// helper functions
+	// returns the first frame after lastFrame that a phase running every interval frames is scheduled; with stagger_phases, agents are spread evenly over the interval.
+	unsigned int nextFrameToRunPhase(unsigned int lastFrame, unsigned int interval) const;
 	bool updateReactiveFeelers( FeelerInfo & feelers );  // returns false if the 3 front rays don't intersect anything, even if the rside/lside rays do.
 	void collectObjectsInVisualField();
 	bool reachedCurrentGoal();
@@ -177,6 +182,7 @@ protected:
 
 	// LONG-TERM PLANNING PHASE
 	int _currentWaypointIndex;
+	bool _longTermPlanPending; // true from requesting a path of the PathPlanningService until receiveLongTermPlan() sets the waypoints.
 
 	// MID-TERM PLANNING PHASE
 	std::vector<Util::Point> _midTermPath;  // "+2" is a very terrible hack to avoid bugs.
@@ -186,7 +192,7 @@ protected:
 	Util::Point _localTargetLocation;
 
 	// PERCEPTION PHASE
-	std::set<SteerLib::SpatialDatabaseItemPtr> _neighbors;
+	std::vector<SteerLib::SpatialDatabaseItemPtr> _neighbors; // reused every frame, so the visual field query does not allocate.
 	unsigned int _numAgentsInVisualField;  // different than _neighbors.size(), which includes static objects.
 
 	// PREDICTION PHASE
@@ -228,6 +234,11 @@ protected:
 	unsigned int _framesToNextPredictivePhase;
 	unsigned int _framesToNextReactivePhase;
 
+	// set by PPRAIModule::preprocessFrame() when a per-frame phase budget is used:
+	// false if this agent's phase is due but has to wait for a later frame.
+	bool _longTermPlanningPhaseAllowed;
+	bool _predictivePhaseAllowed;
+
 
 	// GEOMETRY STATE of the agent (can potentially change per frame)
 	Util::Vector _rightSide;
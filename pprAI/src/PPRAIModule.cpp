@@ -8,6 +8,7 @@
 #include "SimulationPlugin.h"
 #include "PPRAIModule.h"
 #include "PPRAgent.h"
+#include <algorithm>
 
 
 
@@ -40,6 +41,9 @@ namespace PPRGlobals {
 	unsigned int gPerceptivePhaseInterval;
 
 	bool gUseDynamicPhaseScheduling;
+	bool gStaggerPhases;
+	unsigned int gLongTermPlanningPhaseBudget;
+	unsigned int gPredictivePhaseBudget;
 	bool gShowStats;
 	bool logStats;
 	bool gShowAllStats;
@@ -108,6 +112,9 @@ void PPRAIModule::init( const SteerLib::OptionDictionary & options, SteerLib::En
 	gPredictivePhaseInterval = PREDICTIVE_PHASE_INTERVAL;
 	gReactivePhaseInterval = REACTIVE_PHASE_INTERVAL;
 	gUseDynamicPhaseScheduling = false;
+	gStaggerPhases = false;
+	gLongTermPlanningPhaseBudget = 0;
+	gPredictivePhaseBudget = 0;
 	gShowStats = false;
 	logStats = false;
 	gShowAllStats = false;
@@ -185,6 +192,18 @@ void PPRAIModule::init( const SteerLib::OptionDictionary & options, SteerLib::En
 		{
 			gUseDynamicPhaseScheduling = Util::getBoolFromString(value.str());
 		}
+		else if ((*optionIter).first == "stagger_phases")
+		{
+			gStaggerPhases = Util::getBoolFromString(value.str());
+		}
+		else if ((*optionIter).first == "longplan_budget")
+		{
+			value >> gLongTermPlanningPhaseBudget;
+		}
+		else if ((*optionIter).first == "predictive_budget")
+		{
+			value >> gPredictivePhaseBudget;
+		}
 		else if ((*optionIter).first == "ped_max_speed")
 		{
 			value >> ped_max_speed;
@@ -389,6 +408,15 @@ void PPRAIModule::init( const SteerLib::OptionDictionary & options, SteerLib::En
 			std::cout << " predictive: " << "dynamic" << "\n";
 			std::cout << "   reactive: " << "dynamic" << "\n";
 		}
+		if (gStaggerPhases) {
+			std::cout << " phases staggered across agents\n";
+		}
+		if (gLongTermPlanningPhaseBudget > 0) {
+			std::cout << " longplan budget: " << gLongTermPlanningPhaseBudget << " agents per frame\n";
+		}
+		if (gPredictivePhaseBudget > 0) {
+			std::cout << " predictive budget: " << gPredictivePhaseBudget << " agents per frame\n";
+		}
 		std::cout << std::endl;
 	}
 
@@ -551,6 +579,56 @@ void PPRAIModule::initializeSimulation()
 }
 
 
+//
+// preprocessFrame()
+//
+void PPRAIModule::preprocessFrame(float timeStamp, float dt, unsigned int frameNumber)
+{
+	if ((gLongTermPlanningPhaseBudget == 0) && (gPredictivePhaseBudget == 0)) {
+		return;
+	}
+
+	// the same frame count that PPRAgent::updateAI() schedules with.
+	unsigned int currentFrame = frameNumber - 1;
+
+	// the agents are updated right after this, possibly on several threads; deciding here keeps the budget out of their way.
+	const std::vector<SteerLib::AgentInterface*> & agents = _gEngine->getAgents();
+	_dueLongTermPlanningAgents.clear();
+	_duePredictiveAgents.clear();
+	for (unsigned int i=0; i < agents.size(); i++) {
+		PPRAgent * agent = dynamic_cast<PPRAgent *>(agents[i]);
+		if (agent == NULL) continue;
+		agent->_longTermPlanningPhaseAllowed = true;
+		agent->_predictivePhaseAllowed = true;
+		if (!agent->enabled()) continue;
+		if ((gLongTermPlanningPhaseBudget > 0) && (currentFrame >= agent->_nextFrameToRunLongTermPlanningPhase)) {
+			_dueLongTermPlanningAgents.push_back(std::make_pair(agent->_nextFrameToRunLongTermPlanningPhase, i));
+		}
+		if ((gPredictivePhaseBudget > 0) && (currentFrame >= agent->_nextFrameToRunPredictivePhase)) {
+			_duePredictiveAgents.push_back(std::make_pair(agent->_nextFrameToRunPredictivePhase, i));
+		}
+	}
+
+	_deferPhasesOverBudget(_dueLongTermPlanningAgents, gLongTermPlanningPhaseBudget, &PPRAgent::_longTermPlanningPhaseAllowed);
+	_deferPhasesOverBudget(_duePredictiveAgents, gPredictivePhaseBudget, &PPRAgent::_predictivePhaseAllowed);
+}
+
+
+void PPRAIModule::_deferPhasesOverBudget(std::vector< std::pair<unsigned int, unsigned int> > & dueAgents, unsigned int budget, bool PPRAgent::*allowed)
+{
+	if ((budget == 0) || (dueAgents.size() <= budget)) {
+		return;
+	}
+
+	// the earliest scheduled frame first; agents scheduled for the same frame go in the order they were created.
+	std::nth_element(dueAgents.begin(), dueAgents.begin() + budget, dueAgents.end());
+	const std::vector<SteerLib::AgentInterface*> & agents = _gEngine->getAgents();
+	for (size_t i = budget; i < dueAgents.size(); i++) {
+		dynamic_cast<PPRAgent *>(agents[dueAgents[i].second])->*allowed = false;
+	}
+}
+
+
 //
 // cleanupSimulation()
 //
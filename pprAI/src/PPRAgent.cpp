@@ -156,6 +156,7 @@ void PPRAgent::reset(const SteerLib::AgentInitialConditions & initialConditions,
 	// LONG-TERM PLANNING PHASE
 	_waypoints.clear();
 	_currentWaypointIndex = 0;
+	_longTermPlanPending = false;
 
 	// MID-TERM PLANNING PHASE
 	_midTermPathSize = 0;
@@ -193,6 +194,8 @@ void PPRAgent::reset(const SteerLib::AgentInitialConditions & initialConditions,
 	_framesToNextPerceptivePhase = 1;
 	_framesToNextPredictivePhase = 1;
 	_framesToNextReactivePhase = 1;
+	_longTermPlanningPhaseAllowed = true;
+	_predictivePhaseAllowed = true;
 
 	// GEOMETRY STATE
 	// other geometry state was initialized above using the given initial conditions.
@@ -279,9 +282,19 @@ void PPRAgent::updateAI(float timeStamp, float dt, unsigned int frameNumber)
 	// run any phases that were scheduled for this frame.
 	//
 
+	bool longTermPlanningPhaseDeferred = false;
 	if (_currentFrameNumber >= _nextFrameToRunLongTermPlanningPhase) {
-		runLongTermPlanningPhase();
-		_lastFrameLongTermWasCalled = _currentFrameNumber;
+		if (_longTermPlanningPhaseAllowed) {
+			runLongTermPlanningPhase();
+			_lastFrameLongTermWasCalled = _currentFrameNumber;
+		}
+		else if (_waypoints.empty() && !dont_plan) {
+			// the other phases all follow the waypoints, so without a first plan the agent waits for its turn to plan.
+			return;
+		}
+		else {
+			longTermPlanningPhaseDeferred = true;
+		}
 	}
 
 
@@ -303,13 +316,19 @@ void PPRAgent::updateAI(float timeStamp, float dt, unsigned int frameNumber)
 	}
 
 
+	bool predictivePhaseDeferred = false;
 	if (_currentFrameNumber >= _nextFrameToRunPredictivePhase) {
+		if (_predictivePhaseAllowed) {
+			// MUBBASIR FOR REACTIVE APPROACH 
+			runPredictivePhase();
 
-		// MUBBASIR FOR REACTIVE APPROACH 
-		runPredictivePhase();
 
-
-		_lastFramePredictiveWasCalled = _currentFrameNumber;
+			_lastFramePredictiveWasCalled = _currentFrameNumber;
+		}
+		else {
+			// the reactive phase keeps using the threats predicted last time.
+			predictivePhaseDeferred = true;
+		}
 	}
 
 
@@ -324,21 +343,22 @@ void PPRAgent::updateAI(float timeStamp, float dt, unsigned int frameNumber)
 	}
 
 		
+	// deferred phases stay due, so that they run as soon as the budget allows.
 	if (gUseDynamicPhaseScheduling) {
-		_nextFrameToRunLongTermPlanningPhase = _lastFrameLongTermWasCalled + _framesToNextLongTermPlanning;
-		_nextFrameToRunMidTermPlanningPhase = _lastFrameMidTermWasCalled + _framesToNextMidTermPlanning;
-		_nextFrameToRunShortTermPlanningPhase = _lastFrameShortTermWasCalled + _framesToNextShortTermPlanning;
-		_nextFrameToRunPerceptivePhase = _lastFramePerceptiveWasCalled + _framesToNextPerceptivePhase;
-		_nextFrameToRunPredictivePhase = _lastFramePredictiveWasCalled + _framesToNextPredictivePhase;
-		_nextFrameToRunReactivePhase = _lastFrameReactiveWasCalled + _framesToNextReactivePhase;
+		if (!longTermPlanningPhaseDeferred) _nextFrameToRunLongTermPlanningPhase = nextFrameToRunPhase(_lastFrameLongTermWasCalled, _framesToNextLongTermPlanning);
+		_nextFrameToRunMidTermPlanningPhase = nextFrameToRunPhase(_lastFrameMidTermWasCalled, _framesToNextMidTermPlanning);
+		_nextFrameToRunShortTermPlanningPhase = nextFrameToRunPhase(_lastFrameShortTermWasCalled, _framesToNextShortTermPlanning);
+		_nextFrameToRunPerceptivePhase = nextFrameToRunPhase(_lastFramePerceptiveWasCalled, _framesToNextPerceptivePhase);
+		if (!predictivePhaseDeferred) _nextFrameToRunPredictivePhase = nextFrameToRunPhase(_lastFramePredictiveWasCalled, _framesToNextPredictivePhase);
+		_nextFrameToRunReactivePhase = nextFrameToRunPhase(_lastFrameReactiveWasCalled, _framesToNextReactivePhase);
 	}
 	else {
-		_nextFrameToRunLongTermPlanningPhase = _lastFrameLongTermWasCalled + gLongTermPlanningPhaseInterval;
-		_nextFrameToRunMidTermPlanningPhase = _lastFrameMidTermWasCalled + gMidTermPlanningPhaseInterval;
-		_nextFrameToRunShortTermPlanningPhase = _lastFrameShortTermWasCalled + gShortTermPlanningPhaseInterval;
-		_nextFrameToRunPerceptivePhase = _lastFramePerceptiveWasCalled + gPerceptivePhaseInterval;
-		_nextFrameToRunPredictivePhase = _lastFramePredictiveWasCalled + gPredictivePhaseInterval;
-		_nextFrameToRunReactivePhase = _lastFrameReactiveWasCalled + gReactivePhaseInterval;
+		if (!longTermPlanningPhaseDeferred) _nextFrameToRunLongTermPlanningPhase = nextFrameToRunPhase(_lastFrameLongTermWasCalled, gLongTermPlanningPhaseInterval);
+		_nextFrameToRunMidTermPlanningPhase = nextFrameToRunPhase(_lastFrameMidTermWasCalled, gMidTermPlanningPhaseInterval);
+		_nextFrameToRunShortTermPlanningPhase = nextFrameToRunPhase(_lastFrameShortTermWasCalled, gShortTermPlanningPhaseInterval);
+		_nextFrameToRunPerceptivePhase = nextFrameToRunPhase(_lastFramePerceptiveWasCalled, gPerceptivePhaseInterval);
+		if (!predictivePhaseDeferred) _nextFrameToRunPredictivePhase = nextFrameToRunPhase(_lastFramePredictiveWasCalled, gPredictivePhaseInterval);
+		_nextFrameToRunReactivePhase = nextFrameToRunPhase(_lastFrameReactiveWasCalled, gReactivePhaseInterval);
 	}
 
 
@@ -349,6 +369,19 @@ void PPRAgent::updateAI(float timeStamp, float dt, unsigned int frameNumber)
 }
 
 
+//
+// nextFrameToRunPhase()
+//
+unsigned int PPRAgent::nextFrameToRunPhase(unsigned int lastFrame, unsigned int interval) const
+{
+	if (!gStaggerPhases || (interval <= 1)) {
+		return lastFrame + interval;
+	}
+	// the first frame after lastFrame where (frame + _id) is a multiple of interval; consecutive agents get consecutive frames.
+	return lastFrame + interval - (unsigned int)((lastFrame + _id) % interval);
+}
+
+
 //
 // runCognitivePhase()
 //
@@ -409,62 +442,94 @@ void PPRAgent::runLongTermPlanningPhase()
 
 	int myIndexPosition = getSimulationEngine()->getSpatialDatabase()->getCellIndexFromLocation(_position);
 
-	if (myIndexPosition != -1) {
+	if ((myIndexPosition != -1) && (getSimulationEngine()->getPathPlanningService() != NULL)) {
+		// head straight for the landmark target until the path arrives in receiveLongTermPlan().
+		getSimulationEngine()->getPathPlanningService()->requestPath(this, _position, _currentGoal.targetLocation, 50000);
+		_waypoints.clear();
+		_waypoints.push_back(_currentGoal.targetLocation);
+		_currentWaypointIndex = 0;
+		_longTermPlanPending = true;
+	}
+	else if (myIndexPosition != -1) {
 
 		// run the main a-star search here
 		_gEngine->getPathPlanner()->findPath(_position, _currentGoal.targetLocation, longTermPath, 50000);
 
+		setWaypointsFromLongTermPath(longTermPath);
 
-		// set up the waypoints along this path.
-		// if there was no path, then just make one waypoint that is the landmark target.
-		_waypoints.clear();
-		if (longTermPath.size() > 2) {
+		// since we just computed a new long-term path, set the character to steer towards the first waypoint.
+		_currentWaypointIndex = 0; 
+		_longTermPlanPending = false;
+	}
+	else {
+		// can't do A-star if we are outside the database.
+		// this happens rarely, if ever, but still needs to be robustly handled... this seems like a reasonable decision to make in the extreme case.
+		_waypoints.push_back(_currentGoal.targetLocation);
+	}
 
-			// repeatedly pop the path stack, adding waypoints every so often, until the stack is empty.
-			for (size_t p=0; p < longTermPath.size(); p++)
-			{
-				if ( 0 == (p % _PPRParams.ped_next_waypoint_distance) )
-				{
-					_waypoints.push_back(longTermPath.at(p));
-				}
+}
 
-				// every time we successfully popped that many nodes in the path, we can add the next one as a waypoint.
-				// _waypoints.push_back(waypoint);
-			}
-			_waypoints.push_back(_currentGoal.targetLocation);
 
-			/*
-			 
-			 TODO, delete this after debugging the new version.
-
-			// note the >2 condition: if the astar path is not at least this large, then there will be a behavior bug in the AI
-			// when it tries to create waypoints.  in this case, the right thing to do is create only one waypoint that is at the landmark target.
-			// remember the astar lib produces "backwards" paths that start at [pathLengh-1] and end at [0].
-			int nextWaypointIndex = ((int)longTermAStar.getPath().size())-1 - _PPRParams.ped_next_waypoint_distance;
-			while (nextWaypointIndex > 0) {
-				Util::Point waypoint;
-				gSpatialDatabase->getLocationFromIndex(longTermAStar.getPath()[nextWaypointIndex],waypoint);
-				_waypoints.push_back(waypoint);
-				nextWaypointIndex -= _PPRParams.ped_next_waypoint_distance;
+//
+// setWaypointsFromLongTermPath()
+//
+void PPRAgent::setWaypointsFromLongTermPath(const std::vector<Util::Point> & longTermPath)
+{
+	// set up the waypoints along this path.
+	// if there was no path, then just make one waypoint that is the landmark target.
+	_waypoints.clear();
+	if (longTermPath.size() > 2) {
+
+		// repeatedly pop the path stack, adding waypoints every so often, until the stack is empty.
+		for (size_t p=0; p < longTermPath.size(); p++)
+		{
+			if ( 0 == (p % _PPRParams.ped_next_waypoint_distance) )
+			{
+				_waypoints.push_back(longTermPath.at(p));
 			}
-			_waypoints.push_back(_currentGoal.targetLocation);
-			
-			*/
-		}
-		else {
-			_waypoints.push_back(_currentGoal.targetLocation);
-		}
 
+			// every time we successfully popped that many nodes in the path, we can add the next one as a waypoint.
+			// _waypoints.push_back(waypoint);
+		}
+		_waypoints.push_back(_currentGoal.targetLocation);
 
-		// since we just computed a new long-term path, set the character to steer towards the first waypoint.
-		_currentWaypointIndex = 0; 
+		/*
+		 
+		 TODO, delete this after debugging the new version.
+
+		// note the >2 condition: if the astar path is not at least this large, then there will be a behavior bug in the AI
+		// when it tries to create waypoints.  in this case, the right thing to do is create only one waypoint that is at the landmark target.
+		// remember the astar lib produces "backwards" paths that start at [pathLengh-1] and end at [0].
+		int nextWaypointIndex = ((int)longTermAStar.getPath().size())-1 - _PPRParams.ped_next_waypoint_distance;
+		while (nextWaypointIndex > 0) {
+			Util::Point waypoint;
+			gSpatialDatabase->getLocationFromIndex(longTermAStar.getPath()[nextWaypointIndex],waypoint);
+			_waypoints.push_back(waypoint);
+			nextWaypointIndex -= _PPRParams.ped_next_waypoint_distance;
+		}
+		_waypoints.push_back(_currentGoal.targetLocation);
+		
+		*/
 	}
 	else {
-		// can't do A-star if we are outside the database.
-		// this happens rarely, if ever, but still needs to be robustly handled... this seems like a reasonable decision to make in the extreme case.
 		_waypoints.push_back(_currentGoal.targetLocation);
 	}
+}
+
 
+//
+// receiveLongTermPlan()
+//
+void PPRAgent::receiveLongTermPlan(const Util::Point & goalLocation, const std::vector<Util::Point> & path, bool pathComplete)
+{
+	// the agent may have moved on to another landmark while the path was planned.
+	// incomplete paths are used too, the same way runLongTermPlanningPhase() uses them when it plans inline.
+	if (!_enabled || (goalLocation != _currentGoal.targetLocation)) {
+		return;
+	}
+	setWaypointsFromLongTermPath(path);
+	_currentWaypointIndex = 0;
+	_longTermPlanPending = false;
 }
 
 
@@ -499,8 +564,22 @@ void PPRAgent::runMidTermPlanningPhase()
 		}
 	}
 
-	// compute a local a-star from your current location to the waypoint.
-	_gEngine->getPathPlanner()->findPath(_position, _waypoints[_currentWaypointIndex],midTermPath, 50000);
+	if (_longTermPlanPending) {
+		// the only waypoint is the landmark target, so a local a-star would be as long as the long-term search that is still running.
+		// instead, steer straight at a point at most ped_next_waypoint_distance cells toward it until receiveLongTermPlan() sets the waypoints.
+		Util::Vector toWaypoint = _waypoints[_currentWaypointIndex] - _position;
+		float distanceToWaypoint = toWaypoint.length();
+		float distance = std::min(distanceToWaypoint, (float)_PPRParams.ped_next_waypoint_distance);
+		unsigned int numSteps = std::max(1u, (unsigned int)ceilf(distance));
+		float stepFraction = (distanceToWaypoint > 0.0f) ? (distance / distanceToWaypoint / numSteps) : 0.0f;
+		for (unsigned int i=0; i<=numSteps; i++) {
+			midTermPath.push_back(_position + (i * stepFraction) * toWaypoint);
+		}
+	}
+	else {
+		// compute a local a-star from your current location to the waypoint.
+		_gEngine->getPathPlanner()->findPath(_position, _waypoints[_currentWaypointIndex],midTermPath, 50000);
+	}
 
 	// copy the local AStar path to your array
 	_midTermPathSize = (int)midTermPath.size();
@@ -779,7 +858,7 @@ void PPRAgent::runPredictivePhase()
 	//========================================================
 	if (_steeringState != STEERING_STATE_TURN_TOWARDS_TARGET) {	// ignore threats in the STEERING_STATE_TURN_TOWARDS_TARGET state.
 
-		for (std::set<SteerLib::SpatialDatabaseItemPtr>::iterator neighbor = _neighbors.begin(); neighbor != _neighbors.end(); ++neighbor) {
+		for (std::vector<SteerLib::SpatialDatabaseItemPtr>::iterator neighbor = _neighbors.begin(); neighbor != _neighbors.end(); ++neighbor) {
 		//for (unsigned int i=0; i<_neighbors.size(); i++) {
 
 			// ignore items that are not AI agents.
@@ -2288,7 +2367,7 @@ void PPRAgent::draw()
 
 	if (isSelected()) {
 		DrawLib::glColor(gRed);
-		for (std::set<SteerLib::SpatialDatabaseItemPtr>::iterator neighbor = _neighbors.begin(); neighbor != _neighbors.end(); ++neighbor) {
+		for (std::vector<SteerLib::SpatialDatabaseItemPtr>::iterator neighbor = _neighbors.begin(); neighbor != _neighbors.end(); ++neighbor) {
 		//for (unsigned int i=0; i<_neighbors.size(); i++) {
 			if ((*neighbor)->isAgent()) DrawLib::drawLine(_position + verticalOffset, AGENT_PTR((*neighbor))->position() + verticalOffset);
 		}
@@ -14,6 +14,8 @@
 #include "SteerLib.h"
 #include <vector>
 #include "RVO2D_Parameters.h"
+#include "RVO2DBatch.h"
+#include "KdTree.h"
 #include "Logger.h"
 
 
@@ -23,6 +25,8 @@
 
 
 
+class RVO2DAgent;
+
 namespace RVO2DGlobals {
 
 	struct PhaseProfilers {
@@ -50,6 +54,9 @@ namespace RVO2DGlobals {
 	extern bool gShowStats;
 	extern bool gShowAllStats;
 	extern bool dont_plan;
+	extern bool gUseBatchedOrca;
+	extern bool gUseKdTreeNeighbors;
+	extern bool gBenchmarkNeighborProviders;
 
 
 	// Adding a bunch of parameters so they can be changed via input
@@ -63,6 +70,8 @@ namespace RVO2DGlobals {
 
 
 	extern PhaseProfilers * gPhaseProfilers;
+	/// False when senseAI()/actAI() may run on several threads; the shared aiProfiler is not thread-safe.
+	extern bool gProfileAgentUpdates;
 }
 
 
@@ -89,6 +98,8 @@ public:
 	void finish();
 	SteerLib::AgentInterface * createAgent();
 	void destroyAgent( SteerLib::AgentInterface * agent );
+	/// senseAI() only reads other agents and the spatial database, and actAI() only writes the agent itself and the spatial database; aiProfiler is skipped when they run on several threads.
+	bool hasThreadSafeTwoPhaseAgents() { return true; }
 
 	void preprocessFrame(float timeStamp, float dt, unsigned int frameNumber);
 	void postprocessFrame(float timeStamp, float dt, unsigned int frameNumber);
@@ -101,6 +112,32 @@ protected:
 	std::vector<LogObject *> _logData;
 
 	SteerLib::EngineInterface * _gEngine;
+
+	/// Neighbor lists of all engine agents for the current frame, indexed like _gEngine->getAgents().
+	std::vector< std::vector<SteerLib::SpatialDatabaseItemPtr> > _neighborLists;
+
+	/// Snapshot of all agents for the agents' neighbor queries, gathered in preprocessFrame() with the batched_orca option.
+	RVO2DBatch _batch;
+
+	/// The kd-tree of the neighbor_provider=kdtree option:  the kdTreeDatabase's own tree when _findSharedKdTree() allows it, otherwise _ownKdTree; NULL if neither option needs one.
+	KdTree * _kdTree;
+	/// The kd-tree built once per frame in preprocessFrame() when there is no tree to share.
+	KdTree _ownKdTree;
+	/// Returns the engine's kdTreeDatabase tree if the database is one and the kdtree module updates it before this module's preprocessFrame(); NULL otherwise.
+	KdTree * _findSharedKdTree();
+
+	/// @name The benchmark_neighbor_providers option
+	/// @brief Every frame, the k-nearest-agent query of every agent is answered by both the engine's spatial database and the kd-tree, and each is timed.
+	//@{
+	void _benchmarkNeighborProviders(const std::vector<SteerLib::AgentInterface*> & agents);
+	Util::PerformanceProfiler _databaseNeighborsProfiler;
+	Util::PerformanceProfiler _kdTreeNeighborsProfiler;
+	unsigned long long _numBenchmarkQueries;
+	unsigned long long _numBenchmarkMismatches;
+	/// Reused between frames:  the agents queried, and the database's answers.
+	std::vector<RVO2DAgent *> _benchmarkAgents;
+	std::vector< std::vector<std::pair<float, const SteerLib::AgentInterface *> > > _benchmarkDatabaseNeighbors;
+	//@}
 };
 
 #endif
@@ -16,6 +16,8 @@
 // #include "RVO2DAIModule.h"
 #include "Obstacle.h"
 #include "RVO2D_Parameters.h"
+#include "RVO2DBatch.h"
+#include "KdTree.h"
 
 
 /**
@@ -39,6 +41,8 @@ public:
 	~RVO2DAgent();
 	void reset(const SteerLib::AgentInitialConditions & initialConditions, SteerLib::EngineInterface * engineInfo);
 	void updateAI(float timeStamp, float dt, unsigned int frameNumber);
+	void senseAI(float timeStamp, float dt, unsigned int frameNumber);
+	void actAI(float timeStamp, float dt, unsigned int frameNumber);
 	void disable();
 	void draw();
 
@@ -69,18 +73,7 @@ public:
 #ifdef USE_ACCLMESH
 	virtual void updateLocalTarget()
 	{
-		Util::Point tmpTarget = this->_goalQueue.front().targetLocation;
-		// std::cout << "Size of mid term path: " << this->_midTermPath.size() << std::endl;
-		unsigned int i=0;
-		for (i=0; (i < 5) &&
-				i < this->_midTermPath.size(); i++ )
-		{
-			tmpTarget = this->_midTermPath.at(i);
-			if ( this->hasLineOfSightTo(tmpTarget) )
-			{
-				this->_currentLocalTarget = tmpTarget;
-			}
-		}
+		// the local target is always the next waypoint; the mid-term path points in sight used to be traced first, but were then overwritten.
 		this->_currentLocalTarget = _waypoints.front();
 	}
 #endif
@@ -111,6 +104,16 @@ protected:
 	 */
 	void computeNewVelocity(float dt);
 
+	/**
+	 * \brief   Computes the preferred and new velocity of this agent from the current state of its neighbors, without moving it.
+	 */
+	void computeSteering(float dt);
+
+	/**
+	 * \brief   Moves this agent with the new velocity, updates the spatial database, and advances or disables its goal.
+	 */
+	void applySteering(float dt);
+
 	/**
 		 * \brief   Updates the three-dimensional position and three-dimensional velocity of this agent.
 		 */
@@ -134,6 +137,17 @@ protected:
 
 	SteerLib::EngineInterface * _gEngine;
 
+	/// This frame's candidate neighbors, computed for all agents at once by RVO2DAIModule::preprocessFrame(); NULL if the agent has to query the database itself.
+	const std::vector<SteerLib::SpatialDatabaseItemPtr> * _precomputedNeighbors;
+	/// The module's snapshot of all agents when the batched_orca option is on, where computeNeighbors() finds the nearest agents; NULL otherwise.
+	const RVO2DBatch * _batch;
+	/// This agent's index in _batch.
+	unsigned int _batchIndex;
+	/// The kd-tree RVO2DAIModule::preprocessFrame() built or shared when the neighbor_provider option is kdtree, which computeNeighbors() queries through insertAgentNeighbor() and insertObstacleNeighbor(); NULL otherwise.
+	const KdTree * _kdTree;
+	/// Scratch space for linearProgram3(), kept between frames so that solving stops allocating.
+	std::vector<Line> projLines_;
+
 
 	friend class KdTree;
 	friend class RVO2DAIModule;
@@ -180,8 +194,9 @@ size_t linearProgram2(const std::vector<Line> &lines, float radius,
  * \param      beginLine     The line on which the 2-d linear program failed.
  * \param      radius        The radius of the circular constraint.
  * \param      result        A reference to the result of the linear program.
+ * \param      projLines     Scratch space for the projected lines; its contents are overwritten.
  */
 void linearProgram3(const std::vector<Line> &lines, size_t numObstLines, size_t beginLine,
-					float radius, Util::Vector &result);
+					float radius, Util::Vector &result, std::vector<Line> &projLines);
 
 #endif
@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+#ifndef __RVO2D_BATCH_H__
+#define __RVO2D_BATCH_H__
+
+/// @file RVO2DBatch.h
+/// @brief Declares the RVO2DBatch class, the per-frame snapshot of all agents used by the batched ORCA update.
+
+#include <vector>
+#include "SteerLib.h"
+
+/// Average number of agents per cell that RVO2DBatch::gather() sizes its grid for.
+#define RVO_BATCH_AGENTS_PER_CELL 4.0f
+/// Smallest cell size RVO2DBatch::gather() uses, so that agents on top of each other do not make a huge grid.
+#define RVO_BATCH_MIN_CELL_SIZE 0.5f
+
+
+/**
+ * @brief A snapshot of the positions of all agents, binned into a grid of its own, that answers the k-nearest-agent queries of ORCA.
+ *
+ * RVO2DAIModule::preprocessFrame() gathers it once per frame when the batched_orca option is on; then every RVO2DAgent finds its
+ * neighbors here during senseAI(), on any number of threads, instead of filtering the long candidate lists that
+ * SpatialDataBaseInterface::computeAllAgentNeighbors() returns for the full neighbor distance.  Positions are copied next to each
+ * other in cell order, so a query scans contiguous floats without calling AgentInterface functions.
+ *
+ * The snapshot is only correct while no agent moves, which is what the engine's two-phase update guarantees between the
+ * preprocessFrame() and the act pass.
+ *
+ * Storage is reused between frames, so the batch stops allocating once the crowd stops growing.
+ */
+class RVO2DBatch
+{
+public:
+	RVO2DBatch() : _xNumCells(0), _zNumCells(0) { }
+
+	/// Takes the snapshot of the enabled agents; the agent indices of the other functions are indices into agents.
+	void gather(const std::vector<SteerLib::AgentInterface*> & agents);
+
+	/**
+	 * @brief Finds the k agents whose centers are nearest to the center of agent i, and closer than maxRange.
+	 *
+	 * Fills neighbors nearest first, with squared distances, like SpatialDataBaseInterface::getKNearestAgents(); agent i itself
+	 * is left out.  Only reads the batch, so several threads can query it at once.
+	 */
+	void getKNearestAgents(unsigned int i, unsigned int k, float maxRange, std::vector<std::pair<float, const SteerLib::AgentInterface *> > & neighbors) const;
+
+protected:
+	/// Offers the agents of one cell to the sorted neighbor list, shrinking rangeSq once the list holds k agents.
+	void _insertNearestAgentsInCell(unsigned int cellIndex, unsigned int i, unsigned int k, float & rangeSq, std::vector<std::pair<float, const SteerLib::AgentInterface *> > & neighbors) const;
+
+	/// @name Per-agent data, indexed like the agents given to gather().
+	//@{
+	std::vector<const SteerLib::AgentInterface *> _agents;
+	std::vector<float> _x, _z;
+	//@}
+
+	/// @name The grid, over the bounding box of the enabled agents' centers
+	//@{
+	float _xOrigin, _zOrigin, _cellSize, _invCellSize;
+	int _xNumCells, _zNumCells;
+	/// The agents whose centers are in cell c are [_cellStart[c], _cellStart[c+1]) of the arrays below.
+	std::vector<unsigned int> _cellStart;
+	/// Agent indices, and copies of their positions, sorted by cell.
+	std::vector<unsigned int> _agentsByCell;
+	std::vector<float> _cellX, _cellZ;
+	/// The cell of each agent while binning, or NO_CELL for disabled agents.
+	std::vector<unsigned int> _homeCell;
+	//@}
+
+	static const unsigned int NO_CELL = 0xffffffffu;
+};
+
+#endif
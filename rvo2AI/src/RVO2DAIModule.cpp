@@ -12,9 +12,11 @@
 #include "SimulationPlugin.h"
 #include "RVO2DAIModule.h"
 #include "RVO2DAgent.h"
+#include "KdTreeDataBase.h"
 
 #include "LogObject.h"
 #include "LogManager.h"
+#include <algorithm>
 
 
 // globally accessible to the simpleAI plugin
@@ -33,6 +35,9 @@ namespace RVO2DGlobals
 	unsigned int gReactivePhaseInterval;
 	unsigned int gPerceptivePhaseInterval;
 	bool gUseDynamicPhaseScheduling;
+	bool gUseBatchedOrca;
+	bool gUseKdTreeNeighbors;
+	bool gBenchmarkNeighborProviders;
 	bool gShowStats;
 	bool gShowAllStats;
 	bool dont_plan;
@@ -49,6 +54,7 @@ namespace RVO2DGlobals
 
 
 	PhaseProfilers * gPhaseProfilers;
+	bool gProfileAgentUpdates;
 }
 
 using namespace RVO2DGlobals;
@@ -70,9 +76,14 @@ void RVO2DAIModule::init( const SteerLib::OptionDictionary & options, SteerLib::
 	// gSpatialDatabase = engineInfo->getSpatialDatabase();
 
 	gUseDynamicPhaseScheduling = false;
+	gUseBatchedOrca = false;
+	gUseKdTreeNeighbors = false;
+	gBenchmarkNeighborProviders = false;
+	_kdTree = NULL;
 	gShowStats = false;
 	logStats = false;
 	gShowAllStats = false;
+	gProfileAgentUpdates = (engineInfo->getOptions().engineOptions.numThreads <= 1) || !engineInfo->getOptions().engineOptions.twoPhaseAgentUpdate;
 	logFilename = "rvo2AI.log";
 	dont_plan=false;
 
@@ -137,6 +148,29 @@ void RVO2DAIModule::init( const SteerLib::OptionDictionary & options, SteerLib::
 		{
 			dont_plan = Util::getBoolFromString(value.str());
 		}
+		else if ((*optionIter).first == "batched_orca")
+		{
+			gUseBatchedOrca = Util::getBoolFromString(value.str());
+		}
+		else if ((*optionIter).first == "neighbor_provider")
+		{
+			if (value.str() == "kdtree")
+			{
+				gUseKdTreeNeighbors = true;
+			}
+			else if (value.str() == "grid")
+			{
+				gUseKdTreeNeighbors = false;
+			}
+			else
+			{
+				throw Util::GenericException("unknown neighbor_provider \"" + value.str() + "\" given to RVO2D AI module, expected grid or kdtree.");
+			}
+		}
+		else if ((*optionIter).first == "benchmark_neighbor_providers")
+		{
+			gBenchmarkNeighborProviders = Util::getBoolFromString(value.str());
+		}
 		else
 		{
 			// throw Util::GenericException("unrecognized option \"" + Util::toString((*optionIter).first) + "\" given to PPR AI module.");
@@ -194,19 +228,90 @@ void RVO2DAIModule::finish()
 
 void RVO2DAIModule::preprocessSimulation()
 {
-	// kdTree_->buildObstacleTree();
+	_kdTree = NULL;
+	if (gUseKdTreeNeighbors || gBenchmarkNeighborProviders)
+	{
+		_kdTree = _findSharedKdTree();
+		if (_kdTree == NULL)
+		{
+			_ownKdTree.setSimulator(_gEngine);
+			_ownKdTree.setBuildThreads(_gEngine->getOptions().engineOptions.numThreads);
+			_ownKdTree.buildObstacleTree();
+			_kdTree = &_ownKdTree;
+		}
+	}
+
+	_databaseNeighborsProfiler.reset();
+	_kdTreeNeighborsProfiler.reset();
+	_numBenchmarkQueries = 0;
+	_numBenchmarkMismatches = 0;
+}
+
+KdTree * RVO2DAIModule::_findSharedKdTree()
+{
+	SteerLib::KdTreeDataBase * database = dynamic_cast<SteerLib::KdTreeDataBase *>(_gEngine->getSpatialDatabase());
+	if ((database == NULL) || !_gEngine->isModuleLoaded("kdtree"))
+	{
+		return NULL;
+	}
+
+	// the kdtree module updates its tree in its own preprocessFrame(), so it must come before this module in execution order.
+	const std::vector<SteerLib::ModuleInterface*> & modules = _gEngine->getAllModules();
+	std::vector<SteerLib::ModuleInterface*>::const_iterator kdTreeModule = std::find(modules.begin(), modules.end(), _gEngine->getModule("kdtree"));
+	std::vector<SteerLib::ModuleInterface*>::const_iterator thisModule = std::find(modules.begin(), modules.end(), this);
+	if (kdTreeModule > thisModule)
+	{
+		std::cerr << "WARNING: the kdtree module runs after rvo2AI, so rvo2AI builds its own kd-tree instead of sharing the kdTreeDatabase's." << std::endl;
+		return NULL;
+	}
+	return database->getKdTree();
 }
 
 void RVO2DAIModule::preprocessFrame(float timeStamp, float dt, unsigned int frameNumber)
 {
-	if ( frameNumber == 1)
+	if ( (frameNumber == 1) && (_kdTree == &_ownKdTree) )
 	{
 		// Adding in this extra one because it seemed sometimes agents would forget about obstacles.
-		// kdTree_->buildObstacleTree();
+		_ownKdTree.buildObstacleTree();
 	}
 	if ( !agents_.empty() )
 	{
-		// kdTree_->buildAgentTree();
+		if (_kdTree == &_ownKdTree)
+		{
+			_ownKdTree.updateAgentTree();
+		}
+
+		const std::vector<SteerLib::AgentInterface*> & agents = _gEngine->getAgents();
+		// a snapshot taken here is only what the agents see if nothing moves until every agent has solved, i.e., in two-phase updates.
+		bool batched = gUseBatchedOrca && _gEngine->getOptions().engineOptions.twoPhaseAgentUpdate;
+		// in one-phase updates the tree's bounding boxes lag behind the agents that already moved this frame, as they do for the kdTreeDatabase.
+		const KdTree * kdTree = gUseKdTreeNeighbors ? _kdTree : NULL;
+		if (batched)
+		{
+			// the agents then find their nearest neighbors in the snapshot, which answers for any neighbor distance.
+			_batch.gather(agents);
+		}
+		else if (kdTree == NULL)
+		{
+			// one batched neighbor query per frame replaces the k-nearest search every agent would otherwise make.
+			_gEngine->getSpatialDatabase()->computeAllAgentNeighbors(agents, rvo_neighbor_distance, _neighborLists);
+		}
+		if (gBenchmarkNeighborProviders)
+		{
+			_benchmarkNeighborProviders(agents);
+		}
+		for (unsigned int i = 0; i < agents.size(); i++)
+		{
+			RVO2DAgent * agent = dynamic_cast<RVO2DAgent *>(agents[i]);
+			if (agent == NULL) continue;
+			agent->_batch = (batched && agent->enabled()) ? &_batch : NULL;
+			agent->_batchIndex = i;
+			// the kd-tree also provides the obstacle neighbors when the batch provides the agents.
+			agent->_kdTree = agent->enabled() ? kdTree : NULL;
+			// agents whose neighbor distance was changed individually keep querying for themselves.
+			bool usable = !batched && (kdTree == NULL) && agent->enabled() && (agent->_RVO2DParams.rvo_neighbor_distance <= rvo_neighbor_distance);
+			agent->_precomputedNeighbors = usable ? &_neighborLists[i] : NULL;
+		}
 	}
 
 	/*
@@ -217,6 +322,60 @@ void RVO2DAIModule::preprocessFrame(float timeStamp, float dt, unsigned int fram
 	}*/
 }
 
+void RVO2DAIModule::_benchmarkNeighborProviders(const std::vector<SteerLib::AgentInterface*> & agents)
+{
+	_benchmarkAgents.clear();
+	for (unsigned int i = 0; i < agents.size(); i++)
+	{
+		RVO2DAgent * agent = dynamic_cast<RVO2DAgent *>(agents[i]);
+		if ((agent != NULL) && agent->enabled() && (agent->_RVO2DParams.rvo_max_neighbors > 0))
+		{
+			_benchmarkAgents.push_back(agent);
+		}
+	}
+	if (_benchmarkDatabaseNeighbors.size() < _benchmarkAgents.size())
+	{
+		_benchmarkDatabaseNeighbors.resize(_benchmarkAgents.size());
+	}
+
+	// each provider answers all the queries in one go, so neither pays for the other's cache misses; the tree's build is timed by the tree itself.
+	SteerLib::SpatialDataBaseInterface * database = _gEngine->getSpatialDatabase();
+	_databaseNeighborsProfiler.start();
+	for (unsigned int i = 0; i < _benchmarkAgents.size(); i++)
+	{
+		RVO2DAgent * agent = _benchmarkAgents[i];
+		database->getKNearestAgents(_benchmarkDatabaseNeighbors[i], agent->position(), agent->_RVO2DParams.rvo_max_neighbors, agent->_RVO2DParams.rvo_neighbor_distance, agent);
+	}
+	_databaseNeighborsProfiler.stop();
+
+	_kdTreeNeighborsProfiler.start();
+	for (unsigned int i = 0; i < _benchmarkAgents.size(); i++)
+	{
+		RVO2DAgent * agent = _benchmarkAgents[i];
+		agent->agentNeighbors_.clear();
+		_kdTree->computeAgentNeighbors(agent, sqr(agent->_RVO2DParams.rvo_neighbor_distance));
+	}
+	_kdTreeNeighborsProfiler.stop();
+
+	for (unsigned int i = 0; i < _benchmarkAgents.size(); i++)
+	{
+		// agents at equal distances may come in either order, so only the distances are compared.
+		const std::vector<std::pair<float, const SteerLib::AgentInterface *> > & databaseNeighbors = _benchmarkDatabaseNeighbors[i];
+		const std::vector<std::pair<float, const SteerLib::AgentInterface *> > & kdTreeNeighbors = _benchmarkAgents[i]->agentNeighbors_;
+		bool same = (databaseNeighbors.size() == kdTreeNeighbors.size());
+		for (size_t n = 0; same && (n < databaseNeighbors.size()); n++)
+		{
+			same = (databaseNeighbors[n].first == kdTreeNeighbors[n].first);
+		}
+		if (!same)
+		{
+			_numBenchmarkMismatches++;
+		}
+		_benchmarkAgents[i]->agentNeighbors_.clear();
+	}
+	_numBenchmarkQueries += _benchmarkAgents.size();
+}
+
 void RVO2DAIModule::postprocessFrame(float timeStamp, float dt, unsigned int frameNumber)
 {
 	// do nothing for now
@@ -283,8 +442,15 @@ void RVO2DAIModule::destroyAgent( SteerLib::AgentInterface * agent )
 void RVO2DAIModule::cleanupSimulation()
 {
 	agents_.clear();
-	// kdTree_->deleteObstacleTree(kdTree_->obstacleTree_);
-	// kdTree_->agents_.clear();
+	if (gBenchmarkNeighborProviders && (_kdTree != NULL))
+	{
+		std::cout << "RVO2DAIModule neighbor providers, " << _numBenchmarkQueries << " k-nearest queries: "
+			<< _gEngine->getOptions().spatialDatabaseOptions.name << " " << _databaseNeighborsProfiler.getTotalTime() << " s, kd-tree "
+			<< _kdTreeNeighborsProfiler.getTotalTime() << " s plus " << _kdTree->agentTreeBuildProfiler_.getNumTimesExecuted() << " builds ("
+			<< _kdTree->agentTreeBuildProfiler_.getTotalTime() << " s) and " << _kdTree->agentTreeRefitProfiler_.getNumTimesExecuted() << " refits ("
+			<< _kdTree->agentTreeRefitProfiler_.getTotalTime() << " s); " << _numBenchmarkMismatches << " neighbor lists differ" << std::endl;
+	}
+	_kdTree = NULL;
 
 		LogObject rvoLogObject;
 
@@ -314,5 +480,4 @@ void RVO2DAIModule::cleanupSimulation()
 	gPhaseProfilers->predictivePhaseProfiler.reset();
 	gPhaseProfilers->reactivePhaseProfiler.reset();
 	gPhaseProfilers->steeringPhaseProfiler.reset();
-	// kdTree_->deleteObstacleTree(kdTree_->obstacleTree_);
 }
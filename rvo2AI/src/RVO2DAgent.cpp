@@ -36,6 +36,10 @@ RVO2DAgent::RVO2DAgent()
 	_RVO2DParams.rvo_time_horizon  = rvo_time_horizon ;
 	_RVO2DParams.rvo_time_horizon_obstacles  = rvo_time_horizon_obstacles ;
 	_RVO2DParams.next_waypoint_distance = next_waypoint_distance;
+	_precomputedNeighbors = NULL;
+	_batch = NULL;
+	_batchIndex = 0;
+	_kdTree = NULL;
 	_enabled = false;
 }
 
@@ -227,74 +231,47 @@ void RVO2DAgent::reset(const SteerLib::AgentInitialConditions & initialCondition
 	assert(_radius != 0.0f);
 }
 
-/*
 void RVO2DAgent::computeNeighbors()
 {
-	agentNeighbors_.clear();
-
-	if (_RVO2DParams.rvo_max_neighbors > 0) {
-		// std::cout << "About to segfault" << std::endl;
-		dynamic_cast<RVO2DAIModule *>(rvoModule)->kdTree_->computeAgentNeighbors(this, _RVO2DParams.rvo_neighbor_distance * _RVO2DParams.rvo_neighbor_distance);
-		// std::cout << "Made it past segfault" << std::endl;
+	obstacleNeighbors_.clear();
+	float rangeSq = sqr(_RVO2DParams.rvo_time_horizon_obstacles * _RVO2DParams.rvo_max_speed + _radius);
+	if (_kdTree != NULL)
+	{
+		_kdTree->computeObstacleNeighbors(this, rangeSq);
 	}
-}*/
-
-bool compareDist(std::pair<float, const SteerLib::AgentInterface *> a1,
-			std::pair<float, const SteerLib::AgentInterface *> a2 )
+	else
 	{
-		return a1.first < a2.first;
+		getSimulationEngine()->getSpatialDatabase()->computeObstacleNeighbors(this, rangeSq);
 	}
 
-void RVO2DAgent::computeNeighbors()
-{
-	obstacleNeighbors_.clear();
-	float rangeSq = sqr(_RVO2DParams.rvo_time_horizon_obstacles * _RVO2DParams.rvo_max_speed + _radius);
-	// dynamic_cast<RVO2DAIModule *>(rvoModule)->kdTree_->computeObstacleNeighbors(this, rangeSq);
-	getSimulationEngine()->getSpatialDatabase()->computeObstacleNeighbors(this, rangeSq);
-
 	// std::cout << "Number of obstacle neighbours " << obstacleNeighbors_.size() << std::endl;
 
 	agentNeighbors_.clear();
 
-	if (_RVO2DParams.rvo_max_neighbors > 0)
+	if ((_RVO2DParams.rvo_max_neighbors > 0) && (_batch != NULL))
 	{
-	
-		/*
-		 * Old ORCA method
-		 */
-		rangeSq = sqr(_RVO2DParams.rvo_neighbor_distance);
-		// dynamic_cast<RVO2DAIModule *>(rvoModule)->kdTree_->computeAgentNeighbors(this, rangeSq);
-		// std::cout << "RVO spatial database: " << getSimulationEngine()->getSpatialDatabase() << std::endl;
-		getSimulationEngine()->getSpatialDatabase()->computeAgentNeighbors(this, rangeSq);
-		/*
-		 * This was updated to use the SteerLib griddatabase instead
-		 * It is a bad idea to keep two serperate structures to facilitate
-		 * neighbor query operations.
-		 */
-		/*
-		std::set<SpatialDatabaseItemPtr>  neighborList;
-		rangeSq = _RVO2DParams.rvo_neighbor_distance;
-		getSimulationEngine()->getSpatialDatabase()->getItemsInRange(neighborList, position().x-rangeSq, position().x+rangeSq, position().z-rangeSq, position().z+rangeSq, dynamic_cast<SpatialDatabaseItemPtr>(this));
-		// WIll need to sort these.
-
-		for (std::set<SteerLib::SpatialDatabaseItemPtr>::iterator neighbor = neighborList.begin();  neighbor != neighborList.end();  neighbor++)
+		_batch->getKNearestAgents(_batchIndex, _RVO2DParams.rvo_max_neighbors, _RVO2DParams.rvo_neighbor_distance, agentNeighbors_);
+	}
+	else if ((_RVO2DParams.rvo_max_neighbors > 0) && (_kdTree != NULL))
+	{
+		// insertAgentNeighbor() keeps the closest rvo_max_neighbors agents and shrinks the range once it has them.
+		_kdTree->computeAgentNeighbors(this, sqr(_RVO2DParams.rvo_neighbor_distance));
+	}
+	else if ((_RVO2DParams.rvo_max_neighbors > 0) && (_precomputedNeighbors != NULL))
+	{
+		// the candidates are every agent within rvo_neighbor_distance of this agent's body; keep the closest centers, as getKNearestAgents() would.
+		float agentRangeSq = sqr(_RVO2DParams.rvo_neighbor_distance);
+		for (std::vector<SteerLib::SpatialDatabaseItemPtr>::const_iterator neighbor = _precomputedNeighbors->begin(); neighbor != _precomputedNeighbors->end(); ++neighbor)
 		{
-			if ( (*neighbor)->isAgent())
-			{
-				SteerLib::AgentInterface * tmpA = dynamic_cast<SteerLib::AgentInterface *>(*neighbor);
-				// if ( ((dynamic_cast<SteerLib::AgentInterface *>(*neighbor))->position()-position).length()  )
-				{
-					agentNeighbors_.push_back(std::make_pair((tmpA->position()-position()).length(), tmpA));
-					//Util::DrawLib::drawStar(this->position() + ((dynamic_cast<AgentInterface*>(*neighbor)->position() - this->position())/2), Util::Vector(1,0,0), 1.14f, gRed);
-					//std::cerr << "COLLISION FOUND AT TIME " << gTempCurrentTime << "\n";
-				}
-			}
+			if (!(*neighbor)->isAgent()) continue;
+			const SteerLib::AgentInterface * agent = dynamic_cast<const SteerLib::AgentInterface *>(*neighbor);
+			SteerLib::SpatialDataBaseInterface::insertNearestAgent(agentNeighbors_, _RVO2DParams.rvo_max_neighbors, (agent->position() - position()).lengthSquared(), agent, agentRangeSq);
 		}
-		// Will need to sort these.
-		std::sort (agentNeighbors_.begin(), agentNeighbors_.end(), compareDist); // 12 32 45 71(26 33 53 80)
-		agentNeighbors_.resize(_RVO2DParams.rvo_max_neighbors);
-		// dynamic_cast<RVO2DAIModule *>(rvoModule)->kdTree_->computeAgentNeighbors(this, rangeSq);
-		*/
+	}
+	else if (_RVO2DParams.rvo_max_neighbors > 0)
+	{
+		// the database returns the closest rvo_max_neighbors agents, nearest first, with squared distances as insertAgentNeighbor() would.
+		getSimulationEngine()->getSpatialDatabase()->getKNearestAgents(agentNeighbors_, position(), _RVO2DParams.rvo_max_neighbors, _RVO2DParams.rvo_neighbor_distance, this);
 	}
 }
 
@@ -614,7 +591,7 @@ void RVO2DAgent::computeNewVelocity(float dt)
 	size_t lineFail = linearProgram2(orcaLines_, _RVO2DParams.rvo_max_speed, _prefVelocity, false, _newVelocity);
 
 	if (lineFail < orcaLines_.size()) {
-		linearProgram3(orcaLines_, numObstLines, lineFail, _RVO2DParams.rvo_max_speed, _newVelocity);
+		linearProgram3(orcaLines_, numObstLines, lineFail, _RVO2DParams.rvo_max_speed, _newVelocity, projLines_);
 	}
 }
 
@@ -668,13 +645,40 @@ void RVO2DAgent::insertObstacleNeighbor(const ObstacleInterface *obstacle, float
 void RVO2DAgent::updateAI(float timeStamp, float dt, unsigned int frameNumber)
 {
 	// std::cout << "_RVO2DParams.rvo_max_speed " << _RVO2DParams._RVO2DParams.rvo_max_speed << std::endl;
-	Util::AutomaticFunctionProfiler profileThisFunction( &RVO2DGlobals::gPhaseProfilers->aiProfiler );
+	Util::AutomaticFunctionProfiler profileThisFunction( RVO2DGlobals::gProfileAgentUpdates ? &RVO2DGlobals::gPhaseProfilers->aiProfiler : NULL );
 	if (!enabled())
 	{
 		return;
 	}
 
-	Util::AxisAlignedBox oldBounds(_position.x - _radius, _position.x + _radius, 0.0f, 0.0f, _position.z - _radius, _position.z + _radius);
+	computeSteering(dt);
+	applySteering(dt);
+}
+
+void RVO2DAgent::senseAI(float timeStamp, float dt, unsigned int frameNumber)
+{
+	Util::AutomaticFunctionProfiler profileThisFunction( RVO2DGlobals::gProfileAgentUpdates ? &RVO2DGlobals::gPhaseProfilers->aiProfiler : NULL );
+	if (!enabled())
+	{
+		return;
+	}
+
+	computeSteering(dt);
+}
+
+void RVO2DAgent::actAI(float timeStamp, float dt, unsigned int frameNumber)
+{
+	Util::AutomaticFunctionProfiler profileThisFunction( RVO2DGlobals::gProfileAgentUpdates ? &RVO2DGlobals::gPhaseProfilers->aiProfiler : NULL );
+	if (!enabled())
+	{
+		return;
+	}
+
+	applySteering(dt);
+}
+
+void RVO2DAgent::computeSteering(float dt)
+{
 	SteerLib::AgentGoalInfo goalInfo = _goalQueue.front();
 	Util::Vector goalDirection;
 	if ( ! _midTermPath.empty() ) // && (!this->hasLineOfSightTo(goalInfo.targetLocation)) )
@@ -701,6 +705,13 @@ void RVO2DAgent::updateAI(float timeStamp, float dt, unsigned int frameNumber)
 	(this)->computeNewVelocity(dt);
 	// (this)->computeNewVelocity(dt);
 	_prefVelocity.y = 0.0f;
+}
+
+void RVO2DAgent::applySteering(float dt)
+{
+	Util::AxisAlignedBox oldBounds(_position.x - _radius, _position.x + _radius, 0.0f, 0.0f, _position.z - _radius, _position.z + _radius);
+	SteerLib::AgentGoalInfo goalInfo = _goalQueue.front();
+	Util::Vector goalDirection;
 
 	// These are the internal RVO values calculated
 	_velocity = _newVelocity;
@@ -974,14 +985,14 @@ size_t linearProgram2(const std::vector<Line> &lines, float radius, const Util::
 	return lines.size();
 }
 
-void linearProgram3(const std::vector<Line> &lines, size_t numObstLines, size_t beginLine, float radius, Util::Vector &result)
+void linearProgram3(const std::vector<Line> &lines, size_t numObstLines, size_t beginLine, float radius, Util::Vector &result, std::vector<Line> &projLines)
 {
 	float distance = 0.0f;
 
 	for (size_t i = beginLine; i < lines.size(); ++i) {
 		if (det(lines[i].direction, lines[i].point - result) > distance) {
 			/* Result does not satisfy constraint of line i. */
-			std::vector<Line> projLines(lines.begin(), lines.begin() + static_cast<ptrdiff_t>(numObstLines));
+			projLines.assign(lines.begin(), lines.begin() + static_cast<ptrdiff_t>(numObstLines));
 
 			for (size_t j = numObstLines; j < i; ++j) {
 				Line line;
@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+/// @file RVO2DBatch.cpp
+/// @brief Implements the RVO2DBatch class.
+
+#include <algorithm>
+#include <cmath>
+
+#include "RVO2DBatch.h"
+
+#undef min
+#undef max
+
+using namespace SteerLib;
+
+
+void RVO2DBatch::gather(const std::vector<AgentInterface*> & agents)
+{
+	unsigned int numAgents = (unsigned int)agents.size();
+	_agents.resize(numAgents);
+	_x.resize(numAgents);
+	_z.resize(numAgents);
+	_homeCell.resize(numAgents);
+
+	unsigned int numEnabled = 0;
+	float xmin = 0.0f, xmax = 0.0f, zmin = 0.0f, zmax = 0.0f;
+	for (unsigned int i=0; i < numAgents; i++) {
+		_agents[i] = agents[i];
+		Util::Point position = agents[i]->position();
+		_x[i] = position.x;
+		_z[i] = position.z;
+		if (!agents[i]->enabled()) {
+			_homeCell[i] = NO_CELL;
+			continue;
+		}
+		if (numEnabled == 0) {
+			xmin = xmax = position.x;
+			zmin = zmax = position.z;
+		}
+		else {
+			xmin = std::min(xmin, position.x);
+			xmax = std::max(xmax, position.x);
+			zmin = std::min(zmin, position.z);
+			zmax = std::max(zmax, position.z);
+		}
+		numEnabled++;
+	}
+
+	// cells sized for a few agents each on average over the bounding box, so the number of cells grows with the crowd, not the world.
+	_xOrigin = xmin;
+	_zOrigin = zmin;
+	float area = (xmax - xmin) * (zmax - zmin);
+	_cellSize = std::max(sqrtf(area * RVO_BATCH_AGENTS_PER_CELL / (float)std::max(numEnabled, 1u)), RVO_BATCH_MIN_CELL_SIZE);
+	_invCellSize = 1.0f / _cellSize;
+	_xNumCells = (int)((xmax - xmin) * _invCellSize) + 1;
+	_zNumCells = (int)((zmax - zmin) * _invCellSize) + 1;
+	unsigned int numCells = (unsigned int)(_xNumCells * _zNumCells);
+
+	// counting sort of the enabled agents by cell.
+	_cellStart.assign(numCells+1, 0);
+	for (unsigned int i=0; i < numAgents; i++) {
+		if (_homeCell[i] == NO_CELL) continue;
+		int x = std::min((int)((_x[i] - _xOrigin) * _invCellSize), _xNumCells-1);
+		int z = std::min((int)((_z[i] - _zOrigin) * _invCellSize), _zNumCells-1);
+		_homeCell[i] = (unsigned int)(x * _zNumCells + z);
+		_cellStart[_homeCell[i]+1]++;
+	}
+	for (unsigned int c=0; c < numCells; c++) {
+		_cellStart[c+1] += _cellStart[c];
+	}
+
+	_agentsByCell.resize(numEnabled);
+	_cellX.resize(numEnabled);
+	_cellZ.resize(numEnabled);
+	// scatter from the back, so that _cellStart ends up holding the first slot of each cell again.
+	for (unsigned int i=numAgents; i-- > 0; ) {
+		if (_homeCell[i] == NO_CELL) continue;
+		unsigned int slot = --_cellStart[_homeCell[i]+1];
+		_agentsByCell[slot] = i;
+		_cellX[slot] = _x[i];
+		_cellZ[slot] = _z[i];
+	}
+	// each _cellStart[c+1] was decremented down to the start of cell c; shift them back into place.
+	for (unsigned int c=0; c < numCells; c++) {
+		_cellStart[c] = _cellStart[c+1];
+	}
+	_cellStart[numCells] = numEnabled;
+}
+
+
+void RVO2DBatch::_insertNearestAgentsInCell(unsigned int cellIndex, unsigned int i, unsigned int k, float & rangeSq, std::vector<std::pair<float, const AgentInterface *> > & neighbors) const
+{
+	float x = _x[i];
+	float z = _z[i];
+	for (unsigned int slot = _cellStart[cellIndex]; slot < _cellStart[cellIndex+1]; slot++) {
+		float dx = _cellX[slot] - x;
+		float dz = _cellZ[slot] - z;
+		float distSq = dx*dx + dz*dz;
+		if ((distSq >= rangeSq) || (_agentsByCell[slot] == i)) continue;
+
+		// every agent is in exactly one cell, so unlike SpatialDataBaseInterface::insertNearestAgent() there are no duplicates to skip.
+		if (neighbors.size() < k) {
+			neighbors.push_back(std::make_pair(distSq, _agents[_agentsByCell[slot]]));
+		}
+		size_t n = neighbors.size() - 1;
+		while ((n != 0) && (distSq < neighbors[n-1].first)) {
+			neighbors[n] = neighbors[n-1];
+			--n;
+		}
+		neighbors[n] = std::make_pair(distSq, _agents[_agentsByCell[slot]]);
+		if (neighbors.size() == k) {
+			rangeSq = neighbors.back().first;
+		}
+	}
+}
+
+
+void RVO2DBatch::getKNearestAgents(unsigned int i, unsigned int k, float maxRange, std::vector<std::pair<float, const AgentInterface *> > & neighbors) const
+{
+	neighbors.clear();
+	if ((k == 0) || (_homeCell[i] == NO_CELL)) return;
+
+	float rangeSq = maxRange * maxRange;
+	int xCenter = (int)(_homeCell[i] / (unsigned int)_zNumCells);
+	int zCenter = (int)(_homeCell[i] % (unsigned int)_zNumCells);
+
+	// the same ring search as GridDatabase2D::getKNearestAgents():  after searching the square of cells
+	// [xCenter-ring, xCenter+ring] x [zCenter-ring, zCenter+ring], any agent not yet found is at least as far away as its nearest edge.
+	for (int ring=0; ; ring++) {
+		int x0 = xCenter - ring, x1 = xCenter + ring;
+		int z0 = zCenter - ring, z1 = zCenter + ring;
+
+		for (int x = std::max(x0, 0); x <= std::min(x1, _xNumCells-1); x++) {
+			if ((x == x0) || (x == x1)) {
+				for (int z = std::max(z0, 0); z <= std::min(z1, _zNumCells-1); z++) {
+					_insertNearestAgentsInCell((unsigned int)(x * _zNumCells + z), i, k, rangeSq, neighbors);
+				}
+			}
+			else {
+				if (z0 >= 0) _insertNearestAgentsInCell((unsigned int)(x * _zNumCells + z0), i, k, rangeSq, neighbors);
+				if (z1 < _zNumCells) _insertNearestAgentsInCell((unsigned int)(x * _zNumCells + z1), i, k, rangeSq, neighbors);
+			}
+		}
+
+		if ((x0 <= 0) && (z0 <= 0) && (x1 >= _xNumCells-1) && (z1 >= _zNumCells-1)) break;
+
+		float distanceToNextRing = std::min(std::min(_x[i] - (_xOrigin + x0*_cellSize), (_xOrigin + (x1+1)*_cellSize) - _x[i]),
+			std::min(_z[i] - (_zOrigin + z0*_cellSize), (_zOrigin + (z1+1)*_cellSize) - _z[i]));
+		if ((distanceToNextRing > 0.0f) && (distanceToNextRing * distanceToNextRing >= rangeSq)) break;
+	}
+}
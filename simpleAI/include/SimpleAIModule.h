@@ -46,6 +46,8 @@ namespace SimpleAIGlobals {
 	extern bool gShowAllStats;
 
 	extern PhaseProfilers * gPhaseProfilers;
+	/// False when agents may be updated on several threads; the shared aiProfiler is not thread-safe.
+	extern bool gProfileAgentUpdates;
 }
 
 
@@ -79,6 +81,8 @@ public:
 	void finish();
 	SteerLib::AgentInterface * createAgent();
 	void destroyAgent( SteerLib::AgentInterface * agent );
+	/// SimpleAgents never read other agents, and the engine defers their spatial database updates; aiProfiler is skipped when numThreads > 1.
+	bool hasThreadSafeAgents() { return true; }
 
 	void preprocessFrame(float timeStamp, float dt, unsigned int frameNumber);
 	void postprocessFrame(float timeStamp, float dt, unsigned int frameNumber);
@@ -34,6 +34,7 @@ namespace SimpleAIGlobals
 	bool gShowAllStats;
 
 	PhaseProfilers * gPhaseProfilers;
+	bool gProfileAgentUpdates;
 }
 
 using namespace SimpleAIGlobals;
@@ -58,6 +59,7 @@ void SimpleAIModule::init( const SteerLib::OptionDictionary & options, SteerLib:
 	gShowStats = false;
 	logStats = false;
 	gShowAllStats = false;
+	gProfileAgentUpdates = (engineInfo->getOptions().engineOptions.numThreads <= 1);
 	logFilename = "simpleAI.log";
 
 	SteerLib::OptionDictionary::const_iterator optionIter;
@@ -91,7 +91,7 @@ void SimpleAgent::updateAI(float timeStamp, float dt, unsigned int frameNumber)
 {
 	// for this function, we assume that all goals are of type GOAL_TYPE_SEEK_STATIC_TARGET.
 	// the error check for this was performed in reset().
-	Util::AutomaticFunctionProfiler profileThisFunction( &SimpleAIGlobals::gPhaseProfilers->aiProfiler );
+	Util::AutomaticFunctionProfiler profileThisFunction( SimpleAIGlobals::gProfileAgentUpdates ? &SimpleAIGlobals::gPhaseProfilers->aiProfiler : NULL );
 
 	Util::Vector vectorToGoal = _goalQueue.front().targetLocation - _position;
 
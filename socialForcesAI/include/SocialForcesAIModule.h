@@ -14,6 +14,8 @@
 #include "SteerLib.h"
 #include <vector>
 #include "SocialForces_Parameters.h"
+#include "SocialForcesBatch.h"
+#include "SocialForcesAgentPool.h"
 #include "Logger.h"
 
 
@@ -64,6 +66,8 @@ public:
 	void finish();
 	SteerLib::AgentInterface * createAgent();
 	void destroyAgent( SteerLib::AgentInterface * agent );
+	/// senseAI() only reads other agents and the spatial database, and actAI() only writes the agent itself and the spatial database; aiProfiler is skipped when they run on several threads.
+	bool hasThreadSafeTwoPhaseAgents() { return true; }
 
 	void preprocessFrame(float timeStamp, float dt, unsigned int frameNumber);
 	void postprocessFrame(float timeStamp, float dt, unsigned int frameNumber);
@@ -77,6 +81,18 @@ protected:
 	std::vector<LogObject *> _logData;
 
 	SteerLib::EngineInterface * _gEngine;
+
+	/// Neighbor lists of all engine agents for the current frame, indexed like _gEngine->getAgents().
+	std::vector< std::vector<SteerLib::SpatialDatabaseItemPtr> > _neighborLists;
+
+	/// Storage of the agents made by createAgent(); destroyAgent() gives them back for reuse.
+	SocialForcesAgentPool _agentPool;
+
+	/// Computes the agent-agent forces of all agents in preprocessFrame(), with the batched_forces option.
+	SocialForcesBatch _batch;
+	/// Which agents the batch computes, and their parameters; indexed like _gEngine->getAgents().
+	std::vector<char> _batchComputeAgent;
+	std::vector<SocialForcesBatch::AgentParameters> _batchParameters;
 };
 
 #endif
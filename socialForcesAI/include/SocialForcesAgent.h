@@ -36,6 +36,8 @@ public:
 	~SocialForcesAgent();
 	void reset(const SteerLib::AgentInitialConditions & initialConditions, SteerLib::EngineInterface * engineInfo);
 	void updateAI(float timeStamp, float dt, unsigned int frameNumber);
+	void senseAI(float timeStamp, float dt, unsigned int frameNumber);
+	void actAI(float timeStamp, float dt, unsigned int frameNumber);
 	void disable();
 	void draw();
 	bool enabled() const { return _enabled; }
@@ -94,6 +96,21 @@ protected:
 
 	SteerLib::EngineInterface * _gEngine;
 
+	/// Reused by _findNeighbors() so its queries stop allocating once the buffer has grown; only those small, fixed-size queries use it, which bounds what each agent keeps.
+	std::vector<SteerLib::SpatialDatabaseItemPtr> _neighborBuffer;
+	/// This frame's neighbors, computed for all agents at once by SocialForcesAIModule::preprocessFrame(); NULL if the agent has to query the database itself.
+	const std::vector<SteerLib::SpatialDatabaseItemPtr> * _precomputedNeighbors;
+	/// Returns the precomputed neighbors if there are any, otherwise queries the box of _radius + sf_query_radius around the agent into _neighborBuffer.
+	const std::vector<SteerLib::SpatialDatabaseItemPtr> & _findNeighbors();
+	/// True if SocialForcesAIModule::preprocessFrame() computed this frame's agent-agent forces for this agent, with the batched_forces option.
+	bool _hasBatchedAgentForces;
+	/// The agent repulsion force computed by the batch, used instead of visiting the agent neighbors in calcAgentRepulsionForce().
+	Util::Vector _batchedAgentRepulsionForce;
+	/// The proximity force of the agent neighbors computed by the batch; calcProximityForce() then only visits obstacles.
+	Util::Vector _batchedAgentProximityForce;
+	/// Returns the spatial database's obstacle distance field if the wall_distance_field option is on and this agent queries the module's radius; the wall forces then use it instead of testing each obstacle.
+	const SteerLib::ObstacleDistanceField * _wallDistanceField();
+
 	// Used to store Waypoints between goals
 	// A waypoint is choosen every FURTHEST_LOCAL_TARGET_DISTANCE
 
@@ -104,7 +121,16 @@ private:
 	// bool hasLineOfSightTo(Util::Point point);
 
 
+	/// Sets the parameters and flags that the constructor sets, and empties the goal, path and neighbor containers; used by the constructor and SocialForcesAgentPool::allocate().
+	void _resetToConstructedState();
+
 	void calcNextStep(float dt);
+	/// Computes _newVelocity from the current positions and velocities of this agent and its neighbors, without moving anything.
+	void calcNewVelocity(float dt);
+	/// Moves the agent with _newVelocity, updates the spatial database, and advances or disables the goal.
+	void applyNewVelocity(float dt);
+	/// The goal-seeking leader shares its position with followers through DPosition.
+	void publishLeaderPosition();
 	Util::Vector calcRepulsionForce(float dt);
 	Util::Vector calcProximityForce(float dt);
 
@@ -119,6 +145,7 @@ private:
 	// holds the location of the best local target along the midtermpath
 
 	friend class SocialForcesAIModule;
+	friend class SocialForcesAgentPool;
 
 };
 
@@ -0,0 +1,56 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+#ifndef __SocialForces_AGENT_POOL_H__
+#define __SocialForces_AGENT_POOL_H__
+
+/// @file SocialForcesAgentPool.h
+/// @brief Declares the SocialForcesAgentPool class, the storage of the agents that SocialForcesAIModule creates.
+
+#include <vector>
+
+/// Number of agents allocated at once when the pool runs out of free agents.
+#define SF_AGENT_POOL_BLOCK_SIZE 64
+
+class SocialForcesAgent;
+
+
+/**
+ * @brief Allocates SocialForcesAgent objects in contiguous blocks, and recycles the ones that are destroyed.
+ *
+ * Agents created one after the other sit next to each other in memory, which is the order in which the engine updates
+ * them.  A destroyed agent is not deleted:  it goes to a free list and is handed out again by the next allocate(), which
+ * returns it to the state of a newly constructed agent but keeps whatever its goal, path and neighbor containers still hold
+ * after clear(), so that scenarios that keep creating and destroying agents mostly stop going through the allocator.
+ *
+ * Agent pointers stay valid until the pool itself is destroyed, which deletes every block.
+ */
+class SocialForcesAgentPool
+{
+public:
+	SocialForcesAgentPool() : _numAgentsInLastBlock(SF_AGENT_POOL_BLOCK_SIZE) { }
+	~SocialForcesAgentPool();
+
+	/// Returns an agent in the state of a newly constructed one; recently released agents are reused first.
+	SocialForcesAgent * allocate();
+	/// Gives an agent from allocate() back to the pool; the caller must not use it any more.
+	void release(SocialForcesAgent * agent);
+
+protected:
+	/// Arrays of SF_AGENT_POOL_BLOCK_SIZE agents; only the last one can have agents that were never handed out.
+	std::vector<SocialForcesAgent*> _blocks;
+	/// Number of agents of the last block that were handed out at least once.
+	unsigned int _numAgentsInLastBlock;
+	/// Released agents, reused last-in first-out while their memory is still likely to be cached.
+	std::vector<SocialForcesAgent*> _freeAgents;
+
+private:
+	// the pool owns its blocks, so it cannot be copied.
+	SocialForcesAgentPool(const SocialForcesAgentPool &);
+	SocialForcesAgentPool & operator=(const SocialForcesAgentPool &);
+};
+
+#endif
@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+#ifndef __SocialForces_BATCH_H__
+#define __SocialForces_BATCH_H__
+
+/// @file SocialForcesBatch.h
+/// @brief Declares the SocialForcesBatch class, which computes the agent-agent social forces of all agents at once.
+
+#include <vector>
+#include "SteerLib.h"
+
+
+/**
+ * @brief Computes the agent-agent forces of many social forces agents at once, from a structure-of-arrays snapshot.
+ *
+ * SocialForcesAgent::calcAgentRepulsionForce() and the agent part of SocialForcesAgent::calcProximityForce() visit one
+ * neighbor at a time, through AgentInterface virtual functions and Util::Vector temporaries.  This class instead copies
+ * every neighbor's position, velocity and radius next to the agent it pushes, so that the forces are evaluated four
+ * neighbors at a time with SSE2 (with a scalar loop where SSE2 is not available), using a polynomial approximation of exp().
+ *
+ * The forces are the same as the per-agent ones, but every agent sees the same snapshot, which is only what the agents
+ * themselves see when the engine updates them in two phases; and sums are taken in a different order, so results differ
+ * in the last bits.
+ *
+ * Storage is reused between frames, so the batch stops allocating once the crowd stops growing.
+ */
+class SocialForcesBatch
+{
+public:
+	/// The parameters of the agent that the forces act on.
+	struct AgentParameters {
+		float agentA;
+		float agentB;
+		float agentBodyForce;
+		float slidingFrictionForce;
+	};
+
+	/**
+	 * @brief Takes the snapshot:  copies the state of every agent, and of the agent neighbors of the agents that are computed.
+	 *
+	 * neighborLists is indexed like agents, as filled by SpatialDataBaseInterface::computeAllAgentNeighbors(); items that are
+	 * not agents of the list are skipped.  parameters only has to be set for agents whose computeAgent entry is true.
+	 */
+	void gather(const std::vector<SteerLib::AgentInterface*> & agents, const std::vector< std::vector<SteerLib::SpatialDatabaseItemPtr> > & neighborLists,
+		const std::vector<char> & computeAgent, const std::vector<AgentParameters> & parameters);
+	/// Computes the forces on every agent that was marked in gather(); the others get zero forces.
+	void computeForces(float dt);
+
+	/// Returns the agent repulsion force (body force and sliding friction) on agent i, like SocialForcesAgent::calcAgentRepulsionForce().
+	inline Util::Vector getRepulsionForce(unsigned int i) const { return Util::Vector(_repulsionX[i], 0.0f, _repulsionZ[i]); }
+	/// Returns the sum of the proximity forces of the agent neighbors on agent i.
+	inline Util::Vector getProximityForce(unsigned int i) const { return Util::Vector(_proximityX[i], 0.0f, _proximityZ[i]); }
+
+protected:
+	/// Evaluates the forces on agent i from its neighbors; the vectorized and scalar versions share the layout.
+	void _computeAgentForces(unsigned int i, float dt);
+
+	/// @name Per-agent data, one array per field, indexed like the agents given to gather().
+	//@{
+	std::vector<float> _x, _z, _velocityX, _velocityZ, _radius;
+	std::vector<AgentParameters> _parameters;
+	/// The neighbors of agent i are [_neighborStart[i], _neighborStart[i] + _numNeighbors[i]); every start is a multiple of four.
+	std::vector<unsigned int> _neighborStart, _numNeighbors;
+	std::vector<float> _repulsionX, _repulsionZ, _proximityX, _proximityZ;
+	//@}
+
+	/// @name Per-neighbor copies of the neighbor's state, padded to a multiple of four per agent.
+	//@{
+	std::vector<float> _neighborX, _neighborZ, _neighborVelocityX, _neighborVelocityZ, _neighborRadius;
+	//@}
+
+	/// Agents sorted by pointer, with their index, to turn neighbor pointers into indices.
+	std::vector< std::pair<SteerLib::SpatialDatabaseItemPtr, unsigned int> > _agentIndices;
+};
+
+#endif
@@ -31,6 +31,8 @@
 #define WALL_B 0.08f //  inverse proximity force importance
 #define WALL_A 25.0f //  proximity force importance
 #define FURTHEST_LOCAL_TARGET_DISTANCE 45
+#define WALL_DISTANCE_FIELD_SPACING 0.25f // sample spacing of the obstacle distance field used by the wall_distance_field option
+#define WALL_DISTANCE_FIELD_MIN_DISTANCE 0.05f // wall forces divide by the distance, so it is kept at least this large
 
 
 #define MASS 1
@@ -70,6 +72,8 @@ namespace SocialForcesGlobals {
 	extern bool gShowStats;
 	extern bool gShowAllStats;
 	extern bool dont_plan;
+	extern bool gUseWallDistanceField;
+	extern bool gUseBatchedForces;
 
 
 	// Adding a bunch of parameters so they can be changed via input
@@ -89,6 +93,8 @@ namespace SocialForcesGlobals {
 
 
 	extern PhaseProfilers * gPhaseProfilers;
+	/// False when senseAI()/actAI() may run on several threads; the shared aiProfiler is not thread-safe.
+	extern bool gProfileAgentUpdates;
 }
 
 
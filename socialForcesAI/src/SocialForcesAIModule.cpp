@@ -35,6 +35,8 @@ namespace SocialForcesGlobals
 	bool gShowStats;
 	bool gShowAllStats;
 	bool dont_plan;
+	bool gUseWallDistanceField;
+	bool gUseBatchedForces;
 
 
 	// Adding a bunch of parameters so they can be changed via input
@@ -53,6 +55,7 @@ namespace SocialForcesGlobals
 
 
 	PhaseProfilers * gPhaseProfilers;
+	bool gProfileAgentUpdates;
 }
 
 using namespace SocialForcesGlobals;
@@ -79,8 +82,11 @@ void SocialForcesAIModule::init( const SteerLib::OptionDictionary & options, Ste
 	gShowStats = false;
 	logStats = false;
 	gShowAllStats = false;
+	gProfileAgentUpdates = (engineInfo->getOptions().engineOptions.numThreads <= 1) || !engineInfo->getOptions().engineOptions.twoPhaseAgentUpdate;
 	logFilename = "sfAI.log";
 	dont_plan = false;
+	gUseWallDistanceField = false;
+	gUseBatchedForces = false;
 
 	sf_acceleration = ACCELERATION;
 	sf_personal_space_threshold = PERSONAL_SPACE_THRESHOLD;
@@ -175,6 +181,14 @@ void SocialForcesAIModule::init( const SteerLib::OptionDictionary & options, Ste
 		{
 			dont_plan = Util::getBoolFromString(value.str());
 		}
+		else if ((*optionIter).first == "wall_distance_field")
+		{
+			gUseWallDistanceField = Util::getBoolFromString(value.str());
+		}
+		else if ((*optionIter).first == "batched_forces")
+		{
+			gUseBatchedForces = Util::getBoolFromString(value.str());
+		}
 		else
 		{
 			// throw Util::GenericException("unrecognized option \"" + Util::toString((*optionIter).first) + "\" given to PPR AI module.");
@@ -232,8 +246,11 @@ void SocialForcesAIModule::finish()
 
 void SocialForcesAIModule::preprocessSimulation()
 {
-
-
+	if (gUseWallDistanceField)
+	{
+		// walls farther than the query radius would not have been found by the neighbor queries either.
+		_gEngine->getSpatialDatabase()->buildObstacleDistanceField(sf_query_radius, WALL_DISTANCE_FIELD_SPACING);
+	}
 }
 
 void SocialForcesAIModule::preprocessFrame(float timeStamp, float dt, unsigned int frameNumber)
@@ -245,7 +262,47 @@ void SocialForcesAIModule::preprocessFrame(float timeStamp, float dt, unsigned i
 	}
 	if ( !agents_.empty() )
 	{
+		// one batched neighbor query per frame replaces the three range queries every agent would otherwise make.
+		const std::vector<SteerLib::AgentInterface*> & agents = _gEngine->getAgents();
+		_gEngine->getSpatialDatabase()->computeAllAgentNeighbors(agents, sf_query_radius, _neighborLists);
+		// the agent-agent forces can only be computed up front if every agent senses the same snapshot, i.e., in two-phase updates.
+		bool batched = gUseBatchedForces && _gEngine->getOptions().engineOptions.twoPhaseAgentUpdate;
+		if (batched)
+		{
+			_batchComputeAgent.assign(agents.size(), 0);
+			_batchParameters.resize(agents.size());
+		}
+		for (unsigned int i = 0; i < agents.size(); i++)
+		{
+			SocialForcesAgent * agent = dynamic_cast<SocialForcesAgent *>(agents[i]);
+			if (agent == NULL) continue;
+			// agents whose query radius was changed individually keep querying for themselves.
+			bool usable = agent->enabled() && (agent->_SocialForcesParams.sf_query_radius == sf_query_radius);
+			agent->_precomputedNeighbors = usable ? &_neighborLists[i] : NULL;
+			agent->_hasBatchedAgentForces = false;
+			if (batched && usable)
+			{
+				_batchComputeAgent[i] = 1;
+				_batchParameters[i].agentA = agent->_SocialForcesParams.sf_agent_a;
+				_batchParameters[i].agentB = agent->_SocialForcesParams.sf_agent_b;
+				_batchParameters[i].agentBodyForce = agent->_SocialForcesParams.sf_agent_body_force;
+				_batchParameters[i].slidingFrictionForce = agent->_SocialForcesParams.sf_sliding_friction_force;
+			}
+		}
 
+		if (batched)
+		{
+			_batch.gather(agents, _neighborLists, _batchComputeAgent, _batchParameters);
+			_batch.computeForces(dt);
+			for (unsigned int i = 0; i < agents.size(); i++)
+			{
+				if (!_batchComputeAgent[i]) continue;
+				SocialForcesAgent * agent = static_cast<SocialForcesAgent *>(agents[i]);
+				agent->_hasBatchedAgentForces = true;
+				agent->_batchedAgentRepulsionForce = _batch.getRepulsionForce(i);
+				agent->_batchedAgentProximityForce = _batch.getProximityForce(i);
+			}
+		}
 	}
 
 	/*
@@ -264,7 +321,7 @@ void SocialForcesAIModule::postprocessFrame(float timeStamp, float dt, unsigned
 }
 SteerLib::AgentInterface * SocialForcesAIModule::createAgent()
 {
-	SocialForcesAgent * agent = new SocialForcesAgent;
+	SocialForcesAgent * agent = _agentPool.allocate();
 	agent->rvoModule = this;
 	agent->id_ = agents_.size();
 	agents_.push_back(agent);
@@ -301,8 +358,12 @@ void SocialForcesAIModule::destroyAgent( SteerLib::AgentInterface * agent )
 	}*/
 
 
-	// TODO this is going to be a memory leak for now.
-	delete agent;
+	SocialForcesAgent * sfAgent = dynamic_cast<SocialForcesAgent *>(agent);
+	if (sfAgent == NULL)
+	{
+		throw Util::GenericException("SocialForcesAIModule::destroyAgent() was given an agent that it did not create.");
+	}
+	_agentPool.release(sfAgent);
 	/*
 	if (agent && &agents_ && (agents_.size() > 1))
 	{
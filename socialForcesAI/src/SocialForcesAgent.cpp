@@ -29,6 +29,11 @@ Util::Point DPosition;
 // #define _DEBUG_ENTROPY 1
 
 SocialForcesAgent::SocialForcesAgent()
+{
+	_resetToConstructedState();
+}
+
+void SocialForcesAgent::_resetToConstructedState()
 {
 	_SocialForcesParams.sf_acceleration = sf_acceleration;
 	_SocialForcesParams.sf_personal_space_threshold = sf_personal_space_threshold;
@@ -43,7 +48,20 @@ SocialForcesAgent::SocialForcesAgent()
 	_SocialForcesParams.sf_wall_a = sf_wall_a;
 	_SocialForcesParams.sf_max_speed = sf_max_speed;
 
+	_precomputedNeighbors = NULL;
+	_hasBatchedAgentForces = false;
 	_enabled = false;
+
+	// clear() keeps what the containers have allocated, for an agent recycled by SocialForcesAgentPool.
+	_waypoints.clear();
+	_midTermPath.clear();
+	while (!_goalQueue.empty())
+	{
+		_goalQueue.pop();
+	}
+	_neighborBuffer.clear();
+	agentNeighbors_.clear();
+	obstacleNeighbors_.clear();
 }
 
 SocialForcesAgent::~SocialForcesAgent()
@@ -249,26 +267,55 @@ std::pair<float, Util::Point> minimum_distance(Util::Point l1, Util::Point l2, U
 }
 
 
+const std::vector<SteerLib::SpatialDatabaseItemPtr> & SocialForcesAgent::_findNeighbors()
+{
+	if (_precomputedNeighbors != NULL)
+	{
+		return *_precomputedNeighbors;
+	}
+	getSimulationEngine()->getSpatialDatabase()->getItemsInRange(_neighborBuffer,
+			_position.x-(this->_radius + _SocialForcesParams.sf_query_radius),
+			_position.x+(this->_radius + _SocialForcesParams.sf_query_radius),
+			_position.z-(this->_radius + _SocialForcesParams.sf_query_radius),
+			_position.z+(this->_radius + _SocialForcesParams.sf_query_radius),
+			dynamic_cast<SteerLib::SpatialDatabaseItemPtr>(this));
+	return _neighborBuffer;
+}
+
+const SteerLib::ObstacleDistanceField * SocialForcesAgent::_wallDistanceField()
+{
+	if ( !gUseWallDistanceField || (_SocialForcesParams.sf_query_radius != sf_query_radius) )
+	{
+		// the field only reaches as far as the module's query radius.
+		return NULL;
+	}
+	return getSimulationEngine()->getSpatialDatabase()->getObstacleDistanceField();
+}
+
 Util::Vector SocialForcesAgent::calcProximityForce(float dt)
 {
-	std::set<SteerLib::SpatialDatabaseItemPtr> _neighbors;
-		getSimulationEngine()->getSpatialDatabase()->getItemsInRange(_neighbors,
-				_position.x-(this->_radius + _SocialForcesParams.sf_query_radius),
-				_position.x+(this->_radius + _SocialForcesParams.sf_query_radius),
-				_position.z-(this->_radius + _SocialForcesParams.sf_query_radius),
-				_position.z+(this->_radius + _SocialForcesParams.sf_query_radius),
-				dynamic_cast<SteerLib::SpatialDatabaseItemPtr>(this));
+	const std::vector<SteerLib::SpatialDatabaseItemPtr> & _neighbors = _findNeighbors();
+	const SteerLib::ObstacleDistanceField * wallField = _wallDistanceField();
 
 	SteerLib::AgentInterface * tmp_agent;
 	SteerLib::ObstacleInterface * tmp_ob;
 	Util::Vector away = Util::Vector(0,0,0);
 	Util::Vector away_obs = Util::Vector(0,0,0);
 
-	for (std::set<SteerLib::SpatialDatabaseItemPtr>::iterator neighbour = _neighbors.begin();  neighbour != _neighbors.end();  neighbour++)
+	if ( _hasBatchedAgentForces )
+	{
+		away = _batchedAgentProximityForce;
+	}
+
+	for (std::vector<SteerLib::SpatialDatabaseItemPtr>::const_iterator neighbour = _neighbors.begin();  neighbour != _neighbors.end();  neighbour++)
 	// for (int a =0; a < tmp_agents.size(); a++)
 	{
 		if ( (*neighbour)->isAgent() )
 		{
+			if ( _hasBatchedAgentForces )
+			{
+				continue;
+			}
 			tmp_agent = dynamic_cast<SteerLib::AgentInterface *>(*neighbour);
 
 			// direction away from other agent
@@ -337,6 +384,11 @@ Util::Vector SocialForcesAgent::calcProximityForce(float dt)
 		}
 		else
 		{
+			if ( wallField != NULL )
+			{
+				// the nearest wall is looked up once, after the agents.
+				continue;
+			}
 			// It is an obstacle
 			tmp_ob = dynamic_cast<SteerLib::ObstacleInterface *>(*neighbour);
 			CircleObstacle * obs_cir = dynamic_cast<SteerLib::CircleObstacle *>(tmp_ob);
@@ -418,6 +470,24 @@ Util::Vector SocialForcesAgent::calcProximityForce(float dt)
 		}
 
 	}
+
+	float wall_distance;
+	Util::Vector away_wall;
+	if ( wallField != NULL && wallField->getDistance(position(), wall_distance, away_wall) )
+	{
+		away_obs = away_obs +
+				(
+					away_wall
+					*
+					(
+						_SocialForcesParams.sf_wall_a
+						*
+						exp( (this->radius() - wall_distance) / _SocialForcesParams.sf_wall_b )
+					)
+					*
+					dt
+				);
+	}
 	return away + away_obs;
 }
 
@@ -433,19 +503,18 @@ Util::Vector SocialForcesAgent::calcRepulsionForce(float dt)
 Util::Vector SocialForcesAgent::calcAgentRepulsionForce(float dt)
 {
 
+	if ( _hasBatchedAgentForces )
+	{
+		return _batchedAgentRepulsionForce;
+	}
+
 	Util::Vector agent_repulsion_force = Util::Vector(0,0,0);
 
-	std::set<SteerLib::SpatialDatabaseItemPtr> _neighbors;
-		getSimulationEngine()->getSpatialDatabase()->getItemsInRange(_neighbors,
-				_position.x-(this->_radius + _SocialForcesParams.sf_query_radius),
-				_position.x+(this->_radius + _SocialForcesParams.sf_query_radius),
-				_position.z-(this->_radius + _SocialForcesParams.sf_query_radius),
-				_position.z+(this->_radius + _SocialForcesParams.sf_query_radius),
-				(this));
+	const std::vector<SteerLib::SpatialDatabaseItemPtr> & _neighbors = _findNeighbors();
 
 	SteerLib::AgentInterface * tmp_agent;
 
-	for (std::set<SteerLib::SpatialDatabaseItemPtr>::iterator neighbour = _neighbors.begin();  neighbour != _neighbors.end();  neighbour++)
+	for (std::vector<SteerLib::SpatialDatabaseItemPtr>::const_iterator neighbour = _neighbors.begin();  neighbour != _neighbors.end();  neighbour++)
 	// for (int a =0; a < tmp_agents.size(); a++)
 	{
 		if ( (*neighbour)->isAgent() )
@@ -502,18 +571,49 @@ Util::Vector SocialForcesAgent::calcWallRepulsionForce(float dt)
 
 	Util::Vector wall_repulsion_force = Util::Vector(0,0,0);
 
+	const SteerLib::ObstacleDistanceField * wallField = _wallDistanceField();
+	if ( wallField != NULL )
+	{
+		// one lookup of the nearest wall replaces testing every obstacle around the agent.
+		float wall_distance;
+		Util::Vector wall_normal;
+		if ( wallField->getDistance(position(), wall_distance, wall_normal) )
+		{
+			float penetration = radius() - wall_distance;
+			if ( penetration > 0.000001 )
+			{
+				float distance = std::max(wall_distance, WALL_DISTANCE_FIELD_MIN_DISTANCE);
+				wall_repulsion_force = wall_repulsion_force +
+					((
+						wall_normal
+						*
+						(
+							radius() +
+							_SocialForcesParams.sf_personal_space_threshold -
+							wall_distance
+						)
+						/
+						distance
+					)* _SocialForcesParams.sf_body_force * dt);
+				// tangential force
+				wall_repulsion_force = wall_repulsion_force +
+				(
+					dot(forward(),  rightSideInXZPlane(wall_normal))
+					*
+					rightSideInXZPlane(wall_normal)
+					*
+					penetration
+				)* _SocialForcesParams.sf_sliding_friction_force * dt;
+			}
+		}
+		return wall_repulsion_force;
+	}
 
-	std::set<SteerLib::SpatialDatabaseItemPtr> _neighbors;
-		getSimulationEngine()->getSpatialDatabase()->getItemsInRange(_neighbors,
-				_position.x-(this->_radius + _SocialForcesParams.sf_query_radius),
-				_position.x+(this->_radius + _SocialForcesParams.sf_query_radius),
-				_position.z-(this->_radius + _SocialForcesParams.sf_query_radius),
-				_position.z+(this->_radius + _SocialForcesParams.sf_query_radius),
-				dynamic_cast<SteerLib::SpatialDatabaseItemPtr>(this));
+	const std::vector<SteerLib::SpatialDatabaseItemPtr> & _neighbors = _findNeighbors();
 
 	SteerLib::ObstacleInterface * tmp_ob;
 
-	for (std::set<SteerLib::SpatialDatabaseItemPtr>::iterator neighbour = _neighbors.begin();  neighbour != _neighbors.end();  neighbour++)
+	for (std::vector<SteerLib::SpatialDatabaseItemPtr>::const_iterator neighbour = _neighbors.begin();  neighbour != _neighbors.end();  neighbour++)
 	// for (std::set<SteerLib::ObstacleInterface * >::iterator tmp_o = _neighbors.begin();  tmp_o != _neighbors.end();  tmp_o++)
 	{
 		if ( !(*neighbour)->isAgent() )
@@ -769,7 +869,8 @@ void SocialForcesAgent::computeNeighbors()
 //A3 Choice 1: Leader Following
 Util::Vector SocialForcesAgent::LeaderFollowing(SteerLib::AgentGoalInfo goalInfo, Util::Vector goalDirection){
 	//get all neighbors of agent
-	std::set<SteerLib::SpatialDatabaseItemPtr> Neighbors;
+	// a local buffer: keeping the capacity of this near-global query in every agent would cost O(N^2) memory for the crowd
+	std::vector<SteerLib::SpatialDatabaseItemPtr> Neighbors;
 	getSimulationEngine()->getSpatialDatabase()->getItemsInRange(Neighbors,-100.0f,100.0f,-100.0f,100.0f,dynamic_cast<SteerLib::SpatialDatabaseItemPtr>(this));
 	
 	//initialize all agent and conditions
@@ -783,7 +884,6 @@ Util::Vector SocialForcesAgent::LeaderFollowing(SteerLib::AgentGoalInfo goalInfo
 
 		leader=this;
 		this->_color = Util::gRed;
-		DPosition=position();
 
 		if ( ! _midTermPath.empty() && (!this->hasLineOfSightTo(goalInfo.targetLocation)) ){
 			if (reachedCurrentWaypoint()){
@@ -801,7 +901,7 @@ Util::Vector SocialForcesAgent::LeaderFollowing(SteerLib::AgentGoalInfo goalInfo
 	}
 
 	//loop through all agent's neighbors
-	for(std::set<SteerLib::SpatialDatabaseItemPtr>::iterator neighbor=Neighbors.begin();neighbor!=Neighbors.end();neighbor++){
+	for(std::vector<SteerLib::SpatialDatabaseItemPtr>::iterator neighbor=Neighbors.begin();neighbor!=Neighbors.end();neighbor++){
 		if((*neighbor)->isAgent()){
 			if(goalInfo.goalType==GOAL_TYPE_SEEK_DYNAMIC_TARGET){ //if is follower, update goaldirection base on dposition
 				if(true){//if leader is still alive
@@ -830,7 +930,8 @@ Util::Vector SocialForcesAgent::growingSpiral(float dt) {
 	return v * dt;
 }
 std::vector<SteerLib::AgentInterface*> SocialForcesAgent::getNeighbors(float search_radius){
-	std::set<SteerLib::SpatialDatabaseItemPtr> _neighbors;
+	// search_radius is arbitrary, so this query does not reuse _neighborBuffer either
+	std::vector<SteerLib::SpatialDatabaseItemPtr> _neighbors;
 
 	getSimulationEngine()->getSpatialDatabase()->getItemsInRange(_neighbors,
  	_position.x - (this->_radius + search_radius),
@@ -843,7 +944,7 @@ std::vector<SteerLib::AgentInterface*> SocialForcesAgent::getNeighbors(float sea
  	Util::Vector neighbor_avg(0, 0, 0);
  	std::vector<SteerLib::AgentInterface *> neighbors;
 
- 	for (std::set<SteerLib::SpatialDatabaseItemPtr>::iterator neighbour = _neighbors.begin(); neighbour != _neighbors.end(); neighbour++) {
+ 	for (std::vector<SteerLib::SpatialDatabaseItemPtr>::iterator neighbour = _neighbors.begin(); neighbour != _neighbors.end(); neighbour++) {
  		if ((*neighbour)->isAgent()) {
     		tmp_agent = dynamic_cast<SteerLib::AgentInterface *>(*neighbour);
   		}else {
@@ -899,14 +1000,55 @@ Util::Vector SocialForcesAgent::calcUnalignedCollisionAvoidance(SteerLib::AgentG
 void SocialForcesAgent::updateAI(float timeStamp, float dt, unsigned int frameNumber)
 {
 	// std::cout << "_SocialForcesParams.rvo_max_speed " << _SocialForcesParams._SocialForcesParams.rvo_max_speed << std::endl;
-	Util::AutomaticFunctionProfiler profileThisFunction( &SocialForcesGlobals::gPhaseProfilers->aiProfiler );
+	Util::AutomaticFunctionProfiler profileThisFunction( SocialForcesGlobals::gProfileAgentUpdates ? &SocialForcesGlobals::gPhaseProfilers->aiProfiler : NULL );
 	if (!enabled())
 	{
 		return;
 	}
 
-	Util::AxisAlignedBox oldBounds(_position.x - _radius, _position.x + _radius, 0.0f, 0.0f, _position.z - _radius, _position.z + _radius);
+	// followers updated after the leader in this frame steer towards where the leader is now
+	publishLeaderPosition();
+	calcNewVelocity(dt);
+	applyNewVelocity(dt);
+}
+
+void SocialForcesAgent::senseAI(float timeStamp, float dt, unsigned int frameNumber)
+{
+	Util::AutomaticFunctionProfiler profileThisFunction( SocialForcesGlobals::gProfileAgentUpdates ? &SocialForcesGlobals::gPhaseProfilers->aiProfiler : NULL );
+	if (!enabled())
+	{
+		return;
+	}
+
+	calcNewVelocity(dt);
+}
+
+void SocialForcesAgent::actAI(float timeStamp, float dt, unsigned int frameNumber)
+{
+	Util::AutomaticFunctionProfiler profileThisFunction( SocialForcesGlobals::gProfileAgentUpdates ? &SocialForcesGlobals::gPhaseProfilers->aiProfiler : NULL );
+	if (!enabled())
+	{
+		return;
+	}
 
+	applyNewVelocity(dt);
+	// DPosition is only written here, so every follower senses the same leader position in the next frame
+	if (enabled())
+	{
+		publishLeaderPosition();
+	}
+}
+
+void SocialForcesAgent::publishLeaderPosition()
+{
+	if (_goalQueue.front().goalType == GOAL_TYPE_SEEK_STATIC_TARGET)
+	{
+		DPosition = position();
+	}
+}
+
+void SocialForcesAgent::calcNewVelocity(float dt)
+{
 	SteerLib::AgentGoalInfo goalInfo = _goalQueue.front();
 	Util::Vector goalDirection;
 	// std::cout << "midtermpath empty: " << _midTermPath.empty() << std::endl;
@@ -954,12 +1096,22 @@ void SocialForcesAgent::updateAI(float timeStamp, float dt, unsigned int frameNu
 		alpha=0;
 	}
 
-	_velocity = (prefForce) + repulsionForce + proximityForce;
+	_newVelocity = (prefForce) + repulsionForce + proximityForce;
 	// _velocity = (prefForce);
 	// _velocity = velocity() + repulsionForce + proximityForce;
 
-	_velocity = clamp(velocity(), _SocialForcesParams.sf_max_speed);
-	_velocity.y=0.0f;
+	_newVelocity = clamp(_newVelocity, _SocialForcesParams.sf_max_speed);
+	_newVelocity.y=0.0f;
+}
+
+void SocialForcesAgent::applyNewVelocity(float dt)
+{
+	Util::AxisAlignedBox oldBounds(_position.x - _radius, _position.x + _radius, 0.0f, 0.0f, _position.z - _radius, _position.z + _radius);
+
+	SteerLib::AgentGoalInfo goalInfo = _goalQueue.front();
+	Util::Vector goalDirection;
+
+	_velocity = _newVelocity;
  #ifdef _DEBUG_
 	std::cout << "agent" << id() << " speed is " << velocity().length() << std::endl;
  #endif
@@ -0,0 +1,46 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+/// @file SocialForcesAgentPool.cpp
+/// @brief Implements the SocialForcesAgentPool class.
+
+#include "SocialForcesAgentPool.h"
+#include "SocialForcesAgent.h"
+
+
+SocialForcesAgentPool::~SocialForcesAgentPool()
+{
+	for (unsigned int i=0; i < _blocks.size(); i++) {
+		delete [] _blocks[i];
+	}
+}
+
+
+SocialForcesAgent * SocialForcesAgentPool::allocate()
+{
+	SocialForcesAgent * agent;
+	if (!_freeAgents.empty()) {
+		agent = _freeAgents.back();
+		_freeAgents.pop_back();
+	}
+	else {
+		if (_numAgentsInLastBlock == SF_AGENT_POOL_BLOCK_SIZE) {
+			_blocks.push_back(new SocialForcesAgent[SF_AGENT_POOL_BLOCK_SIZE]);
+			_numAgentsInLastBlock = 0;
+		}
+		agent = &(_blocks.back()[_numAgentsInLastBlock++]);
+	}
+
+	// also for agents that were never handed out, since the parameter options may have changed since their block was constructed.
+	agent->_resetToConstructedState();
+	return agent;
+}
+
+
+void SocialForcesAgentPool::release(SocialForcesAgent * agent)
+{
+	_freeAgents.push_back(agent);
+}
@@ -0,0 +1,244 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+/// @file SocialForcesBatch.cpp
+/// @brief Implements the SocialForcesBatch class.
+
+#include <algorithm>
+#include <cmath>
+
+#include "SocialForcesBatch.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SF_BATCH_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#undef min
+#undef max
+
+using namespace SteerLib;
+
+
+void SocialForcesBatch::gather(const std::vector<AgentInterface*> & agents, const std::vector< std::vector<SpatialDatabaseItemPtr> > & neighborLists,
+	const std::vector<char> & computeAgent, const std::vector<AgentParameters> & parameters)
+{
+	unsigned int numAgents = (unsigned int)agents.size();
+	_x.resize(numAgents);
+	_z.resize(numAgents);
+	_velocityX.resize(numAgents);
+	_velocityZ.resize(numAgents);
+	_radius.resize(numAgents);
+	_parameters.resize(numAgents);
+	_neighborStart.resize(numAgents);
+	_numNeighbors.resize(numAgents);
+	_agentIndices.resize(numAgents);
+
+	for (unsigned int i=0; i < numAgents; i++) {
+		Util::Point position = agents[i]->position();
+		Util::Vector velocity = agents[i]->velocity();
+		_x[i] = position.x;
+		_z[i] = position.z;
+		_velocityX[i] = velocity.x;
+		_velocityZ[i] = velocity.z;
+		_radius[i] = agents[i]->radius();
+		_agentIndices[i] = std::make_pair((SpatialDatabaseItemPtr)agents[i], i);
+	}
+	std::sort(_agentIndices.begin(), _agentIndices.end());
+
+	_neighborX.clear();
+	_neighborZ.clear();
+	_neighborVelocityX.clear();
+	_neighborVelocityZ.clear();
+	_neighborRadius.clear();
+	for (unsigned int i=0; i < numAgents; i++) {
+		_neighborStart[i] = (unsigned int)_neighborX.size();
+		_numNeighbors[i] = 0;
+		if (!computeAgent[i]) continue;
+		_parameters[i] = parameters[i];
+
+		const std::vector<SpatialDatabaseItemPtr> & neighbors = neighborLists[i];
+		for (unsigned int k=0; k < neighbors.size(); k++) {
+			if (!neighbors[k]->isAgent()) continue;
+			std::vector< std::pair<SpatialDatabaseItemPtr, unsigned int> >::const_iterator found =
+				std::lower_bound(_agentIndices.begin(), _agentIndices.end(), std::make_pair(neighbors[k], 0u));
+			if ((found == _agentIndices.end()) || (found->first != neighbors[k]) || (found->second == i)) continue;
+			unsigned int j = found->second;
+			_neighborX.push_back(_x[j]);
+			_neighborZ.push_back(_z[j]);
+			_neighborVelocityX.push_back(_velocityX[j]);
+			_neighborVelocityZ.push_back(_velocityZ[j]);
+			_neighborRadius.push_back(_radius[j]);
+			_numNeighbors[i]++;
+		}
+
+		// pad to a whole number of lanes; the padding is masked out, but should still be harmless to compute with.
+		while ((_neighborX.size() & 3) != 0) {
+			_neighborX.push_back(_x[i] + 1.0f);
+			_neighborZ.push_back(_z[i]);
+			_neighborVelocityX.push_back(0.0f);
+			_neighborVelocityZ.push_back(0.0f);
+			_neighborRadius.push_back(0.0f);
+		}
+	}
+
+	_repulsionX.assign(numAgents, 0.0f);
+	_repulsionZ.assign(numAgents, 0.0f);
+	_proximityX.assign(numAgents, 0.0f);
+	_proximityZ.assign(numAgents, 0.0f);
+}
+
+
+void SocialForcesBatch::computeForces(float dt)
+{
+	for (unsigned int i=0; i < _x.size(); i++) {
+		if (_numNeighbors[i] != 0) {
+			_computeAgentForces(i, dt);
+		}
+	}
+}
+
+
+#ifdef SF_BATCH_USE_SSE2
+
+/// Returns exp() of each lane, with a relative error of about 2e-7; the range reduction and polynomial are those of the Cephes library's expf().
+static inline __m128 _expApprox(__m128 x)
+{
+	x = _mm_min_ps(x, _mm_set1_ps(88.3762626647949f));
+	x = _mm_max_ps(x, _mm_set1_ps(-88.3762626647949f));
+
+	// x = n*ln(2) + r, with |r| <= ln(2)/2; n = floor(x/ln(2) + 0.5)
+	__m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+	__m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+	n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, fx), _mm_set1_ps(1.0f)));
+	// ln(2) in two parts, so that n*ln(2) is subtracted without losing the low bits of r.
+	x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(0.693359375f)));
+	x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(-2.12194440e-4f)));
+
+	__m128 y = _mm_set1_ps(1.9875691500E-4f);
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507E-3f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073E-3f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894E-2f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459E-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201E-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), _mm_add_ps(x, _mm_set1_ps(1.0f)));
+
+	// multiply by 2^n, building the float's exponent directly.
+	__m128i exponent = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(y, _mm_castsi128_ps(exponent));
+}
+
+/// Returns the sum of the four lanes.
+static inline float _horizontalSum(__m128 v)
+{
+	__m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+}
+
+void SocialForcesBatch::_computeAgentForces(unsigned int i, float dt)
+{
+	const AgentParameters & p = _parameters[i];
+	const __m128 xi = _mm_set1_ps(_x[i]);
+	const __m128 zi = _mm_set1_ps(_z[i]);
+	const __m128 vxi = _mm_set1_ps(_velocityX[i]);
+	const __m128 vzi = _mm_set1_ps(_velocityZ[i]);
+	const __m128 ri = _mm_set1_ps(_radius[i]);
+	const __m128 proximityScale = _mm_set1_ps(p.agentA * dt);
+	const __m128 invB = _mm_set1_ps(1.0f / p.agentB);
+	const __m128 bodyScale = _mm_set1_ps(p.agentBodyForce * dt);
+	const __m128 frictionScale = _mm_set1_ps(p.slidingFrictionForce * dt);
+	const __m128 minPenetration = _mm_set1_ps(0.000001f);
+	const __m128 laneIndex = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+	__m128 repulsionX = _mm_setzero_ps();
+	__m128 repulsionZ = _mm_setzero_ps();
+	__m128 proximityX = _mm_setzero_ps();
+	__m128 proximityZ = _mm_setzero_ps();
+
+	unsigned int start = _neighborStart[i];
+	unsigned int numNeighbors = _numNeighbors[i];
+	for (unsigned int k=0; k < numNeighbors; k += 4) {
+		unsigned int n = start + k;
+		__m128 valid = _mm_cmplt_ps(laneIndex, _mm_set1_ps((float)(numNeighbors - k)));
+
+		// direction away from the neighbor
+		__m128 dx = _mm_sub_ps(xi, _mm_loadu_ps(&_neighborX[n]));
+		__m128 dz = _mm_sub_ps(zi, _mm_loadu_ps(&_neighborZ[n]));
+		__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)));
+		__m128 awayX = _mm_div_ps(dx, distance);
+		__m128 awayZ = _mm_div_ps(dz, distance);
+		__m128 penetration = _mm_sub_ps(_mm_add_ps(ri, _mm_loadu_ps(&_neighborRadius[n])), distance);
+
+		// proximity force, from every neighbor
+		__m128 proximity = _mm_mul_ps(proximityScale, _expApprox(_mm_mul_ps(penetration, invB)));
+		proximityX = _mm_add_ps(proximityX, _mm_and_ps(valid, _mm_mul_ps(awayX, proximity)));
+		proximityZ = _mm_add_ps(proximityZ, _mm_and_ps(valid, _mm_mul_ps(awayZ, proximity)));
+
+		// body force and sliding friction, from overlapping neighbors; the tangent is cross(cross(-d, v), -d), normalized.
+		__m128 overlapping = _mm_and_ps(valid, _mm_cmpgt_ps(penetration, minPenetration));
+		__m128 turn = _mm_sub_ps(_mm_mul_ps(dx, vzi), _mm_mul_ps(dz, vxi));
+		__m128 tangentX = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(turn, dz));
+		__m128 tangentZ = _mm_mul_ps(turn, dx);
+		__m128 tangentLength = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(tangentX, tangentX), _mm_mul_ps(tangentZ, tangentZ)));
+		tangentX = _mm_div_ps(tangentX, tangentLength);
+		tangentZ = _mm_div_ps(tangentZ, tangentLength);
+		__m128 tangentVelocity = _mm_add_ps(
+			_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&_neighborVelocityX[n]), vxi), tangentX),
+			_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&_neighborVelocityZ[n]), vzi), tangentZ));
+		__m128 body = _mm_mul_ps(bodyScale, penetration);
+		__m128 friction = _mm_mul_ps(_mm_mul_ps(frictionScale, penetration), tangentVelocity);
+		repulsionX = _mm_add_ps(repulsionX, _mm_and_ps(overlapping, _mm_add_ps(_mm_mul_ps(body, awayX), _mm_mul_ps(friction, tangentX))));
+		repulsionZ = _mm_add_ps(repulsionZ, _mm_and_ps(overlapping, _mm_add_ps(_mm_mul_ps(body, awayZ), _mm_mul_ps(friction, tangentZ))));
+	}
+
+	_repulsionX[i] = _horizontalSum(repulsionX);
+	_repulsionZ[i] = _horizontalSum(repulsionZ);
+	_proximityX[i] = _horizontalSum(proximityX);
+	_proximityZ[i] = _horizontalSum(proximityZ);
+}
+
+#else
+
+void SocialForcesBatch::_computeAgentForces(unsigned int i, float dt)
+{
+	const AgentParameters & p = _parameters[i];
+	float repulsionX = 0.0f, repulsionZ = 0.0f, proximityX = 0.0f, proximityZ = 0.0f;
+
+	unsigned int end = _neighborStart[i] + _numNeighbors[i];
+	for (unsigned int n = _neighborStart[i]; n < end; n++) {
+		float dx = _x[i] - _neighborX[n];
+		float dz = _z[i] - _neighborZ[n];
+		float distance = sqrtf(dx*dx + dz*dz);
+		float awayX = dx / distance;
+		float awayZ = dz / distance;
+		float penetration = (_radius[i] + _neighborRadius[n]) - distance;
+
+		float proximity = p.agentA * dt * expf(penetration / p.agentB);
+		proximityX += awayX * proximity;
+		proximityZ += awayZ * proximity;
+
+		if (penetration > 0.000001f) {
+			float turn = dx*_velocityZ[i] - dz*_velocityX[i];
+			float tangentX = -turn * dz;
+			float tangentZ = turn * dx;
+			float tangentLength = sqrtf(tangentX*tangentX + tangentZ*tangentZ);
+			tangentX /= tangentLength;
+			tangentZ /= tangentLength;
+			float tangentVelocity = (_neighborVelocityX[n] - _velocityX[i])*tangentX + (_neighborVelocityZ[n] - _velocityZ[i])*tangentZ;
+			float body = p.agentBodyForce * dt * penetration;
+			float friction = p.slidingFrictionForce * dt * penetration * tangentVelocity;
+			repulsionX += body*awayX + friction*tangentX;
+			repulsionZ += body*awayZ + friction*tangentZ;
+		}
+	}
+
+	_repulsionX[i] = repulsionX;
+	_repulsionZ[i] = repulsionZ;
+	_proximityX[i] = proximityX;
+	_proximityZ[i] = proximityZ;
+}
+
+#endif
@@ -31,12 +31,15 @@
 #include "interfaces/SpatialDataBaseInterface.h"
 #include "util/GenericException.h"
 #include "griddatabase/GridDatabasePlanningDomain.h"
+#include "griddatabase/CompactGridLayout.h"
+#include "griddatabase/ObstacleDistanceField.h"
 
 #include "obstacles/BoxObstacle.h"
 #include "obstacles/OrientedBoxObstacle.h"
 #include "obstacles/CircleObstacle.h"
 
 #include "planning/BestFirstSearchPlanner.h"
+#include "planning/PathPlanningService.h"
 
 #include "simulation/Camera.h"
 #include "simulation/Clock.h"
@@ -63,8 +63,8 @@ namespace SteerLib {
 		AgentMetricsCollector( SteerLib::AgentInterface * agent );
 		/// Resets all metrics, and uses the latest status of the agent to form new initial conditions.
 		void reset();
-		/// Should be called exactly once every simulation step, after the agent has been updated in that step.
-		void update(SteerLib::SpatialDataBaseInterface * gridDB, SteerLib::AgentInterface * updatedAgent, float currentTimeStamp, float timePassedSinceLastFrame);
+		/// Should be called exactly once every simulation step, after the agent has been updated in that step; precomputedNeighbors, if given, is the agent's list from SpatialDataBaseInterface::computeAllAgentNeighbors() with zero padding, and replaces the collision query.
+		void update(SteerLib::SpatialDataBaseInterface * gridDB, SteerLib::AgentInterface * updatedAgent, float currentTimeStamp, float timePassedSinceLastFrame, const std::vector<SteerLib::SpatialDatabaseItemPtr> * precomputedNeighbors = NULL);
 
 	    /// @name query information for metrics
 		//@{
@@ -84,7 +84,7 @@ namespace SteerLib {
 
 	protected:
 	    void _resetMetrics();
-		void _updateCollisionStats(SteerLib::SpatialDataBaseInterface * gridDB, SteerLib::AgentInterface * updatedAgent, float currentTimeStamp);
+		void _updateCollisionStats(SteerLib::SpatialDataBaseInterface * gridDB, SteerLib::AgentInterface * updatedAgent, float currentTimeStamp, const std::vector<SteerLib::SpatialDatabaseItemPtr> * precomputedNeighbors);
 	    void _checkAndUpdateOneCollision(uintptr_t collisionKey, float penetration, float currentTimeStamp);
 	    void _updateAgentInformation(SteerLib::AgentInterface * updatedAgent);
 
@@ -55,6 +55,8 @@ namespace SteerLib {
 	    void _updateEnvironmentMetrics(SteerLib::SpatialDataBaseInterface * gridDB, float currentTimeStamp, float timePassedSinceLastFrame);
 	    
 	    std::vector<AgentMetricsCollector*> _agentCollectors;
+	    /// Neighbor lists of all agents for the current update, reused between updates.
+	    std::vector< std::vector<SteerLib::SpatialDatabaseItemPtr> > _neighborLists;
 	    EnvironmentMetrics _environmentMetrics;
     
 	};
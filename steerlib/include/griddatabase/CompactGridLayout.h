@@ -0,0 +1,148 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+#ifndef __STEERLIB_COMPACT_GRID_LAYOUT_H__
+#define __STEERLIB_COMPACT_GRID_LAYOUT_H__
+
+/// @file CompactGridLayout.h
+/// @brief Declares the SteerLib::CompactGridLayout class, a read-only structure-of-arrays snapshot of a grid.
+
+#include <set>
+#include <vector>
+
+#include "Globals.h"
+#include "util/Geometry.h"
+#include "interfaces/SpatialDatabaseItem.h"
+
+
+#ifdef _WIN32
+// see GridDatabase2DPrivate.h for why this warning is disabled.
+#pragma warning( push )
+#pragma warning( disable : 4251 )
+#endif
+
+namespace SteerLib {
+
+	// forward declarations
+	class STEERLIB_API AgentInterface;
+	class STEERLIB_API ObstacleInterface;
+	class STEERLIB_API SpatialDataBaseInterface;
+
+	/**
+	 * @brief A compact, read-only copy of a grid, rebuilt from scratch instead of updated incrementally.
+	 *
+	 * The GridDatabase2D stores a pointer per slot, so every query dereferences each candidate item, and calls its
+	 * virtual functions, just to find out where it is.  This class instead stores, for every cell, one contiguous range of
+	 * entries, and every entry keeps a copy of its item's 2-D center, half-extents (the radius, for agents) and flags in
+	 * separate arrays.  Range queries and traces reject candidates using only those arrays; only obstacles that pass
+	 * the bounding box test are asked for an exact intersection.
+	 *
+	 * The layout is rebuilt with a counting sort:  addItem() records the items, then build() counts the entries per
+	 * cell, computes each cell's offset with a prefix sum, and scatters the entries into place.  Storage is reused
+	 * between builds, so rebuilding every frame does not allocate once the crowd stops growing.
+	 *
+	 * <h3> Notes </h3>
+	 *  - The layout uses the same origin, cell size and cell counts as the spatial database it was constructed with,
+	 *    but it keeps its own copy of the items; it does not see changes to that database until the next rebuild.
+	 *  - Agents are treated as circles on the ground plane (y = 0), obstacles by their bounding box until the exact test.
+	 *  - Queries may run on several threads at once; adding items and building may not.
+	 *  - Unlike GridDatabase2D::getItemsInRange(), getItemsInRange() only returns items whose bounds actually overlap
+	 *    the range, not every item in an overlapping cell, and the results are in no particular order.
+	 *
+	 */
+	class STEERLIB_API CompactGridLayout {
+	public:
+		/// Copies the grid geometry of spatialDatabase; the items must be added separately.
+		CompactGridLayout(SpatialDataBaseInterface * spatialDatabase);
+
+		/// @name Building the layout
+		//@{
+		/// Forgets all items; the layout is empty until build() is called again.
+		void clear();
+		/// Records an item to be placed by the next build(); items entirely outside the grid are ignored.
+		void addItem(SpatialDatabaseItemPtr item, const Util::AxisAlignedBox & bounds);
+		/// Records an agent, using its position() and radius() as a circle.
+		void addAgent(AgentInterface * agent);
+		/// Records an obstacle, using its getBounds().
+		void addObstacle(ObstacleInterface * obstacle);
+		/// Sorts the recorded items into their cells.
+		void build();
+		/// Convenience function that calls clear(), adds all enabled agents and all obstacles, and calls build().
+		void rebuild(const std::vector<AgentInterface*> & agents, const std::set<ObstacleInterface*> & obstacles);
+		//@}
+
+		/// @name Queries
+		//@{
+		/// Fills neighborList with every item whose bounds overlap the given range, except exclude; each item appears once.
+		void getItemsInRange(std::vector<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude) const;
+		/// Finds the closest item hit by the ray, with the same meaning of arguments and return value as GridDatabase2D::trace().
+		bool trace(const Util::Ray & r, float & t, SpatialDatabaseItemPtr & hitObject, SpatialDatabaseItemPtr exclude, bool excludeAgents) const;
+		/// Returns true if no item that blocks line of sight lies between p1 and p2, ignoring exclude1 and exclude2.
+		bool hasLineOfSight(const Util::Point & p1, const Util::Point & p2, SpatialDatabaseItemPtr exclude1, SpatialDatabaseItemPtr exclude2) const;
+		/// Returns the number of entries; an item that overlaps several cells has one entry in each.
+		inline unsigned int getNumEntries() const { return (unsigned int)_entryItems.size(); }
+		//@}
+
+	protected:
+		/// Flags stored with every entry.
+		enum EntryFlags {
+			ENTRY_IS_AGENT = 1,
+			ENTRY_BLOCKS_LINE_OF_SIGHT = 2
+		};
+
+		/// An item recorded by addItem(), with the range of cells it overlaps.
+		struct SourceItem {
+			SpatialDatabaseItemPtr item;
+			float x, z, halfWidthX, halfWidthZ;
+			unsigned char flags;
+			unsigned int xMinIndex, xMaxIndex, zMinIndex, zMaxIndex;
+		};
+
+		void _addSourceItem(SpatialDatabaseItemPtr item, float x, float z, float halfWidthX, float halfWidthZ, unsigned char flags);
+		/// Returns the x index of the cell containing x, clamped to the grid.
+		inline unsigned int _clampedCellX(float x) const;
+		/// Returns the z index of the cell containing z, clamped to the grid.
+		inline unsigned int _clampedCellZ(float z) const;
+		/// Walks the cells under the ray in order; if findAny is true, returns as soon as any blocking item is hit.
+		bool _traceCells(const Util::Ray & r, float & t, SpatialDatabaseItemPtr & hitObject, SpatialDatabaseItemPtr exclude1, SpatialDatabaseItemPtr exclude2, unsigned char skipFlags, unsigned char requiredFlags, bool findAny) const;
+		/// Returns true and sets t if the ray hits entry i within the ray's interval.
+		inline bool _intersectsEntry(unsigned int i, const Util::Ray & r, float & t) const;
+
+		float _xOrigin;
+		float _zOrigin;
+		float _xCellSize;
+		float _zCellSize;
+		float _xInvCellSize;
+		float _zInvCellSize;
+		unsigned int _xNumCells;
+		unsigned int _zNumCells;
+
+		/// Items recorded since the last clear().
+		std::vector<SourceItem> _sourceItems;
+
+		/// The entries of cell c are [_cellStart[c], _cellStart[c+1]); the last element is the total number of entries.
+		std::vector<unsigned int> _cellStart;
+		/// Scratch space for build(): the next free entry of each cell.
+		std::vector<unsigned int> _cellCursor;
+
+		/// @name Per-entry data, one array per field.
+		//@{
+		std::vector<SpatialDatabaseItemPtr> _entryItems;
+		std::vector<float> _entryX;
+		std::vector<float> _entryZ;
+		std::vector<float> _entryHalfWidthX;
+		std::vector<float> _entryHalfWidthZ;
+		std::vector<unsigned char> _entryFlags;
+		//@}
+	};
+
+} // end namespace SteerLib
+
+#ifdef _WIN32
+#pragma warning( pop )
+#endif
+
+#endif
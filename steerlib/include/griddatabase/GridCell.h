@@ -14,9 +14,9 @@
 // #include "SteerLib.h"
 #include "util/Geometry.h"
 #include "util/GenericException.h"
-#include "util/Mutex.h"
 // #include "interfaces/AgentInterface.h"
 #include <sstream>
+#include <vector>
 
 #ifdef _WIN32
 // on win32, there is an unfortunate conflit between exporting symbols for a
@@ -33,6 +33,60 @@ namespace SteerLib {
 	class STEERLIB_API SpatialDatabaseItem;
 	typedef SpatialDatabaseItem* SpatialDatabaseItemPtr;
 
+	/**
+	 * @brief Blocks of item pointers shared by all cells of one GridDatabase2D, used when a cell holds more items than fit in its own slots.
+	 *
+	 * Block sizes are powers of two; released blocks are kept on a free list per size and reused,
+	 * so a crowd moving across the grid stops allocating after the first few frames.
+	 * Like GridCell, the pool must only be used by one thread at a time.
+	 */
+	class STEERLIB_API GridCellOverflowPool {
+	public:
+		~GridCellOverflowPool() {
+			for (unsigned int i=0; i < _allBlocks.size(); i++) {
+				delete [] _allBlocks[i];
+			}
+		}
+
+		/// Returns the number of items a block allocated for capacity items actually holds: capacity rounded up to a power of two.
+		static unsigned int blockCapacity(unsigned int capacity) { return 1u << _sizeClass(capacity); }
+
+		/// Returns a block that can hold blockCapacity(capacity) items.
+		SpatialDatabaseItemPtr * allocate(unsigned int capacity) {
+			unsigned int sizeClass = _sizeClass(capacity);
+			if (sizeClass < _freeBlocks.size() && !_freeBlocks[sizeClass].empty()) {
+				SpatialDatabaseItemPtr * block = _freeBlocks[sizeClass].back();
+				_freeBlocks[sizeClass].pop_back();
+				return block;
+			}
+			SpatialDatabaseItemPtr * block = new SpatialDatabaseItemPtr[1u << sizeClass];
+			_allBlocks.push_back(block);
+			return block;
+		}
+
+		/// Gives a block back to the pool for reuse by any cell.
+		void release(SpatialDatabaseItemPtr * block, unsigned int capacity) {
+			unsigned int sizeClass = _sizeClass(capacity);
+			if (sizeClass >= _freeBlocks.size()) {
+				_freeBlocks.resize(sizeClass+1);
+			}
+			_freeBlocks[sizeClass].push_back(block);
+		}
+
+	private:
+		static unsigned int _sizeClass(unsigned int capacity) {
+			unsigned int sizeClass = 0;
+			while ((1u << sizeClass) < capacity) sizeClass++;
+			return sizeClass;
+		}
+
+		/// Released blocks, indexed by log2 of their capacity.
+		std::vector< std::vector<SpatialDatabaseItemPtr*> > _freeBlocks;
+		/// Every block ever allocated, so that they can be deleted with the pool.
+		std::vector<SpatialDatabaseItemPtr*> _allBlocks;
+	};
+
+
 	/**
 	 * @brief A single grid cell of the GridDatabase2D spatial database.
 	 *
@@ -40,15 +94,24 @@ namespace SteerLib {
 	 * The cell contains a list of pointers of SpatialDatabaseItem objects that 
 	 * overlap the cell.
 	 *
+	 * Items are kept packed in _items[0.._numItems-1], so scans only visit occupied slots.  Each cell owns a
+	 * small fixed number of slots (maxItemsPerGridCell); a cell that needs more moves its items into a
+	 * larger block from the database's GridCellOverflowPool, and moves them back once they fit again.
+	 *
 	 * Most users should not need to use this class at all, the GridDatabase2D is the main 
 	 * public interface for using the spatial database functionality.
 	 *
+	 * A grid cell has no lock of its own; only one thread may add or remove items at a time.
+	 * GridDatabase2D::beginDeferredUpdates() is the way to move objects from several threads.
+	 *
 	 */
 	class STEERLIB_API GridCell {
 
 	public:
 		void init( unsigned int maxNumItems, SpatialDatabaseItemPtr * localBasePtr, float initialTraversalCost) {
+			_localItems = localBasePtr;
 			_items = localBasePtr;
+			_capacity = maxNumItems;
 			for (unsigned int j=0; j < maxNumItems; j++) {
 				_items[j] = NULL;
 			}
@@ -56,43 +119,21 @@ namespace SteerLib {
 			_traversalCost = initialTraversalCost;
 		}
 
-		/// Adds an object reference to this cell.
-		inline void add(SpatialDatabaseItemPtr entry, unsigned int maxItems, float traversalCostToAdd) {
-
-			_gridCellMutex.lock();
-
-			/** 
-			 * If an exception is thrown in this function, it means, there are too many 
-			 * agents in one grid cell.  If you are certain its not a bug, you can increase 
-			 * the value of numItemsPerCell in the GridDatabase2D constructor, or increase 
-			 * the resolution of the grid. (Note that such changes may affect performance, too.)
-			 */
-
-			if (_numItems >= maxItems)
-			{
-				_gridCellMutex.unlock();
-				std::cout << "The number of items in this cell is:" << _numItems << " The max number of items can be: " << maxItems << std::endl;
-				throw Util::GenericException("There are too many items in a single cell of the grid database.\nIn the next version, this will be handled robstly and not be an error.\nFor now, use a higher number for maxItemsPerGridCell (in the config file), or\nincrease the resolution of the grid (both of which may decrease performance).");
+		/// Adds an object reference to this cell; maxItems is the number of slots the cell owns, and more items spill into overflowPool.
+		inline void add(SpatialDatabaseItemPtr entry, unsigned int maxItems, float traversalCostToAdd, GridCellOverflowPool & overflowPool) {
+			if (_numItems >= _capacity) {
+				_resize(_capacity * 2, maxItems, overflowPool);
 			}
+			_items[_numItems] = entry;
 			_numItems++;
-			unsigned int i=0;
-			while (_items[i] != NULL) {
-				i++;
-			}
-			_items[i] = entry;
 
 			_traversalCost += traversalCostToAdd;
-
-			_gridCellMutex.unlock();
 		}
 
 		/// Removes an object reference from this cell.
-		inline void remove(SpatialDatabaseItemPtr entry, unsigned int maxItems, float traversalCostToSubtract) {
-
-			_gridCellMutex.lock();
+		inline void remove(SpatialDatabaseItemPtr entry, unsigned int maxItems, float traversalCostToSubtract, GridCellOverflowPool & overflowPool) {
 
 			if (_numItems <= 0) {
-				_gridCellMutex.unlock();
 				// throw Util::GenericException("Tried to remove an object from a grid cell, but the grid cell was empty." );
 				std::stringstream errormsg;
 				// I was trying to create a more informative error message
@@ -107,49 +148,78 @@ namespace SteerLib {
 				}
 				throw Util::GenericException(errormsg.str());
 			}
-			_numItems--;
 			unsigned int i=0;
-			while ((_items[i] != entry) && (i<maxItems)) i++;
-			if (i >= maxItems) {
-				_gridCellMutex.unlock();
+			while ((i < _numItems) && (_items[i] != entry)) i++;
+			if (i >= _numItems) {
 				throw Util::GenericException("Tried to remove an object from a grid cell, but it did not exist there in the first place.");
 			}
-			_items[i] = NULL;
+			// keep the items packed by moving the last one into the hole.
+			_numItems--;
+			_items[i] = _items[_numItems];
+			_items[_numItems] = NULL;
 
 			_traversalCost -= traversalCostToSubtract;
 
-			_gridCellMutex.unlock();
-
+			// hand the overflow block back once the items fit in a block half its size (or the cell's own slots), so that a cell does not flip-flop between sizes.
+			if ((_items != _localItems) && (_numItems <= _capacity / 4)) {
+				unsigned int newCapacity = _capacity / 2;
+				_resize((newCapacity > maxItems) ? newCapacity : maxItems, maxItems, overflowPool);
+			}
 		}
 
-		inline void clear()
+		inline void clear(unsigned int maxItems, GridCellOverflowPool & overflowPool)
 		{
-			_gridCellMutex.lock();
+			if (_items != _localItems) {
+				overflowPool.release(_items, _capacity);
+				_items = _localItems;
+				_capacity = maxItems;
+			}
 			for (unsigned int j=0; j < _numItems; j++) {
 				_items[j] = NULL;
 			}
 			_traversalCost = 0;
 			_numItems=0;
-			_gridCellMutex.unlock();
 		}
 
 	private:
 
+		/// Moves the items to storage with room for newCapacity items: the cell's own slots if newCapacity is maxItems, otherwise a block from overflowPool, whose capacity is rounded up to a power of two.
+		inline void _resize(unsigned int newCapacity, unsigned int maxItems, GridCellOverflowPool & overflowPool) {
+			if (newCapacity > maxItems) {
+				newCapacity = GridCellOverflowPool::blockCapacity(newCapacity);
+			}
+			SpatialDatabaseItemPtr * newItems = (newCapacity <= maxItems) ? _localItems : overflowPool.allocate(newCapacity);
+			for (unsigned int j=0; j < _numItems; j++) {
+				newItems[j] = _items[j];
+			}
+			for (unsigned int j=_numItems; j < newCapacity; j++) {
+				newItems[j] = NULL;
+			}
+			if (_items != _localItems) {
+				overflowPool.release(_items, _capacity);
+			}
+			_items = newItems;
+			_capacity = (newCapacity <= maxItems) ? maxItems : newCapacity;
+		}
+
 		// The grid database is allowed to access the grid cell's private data directly.
 		friend class GridDatabase2D;
 		friend class GridDatabase2DPrivate;
 
-		/// The number of items currently referenced in this cell.
+		/// The number of items currently referenced in this cell; they are always stored in _items[0] to _items[_numItems-1].
 		unsigned int _numItems;
 
-		/// An array of pointers of fixed length; the length is determined during GridDatabase initialization.
+		/// The number of slots _items points to.
+		unsigned int _capacity;
+
+		/// The cell's current storage: either _localItems or a block from the overflow pool.
 		SpatialDatabaseItemPtr * _items;
 
+		/// The cell's own fixed-length array of slots; the length is determined during GridDatabase initialization.
+		SpatialDatabaseItemPtr * _localItems;
+
 		/// Cost of traversing this grid cell
 		float _traversalCost;
-
-		/// This lock is used by the grid database directly; by itself the grid cell is not necessarily thread safe.
-		Util::Mutex _gridCellMutex;
 	};
 
 
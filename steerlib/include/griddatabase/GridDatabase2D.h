@@ -51,22 +51,25 @@ namespace SteerLib {
 	 * Perform queries on the database using the appropriate functionality described in the public interface.
 	 *
 	 * <h3> Notes </h3>
-	 *  - The database implementation is not (yet) thread-safe.
+	 *  - Queries may run on several threads at once, as long as nothing is updating the database.  To update
+	 *    from several threads, call #beginDeferredUpdates() first; updates are then recorded without locking
+	 *    and applied to the grid cells by #commitDeferredUpdates().
 	 *  - The grid is located on the x-z plane.
 	 *  - During initialization you separately define (1) the spatial size of the grid, and (2) the 
 	 *    number of cells to create along the x and z directions.
-	 *  - You also define the max number of items to store in each cell.  Trying to storing more than 
-	 *    this number of items in a single grid cell will cause a Util::GenericException to be thrown.
+	 *  - You also define the number of item slots each cell owns.  A cell that needs to store more
+	 *    items than this borrows a larger block from a pool shared by the whole database, and gives
+	 *    it back when enough items leave, so crowded cells are slower but never fail.
 	 *
 	 * <h3> Performance considerations </h3>
 	 * Algorithmically, all types of queries are fairly efficient, by narrowing the computation cost down to 
 	 * only the cells that overlap your query.  Nearest neighbor queries tend to be the most costly type of 
 	 * query when the radius you are searching covers many grid cells.
 	 *
-	 * The performance of the grid database is sensitive to the value of numItemsPerCell (specified in the 
-	 * constructors).  If it is too large, all queries will perform proportionally slower, and the storage
-	 * cost of the database increases.  If it is too small, there is a risk of too many objects overlapping
-	 * one grid cell, causing an exception.  A similar but less sensitive performance issue to consider is
+	 * Queries only visit the occupied slots of each cell, so numItemsPerCell (specified in the constructors)
+	 * mostly affects memory:  if it is too large, the storage cost of the database increases and fewer cells
+	 * fit in cache.  If it is too small, crowded cells spend time moving items in and out of the overflow
+	 * pool.  A similar but less sensitive performance issue to consider is
 	 * how many grid cells to use over the entire database.
 	 *
 	 * To balance these two points above, we suggest making the size of a grid cell approximately the same
@@ -77,10 +80,6 @@ namespace SteerLib {
 	 * @see
 	 *  - the SpatialDatabaseItem interface.
 	 *
-	 * @todo
-	 *  - add a "leftover" grid cell that can become arbitrarily large.  The idea being that the database always
-	 *    works with proper semantics, but may not perform well if too many things get leftover.
-	 *
 	 */
 	class STEERLIB_API GridDatabase2D : public SpatialDataBaseInterface, public GridDatabase2DPrivate  {
 	public:
@@ -135,6 +134,10 @@ namespace SteerLib {
 		void updateObject( SpatialDatabaseItemPtr item, const Util::AxisAlignedBox & oldBounds, const Util::AxisAlignedBox & newBounds );
 		///
 		virtual void clearDatabase();
+		/// Records addObject(), removeObject() and updateObject() calls from any number of threads instead of applying them; expectedNumUpdates only sizes the lock-free buffer.
+		bool beginDeferredUpdates(unsigned int expectedNumUpdates);
+		/// Applies the recorded updates, grouped by item so that the result does not depend on which thread recorded them first.
+		void commitDeferredUpdates();
 		//@}
 
 		/// @name Traversability queries
@@ -159,9 +162,21 @@ namespace SteerLib {
 		void computeObstacleNeighbors(SpatialDatabaseItemPtr agent, float rangeSq) const ;
 		/// Returns an STL set of objects in the specified range, culling agent objects to a hemisphere centered around the facingDirection.
 		void getItemsInVisualField(std::set<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude, const Util::Point & position, const Util::Vector & facingDirection, float radiusSquared);
+		/// Fills a reusable flat buffer with the objects found in the specified spatial range, sorted by pointer with no duplicates; does not allocate once the buffer is large enough.
+		void getItemsInRange(std::vector<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude);
+		/// Fills a reusable flat buffer with the objects found in the specified range of GridCells, sorted by pointer with no duplicates.
+		void getItemsInRange(std::vector<SpatialDatabaseItemPtr> & neighborList, unsigned int xMinIndex, unsigned int xMaxIndex, unsigned int zMinIndex, unsigned int zMaxIndex, SpatialDatabaseItemPtr exclude);
+		/// Fills a reusable flat buffer with the objects in the specified range, culling agent objects to a hemisphere centered around the facingDirection; each agent is tested only once, even if it overlaps several cells.
+		void getItemsInVisualField(std::vector<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude, const Util::Point & position, const Util::Vector & facingDirection, float radiusSquared);
+		/// Finds the k nearest agents by searching rings of cells outwards from position, stopping as soon as no agent in the next ring could be closer than the ones already found.
+		void getKNearestAgents(std::vector<std::pair<float, const AgentInterface *> > & neighbors, const Util::Point & position, unsigned int k, float maxRange, SpatialDatabaseItemPtr exclude);
+		/// Computes all neighbor lists in one pass:  agents are bucketed by the cell of their center, each pair of nearby cells is tested once and every close pair is added to both lists.  Not thread-safe; call it from one thread, e.g., in preprocessFrame().
+		void computeAllAgentNeighbors(const std::vector<AgentInterface*> & agents, float padding, std::vector< std::vector<SpatialDatabaseItemPtr> > & neighborLists);
 		//@}
 
 		/// @name Ray tracing queries
+		/// Queries that ignore agents only test the items of cells that hold an obstacle, using bitmaps that are updated when
+		/// obstacles are added or removed; so an obstacle's blocksLineOfSight() must not change while it is in the database.
 		//@{
 		/// Returns "true" if the ray found an intersection in-between r.mint and r.maxt
 		bool trace(const Util::Ray & r, float & t, SpatialDatabaseItemPtr &hitObject, SpatialDatabaseItemPtr exclude, bool excludeAgents);
@@ -171,6 +186,15 @@ namespace SteerLib {
 		bool hasLineOfSight(const Util::Point & p1, const Util::Point & p2, SpatialDatabaseItemPtr exclude1, SpatialDatabaseItemPtr exclude2);
 		//@}
 
+		/// @name Obstacle distance queries
+		/// Once built, the field follows the obstacles:  adding or removing an item that is not an agent recomputes the samples near it.
+		//@{
+		/// Builds the field over the whole grid from the obstacles currently in the database; a second call with other parameters replaces it.
+		void buildObstacleDistanceField(float maxDistance, float sampleSpacing);
+		/// Returns the field, or NULL if buildObstacleDistanceField() was never called.
+		const ObstacleDistanceField * getObstacleDistanceField() { return _obstacleDistanceField; }
+		//@}
+
 		/// @name Path planning queries
 		//@{
 		/// Returns "true" if a path was found from startLocation to goalLocation, or "false" if no complete path was found; in either case, the path (complete if returning true, or partial path if returning false) is stored in outputPlan as a sequence of grid cell indices.
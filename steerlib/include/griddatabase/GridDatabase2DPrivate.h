@@ -10,6 +10,10 @@
 /// @file GridDatabase2DPrivate.h
 /// @brief Defines private functionality for the SteerLib::GridDatabase2D spatial database.
 
+#include <atomic>
+#include <functional>
+#include <vector>
+
 #include "Globals.h"
 #include "util/Geometry.h"
 #include "util/GenericException.h"
@@ -30,6 +34,9 @@ namespace SteerLib {
 
 	// forward declarations
 	// class GridDatabasePlanningDomain;
+	class STEERLIB_API AgentInterface;
+	class STEERLIB_API ObstacleInterface;
+	class STEERLIB_API ObstacleDistanceField;
 
 
 	/** 
@@ -41,11 +48,54 @@ namespace SteerLib {
 	class STEERLIB_API GridDatabase2DPrivate {
 	protected:
 		/// Protected constructor enforces that users cannot publically instantiate this class.
-		GridDatabase2DPrivate() { } 
+		GridDatabase2DPrivate() : _agentsBlockLineOfSight(false), _obstacleDistanceField(NULL), _deferringUpdates(false), _numDeferredUpdates(0) { } 
 		
 		/// Helper function that allocates the database correctly during initialization
 		void _allocateDatabase();
 
+		/// One addObject(), removeObject() or updateObject() call recorded between beginDeferredUpdates() and commitDeferredUpdates().
+		struct DeferredUpdate {
+			enum UpdateType { DEFERRED_ADD, DEFERRED_REMOVE, DEFERRED_UPDATE };
+			UpdateType type;
+			SpatialDatabaseItemPtr item;
+			Util::AxisAlignedBox oldBounds;
+			Util::AxisAlignedBox newBounds;
+			/// Orders updates by the item they refer to.
+			bool operator<(const DeferredUpdate & other) const { return std::less<SpatialDatabaseItemPtr>()(item, other.item); }
+		};
+
+		/// Records an update from any thread; claims a pre-allocated slot with an atomic increment, and only locks when those slots run out.
+		void _deferUpdate(DeferredUpdate::UpdateType type, SpatialDatabaseItemPtr item, const Util::AxisAlignedBox & oldBounds, const Util::AxisAlignedBox & newBounds);
+
+		/// Offers every agent in one cell to SpatialDataBaseInterface::insertNearestAgent(); used by getKNearestAgents().
+		void _insertNearestAgentsInCell(unsigned int cellIndex, std::vector<std::pair<float, const AgentInterface *> > & neighbors, const Util::Point & position, unsigned int k, float & rangeSq, SpatialDatabaseItemPtr exclude);
+
+		/// Scratch space for computeAllAgentNeighbors(), kept between calls so that it stops allocating.
+		struct NeighborBatch {
+			/// Cached position and radius of each agent, indexed like the agents argument.
+			std::vector<float> x, z, radius;
+			/// Cell containing each enabled agent's center, or NO_CELL for disabled agents.
+			std::vector<unsigned int> homeCell;
+			/// Agent indices sorted by home cell; the agents of cell c are [agentCellStart[c], agentCellStart[c+1]).
+			std::vector<unsigned int> agentCellStart, agentsByCell;
+			/// Non-agent items sorted by cell, in the same layout; an item overlapping several cells appears in each.
+			std::vector<unsigned int> obstacleCellStart;
+			std::vector<SpatialDatabaseItemPtr> obstaclesByCell;
+			/// The next free slot of each cell while scattering.
+			std::vector<unsigned int> cellCursor;
+			static const unsigned int NO_CELL = 0xffffffffu;
+		};
+
+		/// Recomputes the obstacle bits of the given (inclusive) range of cells from the items in them.
+		void _updateObstacleCellBits(unsigned int xMinIndex, unsigned int xMaxIndex, unsigned int zMinIndex, unsigned int zMaxIndex);
+		/// Returns the bit of a cell in one of the per-cell bitmaps.
+		inline static bool _isCellBitSet(const std::vector<unsigned int> & bits, unsigned int cellIndex) { return ((bits[cellIndex >> 5] >> (cellIndex & 31)) & 1) != 0; }
+
+		/// Recomputes the distance field samples within its maximum distance of changedBounds, after an obstacle there was added or removed.
+		void _updateObstacleDistanceField(const Util::AxisAlignedBox & changedBounds);
+		/// Fills obstacles with every item in the (inclusive) range of cells that is an obstacle, each once.
+		void _getObstaclesInCells(std::vector<ObstacleInterface*> & obstacles, unsigned int xMinIndex, unsigned int xMaxIndex, unsigned int zMinIndex, unsigned int zMaxIndex);
+
 		/// Helper function that converts a spatial range to a 2-D integer index range.
 		inline bool _clampSpatialBoundsToIndexRange(float xmin, float xmax, float zmin, float zmax, unsigned int & xMinIndex, unsigned int & xMaxIndex, unsigned int & zMinIndex, unsigned int & zMaxIndex);
 
@@ -70,6 +120,38 @@ namespace SteerLib {
 		/// A 2-D array of grid cells, but organized in a 1-D array.
 		GridCell* _cells;
 
+		/// Extra item storage for cells that hold more than _maxItemsPerCell items.
+		GridCellOverflowPool _overflowPool;
+
+		/// Scratch space for computeAllAgentNeighbors().
+		NeighborBatch _neighborBatch;
+
+		/// @name Obstacle bitmaps, one bit per cell, packed 32 cells to a word
+		/// Only updated when a non-agent item is added or removed, so moving agents never touch them; trace() with excludeAgents
+		/// and hasLineOfSight() skip the items of cells whose bit is clear, because nothing there can stop the ray.
+		//@{
+		/// Set for cells that hold at least one item that is not an agent.
+		std::vector<unsigned int> _obstacleCellBits;
+		/// Set for cells that hold at least one item that is not an agent and blocks line of sight.
+		std::vector<unsigned int> _lineOfSightCellBits;
+		/// True once an agent that blocks line of sight was added; then hasLineOfSight() has to test the items of every cell.
+		bool _agentsBlockLineOfSight;
+		//@}
+
+		/// Signed distance to the obstacles, or NULL until buildObstacleDistanceField() is called.
+		ObstacleDistanceField * _obstacleDistanceField;
+
+		/// True between beginDeferredUpdates() and commitDeferredUpdates().
+		bool _deferringUpdates;
+		/// Slots for deferred updates, sized by beginDeferredUpdates() so that threads never have to grow it.
+		std::vector<DeferredUpdate> _deferredUpdates;
+		/// Number of slots claimed in _deferredUpdates; may exceed its size, in which case the extra updates are in _overflowUpdates.
+		std::atomic<unsigned int> _numDeferredUpdates;
+		/// Deferred updates that did not fit in _deferredUpdates.
+		std::vector<DeferredUpdate> _overflowUpdates;
+		/// Protects _overflowUpdates.
+		Util::Mutex _overflowMutex;
+
 		/// The state space interface used by the planner to plan paths through the database.
 		// GridDatabasePlanningDomain * _planningDomain;
 	};
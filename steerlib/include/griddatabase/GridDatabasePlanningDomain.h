@@ -12,9 +12,18 @@
 
 #include "Globals.h"
 #include "griddatabase/GridDatabase2D.h"
+#include "griddatabase/GridJumpPointPlanningDomain.h"
+#include "griddatabase/GridPathCache.h"
 #include "planning/BestFirstSearchPlanner.h"
 #include "interfaces/PlanningDomainInterface.h"
 #include "interfaces/EngineInterface.h"
+#include "util/Mutex.h"
+
+#ifdef _WIN32
+// see GridDatabase2DPrivate.h for why this warning is disabled.
+#pragma warning( push )
+#pragma warning( disable : 4251 )
+#endif
 
 namespace SteerLib {
 
@@ -26,16 +35,37 @@ namespace SteerLib {
 	 *
 	 * This class should not be used directly.  Instead, use the GridDatabase2D public interface which provides
 	 * path-planning functionality.
+	 *
+	 * Grid cell indices are used directly as states, so paths are planned with an IndexedBestFirstSearchPlanner.
+	 * Each planner keeps its node array between queries, so the domain keeps a pool of idle planners:  each
+	 * query borrows one, which lets agents on different threads plan at the same time.
+	 *
+	 * Paths are planned with A* over every cell by default.  With setSearchAlgorithm("jps"), paths are planned with
+	 * jump point search (see GridJumpPointPlanningDomain) instead, as long as every traversable cell has the same traversal
+	 * cost; otherwise planPath() falls back to A*.  The resulting plans contain every cell along the path either way.
+	 *
+	 * Complete paths can be kept in a GridPathCache (see setPathCacheSize()), which also answers queries that start anywhere
+	 * along a cached path to the same goal.  The cache is disabled by default:  such a query returns the rest of the cached path,
+	 * which costs the same as, but may differ from, the path that a new search would find, so with several threads the
+	 * paths depend on the order of the queries.
 	 */
 	class STEERLIB_API GridDatabasePlanningDomain : public SteerLib::PlanningDomainInterface
 	{
 	public:
-		GridDatabasePlanningDomain(SteerLib::GridDatabase2D * spatialDatabase, SteerLib::EngineInterface * engineInfo) : _spatialDatabase(spatialDatabase)
+		/// The search algorithms that planPath() can use.
+		enum SearchAlgorithm {
+			SEARCH_ALGORITHM_ASTAR,
+			SEARCH_ALGORITHM_JUMP_POINT
+		};
+
+		GridDatabasePlanningDomain(SteerLib::GridDatabase2D * spatialDatabase, SteerLib::EngineInterface * engineInfo) : _spatialDatabase(spatialDatabase),
+			_jumpPointDomain(spatialDatabase), _searchAlgorithm(SEARCH_ALGORITHM_ASTAR), _traversalCostChecked(false), _hasUniformTraversalCost(false),
+			_staticObstacleVersion(0), _pathCache(0)
 		{
 			_engineInfo = engineInfo;
 			std::cout << "Created a grid database planning domain *************" << std::endl;
 		}
-		// virtual ~GridDatabasePlanningDomain() {}
+		virtual ~GridDatabasePlanningDomain();
 
 		virtual bool findPath (Util::Point &startPosition, Util::Point &endPosition, std::vector<Util::Point> & path,
 				unsigned int _maxNodesToExpandForSearch);
@@ -45,12 +75,31 @@ namespace SteerLib {
 
 		virtual bool refresh();
 		virtual void draw() {};
+		/// Adds the obstacle to the grid; not thread-safe with respect to planning.
+		virtual void addObstacle(SteerLib::ObstacleInterface * obstacle);
+		/// Removes the obstacle from the grid; not thread-safe with respect to planning.
+		virtual void removeObstacle(SteerLib::ObstacleInterface * obstacle);
+
+		/// Selects the search algorithm by name, either "astar" or "jps"; throws an exception for any other name.
+		void setSearchAlgorithm(const std::string & searchAlgorithmName);
+		/// Returns the search algorithm that was selected; jump point search may still fall back to A* for some grids.
+		inline SearchAlgorithm getSearchAlgorithm() const { return _searchAlgorithm; }
+
+		/// Sets the maximum number of complete paths to cache; 0, the default, disables the cache.
+		inline void setPathCacheSize(unsigned int maxNumPaths) { _pathCache.setMaxNumPaths(maxNumPaths); }
+		/// Returns the path cache, e.g. for its hit and miss counts.
+		inline GridPathCache & getPathCache() { return _pathCache; }
+		/// Returns a number that changes whenever the domain is refreshed or an obstacle is added or removed.
+		inline unsigned int getStaticObstacleVersion() const { return _staticObstacleVersion; }
 	protected:
 		virtual bool planPath(unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan);
 
 		virtual bool planPath(unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes);
 
 	public:
+		/// Returns the number of states, i.e. grid cells, in the planning domain.
+		inline unsigned int getNumStates() const { return _spatialDatabase->getNumCellsX() * _spatialDatabase->getNumCellsZ(); }
+
 		inline bool canBeTraversed(unsigned int index) const { return (_spatialDatabase->getTraversalCost(index) < 1000.0f); }
 
 		inline bool isAGoalState( const unsigned int & state, const unsigned int & idealGoalState) {
@@ -156,6 +205,25 @@ namespace SteerLib {
 		}
 
 	protected:
+		/// The planners and scratch space used by one query at a time.
+		struct GridPlanners {
+			IndexedBestFirstSearchPlanner<GridDatabasePlanningDomain> aStarPlanner;
+			IndexedBestFirstSearchPlanner<GridJumpPointPlanningDomain> jumpPointPlanner;
+			std::vector<unsigned int> jumpPoints;
+			std::vector<unsigned int> cells;
+		};
+
+		/// Plans with jump point search or A*, without the path cache.
+		bool _planUncachedPath(GridPlanners * planners, unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes);
+
+		/// Takes idle planners from the pool, or creates new ones if all of them are in use.
+		GridPlanners * _acquirePlanners();
+		/// Returns planners to the pool.
+		void _releasePlanners(GridPlanners * planners);
+		/// Returns true if every traversable cell has the same traversal cost, so that jump point search finds the same paths as A*.
+		bool _usesUniformTraversalCost();
+		/// Plans with jump point search, and then fills in the cells between consecutive jump points.
+		bool _planJumpPointPath(GridPlanners * planners, unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes);
 
 		inline SteerLib::DefaultAction<unsigned int> & initAction(unsigned int newState, float f) {
 			_tempAction.cost = f;
@@ -167,12 +235,30 @@ namespace SteerLib {
 		SteerLib::GridDatabase2D * _spatialDatabase;
 		SteerLib::DefaultAction<unsigned int> _tempAction;
 		SteerLib::EngineInterface * _engineInfo;
+
+		GridJumpPointPlanningDomain _jumpPointDomain;
+		SearchAlgorithm _searchAlgorithm;
+
+		/// The result of _usesUniformTraversalCost(), and the jump point domain's copy of the grid, are kept until the next refresh().
+		bool _traversalCostChecked;
+		bool _hasUniformTraversalCost;
+
+		/// Incremented by refresh(), addObstacle() and removeObstacle(); cached paths are only valid for the version they were planned with.
+		unsigned int _staticObstacleVersion;
+		GridPathCache _pathCache;
+
+		/// Planners that are not being used by any query.
+		std::vector<GridPlanners*> _idlePlanners;
+		Util::Mutex _plannerPoolMutex;
 	};
 
 
 
 } // end namespace SteerLib;
 
+#ifdef _WIN32
+#pragma warning( pop )
+#endif
 
 #endif
 
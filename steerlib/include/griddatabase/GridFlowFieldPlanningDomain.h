@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+#ifndef __STEERLIB_GRID_FLOW_FIELD_PLANNING_DOMAIN_H__
+#define __STEERLIB_GRID_FLOW_FIELD_PLANNING_DOMAIN_H__
+
+/// @file GridFlowFieldPlanningDomain.h
+/// @brief Defines SteerLib::GridFlowFieldPlanningDomain, which shares one distance field among all agents that plan towards the same goal.
+
+#include <map>
+#include <vector>
+
+#include "Globals.h"
+#include "griddatabase/GridDatabasePlanningDomain.h"
+
+#ifdef _WIN32
+// see GridDatabase2DPrivate.h for why this warning is disabled.
+#pragma warning( push )
+#pragma warning( disable : 4251 )
+#endif
+
+namespace SteerLib {
+
+
+	/**
+	 * @brief A grid planning domain that plans with flow fields, computed once per goal cell and shared by every agent.
+	 *
+	 * The first query towards a goal cell runs Dijkstra's algorithm backwards from the goal over the whole grid.  The resulting
+	 * flow field stores, for every cell, its distance to the goal and the next cell along the shortest path.  Every later query
+	 * towards the same goal cell, from anywhere, just follows the next cells, so each waypoint costs O(1).  This pays off
+	 * when many agents share a few goals, as in evacuations; with a different goal for every agent, plain A* is faster.
+	 *
+	 * Plans contain every cell along the path, like those of GridDatabasePlanningDomain, so findPath(), findSmoothPath() and
+	 * AgentInterface::runLongTermPlanning() work unchanged.  Select this domain with the planner name "flowFieldGridDomain".
+	 *
+	 * Moves are the same as in GridDatabasePlanningDomain.  A move costs its length times the traversal cost of the cell it
+	 * enters, but at least its length:  the grid resets the cost of free cells to 0, and the fields should follow the shortest path
+	 * rather than an arbitrary one.
+	 *
+	 * <h3> Notes </h3>
+	 *  - At most maxFlowFields fields are kept; once that many goals have fields, queries towards other goals are planned
+	 *    with GridDatabasePlanningDomain::planPath().  With several threads, which goals get the fields depends on the order of the queries.
+	 *  - All fields are discarded by refresh(), addObstacle() and removeObstacle(), and recomputed when they are needed again.
+	 *  - Queries may run on several threads at once; a query that has to compute a field blocks all other queries until it is done.
+	 *    refresh(), addObstacle() and removeObstacle() may not run at the same time as any query.
+	 */
+	class STEERLIB_API GridFlowFieldPlanningDomain : public GridDatabasePlanningDomain
+	{
+	public:
+		GridFlowFieldPlanningDomain(SteerLib::GridDatabase2D * spatialDatabase, SteerLib::EngineInterface * engineInfo, unsigned int maxFlowFields);
+		virtual ~GridFlowFieldPlanningDomain();
+
+		/// Re-adds all obstacles to the grid, and discards all flow fields.
+		virtual bool refresh();
+		/// Adds the obstacle to the grid, and discards all flow fields.
+		virtual void addObstacle(SteerLib::ObstacleInterface * obstacle);
+		/// Removes the obstacle from the grid, and discards all flow fields.
+		virtual void removeObstacle(SteerLib::ObstacleInterface * obstacle);
+
+		/// Stores the next cell from cell towards goalCell, computing the flow field of goalCell if needed; returns false if there is no field for goalCell, or the goal cannot be reached.
+		bool getNextCell(unsigned int cell, unsigned int goalCell, unsigned int & nextCell);
+		/// Returns the number of flow fields that are currently kept.
+		unsigned int getNumFlowFields();
+		/// Discards all flow fields.
+		void clearFlowFields();
+
+	protected:
+		virtual bool planPath(unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes);
+
+		/// The distance from every cell to one goal cell, and the next cell along the shortest path.
+		struct FlowField {
+			std::vector<float> distance;
+			/// The goal cell is its own next cell.
+			std::vector<unsigned int> nextCell;
+		};
+
+		/// Returns the flow field of goalCell, computing it if there is room for another one, or NULL.
+		const FlowField * _getFlowField(unsigned int goalCell);
+		/// Runs Dijkstra's algorithm backwards from goalCell over the whole grid.
+		void _computeFlowField(unsigned int goalCell, FlowField & field);
+
+		unsigned int _maxFlowFields;
+		/// The flow fields, by goal cell; fields are never changed or deleted while queries may use them.
+		std::map<unsigned int, FlowField*> _flowFields;
+		/// Scratch space for _computeFlowField(), used while _flowFieldMutex is locked.
+		std::vector<std::pair<float, unsigned int> > _heap;
+		Util::Mutex _flowFieldMutex;
+	};
+
+
+
+} // end namespace SteerLib;
+
+#ifdef _WIN32
+#pragma warning( pop )
+#endif
+
+#endif
@@ -0,0 +1,213 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+#ifndef __STEERLIB_GRID_HIERARCHICAL_PLANNING_DOMAIN_H__
+#define __STEERLIB_GRID_HIERARCHICAL_PLANNING_DOMAIN_H__
+
+/// @file GridHierarchicalPlanningDomain.h
+/// @brief Defines SteerLib::GridHierarchicalPlanningDomain, which plans long paths in the grid database hierarchically (HPA*).
+
+#include <vector>
+
+#include "Globals.h"
+#include "griddatabase/GridDatabasePlanningDomain.h"
+
+#ifdef _WIN32
+// see GridDatabase2DPrivate.h for why this warning is disabled.
+#pragma warning( push )
+#pragma warning( disable : 4251 )
+#endif
+
+namespace SteerLib {
+
+
+	/**
+	 * @brief A grid planning domain that plans on an abstract graph of clusters of cells, instead of on every cell (HPA*).
+	 *
+	 * The grid is partitioned into square clusters of clusterSize x clusterSize cells.  Wherever cells on both sides of the
+	 * border between two clusters can be traversed, the border has an entrance, represented by a pair of abstract nodes, one
+	 * on each side, that are connected to each other.  Within each cluster, the abstract nodes are connected to each other
+	 * with the cost of the shortest path between them that stays inside the cluster.  All of this is computed once, when the
+	 * domain is refreshed (i.e. during SimulationEngine::preprocessSimulation()).
+	 *
+	 * A query connects the start and goal cells to the abstract nodes of their own clusters, searches the abstract graph,
+	 * and then refines every abstract edge into cells, one cluster at a time.  Plans contain every cell along the path, like
+	 * those of GridDatabasePlanningDomain, so findPath() and findSmoothPath() work unchanged.  The paths are usually a few
+	 * percent longer than optimal, because they have to pass through the entrances.
+	 *
+	 * When an obstacle is added or removed, only the entrances and paths of the clusters it overlaps, and of their
+	 * neighbors, are recomputed.
+	 *
+	 * <h3> Notes </h3>
+	 *  - Queries may run on several threads at once, but refresh(), addObstacle() and removeObstacle() may not run at the same time as any query.
+	 *  - If the start or goal cannot be traversed, or the abstract search does not reach the goal within its horizon, planPath()
+	 *    falls back to GridDatabasePlanningDomain::planPath(), which also provides a partial path.
+	 *  - The horizon of the abstract search counts abstract nodes, so a horizon meant for cells is generous for it.
+	 */
+	class STEERLIB_API GridHierarchicalPlanningDomain : public GridDatabasePlanningDomain
+	{
+	public:
+		GridHierarchicalPlanningDomain(SteerLib::GridDatabase2D * spatialDatabase, SteerLib::EngineInterface * engineInfo, unsigned int clusterSize);
+		virtual ~GridHierarchicalPlanningDomain();
+
+		/// Re-adds all obstacles to the grid, and then builds the abstract graph from scratch.
+		virtual bool refresh();
+		/// Adds the obstacle to the grid, and repairs the clusters it overlaps.
+		virtual void addObstacle(SteerLib::ObstacleInterface * obstacle);
+		/// Removes the obstacle from the grid, and repairs the clusters it overlapped.
+		virtual void removeObstacle(SteerLib::ObstacleInterface * obstacle);
+
+		/// Builds the abstract graph from scratch, for the current contents of the grid.
+		void buildAbstractGraph();
+		/// Recomputes the entrances and intra-cluster edges of every cluster that overlaps the given (inclusive) range of cells, and of their neighbors.
+		void repairClusters(unsigned int xMinCell, unsigned int xMaxCell, unsigned int zMinCell, unsigned int zMaxCell);
+
+		/// Returns the number of cells along the side of a cluster.
+		inline unsigned int getClusterSize() const { return _clusterSize; }
+		/// Returns the number of clusters, or 0 if the abstract graph was not built yet.
+		inline unsigned int getNumClusters() const { return _numClustersX * _numClustersZ; }
+		/// Returns the number of abstract nodes, i.e. of entrance cells, in the abstract graph.
+		inline unsigned int getNumAbstractNodes() const { return (unsigned int)(_abstractNodes.size() - _freeAbstractNodes.size()); }
+
+	protected:
+		virtual bool planPath(unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes);
+
+		/// An edge of the abstract graph.
+		struct AbstractEdge {
+			unsigned int target;
+			float cost;
+		};
+
+		/// A cell on the border of a cluster that belongs to an entrance.
+		struct AbstractNode {
+			unsigned int cell;
+			unsigned int cluster;
+			bool alive;
+			/// The edge to the other side of the entrance, followed by the edges to the other nodes of the same cluster.
+			std::vector<AbstractEdge> edges;
+		};
+
+		/// Shortest paths from (or towards) one cell, restricted to the cells of one cluster.
+		struct ClusterSearch {
+			unsigned int xMin, zMin, numCellsX, numCellsZ;
+			/// Indexed by the cell's position in the cluster, (x - xMin) * numCellsZ + (z - zMin).
+			std::vector<float> distance;
+			/// The next cell towards the source, as a position in the cluster, or -1.
+			std::vector<int> parent;
+			std::vector<std::pair<float, int> > heap;
+
+			inline int getLocalIndex(unsigned int x, unsigned int z) const { return (int)((x - xMin) * numCellsZ + (z - zMin)); }
+		};
+
+		/**
+		 * @brief The state space of the abstract graph, provided to the IndexedBestFirstSearchPlanner for one query.
+		 *
+		 * States are abstract node indices; the start and goal cells are two more states after the last abstract node.
+		 */
+		class AbstractSearchDomain {
+		public:
+			AbstractSearchDomain(GridHierarchicalPlanningDomain * graph, unsigned int startLocation, unsigned int goalLocation, ClusterSearch * startSearch, ClusterSearch * goalSearch);
+
+			inline unsigned int getNumStates() const { return startState + 2; }
+			inline bool isAGoalState( const unsigned int & state, const unsigned int & idealGoalState) { return state == idealGoalState; }
+			inline float estimateTotalCost( const unsigned int & currentState, const unsigned int & idealGoalState, float currentg) {
+				return _graph->estimateTotalCost(getCell(currentState), goalCell, currentg);
+			}
+			void generateTransitions( const unsigned int & currentState, const unsigned int & previousState, const unsigned int & idealGoalState, std::vector<SteerLib::DefaultAction<unsigned int> > & transitions );
+
+			/// Returns the cell that a state stands for.
+			inline unsigned int getCell(unsigned int state) const {
+				if (state == startState) return startCell;
+				if (state == goalState) return goalCell;
+				return _graph->_abstractNodes[state].cell;
+			}
+
+			unsigned int startState;
+			unsigned int goalState;
+			unsigned int startCell;
+			unsigned int goalCell;
+
+		protected:
+			GridHierarchicalPlanningDomain * _graph;
+			unsigned int _startCluster;
+			unsigned int _goalCluster;
+			ClusterSearch * _startSearch;
+			ClusterSearch * _goalSearch;
+		};
+
+		/// The planner and scratch space used by one query at a time.
+		struct HierarchicalPlanners {
+			IndexedBestFirstSearchPlanner<AbstractSearchDomain> abstractPlanner;
+			ClusterSearch startSearch;
+			ClusterSearch goalSearch;
+			ClusterSearch refineSearch;
+			std::vector<unsigned int> cells;
+		};
+
+		/// Takes an idle planner from the pool, or creates a new one if all of them are in use.
+		HierarchicalPlanners * _acquireHierarchicalPlanners();
+		/// Returns a planner to the pool.
+		void _releaseHierarchicalPlanners(HierarchicalPlanners * planners);
+		/// Returns true and stores the plan if the abstract search reaches the goal; outputPlan is not changed otherwise.
+		bool _planHierarchicalPath(HierarchicalPlanners * planners, unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes);
+
+		/// Returns the cluster that contains a cell.
+		inline unsigned int _getCluster(unsigned int cell) {
+			unsigned int x, z;
+			_spatialDatabase->getGridCoordinatesFromIndex(cell, x, z);
+			return (x / _clusterSize) * _numClustersZ + (z / _clusterSize);
+		}
+		/// Returns the position of a cell in the cluster of a search.
+		inline int _getLocalIndex(const ClusterSearch & search, unsigned int cell) {
+			unsigned int x, z;
+			_spatialDatabase->getGridCoordinatesFromIndex(cell, x, z);
+			return search.getLocalIndex(x, z);
+		}
+		/// Computes the cost of the shortest path from (or, if reverse is true, towards) sourceCell to every cell of the cluster, using the same moves and costs as GridDatabasePlanningDomain.
+		void _searchCluster(unsigned int cluster, unsigned int sourceCell, bool reverse, ClusterSearch & search);
+		/// Appends the cells after fromCell, up to and including toCell, of the path found by a search from fromCell (or towards toCell, if reverse is true).
+		void _appendClusterPath(const ClusterSearch & search, unsigned int fromCell, unsigned int toCell, bool reverse, std::vector<unsigned int> & cells);
+
+		/// Removes the entrances on one border; borders are numbered cluster * 2, for the border towards +x, and cluster * 2 + 1, towards +z.
+		void _clearBorder(unsigned int border);
+		/// Finds the entrances on one border, and creates their abstract nodes and the edges across them.
+		void _buildBorder(unsigned int border);
+		/// Recomputes the edges between the abstract nodes of one cluster.
+		void _buildIntraClusterEdges(unsigned int cluster, ClusterSearch & search);
+		/// Creates an abstract node on the given cell, on the given border.
+		unsigned int _createAbstractNode(unsigned int cell, unsigned int cluster, unsigned int border);
+		/// Creates the two abstract nodes of an entrance, and the edges between them.
+		void _createEntrance(unsigned int cell1, unsigned int cluster1, unsigned int cell2, unsigned int cluster2, unsigned int border);
+		/// Repairs the clusters that an obstacle overlaps.
+		void _repairObstacleBounds(SteerLib::ObstacleInterface * obstacle);
+
+		unsigned int _clusterSize;
+		unsigned int _numClustersX;
+		unsigned int _numClustersZ;
+		bool _abstractGraphBuilt;
+
+		std::vector<AbstractNode> _abstractNodes;
+		/// Indices of removed abstract nodes, reused by later entrances.
+		std::vector<unsigned int> _freeAbstractNodes;
+		/// The abstract nodes in each cluster.
+		std::vector< std::vector<unsigned int> > _clusterNodes;
+		/// The abstract nodes on each border, on both of its sides.
+		std::vector< std::vector<unsigned int> > _borderNodes;
+
+		/// Planners that are not being used by any query.
+		std::vector<HierarchicalPlanners*> _idleHierarchicalPlanners;
+		Util::Mutex _hierarchicalPlannerPoolMutex;
+	};
+
+
+
+} // end namespace SteerLib;
+
+#ifdef _WIN32
+#pragma warning( pop )
+#endif
+
+#endif
@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+#ifndef __STEERLIB_GRID_INCREMENTAL_PLANNING_DOMAIN_H__
+#define __STEERLIB_GRID_INCREMENTAL_PLANNING_DOMAIN_H__
+
+/// @file GridIncrementalPlanningDomain.h
+/// @brief Defines SteerLib::GridIncrementalPlanningDomain, which repairs its searches when obstacles change instead of planning from scratch (D* Lite).
+
+#include <map>
+#include <vector>
+
+#include "Globals.h"
+#include "griddatabase/GridDatabasePlanningDomain.h"
+
+#ifdef _WIN32
+// see GridDatabase2DPrivate.h for why this warning is disabled.
+#pragma warning( push )
+#pragma warning( disable : 4251 )
+#endif
+
+namespace SteerLib {
+
+
+	/**
+	 * @brief The search state of D* Lite towards one goal cell of the grid.
+	 *
+	 * The search runs backwards, from the goal towards the start, so every cell it reaches knows its cost to the goal.
+	 * findPath() only searches as far as needed to find the path from the given start, and keeps all of that work:
+	 * a later query from a different start continues the same search, and after updateCells(), only the part of the search
+	 * that the changed cells affect is repaired.
+	 *
+	 * The moves are the same as in GridDatabasePlanningDomain.  A move costs its length times the traversal cost of the cell it
+	 * enters, but at least its length, because the grid resets the cost of free cells to 0 and the heuristic needs a lower bound.
+	 *
+	 * This class is not thread-safe; GridIncrementalPlanningDomain locks each search while it is used.
+	 */
+	class STEERLIB_API GridDStarLiteSearch {
+	public:
+		GridDStarLiteSearch(SteerLib::GridDatabase2D * spatialDatabase, unsigned int goalCell);
+
+		/// Returns true and stores the cells from startCell to the goal, or returns false if the goal cannot be reached within maxNodes expansions.
+		bool findPath(unsigned int startCell, unsigned int maxNodes, std::vector<unsigned int> & cells);
+		/// Repairs the search after the traversal costs of the given (inclusive) range of cells changed.
+		void updateCells(unsigned int xMinCell, unsigned int xMaxCell, unsigned int zMinCell, unsigned int zMaxCell);
+
+		inline unsigned int getGoalCell() const { return _goalCell; }
+		/// Returns the number of cells expanded since the search was created.
+		inline unsigned long long getNumExpandedCells() const { return _numExpandedCells; }
+
+	protected:
+		/// Returns the cost of moving from cell (ux, uz) to its neighbor (vx, vz), or FLT_MAX if the move is not allowed.
+		float _getMoveCost(int ux, int uz, int vx, int vz) const;
+		/// The Euclidean distance in cells, a lower bound on the cost of any path between the two cells.
+		float _getHeuristic(unsigned int cell1, unsigned int cell2) const;
+		void _computeKey(unsigned int cell, float & k1, float & k2) const;
+		/// Recomputes rhs of a cell from its neighbors, and puts it on the open list if it is inconsistent.
+		void _updateCell(unsigned int cell);
+		bool _computeShortestPath(unsigned int startCell, unsigned int maxNodes);
+
+		/// @name The open list, a binary heap ordered by key
+		//@{
+		inline bool _isBefore(unsigned int cell1, unsigned int cell2) const {
+			if (_key1[cell1] != _key1[cell2]) return _key1[cell1] < _key1[cell2];
+			if (_key2[cell1] != _key2[cell2]) return _key2[cell1] < _key2[cell2];
+			return cell1 < cell2;
+		}
+		void _pushOpen(unsigned int cell);
+		void _removeOpen(unsigned int cell);
+		void _siftUp(unsigned int heapIndex);
+		void _siftDown(unsigned int heapIndex);
+		//@}
+
+		static const unsigned int NOT_OPEN = 0xffffffff;
+
+		SteerLib::GridDatabase2D * _spatialDatabase;
+		unsigned int _goalCell;
+		unsigned int _numCellsX;
+		unsigned int _numCellsZ;
+		/// The start of the previous query; the keys on the open list are relative to it, offset by _keyModifier.
+		unsigned int _lastStartCell;
+		float _keyModifier;
+
+		std::vector<float> _g;
+		std::vector<float> _rhs;
+		std::vector<float> _key1;
+		std::vector<float> _key2;
+		std::vector<unsigned int> _heapIndex;
+		std::vector<unsigned int> _openHeap;
+		unsigned long long _numExpandedCells;
+	};
+
+
+	/**
+	 * @brief A grid planning domain that keeps a D* Lite search per goal cell, and repairs it when obstacles change.
+	 *
+	 * Each goal cell gets a GridDStarLiteSearch, shared by every agent that plans towards it, so the search effort for a
+	 * goal is spent once.  When an obstacle is added or removed (e.g. a door opens or closes), each search is only repaired
+	 * where the obstacle's cells affect it, so agents that replan afterwards do not all search from scratch.  Plans contain
+	 * every cell along the path, like those of GridDatabasePlanningDomain.  Select this domain with the planner name "incrementalGridDomain".
+	 *
+	 * <h3> Notes </h3>
+	 *  - At most maxSearches goals are kept; queries towards other goals are planned with GridDatabasePlanningDomain::planPath().
+	 *    With several threads, which goals get a search depends on the order of the queries.
+	 *  - Queries towards different goals may run on several threads at once; queries towards the same goal wait for each other.
+	 *    refresh(), addObstacle() and removeObstacle() may not run at the same time as any query.
+	 *  - refresh() discards all searches.
+	 */
+	class STEERLIB_API GridIncrementalPlanningDomain : public GridDatabasePlanningDomain
+	{
+	public:
+		GridIncrementalPlanningDomain(SteerLib::GridDatabase2D * spatialDatabase, SteerLib::EngineInterface * engineInfo, unsigned int maxSearches);
+		virtual ~GridIncrementalPlanningDomain();
+
+		/// Re-adds all obstacles to the grid, and discards all searches.
+		virtual bool refresh();
+		/// Adds the obstacle to the grid, and repairs every search around it.
+		virtual void addObstacle(SteerLib::ObstacleInterface * obstacle);
+		/// Removes the obstacle from the grid, and repairs every search around it.
+		virtual void removeObstacle(SteerLib::ObstacleInterface * obstacle);
+
+		/// Returns the number of goals that have a search.
+		unsigned int getNumSearches();
+		/// Returns the total number of cells expanded by all current searches.
+		unsigned long long getNumExpandedCells();
+		/// Discards all searches.
+		void clearSearches();
+
+	protected:
+		virtual bool planPath(unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes);
+
+		/// A search and the lock that serializes the queries that use it.
+		struct LockedSearch {
+			LockedSearch(SteerLib::GridDatabase2D * spatialDatabase, unsigned int goalCell) : search(spatialDatabase, goalCell) { }
+			GridDStarLiteSearch search;
+			Util::Mutex mutex;
+		};
+
+		/// Returns the search towards goalCell, creating it if there is room for another one, or NULL.
+		LockedSearch * _getSearch(unsigned int goalCell);
+		/// Repairs every search for the cells that an obstacle overlaps.
+		void _updateObstacleCells(SteerLib::ObstacleInterface * obstacle);
+
+		unsigned int _maxSearches;
+		/// The searches, by goal cell; searches are only deleted by refresh() and clearSearches().
+		std::map<unsigned int, LockedSearch*> _searches;
+		Util::Mutex _searchesMutex;
+	};
+
+
+
+} // end namespace SteerLib;
+
+#ifdef _WIN32
+#pragma warning( pop )
+#endif
+
+#endif
@@ -0,0 +1,253 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+#ifndef __STEERLIB_GRID_JUMP_POINT_PLANNING_DOMAIN_H__
+#define __STEERLIB_GRID_JUMP_POINT_PLANNING_DOMAIN_H__
+
+/// @file GridJumpPointPlanningDomain.h
+/// @brief Defines SteerLib::GridJumpPointPlanningDomain, the state space used for jump point search in the grid database.
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Globals.h"
+#include "griddatabase/GridDatabase2D.h"
+#include "planning/BestFirstSearchPlanner.h"
+
+namespace SteerLib {
+
+
+	/**
+	 * @brief The state space of the grid database for jump point search (JPS), provided to the IndexedBestFirstSearchPlanner.
+	 *
+	 * States are grid cell indices, like in GridDatabasePlanningDomain, and the moves allowed are the same:  8-connected,
+	 * without cutting the corner of an untraversable cell.  Instead of generating every neighbor of a cell, generateTransitions()
+	 * only follows the directions that the move into the cell leaves open, and "jumps" along each of them until it reaches the goal,
+	 * a dead end, or a cell where a blocked cell next to the path forces a new direction.  Only those jump points are states
+	 * in the search, so open areas are crossed in a single transition instead of one node expansion per cell.
+	 *
+	 * Consecutive jump points always lie on one horizontal, vertical or diagonal line; use appendCellsBetween() to turn a plan
+	 * back into the cells that a GridDatabasePlanningDomain plan would contain.
+	 *
+	 * Jumps scan many cells for every node they generate, so the domain keeps its own copy of which cells are traversable, one byte
+	 * per cell with a border of untraversable cells around the grid.  updateTraversableCells() must be called before planning, and
+	 * again whenever the grid changes.
+	 *
+	 * <b>Note:</b> jump point search is only equivalent to A* if every traversable cell has the same traversal cost, and the cost
+	 * of each transition is computed from the cost of the jump point alone.  GridDatabasePlanningDomain checks this before using
+	 * this domain, and falls back to A* otherwise.
+	 *
+	 * This class is implemented directly in the .h file so that most compilers can inline the functions for performance.
+	 */
+	class GridJumpPointPlanningDomain {
+	public:
+		GridJumpPointPlanningDomain(SteerLib::GridDatabase2D * spatialDatabase) : _spatialDatabase(spatialDatabase), _paddedNumCellsZ(0) { }
+
+		/// Copies which cells of the grid can be traversed; not thread-safe with respect to planning.
+		inline void updateTraversableCells() {
+			unsigned int numCellsX = _spatialDatabase->getNumCellsX();
+			unsigned int numCellsZ = _spatialDatabase->getNumCellsZ();
+			_paddedNumCellsZ = numCellsZ + 2;
+			_traversable.assign((numCellsX + 2) * _paddedNumCellsZ, 0);
+			for (unsigned int x=0; x < numCellsX; x++) {
+				for (unsigned int z=0; z < numCellsZ; z++) {
+					_traversable[(x + 1) * _paddedNumCellsZ + (z + 1)] = (_spatialDatabase->getTraversalCost(x, z) < 1000.0f) ? 1 : 0;
+				}
+			}
+		}
+
+		/// Returns the number of states, i.e. grid cells, in the planning domain.
+		inline unsigned int getNumStates() const { return _spatialDatabase->getNumCellsX() * _spatialDatabase->getNumCellsZ(); }
+
+		inline bool isAGoalState( const unsigned int & state, const unsigned int & idealGoalState) {
+			return state == idealGoalState;
+		}
+
+		/// Same heuristic as GridDatabasePlanningDomain::estimateTotalCost().
+		inline float estimateTotalCost( const unsigned int & currentState, const unsigned int & idealGoalState, float currentg) {
+			unsigned int xstart, zstart, xtarget, ztarget;
+			_spatialDatabase->getGridCoordinatesFromIndex(currentState, xstart, zstart);
+			_spatialDatabase->getGridCoordinatesFromIndex(idealGoalState, xtarget, ztarget);
+			int diffx = ((int)xtarget) - ((int)xstart);
+			int diffz = ((int)ztarget) - ((int)zstart);
+			float h = sqrtf((float)(diffx*diffx + diffz*diffz));
+			return currentg + h;
+		}
+
+		/// Generates one transition to each jump point reachable from currentState; previousState is the jump point it was reached from.
+		inline void generateTransitions( const unsigned int & currentState, const unsigned int & previousState, const unsigned int & idealGoalState, std::vector<SteerLib::DefaultAction<unsigned int> > & transitions )
+		{
+			transitions.clear();
+			unsigned int ux, uz, ugoalx, ugoalz;
+			_spatialDatabase->getGridCoordinatesFromIndex(currentState, ux, uz);
+			_spatialDatabase->getGridCoordinatesFromIndex(idealGoalState, ugoalx, ugoalz);
+			int x = (int)ux, z = (int)uz;
+			int goalx = (int)ugoalx, goalz = (int)ugoalz;
+
+			if (previousState == currentState) {
+				// the start state has no direction yet, so every neighbor is a candidate.
+				for (int dx = -1; dx <= 1; dx++) {
+					for (int dz = -1; dz <= 1; dz++) {
+						if (((dx != 0) || (dz != 0)) && _canMove(x, z, dx, dz)) {
+							_addJump(x, z, dx, dz, goalx, goalz, transitions);
+						}
+					}
+				}
+				return;
+			}
+
+			unsigned int px, pz;
+			_spatialDatabase->getGridCoordinatesFromIndex(previousState, px, pz);
+			int dx = (x > (int)px) ? 1 : ((x < (int)px) ? -1 : 0);
+			int dz = (z > (int)pz) ? 1 : ((z < (int)pz) ? -1 : 0);
+
+			if ((dx != 0) && (dz != 0)) {
+				// moving diagonally:  keep going, and also try both of its straight components.
+				if (_isWalkable(x, z+dz)) _addJump(x, z, 0, dz, goalx, goalz, transitions);
+				if (_isWalkable(x+dx, z)) _addJump(x, z, dx, 0, goalx, goalz, transitions);
+				if (_canMove(x, z, dx, dz)) _addJump(x, z, dx, dz, goalx, goalz, transitions);
+			}
+			else if (dx != 0) {
+				// moving along x:  keep going, and turn only towards a side that was blocked one step back; any other
+				// cell to the side is reached at least as cheaply without passing through this cell.
+				if (_isWalkable(x+dx, z)) _addJump(x, z, dx, 0, goalx, goalz, transitions);
+				for (int side = -1; side <= 1; side += 2) {
+					if (_isWalkable(x, z+side) && !_isWalkable(x-dx, z+side)) {
+						_addJump(x, z, 0, side, goalx, goalz, transitions);
+						if (_canMove(x, z, dx, side)) _addJump(x, z, dx, side, goalx, goalz, transitions);
+					}
+				}
+			}
+			else {
+				// moving along z
+				if (_isWalkable(x, z+dz)) _addJump(x, z, 0, dz, goalx, goalz, transitions);
+				for (int side = -1; side <= 1; side += 2) {
+					if (_isWalkable(x+side, z) && !_isWalkable(x+side, z-dz)) {
+						_addJump(x, z, side, 0, goalx, goalz, transitions);
+						if (_canMove(x, z, side, dz)) _addJump(x, z, side, dz, goalx, goalz, transitions);
+					}
+				}
+			}
+		}
+
+		/// Appends the cells after fromState, up to and including toState, that lie on the straight or diagonal line between the two jump points.
+		inline void appendCellsBetween( unsigned int fromState, unsigned int toState, std::vector<unsigned int> & cells )
+		{
+			unsigned int ux, uz, utox, utoz;
+			_spatialDatabase->getGridCoordinatesFromIndex(fromState, ux, uz);
+			_spatialDatabase->getGridCoordinatesFromIndex(toState, utox, utoz);
+			int x = (int)ux, z = (int)uz;
+			int dx = ((int)utox > x) ? 1 : (((int)utox < x) ? -1 : 0);
+			int dz = ((int)utoz > z) ? 1 : (((int)utoz < z) ? -1 : 0);
+			if ((dx == 0) && (dz == 0)) {
+				cells.push_back(toState);
+				return;
+			}
+			while ((x != (int)utox) || (z != (int)utoz)) {
+				x += dx;
+				z += dz;
+				cells.push_back(_spatialDatabase->getCellIndexFromGridCoords((unsigned int)x, (unsigned int)z));
+			}
+		}
+
+	protected:
+		/// Returns true if (x, z) is inside the grid and can be traversed; x and z may be one cell outside the grid.
+		inline bool _isWalkable(int x, int z) const {
+			return (_traversable[(x + 1) * _paddedNumCellsZ + (z + 1)] != 0);
+		}
+
+		/// Returns true if the move from (x, z) by (dx, dz) is allowed; diagonal moves may not cut the corner of an untraversable cell.
+		inline bool _canMove(int x, int z, int dx, int dz) const {
+			if (!_isWalkable(x+dx, z+dz)) {
+				return false;
+			}
+			if ((dx != 0) && (dz != 0)) {
+				return _isWalkable(x+dx, z) && _isWalkable(x, z+dz);
+			}
+			return true;
+		}
+
+		/// Returns true if moving straight by (dx, dz) reaches a jump point, and stores it in (jumpx, jumpz).
+		inline bool _jumpStraight(int x, int z, int dx, int dz, int goalx, int goalz, int & jumpx, int & jumpz) const {
+			while (true) {
+				x += dx;
+				z += dz;
+				if (!_isWalkable(x, z)) {
+					return false;
+				}
+				if ((x == goalx) && (z == goalz)) {
+					break;
+				}
+				// a neighbor that was blocked one step back but is open now can only be reached optimally through this cell.
+				if (dx != 0) {
+					if ((_isWalkable(x, z-1) && !_isWalkable(x-dx, z-1)) || (_isWalkable(x, z+1) && !_isWalkable(x-dx, z+1))) {
+						break;
+					}
+				}
+				else {
+					if ((_isWalkable(x-1, z) && !_isWalkable(x-1, z-dz)) || (_isWalkable(x+1, z) && !_isWalkable(x+1, z-dz))) {
+						break;
+					}
+				}
+			}
+			jumpx = x;
+			jumpz = z;
+			return true;
+		}
+
+		/// Returns true if moving diagonally by (dx, dz) reaches a jump point, and stores it in (jumpx, jumpz).
+		inline bool _jumpDiagonal(int x, int z, int dx, int dz, int goalx, int goalz, int & jumpx, int & jumpz) const {
+			int unusedx, unusedz;
+			while (_canMove(x, z, dx, dz)) {
+				x += dx;
+				z += dz;
+				if (((x == goalx) && (z == goalz))
+					|| _jumpStraight(x, z, dx, 0, goalx, goalz, unusedx, unusedz)
+					|| _jumpStraight(x, z, 0, dz, goalx, goalz, unusedx, unusedz)) {
+					jumpx = x;
+					jumpz = z;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/// If moving from (x, z) by (dx, dz) reaches a jump point, adds the transition to it.
+		inline void _addJump(int x, int z, int dx, int dz, int goalx, int goalz, std::vector<SteerLib::DefaultAction<unsigned int> > & transitions) {
+			int jumpx, jumpz;
+			bool found;
+			if ((dx != 0) && (dz != 0)) {
+				found = _jumpDiagonal(x, z, dx, dz, goalx, goalz, jumpx, jumpz);
+			}
+			else {
+				found = _jumpStraight(x, z, dx, dz, goalx, goalz, jumpx, jumpz);
+			}
+			if (!found) {
+				return;
+			}
+
+			// every cell costs the same, so the transition costs as much as the single steps along it would.
+			int numSteps = abs(jumpx - x);
+			if (numSteps == 0) numSteps = abs(jumpz - z);
+			SteerLib::DefaultAction<unsigned int> action;
+			action.state = _spatialDatabase->getCellIndexFromGridCoords((unsigned int)jumpx, (unsigned int)jumpz);
+			action.cost = _spatialDatabase->getTraversalCost(action.state) * (float)numSteps * (((dx != 0) && (dz != 0)) ? sqrtf(2) : 1.0f);
+			transitions.push_back(action);
+		}
+
+		SteerLib::GridDatabase2D * _spatialDatabase;
+
+		/// One byte per cell, with a border of untraversable cells, so that jumps never need bounds checks.
+		std::vector<unsigned char> _traversable;
+		int _paddedNumCellsZ;
+	};
+
+
+} // end namespace SteerLib;
+
+
+#endif
@@ -0,0 +1,100 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+#ifndef __STEERLIB_GRID_PATH_CACHE_H__
+#define __STEERLIB_GRID_PATH_CACHE_H__
+
+/// @file GridPathCache.h
+/// @brief Declares SteerLib::GridPathCache, a least-recently-used cache of planned grid paths.
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "Globals.h"
+#include "util/Mutex.h"
+
+#ifdef _WIN32
+// see GridDatabase2DPrivate.h for why this warning is disabled.
+#pragma warning( push )
+#pragma warning( disable : 4251 )
+#endif
+
+namespace SteerLib {
+
+	/**
+	 * @brief A least-recently-used cache of complete, optimal paths between grid cells.
+	 *
+	 * Every cell of an optimal path to a goal is the start of another optimal path to the same goal, i.e. the rest of the
+	 * path.  So the cache does not only answer queries with the same start and goal as a cached path, but also queries
+	 * from any cell along a cached path to its goal.
+	 *
+	 * Paths are only valid for the obstacles they were planned with.  The caller passes a version number with every
+	 * call, which it must change whenever an obstacle is added or removed; the cache empties itself when it sees a new version.
+	 *
+	 * The numbers of hits and misses are counted, to help choose the maximum number of paths.  All functions may be called
+	 * from several threads at once.
+	 */
+	class STEERLIB_API GridPathCache {
+	public:
+		/// Creates a cache that holds at most maxNumPaths paths; 0 disables the cache.
+		GridPathCache(unsigned int maxNumPaths);
+
+		/// Changes the maximum number of paths, dropping the least recently used paths if needed.
+		void setMaxNumPaths(unsigned int maxNumPaths);
+		inline unsigned int getMaxNumPaths() const { return _maxNumPaths; }
+
+		/// Returns true and stores the cells from startCell to goalCell if a cached path to goalCell passes through startCell; counts a hit or a miss.
+		bool findPath(unsigned int startCell, unsigned int goalCell, unsigned int obstacleVersion, std::vector<unsigned int> & cells);
+		/// Caches a complete, optimal path, given as the cells from its start to its goal.
+		void addPath(const std::vector<unsigned int> & cells, unsigned int obstacleVersion);
+		/// Removes all paths; the statistics are kept.
+		void clear();
+
+		/// @name Statistics
+		//@{
+		unsigned long long getNumHits();
+		unsigned long long getNumMisses();
+		/// Returns the number of paths currently cached.
+		unsigned int getNumPaths();
+		void resetStatistics();
+		//@}
+
+	protected:
+		/// The cells of one path, from its start to its goal.
+		typedef std::list< std::vector<unsigned int> > PathList;
+
+		/// Where the path from a cell to a goal can be found.
+		struct SuffixLocation {
+			PathList::iterator path;
+			unsigned int position;
+		};
+
+		static inline unsigned long long _getKey(unsigned int cell, unsigned int goalCell) { return (((unsigned long long)cell) << 32) | goalCell; }
+		/// Empties the cache if obstacleVersion differs from the version of the cached paths; must be called with the mutex locked.
+		void _checkVersion(unsigned int obstacleVersion);
+		/// Removes the least recently used path; must be called with the mutex locked.
+		void _removeOldestPath();
+		void _clear();
+
+		unsigned int _maxNumPaths;
+		unsigned int _obstacleVersion;
+		/// The most recently used path is first.
+		PathList _paths;
+		/// Every cell of every cached path, by cell and goal; a cell that is on several paths to the same goal refers to the newest one.
+		std::map<unsigned long long, SuffixLocation> _suffixes;
+		unsigned long long _numHits;
+		unsigned long long _numMisses;
+		Util::Mutex _mutex;
+	};
+
+} // end namespace SteerLib
+
+#ifdef _WIN32
+#pragma warning( pop )
+#endif
+
+#endif
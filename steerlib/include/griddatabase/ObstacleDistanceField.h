@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+#ifndef __STEERLIB_OBSTACLE_DISTANCE_FIELD_H__
+#define __STEERLIB_OBSTACLE_DISTANCE_FIELD_H__
+
+/// @file ObstacleDistanceField.h
+/// @brief Declares the SteerLib::ObstacleDistanceField class, a sampled signed distance to the nearest obstacle.
+
+#include <vector>
+
+#include "Globals.h"
+#include "util/Geometry.h"
+
+
+#ifdef _WIN32
+// see GridDatabase2DPrivate.h for why this warning is disabled.
+#pragma warning( push )
+#pragma warning( disable : 4251 )
+#endif
+
+namespace SteerLib {
+
+	// forward declarations
+	class STEERLIB_API ObstacleInterface;
+
+	/**
+	 * @brief A 2-D signed distance field of the obstacles, with the direction away from the nearest one.
+	 *
+	 * The field stores, on a regular lattice of samples over the x-z plane, the signed distance from each sample to the
+	 * surface of the nearest obstacle (negative inside an obstacle), and the unit direction that leads away from it.
+	 * getDistance() interpolates both bilinearly, so the clearance of a point costs four samples, no matter how many
+	 * obstacles are around it.
+	 *
+	 * Only distances up to maxDistance are stored; samples that are farther than that from every obstacle keep
+	 * maxDistance and a zero direction, which is what lets addObstacle() touch only the samples near each obstacle.
+	 *
+	 * <h3> Notes </h3>
+	 *  - CircleObstacle objects use their exact circle; every other obstacle uses its bounding box from getBounds().
+	 *  - The field only knows about the obstacles it was given; whoever owns it has to call rebuildRegion() when an
+	 *    obstacle is added or removed.
+	 *  - Accuracy depends on the sample spacing: distances are exact at the samples, and off by a fraction of the
+	 *    spacing near corners, where the nearest point on the obstacles jumps.
+	 *  - Queries may run on several threads at once; changing the field may not.
+	 *
+	 */
+	class STEERLIB_API ObstacleDistanceField {
+	public:
+		/// Covers the given range with samples spacing apart; every sample starts out clear, i.e., at maxDistance.
+		ObstacleDistanceField(float xmin, float xmax, float zmin, float zmax, float sampleSpacing, float maxDistance);
+
+		/// @name Building the field
+		//@{
+		/// Resets every sample to maxDistance, as if there were no obstacles.
+		void clear();
+		/// Lowers the samples that are closer to this obstacle than to every obstacle added before.
+		void addObstacle(ObstacleInterface * obstacle);
+		/// Recomputes the samples inside region from scratch, using only the given obstacles; they must include every obstacle within maxDistance of region.
+		void rebuildRegion(const Util::AxisAlignedBox & region, const std::vector<ObstacleInterface*> & obstacles);
+		//@}
+
+		/// @name Queries
+		//@{
+		/// Returns false if p is outside the field or at least maxDistance from every obstacle; otherwise returns the interpolated signed distance, and the unit direction away from the nearest obstacle.
+		bool getDistance(const Util::Point & p, float & distance, Util::Vector & awayFromObstacle) const;
+		/// Returns the largest distance that the field stores.
+		inline float getMaxDistance() const { return _maxDistance; }
+		/// Returns the distance between two neighboring samples.
+		inline float getSampleSpacing() const { return _sampleSpacing; }
+		//@}
+
+	protected:
+		/// Computes the exact signed distance from (x,z) to the obstacle, and the unit direction away from it.
+		static float _signedDistance(ObstacleInterface * obstacle, float x, float z, float & awayX, float & awayZ);
+		/// Lowers the samples of the (inclusive) index range that are closer to this obstacle than to the ones already added.
+		void _addObstacleToSamples(ObstacleInterface * obstacle, unsigned int xMinIndex, unsigned int xMaxIndex, unsigned int zMinIndex, unsigned int zMaxIndex);
+		/// Converts a spatial range to the (inclusive) range of samples inside it; returns false if no sample is inside.
+		bool _clampToSampleRange(float xmin, float xmax, float zmin, float zmax, unsigned int & xMinIndex, unsigned int & xMaxIndex, unsigned int & zMinIndex, unsigned int & zMaxIndex) const;
+
+		float _xOrigin;
+		float _zOrigin;
+		float _sampleSpacing;
+		float _invSampleSpacing;
+		float _maxDistance;
+		/// Number of samples along each axis; samples are stored x-major, like the cells of GridDatabase2D.
+		unsigned int _xNumSamples;
+		unsigned int _zNumSamples;
+
+		/// @name Per-sample data, one array per field.
+		//@{
+		std::vector<float> _distance;
+		std::vector<float> _awayX;
+		std::vector<float> _awayZ;
+		//@}
+	};
+
+} // end namespace SteerLib
+
+#ifdef _WIN32
+#pragma warning( pop )
+#endif
+
+#endif
@@ -61,8 +61,14 @@ namespace SteerLib {
 		virtual void disable() = 0;
 		/// Called once per frame by the engine, update the agent here.
 		virtual void updateAI(float timeStamp, float dt, unsigned int frameNumber) = 0;
+		/// Called once per frame instead of updateAI() when engineOptions.twoPhaseAgentUpdate is enabled; compute the next steering decision here, reading other agents and the spatial database but without changing any state they can see.
+		virtual void senseAI(float timeStamp, float dt, unsigned int frameNumber) { }
+		/// Called once per frame after senseAI() has been called for every agent; commit the new position, velocity and spatial database entry here.  The default simply calls updateAI(), so agents that do not split their update still work in two-phase mode.
+		virtual void actAI(float timeStamp, float dt, unsigned int frameNumber) { updateAI(timeStamp, dt, frameNumber); }
 		/// Called once per frame by the engine, use openGL to draw an agent here.
 		virtual void draw();
+		/// Called by the SteerLib::PathPlanningService at the end of a frame, with the path for the agent's latest request.  The default uses the path like runLongTermPlanning() does, if it is complete and still leads to the current goal.
+		virtual void receiveLongTermPlan(const Util::Point & goalLocation, const std::vector<Util::Point> & path, bool pathComplete);
 		//@}
 
 		/// @name Accessors to query info about the agent
@@ -204,6 +210,8 @@ namespace SteerLib {
 		///
 		virtual bool runLongTermPlanning(Util::Point goalLocation, bool dontPlan);
 		virtual bool runLongTermPlanning2(Util::Point goalLocation, bool dontPlan);
+		/// Fills _midTermPath and _waypoints from a planned path, skipping its first point, which is the agent's location.
+		void _setLongTermPath(const std::vector<Util::Point> & agentPath, const Util::Point & goalLocation);
 		virtual bool reachedCurrentWaypoint();
 		virtual void updateMidTermPath();
 		virtual bool hasLineOfSightTo(Util::Point point);
@@ -25,6 +25,9 @@
 
 namespace SteerLib {
 
+	// forward declaration
+	class STEERLIB_API PathPlanningService;
+
 	/// A pointer type used by the EngineInterface, points to a function that executes a custom command.
 	typedef void (*CommandFunctionPtr)(const std::string & commandString);
 
@@ -77,6 +80,8 @@ namespace SteerLib {
 		virtual SteerLib::SpatialDataBaseInterface * getSpatialDatabase() = 0;
 		/// Returns a pointer to the PathPlanningInterface contained in the engine.
 		virtual SteerLib::PlanningDomainInterface * getPathPlanner() = 0;
+		/// Returns a pointer to the service that plans long-term paths on background threads, or NULL if paths are planned inline.
+		virtual SteerLib::PathPlanningService * getPathPlanningService() { return NULL; }
 		/// Returns a reference to an STL vector containing a list of agents.
 		virtual const std::vector<SteerLib::AgentInterface*> & getAgents() = 0;
 		/// Returns a reference to an STL set of selected agents.
@@ -104,6 +104,10 @@ namespace SteerLib {
 		virtual SteerLib::AgentInterface * createAgent() { return NULL; }
 		/// De-allocates the AgentInterface;  note that anything allocated within a dynamic library should be de-allocated by the dynamic library as well.
 		virtual void destroyAgent( SteerLib::AgentInterface * agent ) { }
+		/// Returns true if the agents created by this module may call updateAI() concurrently with each other; the engine only updates agents on multiple threads (engineOptions.numThreads > 1) when every agent's module returns true, and defers spatial database updates while they run.
+		virtual bool hasThreadSafeAgents() { return false; }
+		/// Returns true if the agents created by this module may call senseAI() concurrently with each other, and actAI() concurrently with each other while the engine defers spatial database updates; only used when engineOptions.twoPhaseAgentUpdate is enabled.
+		virtual bool hasThreadSafeTwoPhaseAgents() { return hasThreadSafeAgents(); }
 		//@}
 
 		/// @name Run-time functionality
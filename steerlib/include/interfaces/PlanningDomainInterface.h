@@ -18,6 +18,8 @@
 
 namespace SteerLib{
 
+	class STEERLIB_API ObstacleInterface;
+
 	class STEERLIB_API PlanningDomainInterface
 	{
 	public:
@@ -35,6 +37,10 @@ namespace SteerLib{
 		virtual bool refresh() = 0;
 		// If there is anything to draw
 		virtual void draw() = 0;
+		/// Called by the engine when an obstacle is added after the domain was created, so that the domain can update itself without a full refresh(); does nothing by default.
+		virtual void addObstacle(SteerLib::ObstacleInterface * obstacle) { }
+		/// Called by the engine when an obstacle is removed from the simulation; does nothing by default.
+		virtual void removeObstacle(SteerLib::ObstacleInterface * obstacle) { }
 
 		//@}
 
@@ -25,6 +25,10 @@ class MTRand;
 
 namespace SteerLib {
 
+	// forward declaration
+	class STEERLIB_API AgentInterface;
+	class STEERLIB_API ObstacleDistanceField;
+
 	/**
 	 * @brief The basic interface for a benchmark technique
 	 *
@@ -83,6 +87,10 @@ namespace SteerLib {
 		virtual void updateObject( SpatialDatabaseItemPtr item, const Util::AxisAlignedBox & oldBounds, const Util::AxisAlignedBox & newBounds ) = 0;
 		/// clear Database
 		virtual void clearDatabase() = 0;
+		/// Starts recording addObject(), removeObject() and updateObject() calls so that several threads may make them at once; queries keep seeing the old state until commitDeferredUpdates().  Returns false if the database cannot defer updates, in which case updates must stay on one thread.
+		virtual bool beginDeferredUpdates(unsigned int expectedNumUpdates) { return false; }
+		/// Applies all updates recorded since beginDeferredUpdates(); must be called from one thread.
+		virtual void commitDeferredUpdates() { }
 		//@}
 
 		/// @name Traversability queries
@@ -119,6 +127,34 @@ namespace SteerLib {
 		virtual void computeObstacleNeighbors(SpatialDatabaseItemPtr agent, float rangeSq) const  = 0;
 		/// Returns an STL set of objects in the specified range, culling agent objects to a hemisphere centered around the facingDirection.
 		virtual void getItemsInVisualField(std::set<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude, const Util::Point & position, const Util::Vector & facingDirection, float radiusSquared) = 0;
+
+		/// Same as the STL set version, but clears and fills a flat buffer instead, sorted by pointer with no duplicates; keep the buffer around between queries so that it stops allocating once it has grown.
+		virtual void getItemsInRange(std::vector<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude)
+		{
+			std::set<SpatialDatabaseItemPtr> neighborSet;
+			getItemsInRange(neighborSet, xmin, xmax, zmin, zmax, exclude);
+			neighborList.assign(neighborSet.begin(), neighborSet.end());
+		}
+		/// Same as the STL set version, but clears and fills a flat buffer instead, sorted by pointer with no duplicates.
+		virtual void getItemsInVisualField(std::vector<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude, const Util::Point & position, const Util::Vector & facingDirection, float radiusSquared)
+		{
+			std::set<SpatialDatabaseItemPtr> neighborSet;
+			getItemsInVisualField(neighborSet, xmin, xmax, zmin, zmax, exclude, position, facingDirection, radiusSquared);
+			neighborList.assign(neighborSet.begin(), neighborSet.end());
+		}
+		/// Fills neighbors with (squared distance, agent) pairs for the (at most) k enabled agents whose centers are closest to position and closer than maxRange, nearest first; the default implementation filters a getItemsInRange() query.
+		virtual void getKNearestAgents(std::vector<std::pair<float, const AgentInterface *> > & neighbors, const Util::Point & position, unsigned int k, float maxRange, SpatialDatabaseItemPtr exclude);
+		/// Helper for getKNearestAgents() implementations:  inserts agent into the sorted list if it is closer than rangeSq, keeping at most k agents, and shrinks rangeSq to the k-th distance once the list is full.
+		static void insertNearestAgent(std::vector<std::pair<float, const AgentInterface *> > & neighbors, unsigned int k, float distSq, const AgentInterface * agent, float & rangeSq);
+		/**
+		 * \brief      Computes the neighbor lists of many agents at once.
+		 *
+		 * neighborLists is resized to agents.size().  The list of an enabled agent a holds every other enabled agent b of
+		 * agents with |a-b| < a.radius + b.radius + padding, and every obstacle that a getItemsInRange() query of the box
+		 * a.position() +/- (a.radius + padding) would return.  Each list is sorted by pointer with no duplicates; lists of
+		 * disabled agents are empty.  The default implementation filters one range query per agent.
+		 */
+		virtual void computeAllAgentNeighbors(const std::vector<AgentInterface*> & agents, float padding, std::vector< std::vector<SpatialDatabaseItemPtr> > & neighborLists);
 		//@}
 
 		/// @name Ray tracing queries
@@ -131,6 +167,14 @@ namespace SteerLib {
 		virtual bool hasLineOfSight(const Util::Point & p1, const Util::Point & p2, SpatialDatabaseItemPtr exclude1, SpatialDatabaseItemPtr exclude2) = 0;
 		//@}
 
+		/// @name Obstacle distance queries
+		//@{
+		/// Builds (or rebuilds) a signed distance field of the obstacles in the database, keeping distances up to maxDistance; databases that cannot keep one ignore this call.
+		virtual void buildObstacleDistanceField(float maxDistance, float sampleSpacing) { }
+		/// Returns the field built by buildObstacleDistanceField(), or NULL if there is none; it stays owned by the database.
+		virtual const ObstacleDistanceField * getObstacleDistanceField() { return NULL; }
+		//@}
+
 
 		/// @name Miscellaneous functions
 		//@{
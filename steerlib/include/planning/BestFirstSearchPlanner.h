@@ -15,6 +15,7 @@
 #include <stack>
 #include <set>
 #include <map>
+#include <climits>
 
 namespace SteerLib {
 
@@ -217,6 +218,9 @@ namespace SteerLib {
 	 *   - When possible, performance can be improved by inlining the functions you implement in your
 	 *     PlanningDomain class.
 	 *
+	 *   - If your states are already dense integer indices, use SteerLib::IndexedBestFirstSearchPlanner instead,
+	 *     which has the same interface but avoids the STL set and map entirely.
+	 *
 	 *
 	 * <h3> Implementing the state and action spaces </h3>
 	 *
@@ -460,6 +464,292 @@ namespace SteerLib {
 		return false;  // returns false because plan is incomplete.
 	}
 
+
+	/**
+	 * @brief A best-first search planner for state spaces whose states are dense integer indices, such as the cells of a grid.
+	 *
+	 * This class has the same interface as BestFirstSearchPlanner, and expands nodes in the same order (up to ties), but it
+	 * does not use any tree-based containers.  Instead:
+	 *   - every state has a node in a flat array, indexed by the state itself, which replaces the std::map of visited states;
+	 *   - every node remembers the query that last touched it (a generation counter), so nothing has to be cleared between
+	 *     queries; the array is only reset when the generation counter wraps around;
+	 *   - the open set is a binary heap of state indices, and every node remembers its own position in the heap, so that
+	 *     a cheaper path to an open node is a decrease-key operation instead of an erase and re-insert.
+	 *
+	 * Once the arrays have grown to the size of the state space, a query does not allocate any memory.
+	 *
+	 * In addition to the functionality of SteerLib::PlanningDomainBase, the planning domain must implement
+	 * <code>unsigned int getNumStates()</code>, and every state must be an unsigned int in the range [0, getNumStates()).
+	 *
+	 * <b>Note:</b> Unlike BestFirstSearchPlanner, this class keeps its node array between queries, so a single instance
+	 * must not be used by several threads at the same time.  Use one instance per thread instead.
+	 *
+	 * @see
+	 *   - Documentation of the BestFirstSearchPlanner class, which describes how states and actions are used.
+	 */
+	template < class PlanningDomain, class PlanningAction = DefaultAction<unsigned int> >
+	class IndexedBestFirstSearchPlanner {
+	public:
+		IndexedBestFirstSearchPlanner() : _maxNumNodesToExpand(0), _planningDomain(NULL), _generation(0) { }
+
+		/// Initializes the planner to use the specified instance of the planning domain, and sets the search horizon limit.
+		void init(PlanningDomain * newPlanningDomain, unsigned int maxNumNodesToExpand ) {
+			_maxNumNodesToExpand = maxNumNodesToExpand;
+			_planningDomain = newPlanningDomain;
+		}
+
+		/// Computes a plan as a sequence of states; returns true if the planner could reach the goal, or false if the plan is only partial and could not reach the goal within the specified horizon.
+		bool computePlan( const unsigned int & startState, const unsigned int & goalState, std::stack<unsigned int> & plan );
+
+		/// Computes a plan as a sequence of actions; returns true if the planner could reach the goal, or false if the plan is only partial and could not reach the goal within the specified horizon.
+		bool computePlan( const unsigned int & startState, const unsigned int & goalState, std::stack<PlanningAction> & plan );
+
+	protected:
+		/// The search node of one state; only valid if generation matches the planner's current generation.
+		class Node {
+		public:
+			float g;
+			float f;
+			unsigned int previousState;
+			PlanningAction action;
+			unsigned int generation;
+			/// Position of this node in the open heap, or CLOSED if the node has already been expanded.
+			unsigned int heapIndex;
+		};
+
+		static const unsigned int CLOSED = UINT_MAX;
+
+		bool _computePlan( const unsigned int & startState, const unsigned int & idealGoalState, unsigned int & actualStateReached );
+		/// Sizes the node array for the domain, and starts a new generation.
+		void _beginQuery();
+		/// Same ordering as CompareCosts: lower f first, and higher g first among equal f.
+		inline bool _isBetter( unsigned int state1, unsigned int state2 ) const {
+			const Node & n1 = _nodes[state1];
+			const Node & n2 = _nodes[state2];
+			return (n1.f != n2.f) ? (n1.f < n2.f) : (n1.g > n2.g);
+		}
+		void _pushOpen( unsigned int state );
+		void _popOpen();
+		void _siftUp( unsigned int heapIndex );
+		void _siftDown( unsigned int heapIndex );
+
+		unsigned int _maxNumNodesToExpand;
+		PlanningDomain * _planningDomain;
+
+		std::vector<Node> _nodes;
+		std::vector<unsigned int> _openHeap;
+		std::vector<PlanningAction> _possibleActions;
+		unsigned int _generation;
+	};
+
+
+	template < class PlanningDomain, class PlanningAction >
+	bool IndexedBestFirstSearchPlanner< PlanningDomain, PlanningAction >::computePlan( const unsigned int & startState, const unsigned int & goalState, std::stack<unsigned int> & plan )
+	{
+		unsigned int s;
+
+		bool isPlanComplete = _computePlan(startState, goalState, s);
+
+		// reconstruct path here, exactly like BestFirstSearchPlanner does.
+		plan.push(s);  // push the goal state
+		do {
+			// keep pushing until the start state was pushed. (inclusive)
+			s = _nodes[s].previousState;
+			plan.push(s);
+		} while ( !(s == startState) );
+
+		return isPlanComplete;
+	}
+
+
+	template < class PlanningDomain, class PlanningAction >
+	bool IndexedBestFirstSearchPlanner< PlanningDomain, PlanningAction >::computePlan( const unsigned int & startState, const unsigned int & goalState, std::stack<PlanningAction> & plan )
+	{
+		unsigned int s;
+
+		bool isPlanComplete = _computePlan(startState, goalState, s);
+
+		// push all actions except for the very first one, which is an invalid dummy action that leads to the start state.
+		while ( !(s == startState) ) {
+			plan.push(_nodes[s].action);
+			s = _nodes[s].previousState;
+		}
+
+		return isPlanComplete;
+	}
+
+
+	template < class PlanningDomain, class PlanningAction >
+	void IndexedBestFirstSearchPlanner< PlanningDomain, PlanningAction >::_beginQuery()
+	{
+		unsigned int numStates = _planningDomain->getNumStates();
+		if (_nodes.size() != numStates) {
+			Node unvisited;
+			unvisited.generation = 0;
+			unvisited.heapIndex = CLOSED;
+			_nodes.assign(numStates, unvisited);
+			_generation = 0;
+		}
+
+		_generation++;
+		if (_generation == 0) {
+			// the counter wrapped around; old generations could be mistaken for the current one.
+			for (unsigned int i=0; i < _nodes.size(); i++) {
+				_nodes[i].generation = 0;
+			}
+			_generation = 1;
+		}
+
+		_openHeap.clear();
+	}
+
+
+	template < class PlanningDomain, class PlanningAction >
+	bool IndexedBestFirstSearchPlanner< PlanningDomain, PlanningAction >::_computePlan( const unsigned int & startState, const unsigned int & idealGoalState, unsigned int & actualStateReached )
+	{
+		_beginQuery();
+
+		Node & startNode = _nodes[startState];
+		startNode.g = 0.0f;
+		startNode.f = _planningDomain->estimateTotalCost(startState, idealGoalState, 0.0f);
+		startNode.previousState = startState;
+		startNode.action.cost = 0.0f;
+		startNode.action.state = startState;
+		startNode.generation = _generation;
+		_pushOpen(startState);
+
+		unsigned int numNodesExpanded = 0;
+
+		while ((numNodesExpanded < _maxNumNodesToExpand) && (!_openHeap.empty())) {
+
+			numNodesExpanded++;
+
+			unsigned int x = _openHeap[0];
+
+			// ask the user if this node is a goal state.  If so, then finish up.
+			if ( _planningDomain->isAGoalState( x, idealGoalState ) ) {
+				actualStateReached = x;
+				return true;
+			}
+
+			// move x from the open set to the closed set.
+			_popOpen();
+			_nodes[x].heapIndex = CLOSED;
+
+			// ask the user to generate all the possible actions from this state.
+			_possibleActions.clear();
+			_planningDomain->generateTransitions( x, _nodes[x].previousState, idealGoalState, _possibleActions );
+
+			// iterate over each potential action, and add it to the open set.
+			// if the node was already seen before, then it is updated if the new cost is better than the old cost.
+			const float xg = _nodes[x].g;
+			for ( typename std::vector<PlanningAction>::const_iterator action = _possibleActions.begin();  action != _possibleActions.end(); ++action) {
+
+				float newg = xg + (*action).cost;
+
+				Node & node = _nodes[(*action).state];
+				bool seenBefore = (node.generation == _generation);
+				if ( seenBefore && !(newg < node.g) ) {
+					// we don't bother updating this node... it already exists with a better cost.
+					continue;
+				}
+
+				node.g = newg;
+				node.f = _planningDomain->estimateTotalCost((*action).state, idealGoalState, newg);
+				node.previousState = x;
+				node.action = (*action);
+				node.generation = _generation;
+
+				if ( seenBefore && (node.heapIndex != CLOSED) ) {
+					// still in the open set; its key just decreased.
+					_siftUp(node.heapIndex);
+				}
+				else {
+					// new, or re-opened after it was already expanded, the same as BestFirstSearchPlanner does.
+					_pushOpen((*action).state);
+				}
+			}
+		}
+
+		if (_openHeap.empty()) {
+			// if we get here, there was no solution.
+			actualStateReached = startState;
+		}
+		else {
+			// if we get here, then we did not find a complete path; return the most promising partial path instead.
+			actualStateReached = _openHeap[0];
+		}
+
+		return false;  // returns false because plan is incomplete.
+	}
+
+
+	template < class PlanningDomain, class PlanningAction >
+	void IndexedBestFirstSearchPlanner< PlanningDomain, PlanningAction >::_pushOpen( unsigned int state )
+	{
+		_nodes[state].heapIndex = (unsigned int)_openHeap.size();
+		_openHeap.push_back(state);
+		_siftUp(_nodes[state].heapIndex);
+	}
+
+
+	template < class PlanningDomain, class PlanningAction >
+	void IndexedBestFirstSearchPlanner< PlanningDomain, PlanningAction >::_popOpen()
+	{
+		unsigned int last = _openHeap.back();
+		_openHeap.pop_back();
+		if (!_openHeap.empty()) {
+			_openHeap[0] = last;
+			_nodes[last].heapIndex = 0;
+			_siftDown(0);
+		}
+	}
+
+
+	template < class PlanningDomain, class PlanningAction >
+	void IndexedBestFirstSearchPlanner< PlanningDomain, PlanningAction >::_siftUp( unsigned int heapIndex )
+	{
+		unsigned int state = _openHeap[heapIndex];
+		while (heapIndex > 0) {
+			unsigned int parentIndex = (heapIndex - 1) / 2;
+			unsigned int parent = _openHeap[parentIndex];
+			if (!_isBetter(state, parent)) {
+				break;
+			}
+			_openHeap[heapIndex] = parent;
+			_nodes[parent].heapIndex = heapIndex;
+			heapIndex = parentIndex;
+		}
+		_openHeap[heapIndex] = state;
+		_nodes[state].heapIndex = heapIndex;
+	}
+
+
+	template < class PlanningDomain, class PlanningAction >
+	void IndexedBestFirstSearchPlanner< PlanningDomain, PlanningAction >::_siftDown( unsigned int heapIndex )
+	{
+		unsigned int state = _openHeap[heapIndex];
+		unsigned int heapSize = (unsigned int)_openHeap.size();
+		while (true) {
+			unsigned int childIndex = 2 * heapIndex + 1;
+			if (childIndex >= heapSize) {
+				break;
+			}
+			if ((childIndex + 1 < heapSize) && _isBetter(_openHeap[childIndex + 1], _openHeap[childIndex])) {
+				childIndex++;
+			}
+			unsigned int child = _openHeap[childIndex];
+			if (!_isBetter(child, state)) {
+				break;
+			}
+			_openHeap[heapIndex] = child;
+			_nodes[child].heapIndex = heapIndex;
+			heapIndex = childIndex;
+		}
+		_openHeap[heapIndex] = state;
+		_nodes[state].heapIndex = heapIndex;
+	}
+
 } // end namespace SteerLib
 
 #endif
@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+#ifndef __STEERLIB_PATH_PLANNING_SERVICE_H__
+#define __STEERLIB_PATH_PLANNING_SERVICE_H__
+
+/// @file PathPlanningService.h
+/// @brief Declares SteerLib::PathPlanningService, which plans long-term paths on background threads.
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Globals.h"
+#include "util/Geometry.h"
+#include "util/Mutex.h"
+
+#ifdef _WIN32
+// see GridDatabase2DPrivate.h for why this warning is disabled.
+#pragma warning( push )
+#pragma warning( disable : 4251 )
+#endif
+
+// forward declaration
+namespace Util {
+	class ThreadedTaskManager;
+}
+
+namespace SteerLib {
+
+	// forward declarations
+	class STEERLIB_API AgentInterface;
+	class STEERLIB_API PlanningDomainInterface;
+
+	/**
+	 * @brief Plans long-term paths on background threads, so that an expensive query does not stall the frame that asked for it.
+	 *
+	 * Agents call requestPath() instead of PlanningDomainInterface::findPath(), and follow a fallback (usually a straight line to
+	 * the goal) until the path arrives.  The engine calls endFrame() once per frame, after all agents were updated:
+	 *   -# it waits for the requests that were started at the end of the previous frame, and hands their paths to the agents
+	 *      with AgentInterface::receiveLongTermPlan();
+	 *   -# it starts the requests made since then on the worker threads, where they run while the next frame is simulated.
+	 *
+	 * So a path requested in one frame is normally used two frames later.  To bound how long endFrame() can wait, each batch of
+	 * requests has a budget:  at most maxRequestsPerFrame requests are started per frame, and workers stop starting requests once
+	 * timeBudget seconds have passed since the batch began; the requests that were not started are kept for the next frame.
+	 * The planner does not report how many nodes each query expands, so the node budget is the maxNodes of each request.
+	 *
+	 * <h3> Notes </h3>
+	 *  - requestPath() may be called from several threads at once; all other functions must be called from the engine's thread.
+	 *  - A newer request from the same agent replaces the older one, and paths are only delivered for an agent's latest request.
+	 *  - The planning domain must allow findPath() to run on several threads at once, and nothing may change it while requests
+	 *    run; the engine calls waitForRunningRequests() before it adds or removes obstacles.
+	 *  - Without a time budget, the same requests produce the same paths in the same frames, regardless of the number of threads.
+	 *    Requests are started in the order of agent ids.
+	 */
+	class STEERLIB_API PathPlanningService {
+	public:
+		/// A time budget or request limit of 0 means unlimited.
+		PathPlanningService(SteerLib::PlanningDomainInterface * planner, unsigned int numThreads, float timeBudget, unsigned int maxRequestsPerFrame);
+		~PathPlanningService();
+
+		/// Queues a request for a path from start to goal; the path is handed to the agent at a later endFrame().
+		void requestPath(SteerLib::AgentInterface * agent, const Util::Point & start, const Util::Point & goal, unsigned int maxNodes);
+		/// Forgets all requests of the agent, e.g. before it is destroyed.
+		void cancelRequests(SteerLib::AgentInterface * agent);
+		/// Forgets all requests, e.g. when the planning domain is refreshed.
+		void clear();
+
+		/// Delivers the finished paths, and starts the next batch of requests; called by the engine once per frame.
+		void endFrame();
+		/// Waits until no request is running; requests that finished are still delivered by the next endFrame().
+		void waitForRunningRequests();
+
+		/// @name Statistics
+		//@{
+		/// Returns the number of requests that are queued or running.
+		unsigned int getNumOutstandingRequests();
+		inline unsigned long long getNumDeliveredPaths() const { return _numDeliveredPaths; }
+		/// Returns the longest time that endFrame() waited for running requests, in seconds.
+		inline float getMaxWaitTime() const { return _maxWaitTime; }
+		//@}
+
+	protected:
+		struct Request {
+			SteerLib::AgentInterface * agent;
+			unsigned long long sequenceNumber;
+			Util::Point start;
+			Util::Point goal;
+			unsigned int maxNodes;
+			std::vector<Util::Point> path;
+			bool pathComplete;
+		};
+
+		static bool _isStartedBefore(const Request & request1, const Request & request2);
+		/// Returns true if no newer request of the same agent was made, and it was not cancelled; must be called with _pendingMutex locked.
+		bool _isLatestRequest(const Request & request);
+		static void _runWorkerTask(unsigned int threadIndex, void * data);
+		/// Runs requests of the current batch until none are left or the budget is spent.
+		void _runRequests();
+		void _deliverBatch();
+
+		SteerLib::PlanningDomainInterface * _planner;
+		Util::ThreadedTaskManager * _taskManager;
+		unsigned int _numThreads;
+		float _timeBudget;
+		unsigned int _maxRequestsPerFrame;
+
+		/// Requests made since the last endFrame(), guarded by _pendingMutex.
+		std::vector<Request> _pendingRequests;
+		/// Older requests that the budget did not allow to start yet, in the order they will be started.
+		std::vector<Request> _waitingRequests;
+		unsigned long long _nextSequenceNumber;
+		/// The sequence number of each agent's latest request, guarded by _pendingMutex.
+		std::map<SteerLib::AgentInterface*, unsigned long long> _latestRequests;
+		Util::Mutex _pendingMutex;
+
+		/// The requests handed to the workers; the first _numStartedRequests of them were started.
+		std::vector<Request> _batch;
+		unsigned int _numStartedRequests;
+		unsigned long long _batchStartTick;
+		bool _batchRunning;
+		/// The message of an exception thrown while planning, rethrown by endFrame().
+		std::string _errorMessage;
+		Util::Mutex _batchMutex;
+
+		unsigned long long _numDeliveredPaths;
+		float _maxWaitTime;
+	};
+
+} // end namespace SteerLib
+
+#ifdef _WIN32
+#pragma warning( pop )
+#endif
+
+#endif
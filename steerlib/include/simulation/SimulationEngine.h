@@ -19,6 +19,11 @@
 
 #define KEY_PRESSED 1
 
+// forward declaration
+namespace Util {
+	class ThreadedTaskManager;
+}
+
 #ifdef _WIN32
 // on win32, there is an unfortunate conflict between exporting symbols for a
 // dynamic/shared library and STL code.  A good document describing the problem
@@ -177,6 +182,7 @@ namespace SteerLib {
 		//@{
 		virtual SteerLib::SpatialDataBaseInterface * getSpatialDatabase() { return _spatialDatabase; }
 		virtual SteerLib::PlanningDomainInterface * getPathPlanner() {return _pathPlanner;}
+		virtual SteerLib::PathPlanningService * getPathPlanningService() { return _pathPlanningService; }
 		virtual const std::vector<SteerLib::AgentInterface*> & getAgents() { return _agents; }
 		virtual const std::set<SteerLib::AgentInterface*> & getSelectedAgents() { return _selectedAgents; }
 		virtual const std::set<SteerLib::ObstacleInterface*> & getObstacles() { return _obstacles; }
@@ -240,6 +246,20 @@ namespace SteerLib {
 		void _reset();
 		/// Runs one step of the simulation
 		bool _simulateOneStep();
+		/// Which agent function _updateAgentRange() calls: updateAI(), or senseAI()/actAI() when engineOptions.twoPhaseAgentUpdate is enabled.
+		enum AgentUpdatePhase {
+			AGENT_UPDATE_FULL,
+			AGENT_UPDATE_SENSE,
+			AGENT_UPDATE_ACT
+		};
+		/// Updates agents [beginIndex, endIndex) for the given phase, counting finished agents and collecting indices of disabled agents that should trigger their emitter; the sense phase does neither, since the act phase that follows it will.
+		void _updateAgentRange(AgentUpdatePhase phase, unsigned int beginIndex, unsigned int endIndex, float currentSimulationTime, float simulationDt, unsigned int currentFrameNumber, unsigned int & numDisabledAgents, std::vector<int> & agentsEmit);
+		/// Splits _agents across the worker threads and updates them in parallel; results are merged in agent order, so emitting and disabled-agent accounting match the serial loop.
+		void _updateAgentsInParallel(AgentUpdatePhase phase, float currentSimulationTime, float simulationDt, unsigned int currentFrameNumber, unsigned int & numDisabledAgents, std::vector<int> & agentsEmit);
+		/// Runs a pass that moves agents; on worker threads only if inParallel is true and the spatial database can defer updates until the pass is over, otherwise serially.
+		void _updateAgentsWithDeferredDatabase(AgentUpdatePhase phase, bool inParallel, float currentSimulationTime, float simulationDt, unsigned int currentFrameNumber, unsigned int & numDisabledAgents, std::vector<int> & agentsEmit);
+		/// Keeps track of agents whose owner does not support multi-threaded updates or sensing; call whenever an agent is added to or removed from _agents.
+		void _countAgentOwner(SteerLib::ModuleInterface * owner, bool agentAdded);
 		/// Just for debugging, dumps out the contents of the engine's organizational data structures
 		void _dumpModuleDataStructures();
 		/// Returns an instance of a built-in module of name moduleName, or returns NULL if moduleName is not a built-in module.
@@ -258,6 +278,24 @@ namespace SteerLib {
 		void _drawAgents();
 	#endif
 
+		/// One contiguous chunk of _agents, updated by one worker thread.
+		struct AgentUpdateTask {
+			SimulationEngine * engine;
+			AgentUpdatePhase phase;
+			unsigned int beginIndex;
+			unsigned int endIndex;
+			float currentSimulationTime;
+			float simulationDt;
+			unsigned int currentFrameNumber;
+			unsigned int numDisabledAgents;
+			std::vector<int> agentsEmit;
+			/// Exceptions cannot propagate out of a worker thread, so the message is stored here and re-thrown by the main thread.
+			std::string errorMessage;
+			bool failed;
+		};
+		/// The Util::TaskFunctionPtr run by worker threads; data points to an AgentUpdateTask.
+		static void _runAgentUpdateTask(unsigned int threadIndex, void * data);
+
 		class EngineStateMachineCallback : public Util::StateMachineCallbackInterface
 		{
 		public:
@@ -292,6 +330,18 @@ namespace SteerLib {
 		std::vector<SteerLib::AgentInitialConditions> _init_agents;
 		std::vector<SteerLib::ModuleInterface*> _agents_ai;
 		std::vector<int> _spawned_agent_emitter_num;
+		/// Number of agents in _agents whose owner module does not support multi-threaded updates; if non-zero, agents are updated serially.
+		unsigned int _numThreadUnsafeAgents;
+		/// Number of agents in _agents whose owner module does not support multi-threaded senseAI() and actAI(); if non-zero, both two-phase passes are serial.
+		unsigned int _numThreadUnsafeTwoPhaseAgents;
+		//@}
+
+		/// @name Multi-threaded agent updates
+		//@{
+		/// Thread pool used to update agents, only allocated if engineOptions.numThreads > 1.
+		Util::ThreadedTaskManager * _agentUpdateTaskManager;
+		/// Per-chunk task data, re-used every frame to avoid allocations.
+		std::vector<AgentUpdateTask> _agentUpdateTasks;
 		//@}
 
 		/// @name Other objects managed by the engine
@@ -301,6 +351,8 @@ namespace SteerLib {
 		SteerLib::Camera _camera;
 		SteerLib::SpatialDataBaseInterface * _spatialDatabase;
 		SteerLib::PlanningDomainInterface * _pathPlanner;
+		/// Plans long-term paths on background threads; only allocated if planningDomainOptions.asyncPlanning is enabled.
+		SteerLib::PathPlanningService * _pathPlanningService;
 		std::set<SteerLib::ObstacleInterface*> _obstacles;
 		SteerLib::EngineControllerInterface * _engineController;
 		//@}
@@ -257,6 +257,7 @@ namespace SteerLib {
 			std::string frameDumpDirectory;
 			std::set<std::string> startupModules;
 			unsigned int numThreads;
+			bool twoPhaseAgentUpdate;
 			unsigned int numFramesToSimulate;
 			float fixedFPS;
 			float minVariableDt;
@@ -280,6 +281,15 @@ namespace SteerLib {
 		struct PlanningDomainOptions {
 			std::string name;
 			unsigned int maxNodesToExpand;
+			std::string searchAlgorithm;
+			unsigned int clusterSize;
+			unsigned int maxFlowFields;
+			unsigned int maxIncrementalSearches;
+			unsigned int pathCacheSize;
+			bool asyncPlanning;
+			unsigned int asyncPlanningThreads;
+			float asyncPlanningTimeBudget;
+			unsigned int asyncPlanningMaxRequestsPerFrame;
 		};
 
 		struct GUIOptions {
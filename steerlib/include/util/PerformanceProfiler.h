@@ -98,12 +98,15 @@ namespace Util {
 	 * With this class, PerformanceProfiler::stop() is automatically invoked when the function 
 	 * returns, no matter where the function returns from.
 	 *
+	 * Passing NULL disables profiling, which lets callers skip a shared profiler when the
+	 * code may run on several threads at once.
+	 *
 	 */
 	class UTIL_API AutomaticFunctionProfiler
 	{
 	public:
-		AutomaticFunctionProfiler(PerformanceProfiler * pp) { _pp = pp; _pp->start(); }
-		~AutomaticFunctionProfiler() { _pp->stop(); }
+		AutomaticFunctionProfiler(PerformanceProfiler * pp) { _pp = pp; if (_pp != NULL) _pp->start(); }
+		~AutomaticFunctionProfiler() { if (_pp != NULL) _pp->stop(); }
 	private:
 		PerformanceProfiler * _pp;
 	};
@@ -102,6 +102,15 @@ bool AgentInterface::runLongTermPlanning(Util::Point goalLocation, bool dontPlan
 	}
 	//==========================================================================
 
+	SteerLib::PathPlanningService * planningService = getSimulationEngine()->getPathPlanningService();
+	if (planningService != NULL)
+	{
+		// head straight for the goal until the path arrives in receiveLongTermPlan().
+		planningService->requestPath(this, position(), goalLocation, (unsigned int) 100000);
+		_waypoints.push_back(goalLocation);
+		return true;
+	}
+
 	// run the main a-star search here
 	std::vector<Util::Point> agentPath;
 	Util::Point pos =  position();
@@ -113,6 +122,14 @@ bool AgentInterface::runLongTermPlanning(Util::Point goalLocation, bool dontPlan
 		return false;
 	}
 
+	_setLongTermPath(agentPath, goalLocation);
+	return true;
+}
+
+void AgentInterface::_setLongTermPath(const std::vector<Util::Point> & agentPath, const Util::Point & goalLocation)
+{
+	_midTermPath.clear();
+	_waypoints.clear();
 	for  (int i=1; i <  agentPath.size(); i++)
 	{
 		_midTermPath.push_back(agentPath.at(i));
@@ -122,7 +139,16 @@ bool AgentInterface::runLongTermPlanning(Util::Point goalLocation, bool dontPlan
 		}
 	}
 	_waypoints.push_back(goalLocation);
-	return true;
+}
+
+void AgentInterface::receiveLongTermPlan(const Util::Point & goalLocation, const std::vector<Util::Point> & path, bool pathComplete)
+{
+	// the agent may have reached or changed its goal while the path was planned.
+	if (!enabled() || !pathComplete || _goalQueue.empty() || (_goalQueue.front().targetLocation != goalLocation))
+	{
+		return;
+	}
+	_setLongTermPath(path, goalLocation);
 }
 
 bool AgentInterface::runLongTermPlanning2(Util::Point goalLocation, bool dontPlan)
@@ -14,6 +14,7 @@
 #include <ios>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 //#include <algorithm>
 //#include <string>
@@ -212,7 +213,7 @@ void AgentMetricsCollector::_checkAndUpdateOneCollision(uintptr_t collisionKey,
 }
 
 
-void AgentMetricsCollector::_updateCollisionStats(SpatialDataBaseInterface * gridDB, AgentInterface * updatedAgent, float currentTimeStamp)
+void AgentMetricsCollector::_updateCollisionStats(SpatialDataBaseInterface * gridDB, AgentInterface * updatedAgent, float currentTimeStamp, const std::vector<SpatialDatabaseItemPtr> * precomputedNeighbors)
 {
 	//
 	// check for collisions with other agents and obstacles.
@@ -220,6 +221,26 @@ void AgentMetricsCollector::_updateCollisionStats(SpatialDataBaseInterface * gri
 	// when analyzing a recording, the spatial database will be populated with AgentMetricsCollector objects instead of agents.
 	//
 
+	if (precomputedNeighbors != NULL) {
+		for (unsigned int i=0; i < precomputedNeighbors->size(); i++) {
+			SpatialDatabaseItemPtr item = (*precomputedNeighbors)[i];
+			_checkAndUpdateOneCollision((uintptr_t)item, item->computePenetration(_currentPosition, _radius), currentTimeStamp);
+		}
+
+		// the list holds every agent that touches this one, so a colliding object that is missing from it has moved
+		// apart (or was removed), and the collision ends just as if it had been found with zero penetration.
+		std::vector<uintptr_t> separatedKeys;
+		for (std::map<uintptr_t, CollisionInfo>::iterator collision = _currentCollidingObjects.begin(); collision != _currentCollidingObjects.end(); ++collision) {
+			if (!std::binary_search(precomputedNeighbors->begin(), precomputedNeighbors->end(), (SpatialDatabaseItemPtr)collision->first)) {
+				separatedKeys.push_back(collision->first);
+			}
+		}
+		for (unsigned int i=0; i < separatedKeys.size(); i++) {
+			_checkAndUpdateOneCollision(separatedKeys[i], 0.0f, currentTimeStamp);
+		}
+		return;
+	}
+
 	std::set<SpatialDatabaseItemPtr> neighbors;
 	std::set<SpatialDatabaseItemPtr>::iterator neighbor;
 	gridDB->getItemsInRange(neighbors, _currentPosition.x - _agentBeingAnalyzed->radius(), _currentPosition.x + _agentBeingAnalyzed->radius(), _currentPosition.z - _agentBeingAnalyzed->radius(), _currentPosition.z + _agentBeingAnalyzed->radius(), updatedAgent);
@@ -268,7 +289,7 @@ void AgentMetricsCollector::_updateAgentInformation(SteerLib::AgentInterface * u
 
 
 
-void AgentMetricsCollector::update(SpatialDataBaseInterface * gridDB, SteerLib::AgentInterface * updatedAgent, float currentTimeStamp, float timePassedSinceLastFrame)
+void AgentMetricsCollector::update(SpatialDataBaseInterface * gridDB, SteerLib::AgentInterface * updatedAgent, float currentTimeStamp, float timePassedSinceLastFrame, const std::vector<SpatialDatabaseItemPtr> * precomputedNeighbors)
 {
 	// this function should not be called if agent is disabled.
 	// std::cout << "collecting metrics for agent " << updatedAgent << " enabled " << updatedAgent->enabled() << std::endl;
@@ -287,7 +308,7 @@ void AgentMetricsCollector::update(SpatialDataBaseInterface * gridDB, SteerLib::
 	_metrics.totalTimeEnabled += timePassedSinceLastFrame;
 
 	// update collision statistics for this frame
-	_updateCollisionStats(gridDB, updatedAgent, currentTimeStamp);
+	_updateCollisionStats(gridDB, updatedAgent, currentTimeStamp, precomputedNeighbors);
 
 
 	Vector changeInPosition = _currentPosition - _previousPosition;                        // units = meters
@@ -0,0 +1,337 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+/// @file CompactGridLayout.cpp
+/// @brief Implements the SteerLib::CompactGridLayout class.
+
+#include <cfloat>
+#include <cmath>
+
+#include "griddatabase/CompactGridLayout.h"
+#include "interfaces/SpatialDataBaseInterface.h"
+#include "interfaces/AgentInterface.h"
+#include "interfaces/ObstacleInterface.h"
+
+using namespace std;
+using namespace SteerLib;
+using namespace Util;
+
+
+CompactGridLayout::CompactGridLayout(SpatialDataBaseInterface * spatialDatabase)
+{
+	_xOrigin = spatialDatabase->getOriginX();
+	_zOrigin = spatialDatabase->getOriginZ();
+	_xCellSize = spatialDatabase->getCellSizeX();
+	_zCellSize = spatialDatabase->getCellSizeZ();
+	_xInvCellSize = 1.0f / _xCellSize;
+	_zInvCellSize = 1.0f / _zCellSize;
+	_xNumCells = spatialDatabase->getNumCellsX();
+	_zNumCells = spatialDatabase->getNumCellsZ();
+
+	_cellStart.assign(_xNumCells*_zNumCells + 1, 0);
+}
+
+
+inline unsigned int CompactGridLayout::_clampedCellX(float x) const
+{
+	float cell = floorf((x - _xOrigin) * _xInvCellSize);
+	if (cell <= 0.0f) return 0;
+	if (cell >= (float)(_xNumCells-1)) return _xNumCells-1;
+	return (unsigned int)cell;
+}
+
+
+inline unsigned int CompactGridLayout::_clampedCellZ(float z) const
+{
+	float cell = floorf((z - _zOrigin) * _zInvCellSize);
+	if (cell <= 0.0f) return 0;
+	if (cell >= (float)(_zNumCells-1)) return _zNumCells-1;
+	return (unsigned int)cell;
+}
+
+
+void CompactGridLayout::clear()
+{
+	_sourceItems.clear();
+	_entryItems.clear();
+	_entryX.clear();
+	_entryZ.clear();
+	_entryHalfWidthX.clear();
+	_entryHalfWidthZ.clear();
+	_entryFlags.clear();
+	_cellStart.assign(_xNumCells*_zNumCells + 1, 0);
+}
+
+
+void CompactGridLayout::_addSourceItem(SpatialDatabaseItemPtr item, float x, float z, float halfWidthX, float halfWidthZ, unsigned char flags)
+{
+	// ignore items that do not touch the grid at all, like GridDatabase2D::addObject() does.
+	if ((x + halfWidthX < _xOrigin) || (x - halfWidthX > _xOrigin + _xNumCells*_xCellSize)
+		|| (z + halfWidthZ < _zOrigin) || (z - halfWidthZ > _zOrigin + _zNumCells*_zCellSize)) {
+		return;
+	}
+
+	SourceItem source;
+	source.item = item;
+	source.x = x;
+	source.z = z;
+	source.halfWidthX = halfWidthX;
+	source.halfWidthZ = halfWidthZ;
+	source.flags = flags;
+	source.xMinIndex = _clampedCellX(x - halfWidthX);
+	source.xMaxIndex = _clampedCellX(x + halfWidthX);
+	source.zMinIndex = _clampedCellZ(z - halfWidthZ);
+	source.zMaxIndex = _clampedCellZ(z + halfWidthZ);
+	_sourceItems.push_back(source);
+}
+
+
+void CompactGridLayout::addItem(SpatialDatabaseItemPtr item, const AxisAlignedBox & bounds)
+{
+	unsigned char flags = 0;
+	if (item->isAgent()) flags |= ENTRY_IS_AGENT;
+	if (item->blocksLineOfSight()) flags |= ENTRY_BLOCKS_LINE_OF_SIGHT;
+	_addSourceItem(item, 0.5f*(bounds.xmin+bounds.xmax), 0.5f*(bounds.zmin+bounds.zmax), 0.5f*(bounds.xmax-bounds.xmin), 0.5f*(bounds.zmax-bounds.zmin), flags);
+}
+
+
+void CompactGridLayout::addAgent(AgentInterface * agent)
+{
+	Point position = agent->position();
+	float radius = agent->radius();
+	unsigned char flags = ENTRY_IS_AGENT;
+	if (agent->blocksLineOfSight()) flags |= ENTRY_BLOCKS_LINE_OF_SIGHT;
+	_addSourceItem(agent, position.x, position.z, radius, radius, flags);
+}
+
+
+void CompactGridLayout::addObstacle(ObstacleInterface * obstacle)
+{
+	addItem(obstacle, obstacle->getBounds());
+}
+
+
+void CompactGridLayout::build()
+{
+	unsigned int numCells = _xNumCells*_zNumCells;
+
+	// count the entries of each cell, shifted by one so that the prefix sum below produces start offsets.
+	_cellStart.assign(numCells + 1, 0);
+	for (unsigned int s=0; s < _sourceItems.size(); s++) {
+		const SourceItem & source = _sourceItems[s];
+		for (unsigned int x=source.xMinIndex; x <= source.xMaxIndex; x++) {
+			for (unsigned int z=source.zMinIndex; z <= source.zMaxIndex; z++) {
+				_cellStart[x*_zNumCells + z + 1]++;
+			}
+		}
+	}
+
+	for (unsigned int c=0; c < numCells; c++) {
+		_cellStart[c+1] += _cellStart[c];
+	}
+
+	unsigned int numEntries = _cellStart[numCells];
+	_entryItems.resize(numEntries);
+	_entryX.resize(numEntries);
+	_entryZ.resize(numEntries);
+	_entryHalfWidthX.resize(numEntries);
+	_entryHalfWidthZ.resize(numEntries);
+	_entryFlags.resize(numEntries);
+
+	// scatter the entries; items keep the order they were added in within each cell.
+	_cellCursor.assign(_cellStart.begin(), _cellStart.end() - 1);
+	for (unsigned int s=0; s < _sourceItems.size(); s++) {
+		const SourceItem & source = _sourceItems[s];
+		for (unsigned int x=source.xMinIndex; x <= source.xMaxIndex; x++) {
+			for (unsigned int z=source.zMinIndex; z <= source.zMaxIndex; z++) {
+				unsigned int i = _cellCursor[x*_zNumCells + z]++;
+				_entryItems[i] = source.item;
+				_entryX[i] = source.x;
+				_entryZ[i] = source.z;
+				_entryHalfWidthX[i] = source.halfWidthX;
+				_entryHalfWidthZ[i] = source.halfWidthZ;
+				_entryFlags[i] = source.flags;
+			}
+		}
+	}
+}
+
+
+void CompactGridLayout::rebuild(const std::vector<AgentInterface*> & agents, const std::set<ObstacleInterface*> & obstacles)
+{
+	clear();
+	for (unsigned int i=0; i < agents.size(); i++) {
+		if (agents[i]->enabled()) {
+			addAgent(agents[i]);
+		}
+	}
+	for (std::set<ObstacleInterface*>::const_iterator iter = obstacles.begin(); iter != obstacles.end(); ++iter) {
+		addObstacle(*iter);
+	}
+	build();
+}
+
+
+void CompactGridLayout::getItemsInRange(std::vector<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude) const
+{
+	neighborList.clear();
+	if (_entryItems.empty()) return;
+
+	unsigned int xMinIndex = _clampedCellX(xmin);
+	unsigned int xMaxIndex = _clampedCellX(xmax);
+	unsigned int zMinIndex = _clampedCellZ(zmin);
+	unsigned int zMaxIndex = _clampedCellZ(zmax);
+
+	for (unsigned int x=xMinIndex; x <= xMaxIndex; x++) {
+		for (unsigned int z=zMinIndex; z <= zMaxIndex; z++) {
+			unsigned int cellIndex = x*_zNumCells + z;
+			for (unsigned int i=_cellStart[cellIndex]; i < _cellStart[cellIndex+1]; i++) {
+				float itemXMin = _entryX[i] - _entryHalfWidthX[i];
+				float itemZMin = _entryZ[i] - _entryHalfWidthZ[i];
+				if ((itemXMin > xmax) || (_entryX[i] + _entryHalfWidthX[i] < xmin)
+					|| (itemZMin > zmax) || (_entryZ[i] + _entryHalfWidthZ[i] < zmin)) {
+					continue;
+				}
+				// an item that spans several cells is only reported by the cell that holds the
+				// min corner of its overlap with the range, so the results need no de-duplication.
+				if ((_clampedCellX(max(itemXMin, xmin)) != x) || (_clampedCellZ(max(itemZMin, zmin)) != z)) {
+					continue;
+				}
+				if (_entryItems[i] != exclude) {
+					neighborList.push_back(_entryItems[i]);
+				}
+			}
+		}
+	}
+}
+
+
+inline bool CompactGridLayout::_intersectsEntry(unsigned int i, const Ray & r, float & t) const
+{
+	if (_entryFlags[i] & ENTRY_IS_AGENT) {
+		return rayIntersectsCircle2D(Point(_entryX[i], 0.0f, _entryZ[i]), _entryHalfWidthX[i], r, t);
+	}
+
+	// obstacles may not be boxes, so the stored bounds can only rule them out.
+	float boxT;
+	if (!rayIntersectsBox2D(_entryX[i] - _entryHalfWidthX[i], _entryX[i] + _entryHalfWidthX[i], _entryZ[i] - _entryHalfWidthZ[i], _entryZ[i] + _entryHalfWidthZ[i], r, boxT)) {
+		return false;
+	}
+	return _entryItems[i]->intersects(r, t);
+}
+
+
+bool CompactGridLayout::_traceCells(const Ray & r, float & t, SpatialDatabaseItemPtr & hitObject, SpatialDatabaseItemPtr exclude1, SpatialDatabaseItemPtr exclude2, unsigned char skipFlags, unsigned char requiredFlags, bool findAny) const
+{
+	hitObject = NULL;
+	if (_entryItems.empty()) return false;
+
+	// clip the ray's interval to the grid.
+	float tEnter = r.mint;
+	float tExit = r.maxt;
+	float xGridMax = _xOrigin + _xNumCells*_xCellSize;
+	float zGridMax = _zOrigin + _zNumCells*_zCellSize;
+	if (r.dir.x != 0.0f) {
+		float t0 = (_xOrigin - r.pos.x) / r.dir.x;
+		float t1 = (xGridMax - r.pos.x) / r.dir.x;
+		if (t0 > t1) swap(t0, t1);
+		tEnter = max(tEnter, t0);
+		tExit = min(tExit, t1);
+	}
+	else if ((r.pos.x < _xOrigin) || (r.pos.x > xGridMax)) {
+		return false;
+	}
+	if (r.dir.z != 0.0f) {
+		float t0 = (_zOrigin - r.pos.z) / r.dir.z;
+		float t1 = (zGridMax - r.pos.z) / r.dir.z;
+		if (t0 > t1) swap(t0, t1);
+		tEnter = max(tEnter, t0);
+		tExit = min(tExit, t1);
+	}
+	else if ((r.pos.z < _zOrigin) || (r.pos.z > zGridMax)) {
+		return false;
+	}
+	if (tEnter > tExit) return false;
+
+	// set up the cell walk, visiting cells in the order the ray crosses them.
+	Point start = r.eval(tEnter);
+	int x = (int)_clampedCellX(start.x);
+	int z = (int)_clampedCellZ(start.z);
+	int stepX = (r.dir.x > 0.0f) ? 1 : -1;
+	int stepZ = (r.dir.z > 0.0f) ? 1 : -1;
+	float tNextX = FLT_MAX, tNextZ = FLT_MAX, tDeltaX = FLT_MAX, tDeltaZ = FLT_MAX;
+	if (r.dir.x != 0.0f) {
+		float nextBoundary = _xOrigin + (x + ((stepX > 0) ? 1 : 0)) * _xCellSize;
+		tNextX = (nextBoundary - r.pos.x) / r.dir.x;
+		tDeltaX = _xCellSize / fabsf(r.dir.x);
+	}
+	if (r.dir.z != 0.0f) {
+		float nextBoundary = _zOrigin + (z + ((stepZ > 0) ? 1 : 0)) * _zCellSize;
+		tNextZ = (nextBoundary - r.pos.z) / r.dir.z;
+		tDeltaZ = _zCellSize / fabsf(r.dir.z);
+	}
+
+	// like GridDatabase2D::trace(), hits outside of the grid do not count.
+	Ray clippedRay = r;
+	float bestT = tExit;
+	bool found = false;
+
+	while (true) {
+		unsigned int cellIndex = x*_zNumCells + z;
+		for (unsigned int i=_cellStart[cellIndex]; i < _cellStart[cellIndex+1]; i++) {
+			unsigned char flags = _entryFlags[i];
+			if ((flags & skipFlags) || ((flags & requiredFlags) != requiredFlags)) continue;
+			if ((_entryItems[i] == exclude1) || (_entryItems[i] == exclude2)) continue;
+
+			float entryT;
+			clippedRay.maxt = bestT;
+			if (_intersectsEntry(i, clippedRay, entryT) && (entryT < bestT)) {
+				bestT = entryT;
+				hitObject = _entryItems[i];
+				found = true;
+				if (findAny) {
+					t = bestT;
+					return true;
+				}
+			}
+		}
+
+		// a hit inside this cell cannot be beaten by anything in the cells further along the ray.
+		float tCellExit = min(tNextX, tNextZ);
+		if ((found) && (bestT <= tCellExit)) break;
+		if (tCellExit >= tExit) break;
+
+		if (tNextX < tNextZ) {
+			x += stepX;
+			if ((x < 0) || (x >= (int)_xNumCells)) break;
+			tNextX += tDeltaX;
+		}
+		else {
+			z += stepZ;
+			if ((z < 0) || (z >= (int)_zNumCells)) break;
+			tNextZ += tDeltaZ;
+		}
+	}
+
+	if (found) t = bestT;
+	return found;
+}
+
+
+bool CompactGridLayout::trace(const Ray & r, float & t, SpatialDatabaseItemPtr & hitObject, SpatialDatabaseItemPtr exclude, bool excludeAgents) const
+{
+	return _traceCells(r, t, hitObject, exclude, exclude, (excludeAgents) ? ENTRY_IS_AGENT : 0, 0, false);
+}
+
+
+bool CompactGridLayout::hasLineOfSight(const Point & p1, const Point & p2, SpatialDatabaseItemPtr exclude1, SpatialDatabaseItemPtr exclude2) const
+{
+	Ray r;
+	r.initWithUnitInterval(p1, p2-p1);
+	float t;
+	SpatialDatabaseItemPtr hitObject;
+	return !_traceCells(r, t, hitObject, exclude1, exclude2, 0, ENTRY_BLOCKS_LINE_OF_SIGHT, true);
+}
@@ -19,7 +19,9 @@
 #include "mersenne/MersenneTwister.h"
 
 #include "interfaces/AgentInterface.h"
+#include "interfaces/ObstacleInterface.h"
 #include "griddatabase/GridDatabase2D.h"
+#include "griddatabase/ObstacleDistanceField.h"
 #include "griddatabase/GridDatabasePlanningDomain.h"
 
 using namespace std;
@@ -82,6 +84,7 @@ GridDatabase2D::~GridDatabase2D()
 {
 	delete [] _basePtr;
 	delete [] _cells;
+	delete _obstacleDistanceField;
 }
 
 
@@ -90,10 +93,8 @@ GridDatabase2D::~GridDatabase2D()
 //
 void GridDatabase2DPrivate::_allocateDatabase()
 {
-	if (_maxItemsPerCell > 15) {
-		cerr << "WARNING: GridDatabase2D is linearly dependent on _maxItemsPerCell." << endl;
-		cerr << "         right now _maxItemsPerCell is " << _maxItemsPerCell << "," << endl;
-		cerr << "         performance may degrade." << endl;
+	if (_maxItemsPerCell == 0) {
+		throw GenericException("maxItemsPerGridCell must be at least 1; cells grow from their own slots into the overflow pool.");
 	}
 
 	unsigned int numTotalCells = _xNumCells*_zNumCells;
@@ -107,6 +108,41 @@ void GridDatabase2DPrivate::_allocateDatabase()
 		// of astar lib...  is traversal cost a fixed cost to add, or is it a multiplicative factor?
 		_cells[i].init( _maxItemsPerCell, _basePtr + (i*_maxItemsPerCell), 1.0f );
 	}
+
+	_obstacleCellBits.assign((numTotalCells + 31) / 32, 0);
+	_lineOfSightCellBits.assign((numTotalCells + 31) / 32, 0);
+}
+
+
+//
+// _updateObstacleCellBits() - called after a non-agent item was added to or removed from the given cells.
+//
+void GridDatabase2DPrivate::_updateObstacleCellBits(unsigned int xMinIndex, unsigned int xMaxIndex, unsigned int zMinIndex, unsigned int zMaxIndex)
+{
+	for (unsigned int i=xMinIndex; i<=xMaxIndex; i++) {
+		unsigned int cellIndex = i*_zNumCells + zMinIndex;
+		for (unsigned int j=zMinIndex; j<=zMaxIndex; j++) {
+			bool hasObstacle = false;
+			bool blocksLineOfSight = false;
+			for (unsigned int k=0; k < _cells[cellIndex]._numItems; k++) {
+				SpatialDatabaseItemPtr item = _cells[cellIndex]._items[k];
+				if (!item->isAgent()) {
+					hasObstacle = true;
+					if (item->blocksLineOfSight()) {
+						blocksLineOfSight = true;
+						break;
+					}
+				}
+			}
+
+			unsigned int mask = 1u << (cellIndex & 31);
+			if (hasObstacle) _obstacleCellBits[cellIndex >> 5] |= mask;
+			else _obstacleCellBits[cellIndex >> 5] &= ~mask;
+			if (blocksLineOfSight) _lineOfSightCellBits[cellIndex >> 5] |= mask;
+			else _lineOfSightCellBits[cellIndex >> 5] &= ~mask;
+			cellIndex++;
+		}
+	}
 }
 
 
@@ -117,7 +153,72 @@ void GridDatabase2D::clearDatabase()
 	{
 		// TODO: is it OK to make the traversal cost 0.0f ?? it would be more general.  need to double-check assumptions
 		// of astar lib...  is traversal cost a fixed cost to add, or is it a multiplicative factor?
-		_cells[i].clear();
+		_cells[i].clear(_maxItemsPerCell, _overflowPool);
+	}
+	std::fill(_obstacleCellBits.begin(), _obstacleCellBits.end(), 0);
+	std::fill(_lineOfSightCellBits.begin(), _lineOfSightCellBits.end(), 0);
+	_agentsBlockLineOfSight = false;
+	if (_obstacleDistanceField != NULL) {
+		_obstacleDistanceField->clear();
+	}
+}
+
+
+//
+// _getObstaclesInCells() - collects the obstacles of a range of cells, skipping the cells that only hold agents.
+//
+void GridDatabase2DPrivate::_getObstaclesInCells(std::vector<ObstacleInterface*> & obstacles, unsigned int xMinIndex, unsigned int xMaxIndex, unsigned int zMinIndex, unsigned int zMaxIndex)
+{
+	obstacles.clear();
+	for (unsigned int i=xMinIndex; i<=xMaxIndex; i++) {
+		unsigned int cellIndex = i*_zNumCells + zMinIndex;
+		for (unsigned int j=zMinIndex; j<=zMaxIndex; j++) {
+			if (_isCellBitSet(_obstacleCellBits, cellIndex)) {
+				for (unsigned int k=0; k < _cells[cellIndex]._numItems; k++) {
+					SpatialDatabaseItemPtr item = _cells[cellIndex]._items[k];
+					if (item->isAgent()) continue;
+					ObstacleInterface * obstacle = dynamic_cast<ObstacleInterface*>(item);
+					if (obstacle != NULL) obstacles.push_back(obstacle);
+				}
+			}
+			cellIndex++;
+		}
+	}
+
+	// obstacles that overlap several cells were found once in each.
+	std::sort(obstacles.begin(), obstacles.end());
+	obstacles.erase(std::unique(obstacles.begin(), obstacles.end()), obstacles.end());
+}
+
+
+//
+// _updateObstacleDistanceField() - called after a non-agent item was added to or removed from the database.
+//
+void GridDatabase2DPrivate::_updateObstacleDistanceField(const AxisAlignedBox & changedBounds)
+{
+	// the change reaches maxDistance around the item; the samples there depend on every obstacle within maxDistance of them.
+	float reach = _obstacleDistanceField->getMaxDistance();
+	AxisAlignedBox region(changedBounds.xmin - reach, changedBounds.xmax + reach, 0.0f, 0.0f, changedBounds.zmin - reach, changedBounds.zmax + reach);
+
+	std::vector<ObstacleInterface*> obstacles;
+	unsigned int xMinIndex, xMaxIndex, zMinIndex, zMaxIndex;
+	if (_clampSpatialBoundsToIndexRange(region.xmin - reach, region.xmax + reach, region.zmin - reach, region.zmax + reach, xMinIndex, xMaxIndex, zMinIndex, zMaxIndex)) {
+		_getObstaclesInCells(obstacles, xMinIndex, xMaxIndex, zMinIndex, zMaxIndex);
+	}
+	_obstacleDistanceField->rebuildRegion(region, obstacles);
+}
+
+
+void GridDatabase2D::buildObstacleDistanceField(float maxDistance, float sampleSpacing)
+{
+	delete _obstacleDistanceField;
+	_obstacleDistanceField = NULL;
+	_obstacleDistanceField = new ObstacleDistanceField(_xOrigin, _xOrigin + _xGridSize, _zOrigin, _zOrigin + _zGridSize, sampleSpacing, maxDistance);
+
+	std::vector<ObstacleInterface*> obstacles;
+	_getObstaclesInCells(obstacles, 0, _xNumCells-1, 0, _zNumCells-1);
+	for (unsigned int i=0; i < obstacles.size(); i++) {
+		_obstacleDistanceField->addObstacle(obstacles[i]);
 	}
 }
 
@@ -186,6 +287,11 @@ inline bool GridDatabase2DPrivate::_clampSpatialBoundsToIndexRange(float xmin, f
 //
 void GridDatabase2D::addObject( SpatialDatabaseItemPtr item, const AxisAlignedBox & newBounds )
 {
+	if (_deferringUpdates) {
+		_deferUpdate(DeferredUpdate::DEFERRED_ADD, item, newBounds, newBounds);
+		return;
+	}
+
 	// convert the spatial bounds of the object into index bounds
 	if ( ( newBounds.xmin != newBounds.xmin ) || (newBounds.xmax != newBounds.xmax) || (newBounds.zmin != newBounds.zmin) ||
 			(newBounds.zmax != newBounds.zmax))
@@ -208,11 +314,21 @@ void GridDatabase2D::addObject( SpatialDatabaseItemPtr item, const AxisAlignedBo
 	for (unsigned int i=xMinIndex; i<=xMaxIndex; i++) {
 		cellIndex = getCellIndexFromGridCoords(i,zMinIndex);
 		for (unsigned int j=zMinIndex; j<=zMaxIndex; j++) {
-			_cells[cellIndex].add(item,_maxItemsPerCell, item->getTraversalCost());
+			_cells[cellIndex].add(item,_maxItemsPerCell, item->getTraversalCost(), _overflowPool);
 			// std::cout << "CellIndex is: " << cellIndex << std::endl;
 			cellIndex++;
 		}
 	}
+
+	if (!item->isAgent()) {
+		_updateObstacleCellBits(xMinIndex, xMaxIndex, zMinIndex, zMaxIndex);
+		if (_obstacleDistanceField != NULL) {
+			_updateObstacleDistanceField(newBounds);
+		}
+	}
+	else if (!_agentsBlockLineOfSight && item->blocksLineOfSight()) {
+		_agentsBlockLineOfSight = true;
+	}
 }
 
 
@@ -221,6 +337,11 @@ void GridDatabase2D::addObject( SpatialDatabaseItemPtr item, const AxisAlignedBo
 //
 void GridDatabase2D::removeObject( SpatialDatabaseItemPtr item, const AxisAlignedBox &oldBounds )
 {
+	if (_deferringUpdates) {
+		_deferUpdate(DeferredUpdate::DEFERRED_REMOVE, item, oldBounds, oldBounds);
+		return;
+	}
+
 	// convert the spatial bounds of the object into index bounds
 	unsigned int xMinIndex, xMaxIndex, zMinIndex, zMaxIndex;
 	if (_clampSpatialBoundsToIndexRange(oldBounds.xmin, oldBounds.xmax, oldBounds.zmin, oldBounds.zmax, xMinIndex, xMaxIndex, zMinIndex, zMaxIndex) == false) {
@@ -240,10 +361,17 @@ void GridDatabase2D::removeObject( SpatialDatabaseItemPtr item, const AxisAligne
 	for (unsigned int i=xMinIndex; i<=xMaxIndex; i++) {
 		cellIndex = getCellIndexFromGridCoords(i,zMinIndex);
 		for (unsigned int j=zMinIndex; j<=zMaxIndex; j++) {
-			_cells[cellIndex].remove(item, _maxItemsPerCell, item->getTraversalCost());
+			_cells[cellIndex].remove(item, _maxItemsPerCell, item->getTraversalCost(), _overflowPool);
 			cellIndex++;
 		}
 	}
+
+	if (!item->isAgent()) {
+		_updateObstacleCellBits(xMinIndex, xMaxIndex, zMinIndex, zMaxIndex);
+		if (_obstacleDistanceField != NULL) {
+			_updateObstacleDistanceField(oldBounds);
+		}
+	}
 }
 
 
@@ -261,12 +389,100 @@ void GridDatabase2D::updateObject( SpatialDatabaseItemPtr item, const AxisAligne
 #ifdef _DEBUG
 	std::cout << "about to updateObject()\n";
 #endif
+	if (_deferringUpdates) {
+		_deferUpdate(DeferredUpdate::DEFERRED_UPDATE, item, oldBounds, newBounds);
+		return;
+	}
+
 	removeObject(item, oldBounds);
 	// assert(item != NULL);
 	addObject(item, newBounds);
 }
 
 
+//
+// beginDeferredUpdates() - from now on, updates are only recorded, so that worker threads can
+// move objects at the same time without locking grid cells.
+//
+bool GridDatabase2D::beginDeferredUpdates(unsigned int expectedNumUpdates)
+{
+	if (_deferringUpdates) {
+		throw GenericException("GridDatabase2D::beginDeferredUpdates() called twice without commitDeferredUpdates().");
+	}
+
+	if (_deferredUpdates.size() < expectedNumUpdates) {
+		_deferredUpdates.resize(expectedNumUpdates);
+	}
+	_numDeferredUpdates = 0;
+	_overflowUpdates.clear();
+	_deferringUpdates = true;
+	return true;
+}
+
+
+//
+// commitDeferredUpdates() - applies the recorded updates on the calling thread.
+//
+void GridDatabase2D::commitDeferredUpdates()
+{
+	if (!_deferringUpdates) {
+		return;
+	}
+	_deferringUpdates = false;
+
+	unsigned int numRecorded = min((unsigned int)_numDeferredUpdates, (unsigned int)_deferredUpdates.size());
+	std::vector<DeferredUpdate>::iterator recordedEnd = _deferredUpdates.begin() + numRecorded;
+	if (!_overflowUpdates.empty()) {
+		_deferredUpdates.insert(recordedEnd, _overflowUpdates.begin(), _overflowUpdates.end());
+		numRecorded += _overflowUpdates.size();
+		_overflowUpdates.clear();
+		recordedEnd = _deferredUpdates.begin() + numRecorded;
+	}
+
+	// threads record in any order, but each item's own updates come from one thread in program order;
+	// a stable sort by item keeps those, and makes the order the grid cells are filled in independent of thread timing.
+	std::stable_sort(_deferredUpdates.begin(), recordedEnd);
+
+	for (std::vector<DeferredUpdate>::iterator update = _deferredUpdates.begin(); update != recordedEnd; ++update) {
+		switch (update->type) {
+			case DeferredUpdate::DEFERRED_ADD:
+				addObject(update->item, update->newBounds);
+				break;
+			case DeferredUpdate::DEFERRED_REMOVE:
+				removeObject(update->item, update->oldBounds);
+				break;
+			case DeferredUpdate::DEFERRED_UPDATE:
+				updateObject(update->item, update->oldBounds, update->newBounds);
+				break;
+		}
+	}
+	_numDeferredUpdates = 0;
+}
+
+
+void GridDatabase2DPrivate::_deferUpdate(DeferredUpdate::UpdateType type, SpatialDatabaseItemPtr item, const AxisAlignedBox & oldBounds, const AxisAlignedBox & newBounds)
+{
+	unsigned int slot = _numDeferredUpdates.fetch_add(1);
+	if (slot < _deferredUpdates.size()) {
+		DeferredUpdate & update = _deferredUpdates[slot];
+		update.type = type;
+		update.item = item;
+		update.oldBounds = oldBounds;
+		update.newBounds = newBounds;
+	}
+	else {
+		DeferredUpdate update;
+		update.type = type;
+		update.item = item;
+		update.oldBounds = oldBounds;
+		update.newBounds = newBounds;
+		_overflowMutex.lock();
+		_overflowUpdates.push_back(update);
+		_overflowMutex.unlock();
+	}
+}
+
+
 //
 // getItemsInRange() - the protected version uses the integer index ranges.
 //
@@ -278,8 +494,8 @@ void GridDatabase2D::getItemsInRange(set<SpatialDatabaseItemPtr> & neighborList,
 	for (unsigned int i=xMinIndex; i<=xMaxIndex; i++) {
 		cellIndex = (i * _zNumCells) + zMinIndex;
 		for (unsigned int j=zMinIndex; j<=zMaxIndex; j++) {
-			for (unsigned int k=0; k < _maxItemsPerCell; k++) {
-				if ((_cells[cellIndex]._items[k]!=NULL) && (_cells[cellIndex]._items[k]!=exclude)) {
+			for (unsigned int k=0; k < _cells[cellIndex]._numItems; k++) {
+				if (_cells[cellIndex]._items[k]!=exclude) {
 					neighborList.insert(_cells[cellIndex]._items[k]);
 				}
 			}
@@ -312,7 +528,7 @@ void GridDatabase2D::getItemsInVisualField(set<SpatialDatabaseItemPtr> & neighbo
 	for (unsigned int i=xMinIndex; i<=xMaxIndex; i++) {
 		cellIndex = getCellIndexFromGridCoords(i,zMinIndex);
 		for (unsigned int j=zMinIndex; j<=zMaxIndex; j++) {
-			for (unsigned int k=0; k < _maxItemsPerCell; k++) {
+			for (unsigned int k=0; k < _cells[cellIndex]._numItems; k++) {
 				SpatialDatabaseItemPtr possiblyVisibleObject = _cells[cellIndex]._items[k];
 
 
@@ -365,6 +581,252 @@ void GridDatabase2D::getItemsInVisualField(set<SpatialDatabaseItemPtr> & neighbo
 	}
 }
 
+
+//
+// getItemsInRange() - flat buffer version of the protected index-range query.  Items that overlap several cells
+// are collected once per cell, then sorted and made unique in place, which gives the same order as the STL set.
+//
+void GridDatabase2D::getItemsInRange(std::vector<SpatialDatabaseItemPtr> & neighborList, unsigned int xMinIndex, unsigned int xMaxIndex, unsigned int zMinIndex, unsigned int zMaxIndex, SpatialDatabaseItemPtr exclude)
+{
+	neighborList.clear();
+
+	int cellIndex;
+	for (unsigned int i=xMinIndex; i<=xMaxIndex; i++) {
+		cellIndex = (i * _zNumCells) + zMinIndex;
+		for (unsigned int j=zMinIndex; j<=zMaxIndex; j++) {
+			for (unsigned int k=0; k < _cells[cellIndex]._numItems; k++) {
+				if (_cells[cellIndex]._items[k]!=exclude) {
+					neighborList.push_back(_cells[cellIndex]._items[k]);
+				}
+			}
+			cellIndex++;
+		}
+	}
+
+	std::sort(neighborList.begin(), neighborList.end());
+	neighborList.erase(std::unique(neighborList.begin(), neighborList.end()), neighborList.end());
+}
+
+
+//
+// getItemsInRange() - flat buffer version; converts the spatial bounds into index range.
+//
+void GridDatabase2D::getItemsInRange(std::vector<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude)
+{
+	unsigned int xMinIndex=0, xMaxIndex=0, zMinIndex=0, zMaxIndex=0;
+	_clampSpatialBoundsToIndexRange(xmin, xmax, zmin, zmax, xMinIndex, xMaxIndex, zMinIndex, zMaxIndex);
+	getItemsInRange(neighborList,xMinIndex,xMaxIndex,zMinIndex,zMaxIndex,exclude);
+}
+
+
+//
+// getItemsInVisualField() - flat buffer version; collects the unique items in range first, so that
+// the line-of-sight test runs once per agent instead of once per overlapped cell.
+//
+void GridDatabase2D::getItemsInVisualField(std::vector<SpatialDatabaseItemPtr> & neighborList, float xmin, float xmax, float zmin, float zmax, SpatialDatabaseItemPtr exclude, const Point & position, const Vector & facingDirection, float radiusSquared)
+{
+	getItemsInRange(neighborList, xmin, xmax, zmin, zmax, exclude);
+
+	// compact the buffer in place, keeping obstacles and the agents that pass the same tests as the STL set version.
+	std::vector<SpatialDatabaseItemPtr>::iterator keep = neighborList.begin();
+	for (std::vector<SpatialDatabaseItemPtr>::iterator item = neighborList.begin(); item != neighborList.end(); ++item) {
+		SpatialDatabaseItemPtr possiblyVisibleObject = *item;
+		if (possiblyVisibleObject->isAgent()) {
+			Point hisPosition = (dynamic_cast<AgentInterface*>(possiblyVisibleObject))->position();
+			Vector directionToOtherAgent = hisPosition - position;
+			float distSquared = directionToOtherAgent.lengthSquared();
+			if (distSquared > radiusSquared)
+				continue;
+
+			float cosTheta = dot(directionToOtherAgent/sqrtf(distSquared),normalize(facingDirection));
+			if (cosTheta < 0.0f)
+				continue;
+
+			if (!hasLineOfSight(position, hisPosition, possiblyVisibleObject, exclude))
+				continue;
+		}
+		*keep = possiblyVisibleObject;
+		++keep;
+	}
+	neighborList.erase(keep, neighborList.end());
+}
+
+void GridDatabase2DPrivate::_insertNearestAgentsInCell(unsigned int cellIndex, std::vector<std::pair<float, const AgentInterface *> > & neighbors, const Point & position, unsigned int k, float & rangeSq, SpatialDatabaseItemPtr exclude)
+{
+	for (unsigned int i=0; i < _cells[cellIndex]._numItems; i++) {
+		SpatialDatabaseItemPtr item = _cells[cellIndex]._items[i];
+		if ((item == exclude) || (!item->isAgent())) continue;
+		AgentInterface * agent = dynamic_cast<AgentInterface*>(item);
+		SpatialDataBaseInterface::insertNearestAgent(neighbors, k, (agent->position() - position).lengthSquared(), agent, rangeSq);
+	}
+}
+
+
+void GridDatabase2D::getKNearestAgents(std::vector<std::pair<float, const AgentInterface *> > & neighbors, const Point & position, unsigned int k, float maxRange, SpatialDatabaseItemPtr exclude)
+{
+	neighbors.clear();
+	if (k == 0) return;
+
+	float rangeSq = maxRange * maxRange;
+	int xNumCells = (int)_xNumCells;
+	int zNumCells = (int)_zNumCells;
+
+	// the cell containing position, clamped to the grid.
+	int xCenter = (int)floor((position.x - _xOrigin) / _xCellSize);
+	int zCenter = (int)floor((position.z - _zOrigin) / _zCellSize);
+	xCenter = max(0, min(xNumCells-1, xCenter));
+	zCenter = max(0, min(zNumCells-1, zCenter));
+
+	// every agent is stored in the cell that contains its center, so after searching the square of
+	// cells [xCenter-ring, xCenter+ring] x [zCenter-ring, zCenter+ring], any agent not yet found is
+	// at least as far away as the nearest edge of that square.
+	for (int ring=0; ; ring++) {
+		int x0 = xCenter - ring, x1 = xCenter + ring;
+		int z0 = zCenter - ring, z1 = zCenter + ring;
+
+		for (int x = max(x0, 0); x <= min(x1, xNumCells-1); x++) {
+			if ((x == x0) || (x == x1)) {
+				for (int z = max(z0, 0); z <= min(z1, zNumCells-1); z++) {
+					_insertNearestAgentsInCell(getCellIndexFromGridCoords(x,z), neighbors, position, k, rangeSq, exclude);
+				}
+			}
+			else {
+				if (z0 >= 0) _insertNearestAgentsInCell(getCellIndexFromGridCoords(x,z0), neighbors, position, k, rangeSq, exclude);
+				if (z1 < zNumCells) _insertNearestAgentsInCell(getCellIndexFromGridCoords(x,z1), neighbors, position, k, rangeSq, exclude);
+			}
+		}
+
+		if ((x0 <= 0) && (z0 <= 0) && (x1 >= xNumCells-1) && (z1 >= zNumCells-1)) break;
+
+		float distanceToNextRing = min(min(position.x - (_xOrigin + x0*_xCellSize), (_xOrigin + (x1+1)*_xCellSize) - position.x),
+			min(position.z - (_zOrigin + z0*_zCellSize), (_zOrigin + (z1+1)*_zCellSize) - position.z));
+		if ((distanceToNextRing > 0.0f) && (distanceToNextRing * distanceToNextRing >= rangeSq)) break;
+	}
+}
+
+
+void GridDatabase2D::computeAllAgentNeighbors(const std::vector<AgentInterface*> & agents, float padding, std::vector< std::vector<SpatialDatabaseItemPtr> > & neighborLists)
+{
+	NeighborBatch & batch = _neighborBatch;
+	unsigned int numAgents = (unsigned int)agents.size();
+	unsigned int numCells = _xNumCells * _zNumCells;
+
+	neighborLists.resize(numAgents);
+	for (unsigned int i=0; i < numAgents; i++) {
+		neighborLists[i].clear();
+	}
+
+	// cache every agent's position and radius, so that the pair tests below do not call virtual functions.
+	batch.x.resize(numAgents);
+	batch.z.resize(numAgents);
+	batch.radius.resize(numAgents);
+	batch.homeCell.resize(numAgents);
+	batch.agentCellStart.assign(numCells+1, 0);
+	float maxRadius = 0.0f;
+	for (unsigned int i=0; i < numAgents; i++) {
+		if (!agents[i]->enabled()) {
+			batch.homeCell[i] = NeighborBatch::NO_CELL;
+			continue;
+		}
+		Point position = agents[i]->position();
+		batch.x[i] = position.x;
+		batch.z[i] = position.z;
+		batch.radius[i] = agents[i]->radius();
+		maxRadius = max(maxRadius, batch.radius[i]);
+
+		int x = (int)floor((position.x - _xOrigin) / _xCellSize);
+		int z = (int)floor((position.z - _zOrigin) / _zCellSize);
+		x = max(0, min((int)_xNumCells-1, x));
+		z = max(0, min((int)_zNumCells-1, z));
+		batch.homeCell[i] = getCellIndexFromGridCoords(x,z);
+		batch.agentCellStart[batch.homeCell[i]+1]++;
+	}
+
+	// counting sort of the agents by home cell.
+	for (unsigned int c=0; c < numCells; c++) {
+		batch.agentCellStart[c+1] += batch.agentCellStart[c];
+	}
+	batch.agentsByCell.resize(batch.agentCellStart[numCells]);
+	batch.cellCursor.assign(batch.agentCellStart.begin(), batch.agentCellStart.end()-1);
+	for (unsigned int i=0; i < numAgents; i++) {
+		if (batch.homeCell[i] != NeighborBatch::NO_CELL) {
+			batch.agentsByCell[batch.cellCursor[batch.homeCell[i]]++] = i;
+		}
+	}
+
+	// two agents can only be neighbors if their centers are closer than reach, so their home cells are at most
+	// xReach, zReach cells apart.  Only half of that neighborhood is visited from each cell, so that every pair of
+	// cells, and every pair of agents, is tested exactly once.
+	float reach = 2.0f * maxRadius + padding;
+	int xReach = (int)ceil(reach / _xCellSize);
+	int zReach = (int)ceil(reach / _zCellSize);
+	for (int x=0; x < (int)_xNumCells; x++) {
+		for (int z=0; z < (int)_zNumCells; z++) {
+			unsigned int cell = getCellIndexFromGridCoords(x,z);
+			unsigned int cellBegin = batch.agentCellStart[cell];
+			unsigned int cellEnd = batch.agentCellStart[cell+1];
+			if (cellBegin == cellEnd) continue;
+
+			for (int nx = x; nx <= min(x + xReach, (int)_xNumCells-1); nx++) {
+				for (int nz = max(z - zReach, 0); nz <= min(z + zReach, (int)_zNumCells-1); nz++) {
+					if ((nx == x) && (nz < z)) continue;
+					unsigned int otherCell = getCellIndexFromGridCoords(nx,nz);
+
+					for (unsigned int a = cellBegin; a < cellEnd; a++) {
+						unsigned int i = batch.agentsByCell[a];
+						unsigned int otherBegin = (otherCell == cell) ? a+1 : batch.agentCellStart[otherCell];
+						for (unsigned int b = otherBegin; b < batch.agentCellStart[otherCell+1]; b++) {
+							unsigned int j = batch.agentsByCell[b];
+							float dx = batch.x[i] - batch.x[j];
+							float dz = batch.z[i] - batch.z[j];
+							float limit = batch.radius[i] + batch.radius[j] + padding;
+							if (dx*dx + dz*dz < limit*limit) {
+								neighborLists[i].push_back(agents[j]);
+								neighborLists[j].push_back(agents[i]);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// collect the non-agent items of every cell once, instead of once per agent that looks at the cell.
+	batch.obstacleCellStart.assign(numCells+1, 0);
+	batch.obstaclesByCell.clear();
+	for (unsigned int c=0; c < numCells; c++) {
+		const GridCell & gridCell = _cells[c];
+		for (unsigned int k=0; k < gridCell._numItems; k++) {
+			if (!gridCell._items[k]->isAgent()) {
+				batch.obstaclesByCell.push_back(gridCell._items[k]);
+			}
+		}
+		batch.obstacleCellStart[c+1] = (unsigned int)batch.obstaclesByCell.size();
+	}
+
+	for (unsigned int i=0; i < numAgents; i++) {
+		if (batch.homeCell[i] == NeighborBatch::NO_CELL) continue;
+		std::vector<SpatialDatabaseItemPtr> & neighbors = neighborLists[i];
+
+		float r = batch.radius[i] + padding;
+		unsigned int xMinIndex, xMaxIndex, zMinIndex, zMaxIndex;
+		if (_clampSpatialBoundsToIndexRange(batch.x[i]-r, batch.x[i]+r, batch.z[i]-r, batch.z[i]+r, xMinIndex, xMaxIndex, zMinIndex, zMaxIndex)) {
+			for (unsigned int cx=xMinIndex; cx<=xMaxIndex; cx++) {
+				unsigned int cell = getCellIndexFromGridCoords(cx,zMinIndex);
+				// the cells of one column are contiguous, and so are their obstacles.
+				unsigned int end = batch.obstacleCellStart[cell + (zMaxIndex-zMinIndex) + 1];
+				for (unsigned int k = batch.obstacleCellStart[cell]; k < end; k++) {
+					neighbors.push_back(batch.obstaclesByCell[k]);
+				}
+			}
+		}
+
+		std::sort(neighbors.begin(), neighbors.end());
+		neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+	}
+}
+
+
 void GridDatabase2D::draw()
 {
 #ifdef ENABLE_GUI
@@ -505,10 +967,12 @@ bool GridDatabase2D::trace(const Ray & r, float & t, SpatialDatabaseItemPtr &hit
 		hitObject = NULL;
 		float mostRecent_maxt = min(maxt,min(txfar,tzfar)); // this way no intersection will be valid unless it was within this grid cell
 
-		for (unsigned int i=0; i<_maxItemsPerCell; i++)
+		// without agents, only cells that hold an obstacle can stop the ray.
+		unsigned int numItemsToTest = ((!excludeAgents) || _isCellBitSet(_obstacleCellBits, currentBin)) ? _cells[currentBin]._numItems : 0;
+		for (unsigned int i=0; i<numItemsToTest; i++)
 		{
 
-			if ((_cells[currentBin]._items[i] != NULL) && (_cells[currentBin]._items[i] != exclude)) // && (_cells[currentBin]._numItems > i))
+			if (_cells[currentBin]._items[i] != exclude)
 			{ // Getting trace errors for outside of mapped region.
 				// Access not within mapped region at address 0xFFFFFFE00991E050
 
@@ -644,8 +1108,10 @@ bool GridDatabase2D::hasLineOfSight(const Ray & r, SpatialDatabaseItemPtr exclud
 		validIntersectionFound = false;
 		float mostRecent_maxt = min(maxt,min(txfar,tzfar)); // this way no intersection will be valid unless it was within this grid cell
 
-		for (unsigned int i=0; i<_maxItemsPerCell; i++) {
-			if ((_cells[currentBin]._items[i] != NULL) && (_cells[currentBin]._items[i] != exclude1) 
+		// unless some agent blocks line of sight, only cells that hold a blocking obstacle can stop the ray.
+		unsigned int numItemsToTest = (_agentsBlockLineOfSight || _isCellBitSet(_lineOfSightCellBits, currentBin)) ? _cells[currentBin]._numItems : 0;
+		for (unsigned int i=0; i<numItemsToTest; i++) {
+			if ((_cells[currentBin]._items[i] != exclude1) 
 				&& (_cells[currentBin]._items[i] != exclude2) && (_cells[currentBin]._items[i]->blocksLineOfSight())) {
 
 				float temp_t;
@@ -10,6 +10,8 @@
  */
 
 #include "griddatabase/GridDatabasePlanningDomain.h"
+#include "util/Misc.h"
+#include "util/GenericException.h"
 #include <limits.h>
 
 using namespace SteerLib;
@@ -23,29 +25,167 @@ bool GridDatabasePlanningDomain::refresh()
 		// std::cout << "Refreshing GridDataBasePlanningDomain" << std::endl;
 		this->_spatialDatabase->addObject(*iter, (*iter)->getBounds());
 	}
+	_traversalCostChecked = false;
+	_staticObstacleVersion++;
 
 	return true;
 }
 
-bool GridDatabasePlanningDomain::planPath(unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan) {
-	BestFirstSearchPlanner<GridDatabasePlanningDomain, unsigned int> gridAStarPlanner;
+void GridDatabasePlanningDomain::addObstacle(SteerLib::ObstacleInterface * obstacle)
+{
+	this->_spatialDatabase->addObject(obstacle, obstacle->getBounds());
+	_traversalCostChecked = false;
+	_staticObstacleVersion++;
+}
 
+void GridDatabasePlanningDomain::removeObstacle(SteerLib::ObstacleInterface * obstacle)
+{
+	this->_spatialDatabase->removeObject(obstacle, obstacle->getBounds());
+	_traversalCostChecked = false;
+	_staticObstacleVersion++;
+}
 
-	gridAStarPlanner.init(this, INT_MAX);
+GridDatabasePlanningDomain::~GridDatabasePlanningDomain()
+{
+	for (unsigned int i=0; i < _idlePlanners.size(); i++) {
+		delete _idlePlanners[i];
+	}
+}
 
-	return gridAStarPlanner.computePlan(startLocation, goalLocation, outputPlan);
+void GridDatabasePlanningDomain::setSearchAlgorithm(const std::string & searchAlgorithmName)
+{
+	std::string name = Util::toLower(searchAlgorithmName);
+	if ((name == "astar") || (name == "a*")) {
+		_searchAlgorithm = SEARCH_ALGORITHM_ASTAR;
+	}
+	else if ((name == "jps") || (name == "jumppoint")) {
+		_searchAlgorithm = SEARCH_ALGORITHM_JUMP_POINT;
+	}
+	else {
+		throw Util::GenericException("Unknown search algorithm \"" + searchAlgorithmName + "\" for the grid planning domain; use \"astar\" or \"jps\".");
+	}
+}
+
+GridDatabasePlanningDomain::GridPlanners * GridDatabasePlanningDomain::_acquirePlanners()
+{
+	GridPlanners * planners = NULL;
+	_plannerPoolMutex.lock();
+	if (!_idlePlanners.empty()) {
+		planners = _idlePlanners.back();
+		_idlePlanners.pop_back();
+	}
+	_plannerPoolMutex.unlock();
+
+	if (planners == NULL) {
+		planners = new GridPlanners();
+	}
+	return planners;
+}
+
+void GridDatabasePlanningDomain::_releasePlanners(GridPlanners * planners)
+{
+	_plannerPoolMutex.lock();
+	_idlePlanners.push_back(planners);
+	_plannerPoolMutex.unlock();
+}
+
+bool GridDatabasePlanningDomain::_usesUniformTraversalCost()
+{
+	_plannerPoolMutex.lock();
+	if (!_traversalCostChecked) {
+		_hasUniformTraversalCost = true;
+		bool foundTraversableCell = false;
+		float traversalCost = 0.0f;
+		unsigned int numCells = getNumStates();
+		for (unsigned int i=0; i < numCells; i++) {
+			if (!canBeTraversed(i)) {
+				continue;
+			}
+			if (!foundTraversableCell) {
+				traversalCost = _spatialDatabase->getTraversalCost(i);
+				foundTraversableCell = true;
+			}
+			else if (_spatialDatabase->getTraversalCost(i) != traversalCost) {
+				_hasUniformTraversalCost = false;
+				break;
+			}
+		}
+		_jumpPointDomain.updateTraversableCells();
+		_traversalCostChecked = true;
+	}
+	bool result = _hasUniformTraversalCost;
+	_plannerPoolMutex.unlock();
+	return result;
+}
+
+bool GridDatabasePlanningDomain::_planJumpPointPath(GridPlanners * planners, unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes)
+{
+	std::stack<unsigned int> jumpPointPlan;
+	planners->jumpPointPlanner.init(&_jumpPointDomain, maxNodes);
+	bool pathComplete = planners->jumpPointPlanner.computePlan(startLocation, goalLocation, jumpPointPlan);
+
+	// the plan starts at the top of the stack; walk it from the start and fill in the cells between jump points.
+	planners->jumpPoints.clear();
+	while (!jumpPointPlan.empty()) {
+		planners->jumpPoints.push_back(jumpPointPlan.top());
+		jumpPointPlan.pop();
+	}
+	planners->cells.clear();
+	planners->cells.push_back(planners->jumpPoints[0]);
+	for (unsigned int i=1; i < planners->jumpPoints.size(); i++) {
+		_jumpPointDomain.appendCellsBetween(planners->jumpPoints[i-1], planners->jumpPoints[i], planners->cells);
+	}
+
+	for (unsigned int i=(unsigned int)planners->cells.size(); i > 0; i--) {
+		outputPlan.push(planners->cells[i-1]);
+	}
+	return pathComplete;
+}
+
+bool GridDatabasePlanningDomain::planPath(unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan) {
+	return planPath(startLocation, goalLocation, outputPlan, INT_MAX);
 }
 
 /*
  * This planning does not always work out perfectly
  */
 bool GridDatabasePlanningDomain::planPath(unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes) {
-	BestFirstSearchPlanner<GridDatabasePlanningDomain, unsigned int> gridAStarPlanner;
+	GridPlanners * planners = _acquirePlanners();
+	bool pathComplete;
 
+	if ((_pathCache.getMaxNumPaths() == 0) || (startLocation == goalLocation)) {
+		pathComplete = _planUncachedPath(planners, startLocation, goalLocation, outputPlan, maxNodes);
+	}
+	else if (_pathCache.findPath(startLocation, goalLocation, _staticObstacleVersion, planners->cells)) {
+		for (unsigned int i=(unsigned int)planners->cells.size(); i > 0; i--) {
+			outputPlan.push(planners->cells[i-1]);
+		}
+		pathComplete = true;
+	}
+	else {
+		pathComplete = _planUncachedPath(planners, startLocation, goalLocation, outputPlan, maxNodes);
+		if (pathComplete) {
+			// partial paths are not optimal, so only complete ones are cached; read the plan from a copy, starting at the top.
+			std::stack<unsigned int> plan(outputPlan);
+			planners->cells.clear();
+			while (!plan.empty()) {
+				planners->cells.push_back(plan.top());
+				plan.pop();
+			}
+			_pathCache.addPath(planners->cells, _staticObstacleVersion);
+		}
+	}
 
-	gridAStarPlanner.init(this, maxNodes);
+	_releasePlanners(planners);
+	return pathComplete;
+}
 
-	return gridAStarPlanner.computePlan(startLocation, goalLocation, outputPlan);
+bool GridDatabasePlanningDomain::_planUncachedPath(GridPlanners * planners, unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes) {
+	if ((_searchAlgorithm == SEARCH_ALGORITHM_JUMP_POINT) && _usesUniformTraversalCost()) {
+		return _planJumpPointPath(planners, startLocation, goalLocation, outputPlan, maxNodes);
+	}
+	planners->aStarPlanner.init(this, maxNodes);
+	return planners->aStarPlanner.computePlan(startLocation, goalLocation, outputPlan);
 }
 
 bool GridDatabasePlanningDomain::findPath (Util::Point &startPosition, Util::Point &endPosition, std::vector<Util::Point> & path,
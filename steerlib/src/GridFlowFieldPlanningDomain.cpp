@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+/// @file GridFlowFieldPlanningDomain.cpp
+/// @brief Implements the SteerLib::GridFlowFieldPlanningDomain class.
+
+#include <algorithm>
+#include <functional>
+#include <float.h>
+#include <math.h>
+
+#include "griddatabase/GridFlowFieldPlanningDomain.h"
+
+using namespace SteerLib;
+
+
+GridFlowFieldPlanningDomain::GridFlowFieldPlanningDomain(SteerLib::GridDatabase2D * spatialDatabase, SteerLib::EngineInterface * engineInfo, unsigned int maxFlowFields)
+	: GridDatabasePlanningDomain(spatialDatabase, engineInfo), _maxFlowFields(maxFlowFields)
+{
+}
+
+GridFlowFieldPlanningDomain::~GridFlowFieldPlanningDomain()
+{
+	clearFlowFields();
+}
+
+bool GridFlowFieldPlanningDomain::refresh()
+{
+	clearFlowFields();
+	return GridDatabasePlanningDomain::refresh();
+}
+
+void GridFlowFieldPlanningDomain::addObstacle(SteerLib::ObstacleInterface * obstacle)
+{
+	clearFlowFields();
+	GridDatabasePlanningDomain::addObstacle(obstacle);
+}
+
+void GridFlowFieldPlanningDomain::removeObstacle(SteerLib::ObstacleInterface * obstacle)
+{
+	clearFlowFields();
+	GridDatabasePlanningDomain::removeObstacle(obstacle);
+}
+
+void GridFlowFieldPlanningDomain::clearFlowFields()
+{
+	_flowFieldMutex.lock();
+	for (std::map<unsigned int, FlowField*>::iterator iter = _flowFields.begin(); iter != _flowFields.end(); ++iter) {
+		delete iter->second;
+	}
+	_flowFields.clear();
+	_flowFieldMutex.unlock();
+}
+
+unsigned int GridFlowFieldPlanningDomain::getNumFlowFields()
+{
+	_flowFieldMutex.lock();
+	unsigned int numFlowFields = (unsigned int)_flowFields.size();
+	_flowFieldMutex.unlock();
+	return numFlowFields;
+}
+
+const GridFlowFieldPlanningDomain::FlowField * GridFlowFieldPlanningDomain::_getFlowField(unsigned int goalCell)
+{
+	FlowField * field = NULL;
+	_flowFieldMutex.lock();
+	std::map<unsigned int, FlowField*>::iterator iter = _flowFields.find(goalCell);
+	if (iter != _flowFields.end()) {
+		field = iter->second;
+	}
+	else if (_flowFields.size() < _maxFlowFields) {
+		field = new FlowField();
+		_computeFlowField(goalCell, *field);
+		_flowFields[goalCell] = field;
+	}
+	_flowFieldMutex.unlock();
+	return field;
+}
+
+void GridFlowFieldPlanningDomain::_computeFlowField(unsigned int goalCell, FlowField & field)
+{
+	unsigned int numCellsX = _spatialDatabase->getNumCellsX();
+	unsigned int numCellsZ = _spatialDatabase->getNumCellsZ();
+	field.distance.assign(numCellsX * numCellsZ, FLT_MAX);
+	field.nextCell.assign(numCellsX * numCellsZ, goalCell);
+
+	field.distance[goalCell] = 0.0f;
+	_heap.clear();
+	_heap.push_back(std::make_pair(0.0f, goalCell));
+
+	const float diagonalFactor = sqrtf(2);
+	while (!_heap.empty()) {
+		std::pop_heap(_heap.begin(), _heap.end(), std::greater< std::pair<float, unsigned int> >());
+		float d = _heap.back().first;
+		unsigned int u = _heap.back().second;
+		_heap.pop_back();
+		if (d > field.distance[u]) {
+			// a stale entry; u was already reached more cheaply.
+			continue;
+		}
+
+		unsigned int ux, uz;
+		_spatialDatabase->getGridCoordinatesFromIndex(u, ux, uz);
+		// every move from a neighbor into u costs the same, at least the length of the move.
+		float uCost = std::max(_spatialDatabase->getTraversalCost(u), 1.0f);
+
+		for (int dx = -1; dx <= 1; dx++) {
+			int vx = (int)ux + dx;
+			if ((vx < 0) || (vx >= (int)numCellsX)) continue;
+			for (int dz = -1; dz <= 1; dz++) {
+				int vz = (int)uz + dz;
+				if (((dx == 0) && (dz == 0)) || (vz < 0) || (vz >= (int)numCellsZ)) continue;
+
+				unsigned int v = _spatialDatabase->getCellIndexFromGridCoords(vx, vz);
+				if (!canBeTraversed(v)) continue;
+				bool diagonal = (dx != 0) && (dz != 0);
+				// the same rule as GridDatabasePlanningDomain::generateTransitions():  diagonal moves may not cut corners.
+				if (diagonal && (!canBeTraversed(_spatialDatabase->getCellIndexFromGridCoords(vx, uz)) || !canBeTraversed(_spatialDatabase->getCellIndexFromGridCoords(ux, vz)))) {
+					continue;
+				}
+
+				float newDistance = d + (diagonal ? uCost * diagonalFactor : uCost);
+				if (newDistance < field.distance[v]) {
+					field.distance[v] = newDistance;
+					field.nextCell[v] = u;
+					_heap.push_back(std::make_pair(newDistance, v));
+					std::push_heap(_heap.begin(), _heap.end(), std::greater< std::pair<float, unsigned int> >());
+				}
+			}
+		}
+	}
+}
+
+bool GridFlowFieldPlanningDomain::getNextCell(unsigned int cell, unsigned int goalCell, unsigned int & nextCell)
+{
+	unsigned int numCells = getNumStates();
+	if ((cell >= numCells) || (goalCell >= numCells) || !canBeTraversed(goalCell)) {
+		return false;
+	}
+	const FlowField * field = _getFlowField(goalCell);
+	if ((field == NULL) || (field->distance[cell] == FLT_MAX)) {
+		return false;
+	}
+	nextCell = field->nextCell[cell];
+	return true;
+}
+
+bool GridFlowFieldPlanningDomain::planPath(unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes)
+{
+	unsigned int numCells = getNumStates();
+	if ((startLocation < numCells) && (goalLocation < numCells) && canBeTraversed(startLocation) && canBeTraversed(goalLocation)) {
+		const FlowField * field = _getFlowField(goalLocation);
+		if ((field != NULL) && (field->distance[startLocation] != FLT_MAX)) {
+			// the plan is a stack, so collect the cells from the start first.
+			std::vector<unsigned int> cells;
+			cells.push_back(startLocation);
+			unsigned int cell = startLocation;
+			while (cell != goalLocation) {
+				cell = field->nextCell[cell];
+				cells.push_back(cell);
+			}
+			if (cells.size() == 1) {
+				// the start is the goal; GridDatabasePlanningDomain plans contain it twice in that case.
+				cells.push_back(startLocation);
+			}
+			for (unsigned int i=(unsigned int)cells.size(); i > 0; i--) {
+				outputPlan.push(cells[i-1]);
+			}
+			return true;
+		}
+	}
+
+	// no field, or the goal cannot be reached; let the cell-level search find the best partial path.
+	return GridDatabasePlanningDomain::planPath(startLocation, goalLocation, outputPlan, maxNodes);
+}
@@ -0,0 +1,496 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+/// @file GridHierarchicalPlanningDomain.cpp
+/// @brief Implements the SteerLib::GridHierarchicalPlanningDomain class.
+
+#include <algorithm>
+#include <functional>
+#include <float.h>
+#include <math.h>
+
+#include "griddatabase/GridHierarchicalPlanningDomain.h"
+#include "interfaces/ObstacleInterface.h"
+#include "util/GenericException.h"
+
+using namespace SteerLib;
+
+/// Entrances narrower than this get a single transition in the middle; wider ones get one at each end.
+#define MIN_ENTRANCE_WIDTH_FOR_TWO_TRANSITIONS 6
+
+
+GridHierarchicalPlanningDomain::GridHierarchicalPlanningDomain(SteerLib::GridDatabase2D * spatialDatabase, SteerLib::EngineInterface * engineInfo, unsigned int clusterSize)
+	: GridDatabasePlanningDomain(spatialDatabase, engineInfo), _clusterSize(clusterSize), _numClustersX(0), _numClustersZ(0), _abstractGraphBuilt(false)
+{
+	if (_clusterSize < 2) {
+		throw Util::GenericException("GridHierarchicalPlanningDomain: the cluster size must be at least 2 cells.");
+	}
+}
+
+GridHierarchicalPlanningDomain::~GridHierarchicalPlanningDomain()
+{
+	for (unsigned int i=0; i < _idleHierarchicalPlanners.size(); i++) {
+		delete _idleHierarchicalPlanners[i];
+	}
+}
+
+bool GridHierarchicalPlanningDomain::refresh()
+{
+	bool result = GridDatabasePlanningDomain::refresh();
+	buildAbstractGraph();
+	return result;
+}
+
+void GridHierarchicalPlanningDomain::addObstacle(SteerLib::ObstacleInterface * obstacle)
+{
+	GridDatabasePlanningDomain::addObstacle(obstacle);
+	_repairObstacleBounds(obstacle);
+}
+
+void GridHierarchicalPlanningDomain::removeObstacle(SteerLib::ObstacleInterface * obstacle)
+{
+	GridDatabasePlanningDomain::removeObstacle(obstacle);
+	_repairObstacleBounds(obstacle);
+}
+
+void GridHierarchicalPlanningDomain::_repairObstacleBounds(SteerLib::ObstacleInterface * obstacle)
+{
+	if (!_abstractGraphBuilt) {
+		// the whole graph is built by the next refresh() anyway.
+		return;
+	}
+
+	const Util::AxisAlignedBox & bounds = obstacle->getBounds();
+	int numCellsX = (int)_spatialDatabase->getNumCellsX();
+	int numCellsZ = (int)_spatialDatabase->getNumCellsZ();
+
+	// one extra cell on each side, in case the grid rounds the bounds differently.
+	int xMin = (int)floorf((bounds.xmin - _spatialDatabase->getOriginX()) / _spatialDatabase->getCellSizeX()) - 1;
+	int xMax = (int)floorf((bounds.xmax - _spatialDatabase->getOriginX()) / _spatialDatabase->getCellSizeX()) + 1;
+	int zMin = (int)floorf((bounds.zmin - _spatialDatabase->getOriginZ()) / _spatialDatabase->getCellSizeZ()) - 1;
+	int zMax = (int)floorf((bounds.zmax - _spatialDatabase->getOriginZ()) / _spatialDatabase->getCellSizeZ()) + 1;
+	if ((xMax < 0) || (zMax < 0) || (xMin >= numCellsX) || (zMin >= numCellsZ)) {
+		return;
+	}
+
+	repairClusters((unsigned int)std::max(xMin, 0), (unsigned int)std::min(xMax, numCellsX-1), (unsigned int)std::max(zMin, 0), (unsigned int)std::min(zMax, numCellsZ-1));
+}
+
+void GridHierarchicalPlanningDomain::buildAbstractGraph()
+{
+	unsigned int numCellsX = _spatialDatabase->getNumCellsX();
+	unsigned int numCellsZ = _spatialDatabase->getNumCellsZ();
+	_numClustersX = (numCellsX + _clusterSize - 1) / _clusterSize;
+	_numClustersZ = (numCellsZ + _clusterSize - 1) / _clusterSize;
+
+	_abstractNodes.clear();
+	_freeAbstractNodes.clear();
+	_clusterNodes.assign(getNumClusters(), std::vector<unsigned int>());
+	_borderNodes.assign(getNumClusters() * 2, std::vector<unsigned int>());
+	_abstractGraphBuilt = true;
+
+	if ((numCellsX == 0) || (numCellsZ == 0)) {
+		return;
+	}
+
+	// building from scratch is just repairing every cluster.
+	repairClusters(0, numCellsX-1, 0, numCellsZ-1);
+}
+
+void GridHierarchicalPlanningDomain::repairClusters(unsigned int xMinCell, unsigned int xMaxCell, unsigned int zMinCell, unsigned int zMaxCell)
+{
+	if (!_abstractGraphBuilt || (getNumClusters() == 0)) {
+		return;
+	}
+
+	int clusterXMin = (int)(xMinCell / _clusterSize);
+	int clusterXMax = std::min((int)(xMaxCell / _clusterSize), (int)_numClustersX - 1);
+	int clusterZMin = (int)(zMinCell / _clusterSize);
+	int clusterZMax = std::min((int)(zMaxCell / _clusterSize), (int)_numClustersZ - 1);
+
+	// the borders of the changed clusters, including the ones they share with their neighbors.
+	for (int cx = std::max(clusterXMin - 1, 0); cx <= clusterXMax; cx++) {
+		for (int cz = clusterZMin; cz <= clusterZMax; cz++) {
+			unsigned int border = (cx * _numClustersZ + cz) * 2;
+			_clearBorder(border);
+			_buildBorder(border);
+		}
+	}
+	for (int cx = clusterXMin; cx <= clusterXMax; cx++) {
+		for (int cz = std::max(clusterZMin - 1, 0); cz <= clusterZMax; cz++) {
+			unsigned int border = (cx * _numClustersZ + cz) * 2 + 1;
+			_clearBorder(border);
+			_buildBorder(border);
+		}
+	}
+
+	// the neighbors have new nodes on the shared borders, so their edges must be recomputed too.
+	HierarchicalPlanners * planners = _acquireHierarchicalPlanners();
+	for (int cx = std::max(clusterXMin - 1, 0); cx <= std::min(clusterXMax + 1, (int)_numClustersX - 1); cx++) {
+		for (int cz = std::max(clusterZMin - 1, 0); cz <= std::min(clusterZMax + 1, (int)_numClustersZ - 1); cz++) {
+			_buildIntraClusterEdges(cx * _numClustersZ + cz, planners->refineSearch);
+		}
+	}
+	_releaseHierarchicalPlanners(planners);
+}
+
+unsigned int GridHierarchicalPlanningDomain::_createAbstractNode(unsigned int cell, unsigned int cluster, unsigned int border)
+{
+	unsigned int id;
+	if (!_freeAbstractNodes.empty()) {
+		id = _freeAbstractNodes.back();
+		_freeAbstractNodes.pop_back();
+	}
+	else {
+		id = (unsigned int)_abstractNodes.size();
+		_abstractNodes.push_back(AbstractNode());
+	}
+
+	AbstractNode & node = _abstractNodes[id];
+	node.cell = cell;
+	node.cluster = cluster;
+	node.alive = true;
+	node.edges.clear();
+	_clusterNodes[cluster].push_back(id);
+	_borderNodes[border].push_back(id);
+	return id;
+}
+
+void GridHierarchicalPlanningDomain::_createEntrance(unsigned int cell1, unsigned int cluster1, unsigned int cell2, unsigned int cluster2, unsigned int border)
+{
+	unsigned int id1 = _createAbstractNode(cell1, cluster1, border);
+	unsigned int id2 = _createAbstractNode(cell2, cluster2, border);
+
+	AbstractEdge edge;
+	edge.target = id2;
+	edge.cost = _spatialDatabase->getTraversalCost(cell2);
+	_abstractNodes[id1].edges.push_back(edge);
+	edge.target = id1;
+	edge.cost = _spatialDatabase->getTraversalCost(cell1);
+	_abstractNodes[id2].edges.push_back(edge);
+}
+
+void GridHierarchicalPlanningDomain::_clearBorder(unsigned int border)
+{
+	std::vector<unsigned int> & borderNodes = _borderNodes[border];
+	for (unsigned int i=0; i < borderNodes.size(); i++) {
+		AbstractNode & node = _abstractNodes[borderNodes[i]];
+		std::vector<unsigned int> & clusterNodes = _clusterNodes[node.cluster];
+		clusterNodes.erase(std::find(clusterNodes.begin(), clusterNodes.end(), borderNodes[i]));
+		node.alive = false;
+		node.edges.clear();
+		_freeAbstractNodes.push_back(borderNodes[i]);
+	}
+	borderNodes.clear();
+}
+
+void GridHierarchicalPlanningDomain::_buildBorder(unsigned int border)
+{
+	unsigned int cluster = border / 2;
+	bool towardsX = ((border % 2) == 0);
+	unsigned int cx = cluster / _numClustersZ;
+	unsigned int cz = cluster % _numClustersZ;
+
+	// the border lies between the cells (x1, z1) + i * step and (x2, z2) + i * step, for i in [0, length).
+	unsigned int x1, z1, x2, z2, length, neighborCluster;
+	if (towardsX) {
+		if (cx + 1 >= _numClustersX) return;
+		x1 = (cx + 1) * _clusterSize - 1;
+		x2 = x1 + 1;
+		z1 = z2 = cz * _clusterSize;
+		length = std::min(_clusterSize, _spatialDatabase->getNumCellsZ() - z1);
+		neighborCluster = cluster + _numClustersZ;
+	}
+	else {
+		if (cz + 1 >= _numClustersZ) return;
+		z1 = (cz + 1) * _clusterSize - 1;
+		z2 = z1 + 1;
+		x1 = x2 = cx * _clusterSize;
+		length = std::min(_clusterSize, _spatialDatabase->getNumCellsX() - x1);
+		neighborCluster = cluster + 1;
+	}
+	unsigned int stepX = towardsX ? 0 : 1;
+	unsigned int stepZ = towardsX ? 1 : 0;
+
+	// find each maximal run of cells that are open on both sides of the border.
+	int runStart = -1;
+	for (unsigned int i=0; i <= length; i++) {
+		bool open = false;
+		if (i < length) {
+			open = canBeTraversed(_spatialDatabase->getCellIndexFromGridCoords(x1 + i*stepX, z1 + i*stepZ))
+				&& canBeTraversed(_spatialDatabase->getCellIndexFromGridCoords(x2 + i*stepX, z2 + i*stepZ));
+		}
+		if (open && (runStart < 0)) {
+			runStart = (int)i;
+		}
+		else if (!open && (runStart >= 0)) {
+			unsigned int first = (unsigned int)runStart;
+			unsigned int last = i - 1;
+			if (last - first + 1 < MIN_ENTRANCE_WIDTH_FOR_TWO_TRANSITIONS) {
+				unsigned int middle = (first + last) / 2;
+				_createEntrance(_spatialDatabase->getCellIndexFromGridCoords(x1 + middle*stepX, z1 + middle*stepZ), cluster,
+					_spatialDatabase->getCellIndexFromGridCoords(x2 + middle*stepX, z2 + middle*stepZ), neighborCluster, border);
+			}
+			else {
+				_createEntrance(_spatialDatabase->getCellIndexFromGridCoords(x1 + first*stepX, z1 + first*stepZ), cluster,
+					_spatialDatabase->getCellIndexFromGridCoords(x2 + first*stepX, z2 + first*stepZ), neighborCluster, border);
+				_createEntrance(_spatialDatabase->getCellIndexFromGridCoords(x1 + last*stepX, z1 + last*stepZ), cluster,
+					_spatialDatabase->getCellIndexFromGridCoords(x2 + last*stepX, z2 + last*stepZ), neighborCluster, border);
+			}
+			runStart = -1;
+		}
+	}
+}
+
+void GridHierarchicalPlanningDomain::_buildIntraClusterEdges(unsigned int cluster, ClusterSearch & search)
+{
+	const std::vector<unsigned int> & nodes = _clusterNodes[cluster];
+
+	// keep only the edge across each node's entrance.
+	for (unsigned int i=0; i < nodes.size(); i++) {
+		_abstractNodes[nodes[i]].edges.resize(1);
+	}
+
+	for (unsigned int i=0; i < nodes.size(); i++) {
+		_searchCluster(cluster, _abstractNodes[nodes[i]].cell, false, search);
+		for (unsigned int j=0; j < nodes.size(); j++) {
+			if (i == j) continue;
+			float distance = search.distance[_getLocalIndex(search, _abstractNodes[nodes[j]].cell)];
+			if (distance < FLT_MAX) {
+				AbstractEdge edge;
+				edge.target = nodes[j];
+				edge.cost = distance;
+				_abstractNodes[nodes[i]].edges.push_back(edge);
+			}
+		}
+	}
+}
+
+void GridHierarchicalPlanningDomain::_searchCluster(unsigned int cluster, unsigned int sourceCell, bool reverse, ClusterSearch & search)
+{
+	unsigned int cx = cluster / _numClustersZ;
+	unsigned int cz = cluster % _numClustersZ;
+	search.xMin = cx * _clusterSize;
+	search.zMin = cz * _clusterSize;
+	search.numCellsX = std::min(_clusterSize, _spatialDatabase->getNumCellsX() - search.xMin);
+	search.numCellsZ = std::min(_clusterSize, _spatialDatabase->getNumCellsZ() - search.zMin);
+
+	unsigned int numLocalCells = search.numCellsX * search.numCellsZ;
+	search.distance.assign(numLocalCells, FLT_MAX);
+	search.parent.assign(numLocalCells, -1);
+	search.heap.clear();
+
+	int source = _getLocalIndex(search, sourceCell);
+	search.distance[source] = 0.0f;
+	search.heap.push_back(std::make_pair(0.0f, source));
+
+	const float diagonalFactor = sqrtf(2);
+	const int xEnd = (int)(search.xMin + search.numCellsX);
+	const int zEnd = (int)(search.zMin + search.numCellsZ);
+
+	while (!search.heap.empty()) {
+		std::pop_heap(search.heap.begin(), search.heap.end(), std::greater< std::pair<float, int> >());
+		float d = search.heap.back().first;
+		int u = search.heap.back().second;
+		search.heap.pop_back();
+		if (d > search.distance[u]) {
+			// a stale entry; u was already reached more cheaply.
+			continue;
+		}
+
+		int ux = (int)search.xMin + u / (int)search.numCellsZ;
+		int uz = (int)search.zMin + u % (int)search.numCellsZ;
+		unsigned int uCell = _spatialDatabase->getCellIndexFromGridCoords(ux, uz);
+
+		// the same moves as GridDatabasePlanningDomain::generateTransitions(), but only within the cluster.
+		for (int dx = -1; dx <= 1; dx++) {
+			int vx = ux + dx;
+			if ((vx < (int)search.xMin) || (vx >= xEnd)) continue;
+			for (int dz = -1; dz <= 1; dz++) {
+				int vz = uz + dz;
+				if (((dx == 0) && (dz == 0)) || (vz < (int)search.zMin) || (vz >= zEnd)) continue;
+
+				unsigned int vCell = _spatialDatabase->getCellIndexFromGridCoords(vx, vz);
+				if (!canBeTraversed(vCell)) continue;
+				bool diagonal = (dx != 0) && (dz != 0);
+				if (diagonal && (!canBeTraversed(_spatialDatabase->getCellIndexFromGridCoords(vx, uz)) || !canBeTraversed(_spatialDatabase->getCellIndexFromGridCoords(ux, vz)))) {
+					continue;
+				}
+
+				// a move costs as much as the cell it enters; searching backwards, that is u.
+				float cost = _spatialDatabase->getTraversalCost(reverse ? uCell : vCell);
+				if (diagonal) cost *= diagonalFactor;
+
+				int v = search.getLocalIndex(vx, vz);
+				float newDistance = d + cost;
+				if (newDistance < search.distance[v]) {
+					search.distance[v] = newDistance;
+					search.parent[v] = u;
+					search.heap.push_back(std::make_pair(newDistance, v));
+					std::push_heap(search.heap.begin(), search.heap.end(), std::greater< std::pair<float, int> >());
+				}
+			}
+		}
+	}
+}
+
+void GridHierarchicalPlanningDomain::_appendClusterPath(const ClusterSearch & search, unsigned int fromCell, unsigned int toCell, bool reverse, std::vector<unsigned int> & cells)
+{
+	if (reverse) {
+		// parents already point towards toCell.
+		for (int i = search.parent[_getLocalIndex(search, fromCell)]; i != -1; i = search.parent[i]) {
+			cells.push_back(_spatialDatabase->getCellIndexFromGridCoords(search.xMin + i / search.numCellsZ, search.zMin + i % search.numCellsZ));
+		}
+	}
+	else {
+		// parents point back towards fromCell, so collect the cells backwards and then flip them.
+		size_t firstAppended = cells.size();
+		int source = _getLocalIndex(search, fromCell);
+		for (int i = _getLocalIndex(search, toCell); i != source; i = search.parent[i]) {
+			cells.push_back(_spatialDatabase->getCellIndexFromGridCoords(search.xMin + i / search.numCellsZ, search.zMin + i % search.numCellsZ));
+		}
+		std::reverse(cells.begin() + firstAppended, cells.end());
+	}
+}
+
+GridHierarchicalPlanningDomain::HierarchicalPlanners * GridHierarchicalPlanningDomain::_acquireHierarchicalPlanners()
+{
+	HierarchicalPlanners * planners = NULL;
+	_hierarchicalPlannerPoolMutex.lock();
+	if (!_idleHierarchicalPlanners.empty()) {
+		planners = _idleHierarchicalPlanners.back();
+		_idleHierarchicalPlanners.pop_back();
+	}
+	_hierarchicalPlannerPoolMutex.unlock();
+
+	if (planners == NULL) {
+		planners = new HierarchicalPlanners();
+	}
+	return planners;
+}
+
+void GridHierarchicalPlanningDomain::_releaseHierarchicalPlanners(HierarchicalPlanners * planners)
+{
+	_hierarchicalPlannerPoolMutex.lock();
+	_idleHierarchicalPlanners.push_back(planners);
+	_hierarchicalPlannerPoolMutex.unlock();
+}
+
+bool GridHierarchicalPlanningDomain::planPath(unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes)
+{
+	unsigned int numCells = getNumStates();
+	if (_abstractGraphBuilt && (startLocation < numCells) && (goalLocation < numCells) && canBeTraversed(startLocation) && canBeTraversed(goalLocation)) {
+		HierarchicalPlanners * planners = _acquireHierarchicalPlanners();
+		bool pathComplete = _planHierarchicalPath(planners, startLocation, goalLocation, outputPlan, maxNodes);
+		_releaseHierarchicalPlanners(planners);
+		if (pathComplete) {
+			return true;
+		}
+	}
+
+	// no complete abstract path; let the cell-level search find the best partial path.
+	return GridDatabasePlanningDomain::planPath(startLocation, goalLocation, outputPlan, maxNodes);
+}
+
+bool GridHierarchicalPlanningDomain::_planHierarchicalPath(HierarchicalPlanners * planners, unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes)
+{
+	// connect the start and goal to the entrances of their clusters.
+	_searchCluster(_getCluster(startLocation), startLocation, false, planners->startSearch);
+	_searchCluster(_getCluster(goalLocation), goalLocation, true, planners->goalSearch);
+
+	AbstractSearchDomain domain(this, startLocation, goalLocation, &planners->startSearch, &planners->goalSearch);
+	std::stack<unsigned int> abstractPlan;
+	planners->abstractPlanner.init(&domain, maxNodes);
+	if (!planners->abstractPlanner.computePlan(domain.startState, domain.goalState, abstractPlan)) {
+		return false;
+	}
+
+	// refine each abstract edge into the cells along it.
+	std::vector<unsigned int> & cells = planners->cells;
+	cells.clear();
+	cells.push_back(startLocation);
+	unsigned int previous = abstractPlan.top();
+	abstractPlan.pop();
+	while (!abstractPlan.empty()) {
+		unsigned int next = abstractPlan.top();
+		abstractPlan.pop();
+
+		if (previous == domain.startState) {
+			_appendClusterPath(planners->startSearch, startLocation, domain.getCell(next), false, cells);
+		}
+		else if (next == domain.goalState) {
+			_appendClusterPath(planners->goalSearch, domain.getCell(previous), goalLocation, true, cells);
+		}
+		else if (_abstractNodes[previous].cluster != _abstractNodes[next].cluster) {
+			// across an entrance, to the adjacent cell.
+			cells.push_back(_abstractNodes[next].cell);
+		}
+		else {
+			_searchCluster(_abstractNodes[previous].cluster, _abstractNodes[previous].cell, false, planners->refineSearch);
+			_appendClusterPath(planners->refineSearch, _abstractNodes[previous].cell, _abstractNodes[next].cell, false, cells);
+		}
+		previous = next;
+	}
+
+	if (cells.size() == 1) {
+		// the start is the goal; GridDatabasePlanningDomain plans contain it twice in that case.
+		cells.push_back(startLocation);
+	}
+	for (unsigned int i=(unsigned int)cells.size(); i > 0; i--) {
+		outputPlan.push(cells[i-1]);
+	}
+	return true;
+}
+
+
+GridHierarchicalPlanningDomain::AbstractSearchDomain::AbstractSearchDomain(GridHierarchicalPlanningDomain * graph, unsigned int startLocation, unsigned int goalLocation, ClusterSearch * startSearch, ClusterSearch * goalSearch)
+	: startCell(startLocation), goalCell(goalLocation), _graph(graph), _startSearch(startSearch), _goalSearch(goalSearch)
+{
+	startState = (unsigned int)graph->_abstractNodes.size();
+	goalState = startState + 1;
+	_startCluster = graph->_getCluster(startLocation);
+	_goalCluster = graph->_getCluster(goalLocation);
+}
+
+void GridHierarchicalPlanningDomain::AbstractSearchDomain::generateTransitions( const unsigned int & currentState, const unsigned int & previousState, const unsigned int & idealGoalState, std::vector<SteerLib::DefaultAction<unsigned int> > & transitions )
+{
+	transitions.clear();
+	SteerLib::DefaultAction<unsigned int> action;
+
+	if (currentState == startState) {
+		// from the start to every entrance of its cluster that it can reach, or straight to the goal if it is in the same cluster.
+		const std::vector<unsigned int> & nodes = _graph->_clusterNodes[_startCluster];
+		for (unsigned int i=0; i < nodes.size(); i++) {
+			action.cost = _startSearch->distance[_graph->_getLocalIndex(*_startSearch, _graph->_abstractNodes[nodes[i]].cell)];
+			if (action.cost < FLT_MAX) {
+				action.state = nodes[i];
+				transitions.push_back(action);
+			}
+		}
+		if (_startCluster == _goalCluster) {
+			action.cost = _startSearch->distance[_graph->_getLocalIndex(*_startSearch, goalCell)];
+			if (action.cost < FLT_MAX) {
+				action.state = goalState;
+				transitions.push_back(action);
+			}
+		}
+		return;
+	}
+
+	const AbstractNode & node = _graph->_abstractNodes[currentState];
+	for (unsigned int i=0; i < node.edges.size(); i++) {
+		action.state = node.edges[i].target;
+		action.cost = node.edges[i].cost;
+		transitions.push_back(action);
+	}
+	if (node.cluster == _goalCluster) {
+		action.cost = _goalSearch->distance[_graph->_getLocalIndex(*_goalSearch, node.cell)];
+		if (action.cost < FLT_MAX) {
+			action.state = goalState;
+			transitions.push_back(action);
+		}
+	}
+}
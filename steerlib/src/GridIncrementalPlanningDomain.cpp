@@ -0,0 +1,405 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+/// @file GridIncrementalPlanningDomain.cpp
+/// @brief Implements the SteerLib::GridDStarLiteSearch and SteerLib::GridIncrementalPlanningDomain classes.
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+#include "griddatabase/GridIncrementalPlanningDomain.h"
+#include "interfaces/ObstacleInterface.h"
+
+using namespace SteerLib;
+
+
+//
+// GridDStarLiteSearch
+//
+
+const unsigned int GridDStarLiteSearch::NOT_OPEN;
+
+GridDStarLiteSearch::GridDStarLiteSearch(SteerLib::GridDatabase2D * spatialDatabase, unsigned int goalCell)
+	: _spatialDatabase(spatialDatabase), _goalCell(goalCell), _keyModifier(0.0f), _numExpandedCells(0)
+{
+	_numCellsX = _spatialDatabase->getNumCellsX();
+	_numCellsZ = _spatialDatabase->getNumCellsZ();
+	unsigned int numCells = _numCellsX * _numCellsZ;
+	_g.assign(numCells, FLT_MAX);
+	_rhs.assign(numCells, FLT_MAX);
+	_key1.assign(numCells, FLT_MAX);
+	_key2.assign(numCells, FLT_MAX);
+	_heapIndex.assign(numCells, NOT_OPEN);
+
+	// the goal costs nothing to reach from itself; the search grows from there once the first start is known.
+	_lastStartCell = goalCell;
+	_rhs[goalCell] = 0.0f;
+	_computeKey(goalCell, _key1[goalCell], _key2[goalCell]);
+	_pushOpen(goalCell);
+}
+
+float GridDStarLiteSearch::_getMoveCost(int ux, int uz, int vx, int vz) const
+{
+	if ((vx < 0) || (vz < 0) || (vx >= (int)_numCellsX) || (vz >= (int)_numCellsZ)) {
+		return FLT_MAX;
+	}
+	unsigned int v = vx * _numCellsZ + vz;
+	float cost = _spatialDatabase->getTraversalCost(v);
+	if ((cost >= 1000.0f) || (_spatialDatabase->getTraversalCost(ux * _numCellsZ + uz) >= 1000.0f)) {
+		return FLT_MAX;
+	}
+	cost = std::max(cost, 1.0f);
+	if ((vx != ux) && (vz != uz)) {
+		// the same rule as GridDatabasePlanningDomain::generateTransitions():  diagonal moves may not cut corners.
+		if ((_spatialDatabase->getTraversalCost(vx * _numCellsZ + uz) >= 1000.0f) || (_spatialDatabase->getTraversalCost(ux * _numCellsZ + vz) >= 1000.0f)) {
+			return FLT_MAX;
+		}
+		cost *= sqrtf(2);
+	}
+	return cost;
+}
+
+float GridDStarLiteSearch::_getHeuristic(unsigned int cell1, unsigned int cell2) const
+{
+	int dx = (int)(cell1 / _numCellsZ) - (int)(cell2 / _numCellsZ);
+	int dz = (int)(cell1 % _numCellsZ) - (int)(cell2 % _numCellsZ);
+	return sqrtf((float)(dx*dx + dz*dz));
+}
+
+void GridDStarLiteSearch::_computeKey(unsigned int cell, float & k1, float & k2) const
+{
+	k2 = std::min(_g[cell], _rhs[cell]);
+	k1 = (k2 == FLT_MAX) ? FLT_MAX : k2 + _getHeuristic(_lastStartCell, cell) + _keyModifier;
+}
+
+void GridDStarLiteSearch::_updateCell(unsigned int cell)
+{
+	if (cell != _goalCell) {
+		// the cost to the goal through the best neighbor.
+		int ux = (int)(cell / _numCellsZ);
+		int uz = (int)(cell % _numCellsZ);
+		float rhs = FLT_MAX;
+		for (int dx = -1; dx <= 1; dx++) {
+			for (int dz = -1; dz <= 1; dz++) {
+				if ((dx == 0) && (dz == 0)) continue;
+				float moveCost = _getMoveCost(ux, uz, ux+dx, uz+dz);
+				if (moveCost == FLT_MAX) continue;
+				float g = _g[(ux+dx) * _numCellsZ + (uz+dz)];
+				if (g != FLT_MAX) {
+					rhs = std::min(rhs, moveCost + g);
+				}
+			}
+		}
+		_rhs[cell] = rhs;
+	}
+
+	if (_heapIndex[cell] != NOT_OPEN) {
+		_removeOpen(cell);
+	}
+	if (_g[cell] != _rhs[cell]) {
+		_computeKey(cell, _key1[cell], _key2[cell]);
+		_pushOpen(cell);
+	}
+}
+
+bool GridDStarLiteSearch::_computeShortestPath(unsigned int startCell, unsigned int maxNodes)
+{
+	unsigned int numExpanded = 0;
+	float startKey1, startKey2;
+	_computeKey(startCell, startKey1, startKey2);
+
+	while (!_openHeap.empty()) {
+		unsigned int u = _openHeap[0];
+		bool topBeforeStart = (_key1[u] < startKey1) || ((_key1[u] == startKey1) && (_key2[u] < startKey2));
+		if (!topBeforeStart && (_rhs[startCell] == _g[startCell])) {
+			break;
+		}
+		if (numExpanded >= maxNodes) {
+			return false;
+		}
+		numExpanded++;
+		_numExpandedCells++;
+
+		float newKey1, newKey2;
+		_computeKey(u, newKey1, newKey2);
+		if ((_key1[u] < newKey1) || ((_key1[u] == newKey1) && (_key2[u] < newKey2))) {
+			// the key was computed for an earlier start; reinsert it with the current one.
+			_removeOpen(u);
+			_key1[u] = newKey1;
+			_key2[u] = newKey2;
+			_pushOpen(u);
+		}
+		else {
+			bool overconsistent = (_g[u] > _rhs[u]);
+			_removeOpen(u);
+			if (overconsistent) {
+				_g[u] = _rhs[u];
+			}
+			else {
+				_g[u] = FLT_MAX;
+				_updateCell(u);
+			}
+			// every neighbor may now reach the goal differently through u.
+			int ux = (int)(u / _numCellsZ);
+			int uz = (int)(u % _numCellsZ);
+			for (int dx = -1; dx <= 1; dx++) {
+				int vx = ux + dx;
+				if ((vx < 0) || (vx >= (int)_numCellsX)) continue;
+				for (int dz = -1; dz <= 1; dz++) {
+					int vz = uz + dz;
+					if (((dx == 0) && (dz == 0)) || (vz < 0) || (vz >= (int)_numCellsZ)) continue;
+					_updateCell(vx * _numCellsZ + vz);
+				}
+			}
+		}
+		_computeKey(startCell, startKey1, startKey2);
+	}
+	return (_g[startCell] != FLT_MAX);
+}
+
+bool GridDStarLiteSearch::findPath(unsigned int startCell, unsigned int maxNodes, std::vector<unsigned int> & cells)
+{
+	cells.clear();
+	if (startCell != _lastStartCell) {
+		// moving the start lowers every heuristic by at most this much, so the keys on the open list stay lower bounds.
+		_keyModifier += _getHeuristic(_lastStartCell, startCell);
+		_lastStartCell = startCell;
+	}
+	if (!_computeShortestPath(startCell, maxNodes)) {
+		return false;
+	}
+
+	// walk downhill:  every step goes to the neighbor with the cheapest remaining cost.
+	unsigned int cell = startCell;
+	cells.push_back(cell);
+	unsigned int maxPathLength = _numCellsX * _numCellsZ;
+	while ((cell != _goalCell) && (cells.size() <= maxPathLength)) {
+		int ux = (int)(cell / _numCellsZ);
+		int uz = (int)(cell % _numCellsZ);
+		float bestCost = FLT_MAX;
+		unsigned int bestCell = cell;
+		for (int dx = -1; dx <= 1; dx++) {
+			for (int dz = -1; dz <= 1; dz++) {
+				if ((dx == 0) && (dz == 0)) continue;
+				float moveCost = _getMoveCost(ux, uz, ux+dx, uz+dz);
+				if (moveCost == FLT_MAX) continue;
+				unsigned int v = (ux+dx) * _numCellsZ + (uz+dz);
+				if ((_g[v] != FLT_MAX) && (moveCost + _g[v] < bestCost)) {
+					bestCost = moveCost + _g[v];
+					bestCell = v;
+				}
+			}
+		}
+		if (bestCell == cell) {
+			return false;
+		}
+		cell = bestCell;
+		cells.push_back(cell);
+	}
+	return (cell == _goalCell);
+}
+
+void GridDStarLiteSearch::updateCells(unsigned int xMinCell, unsigned int xMaxCell, unsigned int zMinCell, unsigned int zMaxCell)
+{
+	// a changed cell affects the moves into it, out of it, and past its corner, so all of its neighbors must be updated too.
+	unsigned int xMin = (xMinCell > 0) ? xMinCell - 1 : 0;
+	unsigned int zMin = (zMinCell > 0) ? zMinCell - 1 : 0;
+	unsigned int xMax = std::min(xMaxCell + 1, _numCellsX - 1);
+	unsigned int zMax = std::min(zMaxCell + 1, _numCellsZ - 1);
+	for (unsigned int x = xMin; x <= xMax; x++) {
+		for (unsigned int z = zMin; z <= zMax; z++) {
+			_updateCell(x * _numCellsZ + z);
+		}
+	}
+}
+
+void GridDStarLiteSearch::_pushOpen(unsigned int cell)
+{
+	_heapIndex[cell] = (unsigned int)_openHeap.size();
+	_openHeap.push_back(cell);
+	_siftUp(_heapIndex[cell]);
+}
+
+void GridDStarLiteSearch::_removeOpen(unsigned int cell)
+{
+	unsigned int i = _heapIndex[cell];
+	unsigned int last = _openHeap.back();
+	_openHeap.pop_back();
+	_heapIndex[cell] = NOT_OPEN;
+	if (last != cell) {
+		_openHeap[i] = last;
+		_heapIndex[last] = i;
+		_siftUp(i);
+		_siftDown(_heapIndex[last]);
+	}
+}
+
+void GridDStarLiteSearch::_siftUp(unsigned int heapIndex)
+{
+	unsigned int cell = _openHeap[heapIndex];
+	while (heapIndex > 0) {
+		unsigned int parent = (heapIndex - 1) / 2;
+		if (!_isBefore(cell, _openHeap[parent])) {
+			break;
+		}
+		_openHeap[heapIndex] = _openHeap[parent];
+		_heapIndex[_openHeap[heapIndex]] = heapIndex;
+		heapIndex = parent;
+	}
+	_openHeap[heapIndex] = cell;
+	_heapIndex[cell] = heapIndex;
+}
+
+void GridDStarLiteSearch::_siftDown(unsigned int heapIndex)
+{
+	unsigned int cell = _openHeap[heapIndex];
+	unsigned int size = (unsigned int)_openHeap.size();
+	while (true) {
+		unsigned int child = 2 * heapIndex + 1;
+		if (child >= size) {
+			break;
+		}
+		if ((child + 1 < size) && _isBefore(_openHeap[child + 1], _openHeap[child])) {
+			child++;
+		}
+		if (!_isBefore(_openHeap[child], cell)) {
+			break;
+		}
+		_openHeap[heapIndex] = _openHeap[child];
+		_heapIndex[_openHeap[heapIndex]] = heapIndex;
+		heapIndex = child;
+	}
+	_openHeap[heapIndex] = cell;
+	_heapIndex[cell] = heapIndex;
+}
+
+
+//
+// GridIncrementalPlanningDomain
+//
+
+GridIncrementalPlanningDomain::GridIncrementalPlanningDomain(SteerLib::GridDatabase2D * spatialDatabase, SteerLib::EngineInterface * engineInfo, unsigned int maxSearches)
+	: GridDatabasePlanningDomain(spatialDatabase, engineInfo), _maxSearches(maxSearches)
+{
+}
+
+GridIncrementalPlanningDomain::~GridIncrementalPlanningDomain()
+{
+	clearSearches();
+}
+
+bool GridIncrementalPlanningDomain::refresh()
+{
+	clearSearches();
+	return GridDatabasePlanningDomain::refresh();
+}
+
+void GridIncrementalPlanningDomain::addObstacle(SteerLib::ObstacleInterface * obstacle)
+{
+	GridDatabasePlanningDomain::addObstacle(obstacle);
+	_updateObstacleCells(obstacle);
+}
+
+void GridIncrementalPlanningDomain::removeObstacle(SteerLib::ObstacleInterface * obstacle)
+{
+	GridDatabasePlanningDomain::removeObstacle(obstacle);
+	_updateObstacleCells(obstacle);
+}
+
+void GridIncrementalPlanningDomain::_updateObstacleCells(SteerLib::ObstacleInterface * obstacle)
+{
+	const Util::AxisAlignedBox & bounds = obstacle->getBounds();
+	int numCellsX = (int)_spatialDatabase->getNumCellsX();
+	int numCellsZ = (int)_spatialDatabase->getNumCellsZ();
+
+	// one extra cell on each side, in case the grid rounds the bounds differently.
+	int xMin = (int)floorf((bounds.xmin - _spatialDatabase->getOriginX()) / _spatialDatabase->getCellSizeX()) - 1;
+	int xMax = (int)floorf((bounds.xmax - _spatialDatabase->getOriginX()) / _spatialDatabase->getCellSizeX()) + 1;
+	int zMin = (int)floorf((bounds.zmin - _spatialDatabase->getOriginZ()) / _spatialDatabase->getCellSizeZ()) - 1;
+	int zMax = (int)floorf((bounds.zmax - _spatialDatabase->getOriginZ()) / _spatialDatabase->getCellSizeZ()) + 1;
+	if ((xMax < 0) || (zMax < 0) || (xMin >= numCellsX) || (zMin >= numCellsZ)) {
+		return;
+	}
+
+	_searchesMutex.lock();
+	for (std::map<unsigned int, LockedSearch*>::iterator iter = _searches.begin(); iter != _searches.end(); ++iter) {
+		iter->second->search.updateCells((unsigned int)std::max(xMin, 0), (unsigned int)std::min(xMax, numCellsX-1), (unsigned int)std::max(zMin, 0), (unsigned int)std::min(zMax, numCellsZ-1));
+	}
+	_searchesMutex.unlock();
+}
+
+void GridIncrementalPlanningDomain::clearSearches()
+{
+	_searchesMutex.lock();
+	for (std::map<unsigned int, LockedSearch*>::iterator iter = _searches.begin(); iter != _searches.end(); ++iter) {
+		delete iter->second;
+	}
+	_searches.clear();
+	_searchesMutex.unlock();
+}
+
+unsigned int GridIncrementalPlanningDomain::getNumSearches()
+{
+	_searchesMutex.lock();
+	unsigned int numSearches = (unsigned int)_searches.size();
+	_searchesMutex.unlock();
+	return numSearches;
+}
+
+unsigned long long GridIncrementalPlanningDomain::getNumExpandedCells()
+{
+	unsigned long long numExpandedCells = 0;
+	_searchesMutex.lock();
+	for (std::map<unsigned int, LockedSearch*>::iterator iter = _searches.begin(); iter != _searches.end(); ++iter) {
+		numExpandedCells += iter->second->search.getNumExpandedCells();
+	}
+	_searchesMutex.unlock();
+	return numExpandedCells;
+}
+
+GridIncrementalPlanningDomain::LockedSearch * GridIncrementalPlanningDomain::_getSearch(unsigned int goalCell)
+{
+	LockedSearch * search = NULL;
+	_searchesMutex.lock();
+	std::map<unsigned int, LockedSearch*>::iterator iter = _searches.find(goalCell);
+	if (iter != _searches.end()) {
+		search = iter->second;
+	}
+	else if (_searches.size() < _maxSearches) {
+		search = new LockedSearch(_spatialDatabase, goalCell);
+		_searches[goalCell] = search;
+	}
+	_searchesMutex.unlock();
+	return search;
+}
+
+bool GridIncrementalPlanningDomain::planPath(unsigned int startLocation, unsigned int goalLocation, std::stack<unsigned int> & outputPlan, unsigned int maxNodes)
+{
+	unsigned int numCells = getNumStates();
+	if ((startLocation < numCells) && (goalLocation < numCells) && canBeTraversed(startLocation) && canBeTraversed(goalLocation)) {
+		LockedSearch * search = _getSearch(goalLocation);
+		if (search != NULL) {
+			std::vector<unsigned int> cells;
+			search->mutex.lock();
+			bool pathComplete = search->search.findPath(startLocation, maxNodes, cells);
+			search->mutex.unlock();
+			if (pathComplete) {
+				if (cells.size() == 1) {
+					// the start is the goal; GridDatabasePlanningDomain plans contain it twice in that case.
+					cells.push_back(startLocation);
+				}
+				for (unsigned int i=(unsigned int)cells.size(); i > 0; i--) {
+					outputPlan.push(cells[i-1]);
+				}
+				return true;
+			}
+		}
+	}
+
+	// no search, or the goal cannot be reached; let the cell-level search find the best partial path.
+	return GridDatabasePlanningDomain::planPath(startLocation, goalLocation, outputPlan, maxNodes);
+}
@@ -0,0 +1,146 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+/// @file GridPathCache.cpp
+/// @brief Implements the SteerLib::GridPathCache class.
+
+#include "griddatabase/GridPathCache.h"
+
+using namespace SteerLib;
+
+
+GridPathCache::GridPathCache(unsigned int maxNumPaths) : _maxNumPaths(maxNumPaths), _obstacleVersion(0), _numHits(0), _numMisses(0)
+{
+}
+
+void GridPathCache::setMaxNumPaths(unsigned int maxNumPaths)
+{
+	_mutex.lock();
+	_maxNumPaths = maxNumPaths;
+	while (_paths.size() > _maxNumPaths) {
+		_removeOldestPath();
+	}
+	_mutex.unlock();
+}
+
+bool GridPathCache::findPath(unsigned int startCell, unsigned int goalCell, unsigned int obstacleVersion, std::vector<unsigned int> & cells)
+{
+	bool found = false;
+	_mutex.lock();
+	_checkVersion(obstacleVersion);
+	std::map<unsigned long long, SuffixLocation>::iterator suffix = _suffixes.find(_getKey(startCell, goalCell));
+	if (suffix != _suffixes.end()) {
+		const std::vector<unsigned int> & path = *(suffix->second.path);
+		cells.assign(path.begin() + suffix->second.position, path.end());
+		// mark the path as the most recently used; list iterators stay valid.
+		_paths.splice(_paths.begin(), _paths, suffix->second.path);
+		_numHits++;
+		found = true;
+	}
+	else {
+		_numMisses++;
+	}
+	_mutex.unlock();
+	return found;
+}
+
+void GridPathCache::addPath(const std::vector<unsigned int> & cells, unsigned int obstacleVersion)
+{
+	if (cells.empty()) {
+		return;
+	}
+
+	_mutex.lock();
+	_checkVersion(obstacleVersion);
+	if (_maxNumPaths == 0) {
+		_mutex.unlock();
+		return;
+	}
+	if (_paths.size() >= _maxNumPaths) {
+		_removeOldestPath();
+	}
+	_paths.push_front(cells);
+
+	unsigned int goalCell = cells.back();
+	SuffixLocation location;
+	location.path = _paths.begin();
+	for (unsigned int i=0; i < cells.size(); i++) {
+		location.position = i;
+		_suffixes[_getKey(cells[i], goalCell)] = location;
+	}
+	_mutex.unlock();
+}
+
+void GridPathCache::clear()
+{
+	_mutex.lock();
+	_clear();
+	_mutex.unlock();
+}
+
+void GridPathCache::_clear()
+{
+	_paths.clear();
+	_suffixes.clear();
+}
+
+void GridPathCache::_checkVersion(unsigned int obstacleVersion)
+{
+	if (obstacleVersion != _obstacleVersion) {
+		_clear();
+		_obstacleVersion = obstacleVersion;
+	}
+}
+
+void GridPathCache::_removeOldestPath()
+{
+	if (_paths.empty()) {
+		return;
+	}
+
+	// only forget the cells that still refer to this path; newer paths may have taken over the others.
+	PathList::iterator oldest = --_paths.end();
+	unsigned int goalCell = oldest->back();
+	for (unsigned int i=0; i < oldest->size(); i++) {
+		std::map<unsigned long long, SuffixLocation>::iterator suffix = _suffixes.find(_getKey((*oldest)[i], goalCell));
+		if ((suffix != _suffixes.end()) && (suffix->second.path == oldest)) {
+			_suffixes.erase(suffix);
+		}
+	}
+	_paths.erase(oldest);
+}
+
+unsigned long long GridPathCache::getNumHits()
+{
+	_mutex.lock();
+	unsigned long long numHits = _numHits;
+	_mutex.unlock();
+	return numHits;
+}
+
+unsigned long long GridPathCache::getNumMisses()
+{
+	_mutex.lock();
+	unsigned long long numMisses = _numMisses;
+	_mutex.unlock();
+	return numMisses;
+}
+
+unsigned int GridPathCache::getNumPaths()
+{
+	_mutex.lock();
+	unsigned int numPaths = (unsigned int)_paths.size();
+	_mutex.unlock();
+	return numPaths;
+}
+
+void GridPathCache::resetStatistics()
+{
+	_mutex.lock();
+	_numHits = 0;
+	_numMisses = 0;
+	_mutex.unlock();
+}
@@ -0,0 +1,219 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+/// @file ObstacleDistanceField.cpp
+/// @brief Implements the SteerLib::ObstacleDistanceField class.
+
+#include <algorithm>
+#include <cmath>
+
+#include "griddatabase/ObstacleDistanceField.h"
+#include "interfaces/ObstacleInterface.h"
+#include "obstacles/CircleObstacle.h"
+#include "util/GenericException.h"
+
+using namespace std;
+using namespace SteerLib;
+using namespace Util;
+
+
+ObstacleDistanceField::ObstacleDistanceField(float xmin, float xmax, float zmin, float zmax, float sampleSpacing, float maxDistance)
+{
+	if ((sampleSpacing <= 0.0f) || (maxDistance <= 0.0f)) {
+		throw GenericException("ObstacleDistanceField needs a positive sample spacing and maximum distance.");
+	}
+	if (xmin > xmax) swap(xmin, xmax);
+	if (zmin > zmax) swap(zmin, zmax);
+
+	_xOrigin = xmin;
+	_zOrigin = zmin;
+	_sampleSpacing = sampleSpacing;
+	_invSampleSpacing = 1.0f / sampleSpacing;
+	_maxDistance = maxDistance;
+	// one more sample than intervals, so that the last sample reaches (or passes) xmax and zmax.
+	_xNumSamples = (unsigned int)ceilf((xmax - xmin) * _invSampleSpacing) + 1;
+	_zNumSamples = (unsigned int)ceilf((zmax - zmin) * _invSampleSpacing) + 1;
+
+	clear();
+}
+
+
+void ObstacleDistanceField::clear()
+{
+	unsigned int numSamples = _xNumSamples * _zNumSamples;
+	_distance.assign(numSamples, _maxDistance);
+	_awayX.assign(numSamples, 0.0f);
+	_awayZ.assign(numSamples, 0.0f);
+}
+
+
+bool ObstacleDistanceField::_clampToSampleRange(float xmin, float xmax, float zmin, float zmax, unsigned int & xMinIndex, unsigned int & xMaxIndex, unsigned int & zMinIndex, unsigned int & zMaxIndex) const
+{
+	float first, last;
+
+	first = max(ceilf((xmin - _xOrigin) * _invSampleSpacing), 0.0f);
+	last = min(floorf((xmax - _xOrigin) * _invSampleSpacing), (float)(_xNumSamples-1));
+	if (first > last) return false;
+	xMinIndex = (unsigned int)first;
+	xMaxIndex = (unsigned int)last;
+
+	first = max(ceilf((zmin - _zOrigin) * _invSampleSpacing), 0.0f);
+	last = min(floorf((zmax - _zOrigin) * _invSampleSpacing), (float)(_zNumSamples-1));
+	if (first > last) return false;
+	zMinIndex = (unsigned int)first;
+	zMaxIndex = (unsigned int)last;
+
+	return true;
+}
+
+
+float ObstacleDistanceField::_signedDistance(ObstacleInterface * obstacle, float x, float z, float & awayX, float & awayZ)
+{
+	CircleObstacle * circle = dynamic_cast<CircleObstacle*>(obstacle);
+	if (circle != NULL) {
+		Point center = circle->position();
+		float dx = x - center.x;
+		float dz = z - center.z;
+		float length = sqrtf(dx*dx + dz*dz);
+		if (length == 0.0f) {
+			// at the very center every direction leads out equally fast.
+			awayX = 1.0f;
+			awayZ = 0.0f;
+		}
+		else {
+			awayX = dx / length;
+			awayZ = dz / length;
+		}
+		return length - circle->radius();
+	}
+
+	const AxisAlignedBox & box = obstacle->getBounds();
+	// how far outside each pair of faces the point is; negative means between them.
+	float outsideX = max(box.xmin - x, x - box.xmax);
+	float outsideZ = max(box.zmin - z, z - box.zmax);
+	float signX = (x > 0.5f * (box.xmin + box.xmax)) ? 1.0f : -1.0f;
+	float signZ = (z > 0.5f * (box.zmin + box.zmax)) ? 1.0f : -1.0f;
+
+	if ((outsideX > 0.0f) || (outsideZ > 0.0f)) {
+		// outside:  the nearest point is on a face or, past both faces, on a corner.
+		float dx = max(outsideX, 0.0f);
+		float dz = max(outsideZ, 0.0f);
+		float length = sqrtf(dx*dx + dz*dz);
+		awayX = signX * dx / length;
+		awayZ = signZ * dz / length;
+		return length;
+	}
+
+	// inside (or on the boundary):  the nearest face is the one that is least far away.
+	if (outsideX > outsideZ) {
+		awayX = signX;
+		awayZ = 0.0f;
+		return outsideX;
+	}
+	awayX = 0.0f;
+	awayZ = signZ;
+	return outsideZ;
+}
+
+
+void ObstacleDistanceField::_addObstacleToSamples(ObstacleInterface * obstacle, unsigned int xMinIndex, unsigned int xMaxIndex, unsigned int zMinIndex, unsigned int zMaxIndex)
+{
+	float awayX, awayZ;
+	for (unsigned int i=xMinIndex; i<=xMaxIndex; i++) {
+		float x = _xOrigin + (float)i * _sampleSpacing;
+		unsigned int sampleIndex = i*_zNumSamples + zMinIndex;
+		for (unsigned int j=zMinIndex; j<=zMaxIndex; j++) {
+			float z = _zOrigin + (float)j * _sampleSpacing;
+			float distance = _signedDistance(obstacle, x, z, awayX, awayZ);
+			if (distance < _distance[sampleIndex]) {
+				_distance[sampleIndex] = distance;
+				_awayX[sampleIndex] = awayX;
+				_awayZ[sampleIndex] = awayZ;
+			}
+			sampleIndex++;
+		}
+	}
+}
+
+
+void ObstacleDistanceField::addObstacle(ObstacleInterface * obstacle)
+{
+	// samples farther than _maxDistance from the bounds are farther than that from the obstacle, and stay as they are.
+	const AxisAlignedBox & bounds = obstacle->getBounds();
+	unsigned int xMinIndex, xMaxIndex, zMinIndex, zMaxIndex;
+	if (_clampToSampleRange(bounds.xmin - _maxDistance, bounds.xmax + _maxDistance, bounds.zmin - _maxDistance, bounds.zmax + _maxDistance, xMinIndex, xMaxIndex, zMinIndex, zMaxIndex)) {
+		_addObstacleToSamples(obstacle, xMinIndex, xMaxIndex, zMinIndex, zMaxIndex);
+	}
+}
+
+
+void ObstacleDistanceField::rebuildRegion(const AxisAlignedBox & region, const std::vector<ObstacleInterface*> & obstacles)
+{
+	unsigned int xMinIndex, xMaxIndex, zMinIndex, zMaxIndex;
+	if (!_clampToSampleRange(region.xmin, region.xmax, region.zmin, region.zmax, xMinIndex, xMaxIndex, zMinIndex, zMaxIndex)) {
+		return;
+	}
+
+	for (unsigned int i=xMinIndex; i<=xMaxIndex; i++) {
+		unsigned int rowStart = i*_zNumSamples;
+		std::fill(_distance.begin() + rowStart + zMinIndex, _distance.begin() + rowStart + zMaxIndex + 1, _maxDistance);
+		std::fill(_awayX.begin() + rowStart + zMinIndex, _awayX.begin() + rowStart + zMaxIndex + 1, 0.0f);
+		std::fill(_awayZ.begin() + rowStart + zMinIndex, _awayZ.begin() + rowStart + zMaxIndex + 1, 0.0f);
+	}
+
+	for (unsigned int k=0; k < obstacles.size(); k++) {
+		const AxisAlignedBox & bounds = obstacles[k]->getBounds();
+		unsigned int obstacleXMin, obstacleXMax, obstacleZMin, obstacleZMax;
+		if (!_clampToSampleRange(bounds.xmin - _maxDistance, bounds.xmax + _maxDistance, bounds.zmin - _maxDistance, bounds.zmax + _maxDistance, obstacleXMin, obstacleXMax, obstacleZMin, obstacleZMax)) {
+			continue;
+		}
+		// only the samples inside both the region and the obstacle's reach.
+		obstacleXMin = max(obstacleXMin, xMinIndex);
+		obstacleXMax = min(obstacleXMax, xMaxIndex);
+		obstacleZMin = max(obstacleZMin, zMinIndex);
+		obstacleZMax = min(obstacleZMax, zMaxIndex);
+		if ((obstacleXMin <= obstacleXMax) && (obstacleZMin <= obstacleZMax)) {
+			_addObstacleToSamples(obstacles[k], obstacleXMin, obstacleXMax, obstacleZMin, obstacleZMax);
+		}
+	}
+}
+
+
+bool ObstacleDistanceField::getDistance(const Point & p, float & distance, Vector & awayFromObstacle) const
+{
+	float fx = (p.x - _xOrigin) * _invSampleSpacing;
+	float fz = (p.z - _zOrigin) * _invSampleSpacing;
+	// the four samples around p have to exist; also rejects NaN.
+	if (!((fx >= 0.0f) && (fx < (float)(_xNumSamples-1)) && (fz >= 0.0f) && (fz < (float)(_zNumSamples-1)))) {
+		return false;
+	}
+
+	unsigned int i = (unsigned int)fx;
+	unsigned int j = (unsigned int)fz;
+	float tx = fx - (float)i;
+	float tz = fz - (float)j;
+	float w00 = (1.0f - tx) * (1.0f - tz);
+	float w01 = (1.0f - tx) * tz;
+	float w10 = tx * (1.0f - tz);
+	float w11 = tx * tz;
+	unsigned int s00 = i*_zNumSamples + j;
+	unsigned int s10 = s00 + _zNumSamples;
+
+	distance = w00*_distance[s00] + w01*_distance[s00+1] + w10*_distance[s10] + w11*_distance[s10+1];
+	if (distance >= _maxDistance) {
+		return false;
+	}
+
+	float awayX = w00*_awayX[s00] + w01*_awayX[s00+1] + w10*_awayX[s10] + w11*_awayX[s10+1];
+	float awayZ = w00*_awayZ[s00] + w01*_awayZ[s00+1] + w10*_awayZ[s10] + w11*_awayZ[s10+1];
+	float length = sqrtf(awayX*awayX + awayZ*awayZ);
+	if (length == 0.0f) {
+		// directions on opposite sides of a thin obstacle can cancel out.
+		return false;
+	}
+	awayFromObstacle = Vector(awayX / length, 0.0f, awayZ / length);
+	return true;
+}
@@ -0,0 +1,233 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+/// @file PathPlanningService.cpp
+/// @brief Implements the SteerLib::PathPlanningService class.
+
+#include <algorithm>
+
+#include "planning/PathPlanningService.h"
+#include "interfaces/AgentInterface.h"
+#include "interfaces/PlanningDomainInterface.h"
+#include "util/GenericException.h"
+#include "util/HighResCounter.h"
+#include "util/ThreadedTaskManager.h"
+
+using namespace SteerLib;
+using namespace Util;
+
+
+PathPlanningService::PathPlanningService(SteerLib::PlanningDomainInterface * planner, unsigned int numThreads, float timeBudget, unsigned int maxRequestsPerFrame)
+	: _planner(planner), _taskManager(NULL), _numThreads(numThreads), _timeBudget(timeBudget), _maxRequestsPerFrame(maxRequestsPerFrame),
+	_nextSequenceNumber(0), _numStartedRequests(0), _batchStartTick(0), _batchRunning(false), _numDeliveredPaths(0), _maxWaitTime(0.0f)
+{
+	if (_planner == NULL) {
+		throw GenericException("PathPlanningService needs a planning domain.");
+	}
+	if (_numThreads == 0) {
+		throw GenericException("PathPlanningService needs at least one thread.");
+	}
+	_taskManager = new ThreadedTaskManager(_numThreads);
+}
+
+PathPlanningService::~PathPlanningService()
+{
+	waitForRunningRequests();
+	delete _taskManager;
+}
+
+void PathPlanningService::requestPath(SteerLib::AgentInterface * agent, const Util::Point & start, const Util::Point & goal, unsigned int maxNodes)
+{
+	Request request;
+	request.agent = agent;
+	request.start = start;
+	request.goal = goal;
+	request.maxNodes = maxNodes;
+	request.pathComplete = false;
+
+	_pendingMutex.lock();
+	request.sequenceNumber = _nextSequenceNumber++;
+	_latestRequests[agent] = request.sequenceNumber;
+	_pendingRequests.push_back(request);
+	_pendingMutex.unlock();
+}
+
+void PathPlanningService::cancelRequests(SteerLib::AgentInterface * agent)
+{
+	// requests that are already running finish, but are not delivered without a latest request to match.
+	_pendingMutex.lock();
+	_latestRequests.erase(agent);
+	unsigned int numKept = 0;
+	for (unsigned int i=0; i < _pendingRequests.size(); i++) {
+		if (_pendingRequests[i].agent != agent) {
+			_pendingRequests[numKept++] = _pendingRequests[i];
+		}
+	}
+	_pendingRequests.resize(numKept);
+	_pendingMutex.unlock();
+
+	numKept = 0;
+	for (unsigned int i=0; i < _waitingRequests.size(); i++) {
+		if (_waitingRequests[i].agent != agent) {
+			_waitingRequests[numKept++] = _waitingRequests[i];
+		}
+	}
+	_waitingRequests.resize(numKept);
+}
+
+void PathPlanningService::clear()
+{
+	waitForRunningRequests();
+	_batch.clear();
+	_waitingRequests.clear();
+	_numStartedRequests = 0;
+	_errorMessage.clear();
+	_pendingMutex.lock();
+	_pendingRequests.clear();
+	_latestRequests.clear();
+	_pendingMutex.unlock();
+}
+
+unsigned int PathPlanningService::getNumOutstandingRequests()
+{
+	_pendingMutex.lock();
+	unsigned int numRequests = (unsigned int)_pendingRequests.size();
+	_pendingMutex.unlock();
+	return numRequests + (unsigned int)(_waitingRequests.size() + _batch.size());
+}
+
+void PathPlanningService::waitForRunningRequests()
+{
+	if (_batchRunning) {
+		_taskManager->waitForAllTasksToComplete();
+		_batchRunning = false;
+	}
+}
+
+bool PathPlanningService::_isStartedBefore(const Request & request1, const Request & request2)
+{
+	if (request1.agent->id() != request2.agent->id()) {
+		return request1.agent->id() < request2.agent->id();
+	}
+	return request1.sequenceNumber < request2.sequenceNumber;
+}
+
+void PathPlanningService::endFrame()
+{
+	unsigned long long waitStartTick = getHighResCounterValue();
+	waitForRunningRequests();
+	float waitTime = (float)(getHighResCounterValue() - waitStartTick) / (float)getHighResCounterFrequency();
+	_maxWaitTime = std::max(_maxWaitTime, waitTime);
+
+	_deliverBatch();
+
+	// the new requests wait behind the older ones, in the order of agent ids; requests that were replaced are dropped.
+	_pendingMutex.lock();
+	std::stable_sort(_pendingRequests.begin(), _pendingRequests.end(), _isStartedBefore);
+	_waitingRequests.insert(_waitingRequests.end(), _pendingRequests.begin(), _pendingRequests.end());
+	_pendingRequests.clear();
+	unsigned int numKept = 0;
+	for (unsigned int i=0; i < _waitingRequests.size(); i++) {
+		if (_isLatestRequest(_waitingRequests[i])) {
+			_waitingRequests[numKept++] = _waitingRequests[i];
+		}
+	}
+	_waitingRequests.resize(numKept);
+	_pendingMutex.unlock();
+
+	unsigned int batchSize = (unsigned int)_waitingRequests.size();
+	if ((_maxRequestsPerFrame > 0) && (batchSize > _maxRequestsPerFrame)) {
+		batchSize = _maxRequestsPerFrame;
+	}
+	if (batchSize == 0) {
+		return;
+	}
+	_batch.assign(_waitingRequests.begin(), _waitingRequests.begin() + batchSize);
+	_waitingRequests.erase(_waitingRequests.begin(), _waitingRequests.begin() + batchSize);
+
+	_numStartedRequests = 0;
+	_batchStartTick = getHighResCounterValue();
+	_batchRunning = true;
+	for (unsigned int i=0; i < _numThreads; i++) {
+		Task newTask;
+		newTask.function = &PathPlanningService::_runWorkerTask;
+		newTask.data = this;
+		// only wake up the worker threads once, after all tasks are queued.
+		_taskManager->addTask(newTask, false);
+	}
+	_taskManager->wakeUpAllSleepingWorkerThreads();
+}
+
+bool PathPlanningService::_isLatestRequest(const Request & request)
+{
+	std::map<SteerLib::AgentInterface*, unsigned long long>::iterator latest = _latestRequests.find(request.agent);
+	return (latest != _latestRequests.end()) && (latest->second == request.sequenceNumber);
+}
+
+void PathPlanningService::_deliverBatch()
+{
+	// hand out the finished paths; the requests that the budget did not allow to start go back to the front of the queue.
+	std::vector<Request> notStarted;
+	for (unsigned int i=0; i < _batch.size(); i++) {
+		Request & request = _batch[i];
+		_pendingMutex.lock();
+		bool isLatest = _isLatestRequest(request);
+		if (isLatest && (i < _numStartedRequests)) {
+			_latestRequests.erase(request.agent);
+		}
+		_pendingMutex.unlock();
+
+		if (!isLatest) {
+			// replaced by a newer request, or cancelled.
+			continue;
+		}
+		if (i < _numStartedRequests) {
+			request.agent->receiveLongTermPlan(request.goal, request.path, request.pathComplete);
+			_numDeliveredPaths++;
+		}
+		else {
+			notStarted.push_back(request);
+		}
+	}
+	_waitingRequests.insert(_waitingRequests.begin(), notStarted.begin(), notStarted.end());
+	_batch.clear();
+	_numStartedRequests = 0;
+
+	if (!_errorMessage.empty()) {
+		std::string errorMessage = _errorMessage;
+		_errorMessage.clear();
+		throw GenericException("Exception while planning a path:\n" + errorMessage);
+	}
+}
+
+void PathPlanningService::_runWorkerTask(unsigned int threadIndex, void * data)
+{
+	((PathPlanningService*)data)->_runRequests();
+}
+
+void PathPlanningService::_runRequests()
+{
+	unsigned long long budgetTicks = (unsigned long long)(_timeBudget * (float)getHighResCounterFrequency());
+	while (true) {
+		_batchMutex.lock();
+		bool budgetSpent = (_timeBudget > 0.0f) && (getHighResCounterValue() - _batchStartTick >= budgetTicks);
+		if ((_numStartedRequests >= _batch.size()) || budgetSpent) {
+			_batchMutex.unlock();
+			return;
+		}
+		Request & request = _batch[_numStartedRequests++];
+		_batchMutex.unlock();
+
+		try {
+			request.pathComplete = _planner->findPath(request.start, request.goal, request.path, request.maxNodes);
+		}
+		catch (std::exception &e) {
+			_batchMutex.lock();
+			_errorMessage = e.what();
+			_batchMutex.unlock();
+		}
+	}
+}
@@ -27,6 +27,11 @@
 // #include "modules/SpatialDatabaseModule.h"
 #include "griddatabase/GridDatabase2D.h"
 #include "griddatabase/GridDatabasePlanningDomain.h"
+#include "griddatabase/GridHierarchicalPlanningDomain.h"
+#include "griddatabase/GridFlowFieldPlanningDomain.h"
+#include "griddatabase/GridIncrementalPlanningDomain.h"
+#include "util/ThreadedTaskManager.h"
+#include "planning/PathPlanningService.h"
 // #include "kdtree/KdTreeDataBase.h"
 #include "interfaces/SpatialDataBaseModuleInterface.h"
 #include "interfaces/PlanningDomainModuleInterface.h"
@@ -41,6 +46,11 @@ using namespace Util;
 
 // #define _DEBUG 1
 
+/// Each worker thread gets several chunks of agents per frame, so that threads finishing early can pick up remaining work.
+#define AGENT_UPDATE_CHUNKS_PER_THREAD 4
+/// Below this many agents, the overhead of waking up worker threads outweighs the benefit of updating in parallel.
+#define MIN_AGENTS_FOR_PARALLEL_UPDATE 64
+
 
 SimulationEngine::SimulationEngine()
 {
@@ -57,6 +67,11 @@ void SimulationEngine::_reset()
 	_agents.clear();
 	_selectedAgents.clear();
 	_agentOwners.clear();
+	_numThreadUnsafeAgents = 0;
+	_numThreadUnsafeTwoPhaseAgents = 0;
+	_agentUpdateTaskManager = NULL;
+	_agentUpdateTasks.clear();
+	_pathPlanningService = NULL;
 	_commands.clear();
 	_obstacles.clear();
 	//_clock reset ???;
@@ -120,8 +135,13 @@ void SimulationEngine::init(SimulationOptions * options, SteerLib::EngineControl
 	float zmax = (_options->gridDatabaseOptions.gridSizeZ / 2.0f);
 
 
-	if (_options->engineOptions.numThreads != 1) {
-		throw GenericException("multi-threading not supported yet");
+	if (_options->engineOptions.numThreads == 0) {
+		throw GenericException("engineOptions.numThreads must be at least 1.");
+	}
+	else if (_options->engineOptions.numThreads > 1) {
+		// agents are only updated in parallel if their modules declare them thread-safe; see ModuleInterface::hasThreadSafeAgents().
+		_agentUpdateTaskManager = new ThreadedTaskManager(_options->engineOptions.numThreads);
+		_agentUpdateTasks.resize(_options->engineOptions.numThreads * AGENT_UPDATE_CHUNKS_PER_THREAD);
 	}
 
 	int spatialDataBaseIndex = -1;
@@ -202,12 +222,45 @@ void SimulationEngine::init(SimulationOptions * options, SteerLib::EngineControl
 		{
 			grid = new GridDatabase2D(xmin, xmax, zmin, zmax, _options->gridDatabaseOptions.numGridCellsX, _options->gridDatabaseOptions.numGridCellsZ, _options->gridDatabaseOptions.maxItemsPerGridCell, _options->gridDatabaseOptions.drawGrid);
 		}*/
-		_pathPlanner = new GridDatabasePlanningDomain(grid, this);
+		GridDatabasePlanningDomain * gridPlanningDomain = new GridDatabasePlanningDomain(grid, this);
+		gridPlanningDomain->setSearchAlgorithm(_options->planningDomainOptions.searchAlgorithm);
+		gridPlanningDomain->setPathCacheSize(_options->planningDomainOptions.pathCacheSize);
+		_pathPlanner = gridPlanningDomain;
 		/*else
 		{
 			throw Util::GenericException("Planning Domain " + _options->planningDomainOptions.name + " can only be used with the grid database");
 		}*/
 	}
+	else if ( _options->planningDomainOptions.name == "hierarchicalGridDomain")
+	{
+		std::cout << "Creating planning domain: " << _options->planningDomainOptions.name << std::endl;
+		GridDatabase2D* grid = new GridDatabase2D(xmin, xmax, zmin, zmax, _options->gridDatabaseOptions.numGridCellsX, _options->gridDatabaseOptions.numGridCellsZ, _options->gridDatabaseOptions.maxItemsPerGridCell, _options->gridDatabaseOptions.drawGrid);
+		GridHierarchicalPlanningDomain * hierarchicalPlanningDomain = new GridHierarchicalPlanningDomain(grid, this, _options->planningDomainOptions.clusterSize);
+		// used for the paths that the abstract graph cannot provide.
+		hierarchicalPlanningDomain->setSearchAlgorithm(_options->planningDomainOptions.searchAlgorithm);
+		hierarchicalPlanningDomain->setPathCacheSize(_options->planningDomainOptions.pathCacheSize);
+		_pathPlanner = hierarchicalPlanningDomain;
+	}
+	else if ( _options->planningDomainOptions.name == "flowFieldGridDomain")
+	{
+		std::cout << "Creating planning domain: " << _options->planningDomainOptions.name << std::endl;
+		GridDatabase2D* grid = new GridDatabase2D(xmin, xmax, zmin, zmax, _options->gridDatabaseOptions.numGridCellsX, _options->gridDatabaseOptions.numGridCellsZ, _options->gridDatabaseOptions.maxItemsPerGridCell, _options->gridDatabaseOptions.drawGrid);
+		GridFlowFieldPlanningDomain * flowFieldPlanningDomain = new GridFlowFieldPlanningDomain(grid, this, _options->planningDomainOptions.maxFlowFields);
+		// used for the goals that do not get a flow field.
+		flowFieldPlanningDomain->setSearchAlgorithm(_options->planningDomainOptions.searchAlgorithm);
+		flowFieldPlanningDomain->setPathCacheSize(_options->planningDomainOptions.pathCacheSize);
+		_pathPlanner = flowFieldPlanningDomain;
+	}
+	else if ( _options->planningDomainOptions.name == "incrementalGridDomain")
+	{
+		std::cout << "Creating planning domain: " << _options->planningDomainOptions.name << std::endl;
+		GridDatabase2D* grid = new GridDatabase2D(xmin, xmax, zmin, zmax, _options->gridDatabaseOptions.numGridCellsX, _options->gridDatabaseOptions.numGridCellsZ, _options->gridDatabaseOptions.maxItemsPerGridCell, _options->gridDatabaseOptions.drawGrid);
+		GridIncrementalPlanningDomain * incrementalPlanningDomain = new GridIncrementalPlanningDomain(grid, this, _options->planningDomainOptions.maxIncrementalSearches);
+		// used for the goals that do not get a search.
+		incrementalPlanningDomain->setSearchAlgorithm(_options->planningDomainOptions.searchAlgorithm);
+		incrementalPlanningDomain->setPathCacheSize(_options->planningDomainOptions.pathCacheSize);
+		_pathPlanner = incrementalPlanningDomain;
+	}
 	else if (_options->planningDomainOptions.name == "navmeshDomain")
 	{
 		std::cout << "Creating planning domain: " << _options->planningDomainOptions.name << std::endl;
@@ -263,6 +316,10 @@ void SimulationEngine::init(SimulationOptions * options, SteerLib::EngineControl
 		throw Util::GenericException("Planning Domain " + _options->planningDomainOptions.name + " is not a valid planning domain module");
 	}
 
+	if (_options->planningDomainOptions.asyncPlanning) {
+		// agents that support it request their long-term paths from this service instead of planning inline; see AgentInterface::runLongTermPlanning().
+		_pathPlanningService = new PathPlanningService(_pathPlanner, _options->planningDomainOptions.asyncPlanningThreads, _options->planningDomainOptions.asyncPlanningTimeBudget, _options->planningDomainOptions.asyncPlanningMaxRequestsPerFrame);
+	}
 
 
 	// load the modules that were requested.
@@ -332,6 +389,8 @@ void SimulationEngine::finish()
 		}
 		_agents.clear();
 		_agentOwners.clear();
+		_numThreadUnsafeAgents = 0;
+		_numThreadUnsafeTwoPhaseAgents = 0;
 	}
 	_selectedAgents.clear();
 
@@ -356,6 +415,16 @@ void SimulationEngine::finish()
 		delete _spatialDatabase;
 	}
 	_commands.clear();
+
+	if (_agentUpdateTaskManager != NULL) {
+		delete _agentUpdateTaskManager;
+		_agentUpdateTaskManager = NULL;
+	}
+	_agentUpdateTasks.clear();
+	if (_pathPlanningService != NULL) {
+		delete _pathPlanningService;
+		_pathPlanningService = NULL;
+	}
 	// this->_pathPlanner cleanup??
 	//_clock cleanup??
 	//_camera cleanup??
@@ -416,6 +485,10 @@ void SimulationEngine::preprocessSimulation()
 		(*iter)->preprocessSimulation();
 	}
 
+	if (_pathPlanningService != NULL) {
+		// requests that agents made while modules were preprocessing are planned after the refresh.
+		_pathPlanningService->waitForRunningRequests();
+	}
 	this->_pathPlanner->refresh();
 	// reset the agents
 	for (size_t a=0; a < _agentInitialConditions.size(); a++)
@@ -438,6 +511,13 @@ void SimulationEngine::postprocessSimulation()
 	_engineState.transitionToState(ENGINE_STATE_POSTPROCESSING_SIMULATION);
 
 	std::cout << "Simulated " << _numFramesSimulated << " frames." << std::endl;
+	GridDatabasePlanningDomain * gridPlanningDomain = dynamic_cast<GridDatabasePlanningDomain*>(_pathPlanner);
+	if ((gridPlanningDomain != NULL) && (gridPlanningDomain->getPathCache().getMaxNumPaths() > 0)) {
+		std::cout << "Path cache: " << gridPlanningDomain->getPathCache().getNumHits() << " hits, " << gridPlanningDomain->getPathCache().getNumMisses() << " misses." << std::endl;
+	}
+	if (_pathPlanningService != NULL) {
+		std::cout << "Asynchronous planning: " << _pathPlanningService->getNumDeliveredPaths() << " paths delivered, longest wait at the end of a frame " << _pathPlanningService->getMaxWaitTime() << " seconds." << std::endl;
+	}
 
 	std::vector<SteerLib::ModuleInterface*>::iterator iter;
 	for ( iter = _modulesInExecutionOrder.begin(); iter != _modulesInExecutionOrder.end();  ++iter ) {
@@ -502,26 +582,22 @@ bool SimulationEngine::_simulateOneStep()
 		(*moduleIterator)->preprocessFrame(currentSimulationTime, simulatonDt, currentFrameNumber);
 	}
 
-	int iter = 0;
 	std::vector<int> agentsEmit;
-	// call updateAI for all agents
-	std::vector<SteerLib::AgentInterface*>::iterator agentIterator;
-	for ( agentIterator = _agents.begin(); agentIterator != _agents.end(); ++agentIterator )
-	{
-		if ((*agentIterator)->enabled()){
-			(*agentIterator)->updateAI(currentSimulationTime, simulatonDt, currentFrameNumber);
+	bool canUseWorkerThreads = (_agentUpdateTaskManager != NULL) && (_agents.size() >= MIN_AGENTS_FOR_PARALLEL_UPDATE);
+	if (_options->engineOptions.twoPhaseAgentUpdate) {
+		// every agent senses the same snapshot of the previous frame, because nothing moves until the act pass.
+		bool twoPhaseInParallel = canUseWorkerThreads && (_numThreadUnsafeTwoPhaseAgents == 0);
+		if (twoPhaseInParallel) {
+			_updateAgentsInParallel(AGENT_UPDATE_SENSE, currentSimulationTime, simulatonDt, currentFrameNumber, numDisabledAgents, agentsEmit);
 		}
 		else {
-			if((*agentIterator)->finished()) {	//for most AIs, this will in turn call enabled() and duplicate original behavior; ShadowAI overrides this behavior
-				numDisabledAgents++;
-			}
-			if(iter <= _spawned_agent_emitter_num.size()-1) {//make sure agent is within bounds
-				if(_spawned_agent_emitter_num[iter] >= 0) {//only agents emitted call another emit
-					agentsEmit.push_back(iter);
-				}
-			}
+			_updateAgentRange(AGENT_UPDATE_SENSE, 0, _agents.size(), currentSimulationTime, simulatonDt, currentFrameNumber, numDisabledAgents, agentsEmit);
 		}
-		iter++;
+		_updateAgentsWithDeferredDatabase(AGENT_UPDATE_ACT, twoPhaseInParallel, currentSimulationTime, simulatonDt, currentFrameNumber, numDisabledAgents, agentsEmit);
+	}
+	else {
+		// call updateAI for all agents
+		_updateAgentsWithDeferredDatabase(AGENT_UPDATE_FULL, canUseWorkerThreads && (_numThreadUnsafeAgents == 0), currentSimulationTime, simulatonDt, currentFrameNumber, numDisabledAgents, agentsEmit);
 	}
 
 	// emit agents and turn off disabled agent from emitting more agents
@@ -533,6 +609,11 @@ bool SimulationEngine::_simulateOneStep()
 		_spawned_agent_emitter_num[agentsEmit[j]] = -1;//disable spawning agent
 	}
 
+	// hand the paths planned during this frame to the agents, and start planning the requests made in this frame.
+	if (_pathPlanningService != NULL) {
+		_pathPlanningService->endFrame();
+	}
+
 	// call postprocess for all modules
 	for ( moduleIterator = _modulesInExecutionOrder.begin(); moduleIterator != _modulesInExecutionOrder.end();  ++moduleIterator ) {
 		(*moduleIterator)->postprocessFrame(currentSimulationTime, simulatonDt, currentFrameNumber);
@@ -557,6 +638,113 @@ bool SimulationEngine::_simulateOneStep()
 	return true;
 }
 
+void SimulationEngine::_updateAgentRange(AgentUpdatePhase phase, unsigned int beginIndex, unsigned int endIndex, float currentSimulationTime, float simulationDt, unsigned int currentFrameNumber, unsigned int & numDisabledAgents, std::vector<int> & agentsEmit)
+{
+	if (phase == AGENT_UPDATE_SENSE) {
+		for (unsigned int i = beginIndex; i < endIndex; i++) {
+			if (_agents[i]->enabled()) {
+				_agents[i]->senseAI(currentSimulationTime, simulationDt, currentFrameNumber);
+			}
+		}
+		return;
+	}
+
+	for (unsigned int i = beginIndex; i < endIndex; i++)
+	{
+		if (_agents[i]->enabled()) {
+			if (phase == AGENT_UPDATE_ACT) {
+				_agents[i]->actAI(currentSimulationTime, simulationDt, currentFrameNumber);
+			}
+			else {
+				_agents[i]->updateAI(currentSimulationTime, simulationDt, currentFrameNumber);
+			}
+		}
+		else {
+			if(_agents[i]->finished()) {	//for most AIs, this will in turn call enabled() and duplicate original behavior; ShadowAI overrides this behavior
+				numDisabledAgents++;
+			}
+			if(i < _spawned_agent_emitter_num.size()) {//make sure agent is within bounds
+				if(_spawned_agent_emitter_num[i] >= 0) {//only agents emitted call another emit
+					agentsEmit.push_back(i);
+				}
+			}
+		}
+	}
+}
+
+void SimulationEngine::_updateAgentsWithDeferredDatabase(AgentUpdatePhase phase, bool inParallel, float currentSimulationTime, float simulationDt, unsigned int currentFrameNumber, unsigned int & numDisabledAgents, std::vector<int> & agentsEmit)
+{
+	// each agent usually makes one update, plus one removal if it is disabled.
+	if (inParallel && _spatialDatabase->beginDeferredUpdates(2 * _agents.size())) {
+		try {
+			_updateAgentsInParallel(phase, currentSimulationTime, simulationDt, currentFrameNumber, numDisabledAgents, agentsEmit);
+		}
+		catch (std::exception &e) {
+			_spatialDatabase->commitDeferredUpdates();
+			throw;
+		}
+		_spatialDatabase->commitDeferredUpdates();
+	}
+	else {
+		_updateAgentRange(phase, 0, _agents.size(), currentSimulationTime, simulationDt, currentFrameNumber, numDisabledAgents, agentsEmit);
+	}
+}
+
+void SimulationEngine::_updateAgentsInParallel(AgentUpdatePhase phase, float currentSimulationTime, float simulationDt, unsigned int currentFrameNumber, unsigned int & numDisabledAgents, std::vector<int> & agentsEmit)
+{
+	unsigned int numTasks = _agentUpdateTasks.size();
+	unsigned int numAgents = _agents.size();
+	unsigned int chunkSize = (numAgents + numTasks - 1) / numTasks;
+
+	unsigned int numTasksUsed = 0;
+	for (unsigned int i=0; i < numTasks; i++) {
+		AgentUpdateTask & task = _agentUpdateTasks[i];
+		task.beginIndex = i * chunkSize;
+		if (task.beginIndex >= numAgents)
+			break;
+		task.endIndex = min(task.beginIndex + chunkSize, numAgents);
+		task.engine = this;
+		task.phase = phase;
+		task.currentSimulationTime = currentSimulationTime;
+		task.simulationDt = simulationDt;
+		task.currentFrameNumber = currentFrameNumber;
+		task.numDisabledAgents = 0;
+		task.agentsEmit.clear();
+		task.failed = false;
+
+		Task newTask;
+		newTask.function = &SimulationEngine::_runAgentUpdateTask;
+		newTask.data = &task;
+		// only wake up the worker threads once, after all tasks are queued.
+		_agentUpdateTaskManager->addTask(newTask, false);
+		numTasksUsed++;
+	}
+	_agentUpdateTaskManager->wakeUpAllSleepingWorkerThreads();
+	_agentUpdateTaskManager->waitForAllTasksToComplete();
+
+	// merge in chunk order, so that emitters fire in the same order as a serial update.
+	for (unsigned int i=0; i < numTasksUsed; i++) {
+		AgentUpdateTask & task = _agentUpdateTasks[i];
+		if (task.failed) {
+			throw GenericException("Exception while updating agents " + toString(task.beginIndex) + " to " + toString(task.endIndex-1) + ":\n" + task.errorMessage);
+		}
+		numDisabledAgents += task.numDisabledAgents;
+		agentsEmit.insert(agentsEmit.end(), task.agentsEmit.begin(), task.agentsEmit.end());
+	}
+}
+
+void SimulationEngine::_runAgentUpdateTask(unsigned int threadIndex, void * data)
+{
+	AgentUpdateTask * task = (AgentUpdateTask*)data;
+	try {
+		task->engine->_updateAgentRange(task->phase, task->beginIndex, task->endIndex, task->currentSimulationTime, task->simulationDt, task->currentFrameNumber, task->numDisabledAgents, task->agentsEmit);
+	}
+	catch (std::exception &e) {
+		task->errorMessage = e.what();
+		task->failed = true;
+	}
+}
+
 
 //========================================
 
@@ -1210,6 +1398,7 @@ SteerLib::AgentInterface * SimulationEngine::createAgent(const SteerLib::AgentIn
 		// newAgent->reset(initialConditions,this);
 		_agents.push_back(newAgent);
 		_agentOwners[newAgent] = owner;
+		_countAgentOwner(owner, true);
 		_spawned_agent_emitter_num.push_back(-1);// default = no emitter
 	}
 
@@ -1224,6 +1413,7 @@ SteerLib::AgentInterface * SimulationEngine::createEmittedAgent(const SteerLib::
 		newAgent->reset(initialConditions,this);
 		_agents.push_back(newAgent);
 		_agentOwners[newAgent] = owner;
+		_countAgentOwner(owner, true);
 		_spawned_agent_emitter_num.push_back(emitterNum);// default = no emitter
 	}
 
@@ -1296,6 +1486,11 @@ void SimulationEngine::destroyAgent(SteerLib::AgentInterface * agentToDestroy)
 
 		// remove the agent from the list of owners
 		_agentOwners.erase(agentToDestroy);
+		_countAgentOwner(module, false);
+
+		if (_pathPlanningService != NULL) {
+			_pathPlanningService->cancelRequests(agentToDestroy);
+		}
 
 		// destroy the agent
 		module->destroyAgent(agentToDestroy);
@@ -1336,6 +1531,7 @@ void SimulationEngine::addAgent(SteerLib::AgentInterface * newAgent, SteerLib::M
 	_spawned_agent_emitter_num.push_back(-1);// default = no emitter
 	_agents.push_back(newAgent);
 	_agentOwners[newAgent] = owner;
+	_countAgentOwner(owner, true);
 }
 
 //========================================
@@ -1354,7 +1550,40 @@ void SimulationEngine::removeAgent(SteerLib::AgentInterface * agentToRemove)
 	_agents.pop_back();
 
 	// remove the agent from the list of owners
-	_agentOwners.erase(agentToRemove);
+	std::map<SteerLib::AgentInterface*, SteerLib::ModuleInterface*>::iterator moduleIter = _agentOwners.find(agentToRemove);
+	if (moduleIter != _agentOwners.end()) {
+		_countAgentOwner((*moduleIter).second, false);
+		_agentOwners.erase(moduleIter);
+	}
+
+	if (_pathPlanningService != NULL) {
+		_pathPlanningService->cancelRequests(agentToRemove);
+	}
+}
+
+//========================================
+
+void SimulationEngine::_countAgentOwner(SteerLib::ModuleInterface * owner, bool agentAdded)
+{
+	if ((owner == NULL) || !owner->hasThreadSafeAgents()) {
+		if (agentAdded) {
+			_numThreadUnsafeAgents++;
+		}
+		else {
+			assert(_numThreadUnsafeAgents > 0);
+			_numThreadUnsafeAgents--;
+		}
+	}
+
+	if ((owner == NULL) || !owner->hasThreadSafeTwoPhaseAgents()) {
+		if (agentAdded) {
+			_numThreadUnsafeTwoPhaseAgents++;
+		}
+		else {
+			assert(_numThreadUnsafeTwoPhaseAgents > 0);
+			_numThreadUnsafeTwoPhaseAgents--;
+		}
+	}
 }
 
 /*
@@ -1385,6 +1614,13 @@ void SimulationEngine::destroyAllObstaclesFromModule(SteerLib::ModuleInterface *
 void SimulationEngine::addObstacle(SteerLib::ObstacleInterface * newObstacle)
 {
 	_obstacles.insert(newObstacle);
+	if (_pathPlanningService != NULL) {
+		// running requests read the planning domain.
+		_pathPlanningService->waitForRunningRequests();
+	}
+	if (_pathPlanner != NULL) {
+		_pathPlanner->addObstacle(newObstacle);
+	}
 }
 
 
@@ -1392,7 +1628,12 @@ void SimulationEngine::addObstacle(SteerLib::ObstacleInterface * newObstacle)
 
 void SimulationEngine::removeObstacle(SteerLib::ObstacleInterface * obstacleToRemove)
 {
-	_obstacles.erase(obstacleToRemove);
+	if ((_obstacles.erase(obstacleToRemove) != 0) && (_pathPlanner != NULL)) {
+		if (_pathPlanningService != NULL) {
+			_pathPlanningService->waitForRunningRequests();
+		}
+		_pathPlanner->removeObstacle(obstacleToRemove);
+	}
 }
 
 /**
@@ -56,10 +56,13 @@ void SimulationMetricsCollector::_resetEnvironmentMetrics()
 
 void SimulationMetricsCollector::_updateAgentMetrics(SteerLib::SpatialDataBaseInterface * gridDB, const std::vector<SteerLib::AgentInterface*> & updatedAgents, float currentTimeStamp, float timePassedSinceLastFrame)
 {
+	// one batched query finds every touching pair, instead of one collision query per agent.
+	gridDB->computeAllAgentNeighbors(updatedAgents, 0.0f, _neighborLists);
+
 	for (unsigned int i=0; i < getNumAgents(); i++) {
 		/// @todo do we need this enabled() check here?  It may even be undesirable to keep it here.
 		// std::cout << "Updating agent " << i << " metrics" << std::endl;
-		if (updatedAgents[i]->enabled()) _agentCollectors[i]->update(gridDB, updatedAgents[i], currentTimeStamp, timePassedSinceLastFrame);
+		if (updatedAgents[i]->enabled()) _agentCollectors[i]->update(gridDB, updatedAgents[i], currentTimeStamp, timePassedSinceLastFrame, &_neighborLists[i]);
 	}
 }
 
@@ -145,6 +145,7 @@ using namespace Util;
 #define DEFAULT_CLOG_REDIRECTION_FILENAME ""
 #define DEFAULT_DATA_FILE ""
 #define DEFAULT_NUM_THREADS 1
+#define DEFAULT_TWO_PHASE_AGENT_UPDATE false
 #define DEFAULT_NUM_FRAMES_TO_SIMULATE 0
 #define DEFAULT_FIXED_FPS 20.0f
 #define DEFAULT_MIN_VARIABLE_DT 0.001f
@@ -171,6 +172,15 @@ using namespace Util;
 //====================================
 #define DEFAULT_USE_PLANNER "gridDomain"
 #define DEFAULT_MAX_NODES_TO_EXPAND 50000
+#define DEFAULT_PLANNING_SEARCH_ALGORITHM "astar"
+#define DEFAULT_HIERARCHICAL_CLUSTER_SIZE 16
+#define DEFAULT_MAX_FLOW_FIELDS 32
+#define DEFAULT_MAX_INCREMENTAL_SEARCHES 32
+#define DEFAULT_PATH_CACHE_SIZE 0
+#define DEFAULT_ASYNC_PLANNING false
+#define DEFAULT_ASYNC_PLANNING_THREADS 1
+#define DEFAULT_ASYNC_PLANNING_TIME_BUDGET 0.0f
+#define DEFAULT_ASYNC_PLANNING_MAX_REQUESTS_PER_FRAME 0
 
 
 //====================================
@@ -242,6 +252,7 @@ SimulationOptions::SimulationOptions()
 	engineOptions.testCaseSearchPath = DEFAULT_TEST_CASE_SEARCH_PATH;
 	engineOptions.startupModules.clear();
 	engineOptions.numThreads = DEFAULT_NUM_THREADS;
+	engineOptions.twoPhaseAgentUpdate = DEFAULT_TWO_PHASE_AGENT_UPDATE;
 	engineOptions.numFramesToSimulate = DEFAULT_NUM_FRAMES_TO_SIMULATE;
 	engineOptions.fixedFPS = DEFAULT_FIXED_FPS;
 	engineOptions.minVariableDt = DEFAULT_MIN_VARIABLE_DT;
@@ -261,6 +272,15 @@ SimulationOptions::SimulationOptions()
 	// Planning Domain options
 	planningDomainOptions.name = DEFAULT_USE_PLANNER;
 	planningDomainOptions.maxNodesToExpand = DEFAULT_MAX_NODES_TO_EXPAND;
+	planningDomainOptions.searchAlgorithm = DEFAULT_PLANNING_SEARCH_ALGORITHM;
+	planningDomainOptions.clusterSize = DEFAULT_HIERARCHICAL_CLUSTER_SIZE;
+	planningDomainOptions.maxFlowFields = DEFAULT_MAX_FLOW_FIELDS;
+	planningDomainOptions.maxIncrementalSearches = DEFAULT_MAX_INCREMENTAL_SEARCHES;
+	planningDomainOptions.pathCacheSize = DEFAULT_PATH_CACHE_SIZE;
+	planningDomainOptions.asyncPlanning = DEFAULT_ASYNC_PLANNING;
+	planningDomainOptions.asyncPlanningThreads = DEFAULT_ASYNC_PLANNING_THREADS;
+	planningDomainOptions.asyncPlanningTimeBudget = DEFAULT_ASYNC_PLANNING_TIME_BUDGET;
+	planningDomainOptions.asyncPlanningMaxRequestsPerFrame = DEFAULT_ASYNC_PLANNING_MAX_REQUESTS_PER_FRAME;
 
 	// GUI options
 	guiOptions.useAntialiasing = DEFAULT_ANTIALIASING;
@@ -461,6 +481,7 @@ void SimulationOptions::_setupXMLStructure( Util::XMLParser & xmlOpts )
 	engineTag->createChildTag("testCaseSearchPath","The default directory to search for test cases at runtime.", XML_DATA_TYPE_STRING, &engineOptions.testCaseSearchPath);
 	engineTag->createChildTag("startupModules", "The list of modules to use on startup.  Modules specified by the command line will be merged with this list.", XML_DATA_TYPE_CONTAINER, NULL, &_startupModulesXMLParser);
 	engineTag->createChildTag("numThreads", "The default number of threads to run on the simulation", XML_DATA_TYPE_UNSIGNED_INT, &engineOptions.numThreads);
+	engineTag->createChildTag("twoPhaseAgentUpdate", "Set to \"true\" to update agents in two phases: every agent first senses a frozen snapshot of the previous frame, then all agents commit their new state.  Results no longer depend on agent order, and the sensing phase can run on multiple threads.", XML_DATA_TYPE_BOOLEAN, &engineOptions.twoPhaseAgentUpdate);
 	engineTag->createChildTag("numFrames", "The default number of frames to simulate - 0 means run the entire simulation until all agents are disabled.", XML_DATA_TYPE_UNSIGNED_INT, &engineOptions.numFramesToSimulate);
 	engineTag->createChildTag("fixedFPS", "The fixed frames-per-second for the simulation clock.  This value is used when simulationClockMode is \"fixed-fast\" or \"fixed-real-time\".", XML_DATA_TYPE_FLOAT, &engineOptions.fixedFPS);
 	engineTag->createChildTag("minVariableDt", "The minimum time-step allowed when the clock is in \"variable-real-time\" mode.  If the proposed time-step is smaller, this value will be used instead, effectively limiting the max frame rate.", XML_DATA_TYPE_FLOAT, &engineOptions.minVariableDt);
@@ -476,6 +497,15 @@ void SimulationOptions::_setupXMLStructure( Util::XMLParser & xmlOpts )
 	planningDomainTag->createChildTag("planner", "Options selects which planning tool to use during simulation", XML_DATA_TYPE_STRING, &planningDomainOptions.name);
 	XMLTag * planningDomainSettingsTag = planningDomainTag->createChildTag("domainSettings", "Options related to the grid database");
 	planningDomainSettingsTag->createChildTag("maxNodesToExpand", "Options informs planner to the max number of nodes to expand in search", XML_DATA_TYPE_UNSIGNED_INT, &planningDomainOptions.maxNodesToExpand);
+	planningDomainSettingsTag->createChildTag("searchAlgorithm", "Search algorithm used by the grid planning domain, either \"astar\" or \"jps\" (jump point search, which falls back to A* if traversal costs are not uniform)", XML_DATA_TYPE_STRING, &planningDomainOptions.searchAlgorithm);
+	planningDomainSettingsTag->createChildTag("clusterSize", "Number of cells along the side of each cluster of the hierarchicalGridDomain planner", XML_DATA_TYPE_UNSIGNED_INT, &planningDomainOptions.clusterSize);
+	planningDomainSettingsTag->createChildTag("maxFlowFields", "Maximum number of goals that the flowFieldGridDomain planner keeps a flow field for; other goals are planned with A*", XML_DATA_TYPE_UNSIGNED_INT, &planningDomainOptions.maxFlowFields);
+	planningDomainSettingsTag->createChildTag("maxIncrementalSearches", "Maximum number of goals that the incrementalGridDomain planner keeps a D* Lite search for, which it repairs when obstacles are added or removed; other goals are planned with A*", XML_DATA_TYPE_UNSIGNED_INT, &planningDomainOptions.maxIncrementalSearches);
+	planningDomainSettingsTag->createChildTag("pathCacheSize", "Number of complete paths that the grid planning domains cache; a cached path also answers queries from any cell along it to the same goal.  0 disables the cache", XML_DATA_TYPE_UNSIGNED_INT, &planningDomainOptions.pathCacheSize);
+	planningDomainSettingsTag->createChildTag("asyncPlanning", "Set to \"true\" to plan long-term paths on background threads; agents follow a straight line to their goal until their path arrives, usually two frames later", XML_DATA_TYPE_BOOLEAN, &planningDomainOptions.asyncPlanning);
+	planningDomainSettingsTag->createChildTag("asyncPlanningThreads", "Number of background threads that plan long-term paths when asyncPlanning is enabled", XML_DATA_TYPE_UNSIGNED_INT, &planningDomainOptions.asyncPlanningThreads);
+	planningDomainSettingsTag->createChildTag("asyncPlanningTimeBudget", "Seconds per frame after which the background threads stop starting new path requests; the rest wait for the next frame.  0 means unlimited, which keeps simulations deterministic", XML_DATA_TYPE_FLOAT, &planningDomainOptions.asyncPlanningTimeBudget);
+	planningDomainSettingsTag->createChildTag("asyncPlanningMaxRequestsPerFrame", "Maximum number of path requests started per frame when asyncPlanning is enabled; 0 means unlimited", XML_DATA_TYPE_UNSIGNED_INT, &planningDomainOptions.asyncPlanningMaxRequestsPerFrame);
 
 	// grid database options
 	gridDatabaseTag->createChildTag("maxItemsPerGridCell", "Max number of items a grid cell can contain", XML_DATA_TYPE_UNSIGNED_INT, &gridDatabaseOptions.maxItemsPerGridCell);
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2009-2015 Glen Berseth, Mubbasir Kapadia, Shawn Singh, Petros Faloutsos, Glenn Reinman
+// See license.txt for complete license.
+//
+
+
+/// @file SpatialDataBaseInterface.cpp
+/// @brief Implements the default queries of the SteerLib::SpatialDataBaseInterface.
+
+#include "interfaces/SpatialDataBaseInterface.h"
+#include "interfaces/AgentInterface.h"
+#include <algorithm>
+
+using namespace SteerLib;
+using namespace Util;
+
+
+void SpatialDataBaseInterface::getKNearestAgents(std::vector<std::pair<float, const AgentInterface *> > & neighbors, const Point & position, unsigned int k, float maxRange, SpatialDatabaseItemPtr exclude)
+{
+	neighbors.clear();
+	if (k == 0) return;
+
+	std::vector<SpatialDatabaseItemPtr> candidates;
+	getItemsInRange(candidates, position.x - maxRange, position.x + maxRange, position.z - maxRange, position.z + maxRange, exclude);
+
+	float rangeSq = maxRange * maxRange;
+	for (unsigned int i=0; i < candidates.size(); i++) {
+		if (!candidates[i]->isAgent()) continue;
+		AgentInterface * agent = dynamic_cast<AgentInterface*>(candidates[i]);
+		if ((agent == NULL) || (!agent->enabled())) continue;
+		insertNearestAgent(neighbors, k, (agent->position() - position).lengthSquared(), agent, rangeSq);
+	}
+}
+
+
+void SpatialDataBaseInterface::computeAllAgentNeighbors(const std::vector<AgentInterface*> & agents, float padding, std::vector< std::vector<SpatialDatabaseItemPtr> > & neighborLists)
+{
+	neighborLists.resize(agents.size());
+
+	// only agents of the given list count as agent neighbors; sorted so they can be found with a binary search.
+	std::vector<SpatialDatabaseItemPtr> enabledAgents;
+	for (unsigned int i=0; i < agents.size(); i++) {
+		if (agents[i]->enabled()) enabledAgents.push_back(agents[i]);
+	}
+	std::sort(enabledAgents.begin(), enabledAgents.end());
+
+	std::vector<SpatialDatabaseItemPtr> candidates;
+	for (unsigned int i=0; i < agents.size(); i++) {
+		std::vector<SpatialDatabaseItemPtr> & neighbors = neighborLists[i];
+		neighbors.clear();
+		AgentInterface * agent = agents[i];
+		if (!agent->enabled()) continue;
+
+		Point position = agent->position();
+		float reach = agent->radius() + padding;
+		getItemsInRange(candidates, position.x - reach, position.x + reach, position.z - reach, position.z + reach, agent);
+
+		for (unsigned int j=0; j < candidates.size(); j++) {
+			if (!candidates[j]->isAgent()) {
+				neighbors.push_back(candidates[j]);
+				continue;
+			}
+			if (!std::binary_search(enabledAgents.begin(), enabledAgents.end(), candidates[j])) continue;
+			AgentInterface * other = dynamic_cast<AgentInterface*>(candidates[j]);
+			float limit = reach + other->radius();
+			if ((other->position() - position).lengthSquared() < limit * limit) {
+				neighbors.push_back(other);
+			}
+		}
+	}
+}
+
+
+void SpatialDataBaseInterface::insertNearestAgent(std::vector<std::pair<float, const AgentInterface *> > & neighbors, unsigned int k, float distSq, const AgentInterface * agent, float & rangeSq)
+{
+	if (distSq >= rangeSq) return;
+
+	// an agent that overlaps several cells or leaves can be offered more than once.
+	for (unsigned int i=0; i < neighbors.size(); i++) {
+		if (neighbors[i].second == agent) return;
+	}
+
+	if (neighbors.size() < k) {
+		neighbors.push_back(std::make_pair(distSq, agent));
+	}
+
+	// insertion sort from the back, dropping the farthest agent if the list was already full.
+	size_t i = neighbors.size() - 1;
+	while ((i != 0) && (distSq < neighbors[i-1].first)) {
+		neighbors[i] = neighbors[i-1];
+		--i;
+	}
+	neighbors[i] = std::make_pair(distSq, agent);
+
+	if (neighbors.size() == k) {
+		rangeSq = neighbors.back().first;
+	}
+}
@@ -130,7 +130,12 @@ void ThreadedTaskManager::waitForAllTasksToComplete()
 
 void ThreadedTaskManager::_runWorkerThread() throw()
 {
+	// the constructor holds the lock until every thread is created, so acquiring it here guarantees
+	// that this thread's handle is already in _threads.
+	_lock();
 	unsigned int threadIndex = _getIndexOfCurrentWorkerThread();
+	_unlock();
+
 	while(true) {
 
 		// acquire the lock
@@ -355,6 +355,10 @@ void initializeOptionsFromCommandLine( int argc, char **argv, SimulationOptions
 	opts.addOption( "-numframes", &simulationOptions.engineOptions.numFramesToSimulate, OPTION_DATA_TYPE_UNSIGNED_INT);
 	opts.addOption( "-numThreads", &simulationOptions.engineOptions.numThreads, OPTION_DATA_TYPE_UNSIGNED_INT);
 	opts.addOption( "-numthreads", &simulationOptions.engineOptions.numThreads, OPTION_DATA_TYPE_UNSIGNED_INT);
+	opts.addOption( "-twoPhaseUpdate", NULL, OPTION_DATA_TYPE_NO_DATA, 0, &simulationOptions.engineOptions.twoPhaseAgentUpdate, true);
+	opts.addOption( "-twophaseupdate", NULL, OPTION_DATA_TYPE_NO_DATA, 0, &simulationOptions.engineOptions.twoPhaseAgentUpdate, true);
+	opts.addOption( "-searchAlgorithm", &simulationOptions.planningDomainOptions.searchAlgorithm, OPTION_DATA_TYPE_STRING);
+	opts.addOption( "-searchalgorithm", &simulationOptions.planningDomainOptions.searchAlgorithm, OPTION_DATA_TYPE_STRING);
 	opts.addOption( "-testCaseSearchPath", &simulationOptions.engineOptions.testCaseSearchPath, OPTION_DATA_TYPE_STRING);
 	opts.addOption( "-testcasesearchpath", &simulationOptions.engineOptions.testCaseSearchPath, OPTION_DATA_TYPE_STRING);
 	opts.addOption( "-testCasePath", &simulationOptions.engineOptions.testCaseSearchPath, OPTION_DATA_TYPE_STRING);
@@ -63,6 +63,80 @@ public:
 	void runTest();
 };
 
+/**
+ * @brief Microbenchmark comparing the GridDatabase2D against the SteerLib::CompactGridLayout.
+ *
+ * For 1k, 10k and 100k agents at a constant density, each simulated frame moves every agent a little,
+ * then times keeping each structure up to date (incremental updates vs. a full rebuild), a range query
+ * around every agent, and a short trace from every agent.  Results of the two structures are compared
+ * on every frame, and the test fails if they disagree.  It also times finding the distance to the nearest
+ * obstacle around every agent, by testing each obstacle and with the SteerLib::ObstacleDistanceField,
+ * and checks that the field is within one sample diagonal of the exact distance, while one obstacle moves every frame.
+ */
+class GridDatabaseBenchmark
+{
+public:
+	GridDatabaseBenchmark() { }
+	~GridDatabaseBenchmark() { }
+	void runTest();
+protected:
+	void _runTestWithNumAgents(unsigned int numAgents);
+	/// Returns the exact signed distance from p to the nearest obstacle among items, or FLT_MAX if there is none.
+	static float _exactObstacleDistance(const std::vector<SteerLib::SpatialDatabaseItemPtr> & items, const Util::Point & p);
+
+	static const unsigned int NUM_FRAMES = 10;
+};
+
+/**
+ * @brief Microbenchmark comparing the grid path planners.
+ *
+ * Plans long paths between random cells of a grid with scattered box obstacles or rows of shelves, using the same SteerLib::GridDatabasePlanningDomain
+ * with the BestFirstSearchPlanner, the SteerLib::IndexedBestFirstSearchPlanner, and jump point search.  Every path is checked to be
+ * connected and traversable.  The test fails if the indexed planner finds a path that costs more than the path of the
+ * BestFirstSearchPlanner, or if jump point search and the indexed planner disagree on the cost of a path.
+ *
+ * SteerLib::GridHierarchicalPlanningDomain (HPA*) plans the same paths; the test reports how much longer its paths are, and
+ * fails if they are shorter than optimal, or if its abstract graph, after being repaired for a new obstacle, plans differently
+ * from one built from scratch.  Paths from every start to a single shared goal are planned with a
+ * SteerLib::GridFlowFieldPlanningDomain, which must find paths as cheap as those of A*.  Finally, some paths are planned
+ * repeatedly, and from their middle, with the SteerLib::GridPathCache enabled, which must hit for all but the first round.
+ * The largest grid is only planned without the BestFirstSearchPlanner, which is too slow for it.
+ */
+class PathPlanningBenchmark
+{
+public:
+	PathPlanningBenchmark() { }
+	~PathPlanningBenchmark() { }
+	void runTest();
+protected:
+	void _runTestWithGridSize(unsigned int numCellsPerSide, bool useShelves, bool useSetPlanner);
+	/// Checks that every step of the path is to a traversable neighbor cell, and returns the cost of the path; the path is emptied.
+	float _checkPath(SteerLib::GridDatabase2D & grid, SteerLib::GridDatabasePlanningDomain & domain, std::stack<unsigned int> & path, unsigned int pathIndex, unsigned long long & numSteps);
+	/// Plans with findPath(), and converts the points back to cells.
+	void _findCellPath(SteerLib::GridDatabase2D & grid, SteerLib::PlanningDomainInterface & domain, unsigned int start, unsigned int goal, std::stack<unsigned int> & path, bool & pathComplete);
+
+	static const unsigned int NUM_PATHS = 200;
+	static const unsigned int DEFAULT_CLUSTER_SIZE = 16;
+};
+
+/**
+ * @brief Engine test for asynchronous long-term planning with the PPR agents.
+ *
+ * Simulates the basic-office test case with pprAI and planningDomainOptions.asyncPlanning enabled, from the default module
+ * and test case search paths.  The agents request their long-term paths from the SteerLib::PathPlanningService in the
+ * first frame, and receive them a few frames later.  The test fails if, until the first path is delivered, an agent calls
+ * the planner synchronously with its final goal, which would plan the same full-length path in the frame that requested it.
+ */
+class AsyncPlanningTest
+{
+public:
+	AsyncPlanningTest() { }
+	~AsyncPlanningTest() { }
+	void runTest();
+protected:
+	static const unsigned int NUM_FRAMES = 20;
+};
+
 /**
  * @brief Unit test for the helper file functions.
  */
@@ -9,8 +9,17 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cfloat>
 
 #include "UnitTest.h"
+#include "modules/DummyAIModule.h"
+#include "mersenne/MersenneTwister.h"
+#include "griddatabase/GridDatabasePlanningDomain.h"
+#include "griddatabase/GridHierarchicalPlanningDomain.h"
+#include "griddatabase/GridFlowFieldPlanningDomain.h"
+#include "griddatabase/GridIncrementalPlanningDomain.h"
+#include "astar/AStarLite.h"
+#include <stdexcept>
 
 using namespace SteerLib;
 using namespace Util;
@@ -38,6 +47,18 @@ void runUnitTest(const std::string & unitTestName)
 		StateMachineTest FSMTest;
 		FSMTest.runTest();
 	}
+	else if (caseInsensitiveTestName == "griddatabase") {
+		GridDatabaseBenchmark gridTest;
+		gridTest.runTest();
+	}
+	else if (caseInsensitiveTestName == "pathplanning") {
+		PathPlanningBenchmark planningTest;
+		planningTest.runTest();
+	}
+	else if (caseInsensitiveTestName == "asyncplanning") {
+		AsyncPlanningTest asyncPlanningTest;
+		asyncPlanningTest.runTest();
+	}
 	else {
 		throw GenericException("Unknown name for unit test, \"" + unitTestName + "\"");
 	}
@@ -312,6 +333,796 @@ void FileUtilTest::runTest()
 }
 
 
+void GridDatabaseBenchmark::runTest()
+{
+	_runTestWithNumAgents(1000);
+	_runTestWithNumAgents(10000);
+	_runTestWithNumAgents(100000);
+}
+
+void GridDatabaseBenchmark::_runTestWithNumAgents(unsigned int numAgents)
+{
+	const float agentRadius = 0.5f;
+	const float queryRadius = 3.0f;
+	const float traceLength = 5.0f;
+
+	// about one agent every 4 square meters, with 1 meter grid cells like the engine's default database.
+	unsigned int numCellsPerSide = (unsigned int)ceilf(sqrtf(4.0f * numAgents));
+	float halfSize = 0.5f * numCellsPerSide;
+	GridDatabase2D grid(-halfSize, halfSize, -halfSize, halfSize, numCellsPerSide, numCellsPerSide, 7, false);
+	CompactGridLayout compact(&grid);
+	MTRand randomNumberGenerator(1);
+
+	std::vector<AgentInterface*> agents;
+	std::vector<Point> positions;
+	std::set<ObstacleInterface*> obstacles;
+
+	AgentInitialConditions initialConditions;
+	initialConditions.direction = Vector(1.0f, 0.0f, 0.0f);
+	initialConditions.radius = agentRadius;
+	initialConditions.speed = 0.0f;
+	AgentGoalInfo goal;
+	goal.goalType = GOAL_TYPE_SEEK_STATIC_TARGET;
+	goal.targetLocation = Point(0.0f, 0.0f, 0.0f);
+	initialConditions.goals.push_back(goal);
+
+	for (unsigned int i=0; i < numAgents; i++) {
+		initialConditions.position = Point((float)randomNumberGenerator.randExc(2.0f*halfSize) - halfSize, 0.0f, (float)randomNumberGenerator.randExc(2.0f*halfSize) - halfSize);
+		AgentInterface * agent = new DummyAgent;
+		agent->reset(initialConditions, NULL);
+		agents.push_back(agent);
+		positions.push_back(initialConditions.position);
+		grid.addObject(agent, AxisAlignedBox(initialConditions.position.x-agentRadius, initialConditions.position.x+agentRadius, 0.0f, 0.0f, initialConditions.position.z-agentRadius, initialConditions.position.z+agentRadius));
+	}
+
+	// a few wall segments, so that traces also test obstacles; the first one moves around every frame.
+	BoxObstacle * movingWall = NULL;
+	for (unsigned int i=0; i < numAgents/50; i++) {
+		float x = (float)randomNumberGenerator.randExc(2.0f*halfSize) - halfSize;
+		float z = (float)randomNumberGenerator.randExc(2.0f*halfSize) - halfSize;
+		BoxObstacle * obstacle = new BoxObstacle(x, x+2.0f, 0.0f, 1.0f, z, z+0.2f);
+		if (movingWall == NULL) movingWall = obstacle;
+		obstacles.insert(obstacle);
+		grid.addObject(obstacle, obstacle->getBounds());
+	}
+	// and some pillars.
+	for (unsigned int i=0; i < numAgents/200; i++) {
+		float x = (float)randomNumberGenerator.randExc(2.0f*halfSize) - halfSize;
+		float z = (float)randomNumberGenerator.randExc(2.0f*halfSize) - halfSize;
+		ObstacleInterface * obstacle = new CircleObstacle(Point(x, 0.0f, z), 0.4f, 0.0f, 1.0f);
+		obstacles.insert(obstacle);
+		grid.addObject(obstacle, obstacle->getBounds());
+	}
+
+	const float distanceFieldSpacing = 0.25f;
+	PerformanceProfiler distanceFieldBuildTime;
+	distanceFieldBuildTime.reset();
+	distanceFieldBuildTime.start();
+	grid.buildObstacleDistanceField(queryRadius, distanceFieldSpacing);
+	distanceFieldBuildTime.stop();
+	const ObstacleDistanceField * distanceField = grid.getObstacleDistanceField();
+
+	PerformanceProfiler gridUpdateTime, compactRebuildTime, gridRangeTime, compactRangeTime, gridTraceTime, compactTraceTime, gridStaticTraceTime, gridLineOfSightTime, exactObstacleDistanceTime, fieldObstacleDistanceTime;
+	gridUpdateTime.reset();
+	compactRebuildTime.reset();
+	gridRangeTime.reset();
+	compactRangeTime.reset();
+	gridTraceTime.reset();
+	compactTraceTime.reset();
+	gridStaticTraceTime.reset();
+	gridLineOfSightTime.reset();
+	exactObstacleDistanceTime.reset();
+	fieldObstacleDistanceTime.reset();
+
+	std::vector<Point> newPositions(numAgents);
+	std::vector<Vector> traceDirections(numAgents);
+	std::vector<SpatialDatabaseItemPtr> gridNeighbors, compactNeighbors;
+	std::vector<SpatialDatabaseItemPtr> gridHits(numAgents), compactHits(numAgents);
+	std::vector<float> gridHitT(numAgents), compactHitT(numAgents);
+	std::vector<float> exactDistances(numAgents), fieldDistances(numAgents);
+	std::vector<char> fieldFoundObstacle(numAgents);
+	unsigned long long totalNeighbors = 0;
+
+	for (unsigned int frame=0; frame < NUM_FRAMES; frame++) {
+
+		// move every agent a little, staying inside the grid.
+		for (unsigned int i=0; i < numAgents; i++) {
+			Point p = positions[i] + Vector((float)randomNumberGenerator.randExc(0.2f) - 0.1f, 0.0f, (float)randomNumberGenerator.randExc(0.2f) - 0.1f);
+			p.x = std::max(-halfSize, std::min(halfSize - 0.01f, p.x));
+			p.z = std::max(-halfSize, std::min(halfSize - 0.01f, p.z));
+			newPositions[i] = p;
+			float angle = (float)randomNumberGenerator.randExc(2.0f*M_PI);
+			traceDirections[i] = Vector(traceLength*cosf(angle), 0.0f, traceLength*sinf(angle));
+		}
+
+		gridUpdateTime.start();
+		for (unsigned int i=0; i < numAgents; i++) {
+			grid.updateObject(agents[i],
+				AxisAlignedBox(positions[i].x-agentRadius, positions[i].x+agentRadius, 0.0f, 0.0f, positions[i].z-agentRadius, positions[i].z+agentRadius),
+				AxisAlignedBox(newPositions[i].x-agentRadius, newPositions[i].x+agentRadius, 0.0f, 0.0f, newPositions[i].z-agentRadius, newPositions[i].z+agentRadius));
+		}
+		gridUpdateTime.stop();
+
+		// the distance field follows obstacles that move.
+		AxisAlignedBox oldWallBounds = movingWall->getBounds();
+		float wallShift = (float)randomNumberGenerator.randExc(2.0f) - 1.0f;
+		grid.removeObject(movingWall, oldWallBounds);
+		movingWall->setBounds(AxisAlignedBox(oldWallBounds.xmin + wallShift, oldWallBounds.xmax + wallShift, oldWallBounds.ymin, oldWallBounds.ymax, oldWallBounds.zmin - wallShift, oldWallBounds.zmax - wallShift));
+		grid.addObject(movingWall, movingWall->getBounds());
+
+		for (unsigned int i=0; i < numAgents; i++) {
+			initialConditions.position = newPositions[i];
+			agents[i]->reset(initialConditions, NULL);
+			positions[i] = newPositions[i];
+		}
+
+		compactRebuildTime.start();
+		compact.rebuild(agents, obstacles);
+		compactRebuildTime.stop();
+
+		// range queries:  time each structure over all agents, then compare the results outside of the timed loops.
+		gridRangeTime.start();
+		for (unsigned int i=0; i < numAgents; i++) {
+			grid.getItemsInRange(gridNeighbors, positions[i].x-queryRadius, positions[i].x+queryRadius, positions[i].z-queryRadius, positions[i].z+queryRadius, agents[i]);
+			totalNeighbors += gridNeighbors.size();
+		}
+		gridRangeTime.stop();
+
+		compactRangeTime.start();
+		for (unsigned int i=0; i < numAgents; i++) {
+			compact.getItemsInRange(compactNeighbors, positions[i].x-queryRadius, positions[i].x+queryRadius, positions[i].z-queryRadius, positions[i].z+queryRadius, agents[i]);
+			totalNeighbors += compactNeighbors.size();
+		}
+		compactRangeTime.stop();
+
+		// the compact layout only returns items that really overlap the range, so check it against the grid's results filtered the same way.
+		for (unsigned int i=0; i < numAgents; i += 97) {
+			grid.getItemsInRange(gridNeighbors, positions[i].x-queryRadius, positions[i].x+queryRadius, positions[i].z-queryRadius, positions[i].z+queryRadius, agents[i]);
+			compact.getItemsInRange(compactNeighbors, positions[i].x-queryRadius, positions[i].x+queryRadius, positions[i].z-queryRadius, positions[i].z+queryRadius, agents[i]);
+			std::vector<SpatialDatabaseItemPtr> expected;
+			for (unsigned int j=0; j < gridNeighbors.size(); j++) {
+				AxisAlignedBox bounds;
+				if (gridNeighbors[j]->isAgent()) {
+					Point p = dynamic_cast<AgentInterface*>(gridNeighbors[j])->position();
+					bounds = AxisAlignedBox(p.x-agentRadius, p.x+agentRadius, 0.0f, 0.0f, p.z-agentRadius, p.z+agentRadius);
+				}
+				else {
+					bounds = dynamic_cast<ObstacleInterface*>(gridNeighbors[j])->getBounds();
+				}
+				if ((bounds.xmin <= positions[i].x+queryRadius) && (bounds.xmax >= positions[i].x-queryRadius)
+					&& (bounds.zmin <= positions[i].z+queryRadius) && (bounds.zmax >= positions[i].z-queryRadius)) {
+					expected.push_back(gridNeighbors[j]);
+				}
+			}
+			std::sort(compactNeighbors.begin(), compactNeighbors.end());
+			if (expected != compactNeighbors) {
+				throw GenericException("FAILED: CompactGridLayout::getItemsInRange() found " + toString(compactNeighbors.size()) + " items, but the GridDatabase2D found " + toString(expected.size()) + ".");
+			}
+		}
+
+		// traces
+		gridTraceTime.start();
+		for (unsigned int i=0; i < numAgents; i++) {
+			Ray r;
+			r.initWithUnitInterval(positions[i], traceDirections[i]);
+			gridHitT[i] = 0.0f;
+			if (!grid.trace(r, gridHitT[i], gridHits[i], agents[i], false)) {
+				gridHits[i] = NULL;
+			}
+		}
+		gridTraceTime.stop();
+
+		compactTraceTime.start();
+		for (unsigned int i=0; i < numAgents; i++) {
+			Ray r;
+			r.initWithUnitInterval(positions[i], traceDirections[i]);
+			compactHitT[i] = 0.0f;
+			if (!compact.trace(r, compactHitT[i], compactHits[i], agents[i], false)) {
+				compactHits[i] = NULL;
+			}
+		}
+		compactTraceTime.stop();
+
+		// two overlapping agents can be hit at the same t, so only the distances have to match.
+		for (unsigned int i=0; i < numAgents; i++) {
+			if (((gridHits[i] == NULL) != (compactHits[i] == NULL)) || ((gridHits[i] != NULL) && (fabsf(gridHitT[i] - compactHitT[i]) > 0.0001f))) {
+				throw GenericException("FAILED: CompactGridLayout::trace() and GridDatabase2D::trace() disagree for agent " + toString(i) + ".");
+			}
+		}
+
+		// traces that ignore agents, and line of sight, where the grid only tests the items of cells that hold obstacles.
+		gridStaticTraceTime.start();
+		for (unsigned int i=0; i < numAgents; i++) {
+			Ray r;
+			r.initWithUnitInterval(positions[i], traceDirections[i]);
+			gridHitT[i] = 0.0f;
+			if (!grid.trace(r, gridHitT[i], gridHits[i], NULL, true)) {
+				gridHits[i] = NULL;
+			}
+		}
+		gridStaticTraceTime.stop();
+
+		std::vector<char> gridLineOfSight(numAgents);
+		gridLineOfSightTime.start();
+		for (unsigned int i=0; i < numAgents; i++) {
+			gridLineOfSight[i] = grid.hasLineOfSight(positions[i], positions[i] + traceDirections[i], agents[i], NULL);
+		}
+		gridLineOfSightTime.stop();
+
+		for (unsigned int i=0; i < numAgents; i++) {
+			Ray r;
+			r.initWithUnitInterval(positions[i], traceDirections[i]);
+			compactHitT[i] = 0.0f;
+			if (!compact.trace(r, compactHitT[i], compactHits[i], NULL, true)) {
+				compactHits[i] = NULL;
+			}
+			if ((gridHits[i] != compactHits[i]) || ((gridHits[i] != NULL) && (fabsf(gridHitT[i] - compactHitT[i]) > 0.0001f))) {
+				throw GenericException("FAILED: CompactGridLayout::trace() and GridDatabase2D::trace() disagree without agents for agent " + toString(i) + ".");
+			}
+			// GridDatabase2D::hasLineOfSight() reports no line of sight when the segment leaves the grid, so only compare segments inside it.
+			Point end = positions[i] + traceDirections[i];
+			bool endInsideGrid = (fabsf(end.x) < halfSize - 1.0f) && (fabsf(end.z) < halfSize - 1.0f);
+			if (endInsideGrid && ((bool)gridLineOfSight[i] != compact.hasLineOfSight(positions[i], end, agents[i], NULL))) {
+				throw GenericException("FAILED: CompactGridLayout::hasLineOfSight() and GridDatabase2D::hasLineOfSight() disagree for agent " + toString(i) + ".");
+			}
+		}
+		// distance to the nearest obstacle:  testing every obstacle in range, like the social forces do, against one field lookup.
+		exactObstacleDistanceTime.start();
+		for (unsigned int i=0; i < numAgents; i++) {
+			grid.getItemsInRange(gridNeighbors, positions[i].x-queryRadius, positions[i].x+queryRadius, positions[i].z-queryRadius, positions[i].z+queryRadius, agents[i]);
+			exactDistances[i] = _exactObstacleDistance(gridNeighbors, positions[i]);
+		}
+		exactObstacleDistanceTime.stop();
+
+		fieldObstacleDistanceTime.start();
+		for (unsigned int i=0; i < numAgents; i++) {
+			Vector awayFromObstacle;
+			fieldFoundObstacle[i] = distanceField->getDistance(positions[i], fieldDistances[i], awayFromObstacle);
+		}
+		fieldObstacleDistanceTime.stop();
+
+		// distances change by at most the distance moved, so interpolating samples one cell diagonal away is off by at most that much.
+		const float tolerance = distanceFieldSpacing * sqrtf(2.0f);
+		for (unsigned int i=0; i < numAgents; i++) {
+			if (exactDistances[i] < queryRadius - tolerance) {
+				if (!fieldFoundObstacle[i] || (fabsf(fieldDistances[i] - exactDistances[i]) > tolerance)) {
+					throw GenericException("FAILED: the obstacle distance field gives " + (fieldFoundObstacle[i] ? toString(fieldDistances[i]) : std::string("no obstacle")) + " for agent " + toString(i) + ", but the nearest obstacle is " + toString(exactDistances[i]) + " away.");
+				}
+			}
+			else if ((exactDistances[i] > queryRadius + tolerance) && fieldFoundObstacle[i]) {
+				throw GenericException("FAILED: the obstacle distance field finds an obstacle " + toString(fieldDistances[i]) + " away from agent " + toString(i) + ", but there is none within " + toString(queryRadius) + ".");
+			}
+		}
+	}
+
+	std::cout << numAgents << " agents, " << obstacles.size() << " obstacles, " << numCellsPerSide << "x" << numCellsPerSide << " cells (" << totalNeighbors << " neighbors found):\n";
+	std::cout << "   avg time per frame to update the grid database:      " << gridUpdateTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per frame to rebuild the compact layout:    " << compactRebuildTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per frame for range queries, grid database: " << gridRangeTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per frame for range queries, compact:       " << compactRangeTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per frame for traces, grid database:        " << gridTraceTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per frame for traces, compact:              " << compactTraceTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per frame for traces ignoring agents, grid: " << gridStaticTraceTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per frame for line of sight, grid database: " << gridLineOfSightTime.getAverageExecutionTime() << "\n";
+	std::cout << "   time to build the obstacle distance field:          " << distanceFieldBuildTime.getTotalTime() << "\n";
+	std::cout << "   avg time per frame for nearest obstacle, per item:   " << exactObstacleDistanceTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per frame for nearest obstacle, field:      " << fieldObstacleDistanceTime.getAverageExecutionTime() << "\n";
+
+	for (unsigned int i=0; i < numAgents; i++) {
+		delete agents[i];
+	}
+	for (std::set<ObstacleInterface*>::iterator iter = obstacles.begin(); iter != obstacles.end(); ++iter) {
+		delete (*iter);
+	}
+}
+
+
+float GridDatabaseBenchmark::_exactObstacleDistance(const std::vector<SpatialDatabaseItemPtr> & items, const Point & p)
+{
+	float nearest = FLT_MAX;
+	for (unsigned int i=0; i < items.size(); i++) {
+		if (items[i]->isAgent()) continue;
+		float distance;
+		CircleObstacle * circle = dynamic_cast<CircleObstacle*>(items[i]);
+		if (circle != NULL) {
+			distance = (p - circle->position()).length() - circle->radius();
+		}
+		else {
+			const AxisAlignedBox & box = dynamic_cast<ObstacleInterface*>(items[i])->getBounds();
+			float outsideX = std::max(box.xmin - p.x, p.x - box.xmax);
+			float outsideZ = std::max(box.zmin - p.z, p.z - box.zmax);
+			if ((outsideX > 0.0f) || (outsideZ > 0.0f)) {
+				distance = sqrtf(std::max(outsideX, 0.0f)*std::max(outsideX, 0.0f) + std::max(outsideZ, 0.0f)*std::max(outsideZ, 0.0f));
+			}
+			else {
+				distance = std::max(outsideX, outsideZ);
+			}
+		}
+		nearest = std::min(nearest, distance);
+	}
+	return nearest;
+}
+
+
+/// Lets AStarLite search a grid planning domain; node ids are cell indices.
+class GridDomainEnvironment : public Environment
+{
+public:
+	GridDomainEnvironment(GridDatabasePlanningDomain & domain) : _domain(domain) { }
+	float getHeuristic(int start, int target) const { return _domain.estimateTotalCost(start, target, 0.0f); }
+	void getSuccessors(int nodeId, int lastNodeId, vector<Successor> & result) const {
+		// AStarLite passes -1 when there is no last node, which is no cell index, so nothing is excluded.
+		_domain.generateTransitions(nodeId, lastNodeId, nodeId, _transitions);
+		result.clear();
+		for (unsigned int i=0; i < _transitions.size(); i++) {
+			result.push_back(Successor(_transitions[i].state, _transitions[i].cost));
+		}
+	}
+	bool isValidNodeId(int nodeId) const { return (nodeId >= 0) && (nodeId < getNumNodes()); }
+	int getNumNodes() const { return (int)_domain.getNumStates(); }
+private:
+	GridDatabasePlanningDomain & _domain;
+	mutable std::vector<DefaultAction<unsigned int> > _transitions;
+};
+
+
+void PathPlanningBenchmark::runTest()
+{
+	_runTestWithGridSize(100, false, true);
+	_runTestWithGridSize(400, false, true);
+	_runTestWithGridSize(400, true, true);
+	// the set-based planner takes too long on the large grid.
+	_runTestWithGridSize(1000, true, false);
+}
+
+float PathPlanningBenchmark::_checkPath(GridDatabase2D & grid, GridDatabasePlanningDomain & domain, std::stack<unsigned int> & path, unsigned int pathIndex, unsigned long long & numSteps)
+{
+	// the plan begins with the start state twice; after that, every step must be to a traversable neighbor cell.
+	float cost = 0.0f;
+	unsigned int previous = path.top();
+	path.pop();
+	while (!path.empty()) {
+		unsigned int current = path.top();
+		path.pop();
+		if (current == previous) {
+			continue;
+		}
+		unsigned int x1, z1, x2, z2;
+		grid.getGridCoordinatesFromIndex(previous, x1, z1);
+		grid.getGridCoordinatesFromIndex(current, x2, z2);
+		int dx = abs((int)x2 - (int)x1);
+		int dz = abs((int)z2 - (int)z1);
+		if ((dx > 1) || (dz > 1) || !domain.canBeTraversed(current)) {
+			throw GenericException("FAILED: path " + toString(pathIndex) + " contains an invalid step.");
+		}
+		cost += grid.getTraversalCost(current) * (((dx == 1) && (dz == 1)) ? sqrtf(2) : 1.0f);
+		numSteps++;
+		previous = current;
+	}
+	return cost;
+}
+
+void PathPlanningBenchmark::_findCellPath(GridDatabase2D & grid, PlanningDomainInterface & domain, unsigned int start, unsigned int goal, std::stack<unsigned int> & path, bool & pathComplete)
+{
+	// only the cells are needed, but the public interface returns points.
+	std::vector<Point> points;
+	Point startPoint, goalPoint;
+	grid.getLocationFromIndex(start, startPoint);
+	grid.getLocationFromIndex(goal, goalPoint);
+	pathComplete = domain.findPath(startPoint, goalPoint, points, INT_MAX);
+	for (unsigned int j=points.size(); j > 0; j--) {
+		path.push(grid.getCellIndexFromLocation(points[j-1]));
+	}
+}
+
+void PathPlanningBenchmark::_runTestWithGridSize(unsigned int numCellsPerSide, bool useShelves, bool useSetPlanner)
+{
+	float halfSize = 0.5f * numCellsPerSide;
+	GridDatabase2D grid(-halfSize, halfSize, -halfSize, halfSize, numCellsPerSide, numCellsPerSide, 7, false);
+	GridDatabasePlanningDomain domain(&grid, NULL);
+	MTRand randomNumberGenerator(1);
+
+	std::vector<ObstacleInterface*> obstacles;
+	if (useShelves) {
+		// a warehouse:  long rows of shelves with open aisles between them, and a few cross aisles.
+		for (float x = -halfSize + 10.0f; x < halfSize - 10.0f; x += 8.0f) {
+			for (float z = -halfSize + 10.0f; z < halfSize - 10.0f; z += 40.0f) {
+				ObstacleInterface * obstacle = new BoxObstacle(x, x + 2.0f, 0.0f, 1.0f, z, z + 34.0f);
+				obstacles.push_back(obstacle);
+				grid.addObject(obstacle, obstacle->getBounds());
+			}
+		}
+	}
+	else {
+		// scattered boxes covering roughly a fifth of the grid.
+		for (unsigned int i=0; i < numCellsPerSide*numCellsPerSide/50; i++) {
+			float x = (float)randomNumberGenerator.randExc(2.0f*halfSize) - halfSize;
+			float z = (float)randomNumberGenerator.randExc(2.0f*halfSize) - halfSize;
+			ObstacleInterface * obstacle = new BoxObstacle(x, x + 1.0f + (float)randomNumberGenerator.randExc(5.0f), 0.0f, 1.0f, z, z + 1.0f + (float)randomNumberGenerator.randExc(5.0f));
+			obstacles.push_back(obstacle);
+			grid.addObject(obstacle, obstacle->getBounds());
+		}
+	}
+
+	// start and goal cells in opposite corners of the grid, so that the paths are long.
+	std::vector<unsigned int> starts, goals;
+	unsigned int quarter = numCellsPerSide / 4;
+	while (starts.size() < NUM_PATHS) {
+		unsigned int start = grid.getCellIndexFromGridCoords(randomNumberGenerator.randInt(quarter-1), randomNumberGenerator.randInt(quarter-1));
+		unsigned int goal = grid.getCellIndexFromGridCoords(numCellsPerSide-1-randomNumberGenerator.randInt(quarter-1), numCellsPerSide-1-randomNumberGenerator.randInt(quarter-1));
+		if (domain.canBeTraversed(start) && domain.canBeTraversed(goal)) {
+			starts.push_back(start);
+			goals.push_back(goal);
+		}
+	}
+
+	BestFirstSearchPlanner<GridDatabasePlanningDomain, unsigned int> setPlanner;
+	IndexedBestFirstSearchPlanner<GridDatabasePlanningDomain> indexedPlanner;
+	setPlanner.init(&domain, INT_MAX);
+	indexedPlanner.init(&domain, INT_MAX);
+
+	// jump point search and HPA* are only available through the domains' public interface.
+	GridDatabasePlanningDomain jumpPointDomain(&grid, NULL);
+	jumpPointDomain.setSearchAlgorithm("jps");
+	GridHierarchicalPlanningDomain hierarchicalDomain(&grid, NULL, DEFAULT_CLUSTER_SIZE);
+	PerformanceProfiler hierarchicalBuildTime;
+	hierarchicalBuildTime.reset();
+	hierarchicalBuildTime.start();
+	hierarchicalDomain.buildAbstractGraph();
+	hierarchicalBuildTime.stop();
+
+	std::vector<float> setCosts(NUM_PATHS), indexedCosts(NUM_PATHS), jumpPointCosts(NUM_PATHS), hierarchicalCosts(NUM_PATHS);
+	std::vector<bool> setComplete(NUM_PATHS), indexedComplete(NUM_PATHS), jumpPointComplete(NUM_PATHS), hierarchicalComplete(NUM_PATHS);
+	unsigned long long totalIndexedPathLength = 0, otherPathLength = 0;
+	PerformanceProfiler setTime, indexedTime, jumpPointTime, hierarchicalTime;
+	setTime.reset();
+	indexedTime.reset();
+	jumpPointTime.reset();
+	hierarchicalTime.reset();
+
+	for (unsigned int i=0; i < NUM_PATHS; i++) {
+		std::stack<unsigned int> setPath, indexedPath, jumpPointPath, hierarchicalPath;
+		bool pathComplete;
+
+		if (useSetPlanner) {
+			setTime.start();
+			setComplete[i] = setPlanner.computePlan(starts[i], goals[i], setPath);
+			setTime.stop();
+		}
+
+		indexedTime.start();
+		indexedComplete[i] = indexedPlanner.computePlan(starts[i], goals[i], indexedPath);
+		indexedTime.stop();
+
+		jumpPointTime.start();
+		_findCellPath(grid, jumpPointDomain, starts[i], goals[i], jumpPointPath, pathComplete);
+		jumpPointTime.stop();
+		jumpPointComplete[i] = pathComplete;
+
+		hierarchicalTime.start();
+		_findCellPath(grid, hierarchicalDomain, starts[i], goals[i], hierarchicalPath, pathComplete);
+		hierarchicalTime.stop();
+		hierarchicalComplete[i] = pathComplete;
+
+		indexedCosts[i] = _checkPath(grid, domain, indexedPath, i, totalIndexedPathLength);
+		setCosts[i] = useSetPlanner ? _checkPath(grid, domain, setPath, i, otherPathLength) : indexedCosts[i];
+		setComplete[i] = useSetPlanner ? setComplete[i] : indexedComplete[i];
+		jumpPointCosts[i] = _checkPath(grid, domain, jumpPointPath, i, otherPathLength);
+		hierarchicalCosts[i] = _checkPath(grid, domain, hierarchicalPath, i, otherPathLength);
+
+		// the set-based planner cannot hold two open nodes with the same f and g, so it may miss the best path, but never finds a better one.
+		if ((indexedComplete[i] != setComplete[i]) || (indexedCosts[i] > setCosts[i] + 0.001f * setCosts[i])) {
+			throw GenericException("FAILED: IndexedBestFirstSearchPlanner found a worse path (" + toString(indexedCosts[i]) + ") than BestFirstSearchPlanner (" + toString(setCosts[i]) + ") for path " + toString(i) + ".");
+		}
+		if ((jumpPointComplete[i] != indexedComplete[i]) || (fabsf(jumpPointCosts[i] - indexedCosts[i]) > 0.001f * indexedCosts[i])) {
+			throw GenericException("FAILED: jump point search found a path of cost " + toString(jumpPointCosts[i]) + ", but A* found one of cost " + toString(indexedCosts[i]) + " for path " + toString(i) + ".");
+		}
+		// HPA* paths may be longer, but never shorter than optimal.
+		if ((hierarchicalComplete[i] != indexedComplete[i]) || (hierarchicalCosts[i] < indexedCosts[i] - 0.001f * indexedCosts[i])) {
+			throw GenericException("FAILED: HPA* found a path of cost " + toString(hierarchicalCosts[i]) + ", but A* found one of cost " + toString(indexedCosts[i]) + " for path " + toString(i) + ".");
+		}
+	}
+
+	unsigned int numCheaperPaths = 0, numCompletePaths = 0;
+	float totalHierarchicalRatio = 0.0f, maxHierarchicalRatio = 0.0f;
+	for (unsigned int i=0; i < NUM_PATHS; i++) {
+		if (indexedCosts[i] < setCosts[i] - 0.001f * setCosts[i]) {
+			numCheaperPaths++;
+		}
+		if (indexedComplete[i] && (indexedCosts[i] > 0.0f)) {
+			float ratio = hierarchicalCosts[i] / indexedCosts[i];
+			totalHierarchicalRatio += ratio;
+			maxHierarchicalRatio = std::max(maxHierarchicalRatio, ratio);
+			numCompletePaths++;
+		}
+	}
+
+	// repair:  wall off the middle of the grid, and check that the repaired graph plans as well as one built from scratch.
+	BoxObstacle wall(-0.25f * halfSize, 0.25f * halfSize, 0.0f, 1.0f, -2.0f, 2.0f);
+	PerformanceProfiler repairTime;
+	repairTime.reset();
+	repairTime.start();
+	hierarchicalDomain.addObstacle(&wall);
+	repairTime.stop();
+	GridHierarchicalPlanningDomain rebuiltDomain(&grid, NULL, DEFAULT_CLUSTER_SIZE);
+	rebuiltDomain.buildAbstractGraph();
+	for (unsigned int i=0; i < NUM_PATHS; i += 10) {
+		std::stack<unsigned int> repairedPath, rebuiltPath;
+		bool repairedComplete, rebuiltComplete;
+		_findCellPath(grid, hierarchicalDomain, starts[i], goals[i], repairedPath, repairedComplete);
+		_findCellPath(grid, rebuiltDomain, starts[i], goals[i], rebuiltPath, rebuiltComplete);
+		float repairedCost = _checkPath(grid, domain, repairedPath, i, otherPathLength);
+		float rebuiltCost = _checkPath(grid, domain, rebuiltPath, i, otherPathLength);
+		if ((repairedComplete != rebuiltComplete) || (fabsf(repairedCost - rebuiltCost) > 0.001f * rebuiltCost)) {
+			throw GenericException("FAILED: after adding an obstacle, HPA* found a path of cost " + toString(repairedCost) + ", but a rebuilt abstract graph found one of cost " + toString(rebuiltCost) + " for path " + toString(i) + ".");
+		}
+	}
+	hierarchicalDomain.removeObstacle(&wall);
+
+	// a shared goal, as in an evacuation:  the flow field is computed by the first path, and followed by all others.
+	GridFlowFieldPlanningDomain flowFieldDomain(&grid, NULL, 1);
+	PerformanceProfiler sharedGoalIndexedTime, flowFieldTime;
+	sharedGoalIndexedTime.reset();
+	flowFieldTime.reset();
+	for (unsigned int i=0; i < NUM_PATHS; i++) {
+		std::stack<unsigned int> flowFieldPath;
+		bool flowFieldComplete;
+		flowFieldTime.start();
+		_findCellPath(grid, flowFieldDomain, starts[i], goals[0], flowFieldPath, flowFieldComplete);
+		flowFieldTime.stop();
+		float flowFieldCost = _checkPath(grid, domain, flowFieldPath, i, otherPathLength);
+
+		// A* is too slow to compare every path.
+		if ((i % 10) == 0) {
+			std::stack<unsigned int> sharedGoalPath;
+			sharedGoalIndexedTime.start();
+			bool sharedGoalComplete = indexedPlanner.computePlan(starts[i], goals[0], sharedGoalPath);
+			sharedGoalIndexedTime.stop();
+			float sharedGoalCost = _checkPath(grid, domain, sharedGoalPath, i, otherPathLength);
+			if ((flowFieldComplete != sharedGoalComplete) || (fabsf(flowFieldCost - sharedGoalCost) > 0.001f * sharedGoalCost)) {
+				throw GenericException("FAILED: the flow field found a path of cost " + toString(flowFieldCost) + ", but A* found one of cost " + toString(sharedGoalCost) + " for path " + toString(i) + " to the shared goal.");
+			}
+		}
+	}
+
+	// the path cache:  plan some of the paths twice, and then from the middle of each path; only the first round should miss.
+	GridDatabasePlanningDomain cachedDomain(&grid, NULL);
+	cachedDomain.setPathCacheSize(NUM_PATHS);
+	PerformanceProfiler cacheMissTime, cacheHitTime;
+	cacheMissTime.reset();
+	cacheHitTime.reset();
+	std::vector<unsigned int> middleCells(NUM_PATHS);
+	unsigned int numCachedPaths = 0;
+	for (unsigned int round=0; round < 3; round++) {
+		for (unsigned int i=0; i < NUM_PATHS; i += 10) {
+			if (!indexedComplete[i]) {
+				continue;
+			}
+			std::stack<unsigned int> cachedPath;
+			bool cachedComplete;
+			PerformanceProfiler & time = (round == 0) ? cacheMissTime : cacheHitTime;
+			time.start();
+			_findCellPath(grid, cachedDomain, (round == 2) ? middleCells[i] : starts[i], goals[i], cachedPath, cachedComplete);
+			time.stop();
+			if (round == 0) {
+				std::stack<unsigned int> pathCopy(cachedPath);
+				for (unsigned int j = (unsigned int)pathCopy.size() / 2; j > 0; j--) {
+					pathCopy.pop();
+				}
+				middleCells[i] = pathCopy.top();
+				numCachedPaths++;
+			}
+			float cachedCost = _checkPath(grid, domain, cachedPath, i, otherPathLength);
+			if (!cachedComplete || ((round < 2) && (fabsf(cachedCost - indexedCosts[i]) > 0.001f * indexedCosts[i]))) {
+				throw GenericException("FAILED: the path cache returned a path of cost " + toString(cachedCost) + ", but A* found one of cost " + toString(indexedCosts[i]) + " for path " + toString(i) + ".");
+			}
+		}
+	}
+	if ((cachedDomain.getPathCache().getNumHits() != 2 * numCachedPaths) || (cachedDomain.getPathCache().getNumMisses() != numCachedPaths)) {
+		throw GenericException("FAILED: the path cache had " + toString(cachedDomain.getPathCache().getNumHits()) + " hits and " + toString(cachedDomain.getPathCache().getNumMisses()) + " misses, expected " + toString(2 * numCachedPaths) + " and " + toString(numCachedPaths) + ".");
+	}
+	// a new obstacle must invalidate every cached path.
+	cachedDomain.addObstacle(&wall);
+	for (unsigned int i=0; i < NUM_PATHS; i += 10) {
+		std::stack<unsigned int> cachedPath;
+		bool cachedComplete;
+		_findCellPath(grid, cachedDomain, starts[i], goals[i], cachedPath, cachedComplete);
+		_checkPath(grid, domain, cachedPath, i, otherPathLength);
+	}
+	cachedDomain.removeObstacle(&wall);
+	if (cachedDomain.getPathCache().getNumHits() != 2 * numCachedPaths) {
+		throw GenericException("FAILED: the path cache returned paths that were planned before an obstacle was added.");
+	}
+
+	// incremental replanning, as for a door that closes and opens again:  the D* Lite search to the shared goal is repaired
+	// around the wall, and must then plan as well as A* from scratch.
+	GridIncrementalPlanningDomain incrementalDomain(&grid, NULL, 1);
+	PerformanceProfiler incrementalTime[3], replanIndexedTime;
+	replanIndexedTime.reset();
+	for (unsigned int round=0; round < 3; round++) {
+		incrementalTime[round].reset();
+		if (round == 1) {
+			incrementalDomain.addObstacle(&wall);
+		}
+		else if (round == 2) {
+			incrementalDomain.removeObstacle(&wall);
+		}
+		for (unsigned int i=0; i < NUM_PATHS; i += 10) {
+			std::stack<unsigned int> incrementalPath, replanPath;
+			bool incrementalComplete;
+			incrementalTime[round].start();
+			_findCellPath(grid, incrementalDomain, starts[i], goals[0], incrementalPath, incrementalComplete);
+			incrementalTime[round].stop();
+			replanIndexedTime.start();
+			bool replanComplete = indexedPlanner.computePlan(starts[i], goals[0], replanPath);
+			replanIndexedTime.stop();
+			float incrementalCost = _checkPath(grid, domain, incrementalPath, i, otherPathLength);
+			float replanCost = _checkPath(grid, domain, replanPath, i, otherPathLength);
+			if ((incrementalComplete != replanComplete) || (fabsf(incrementalCost - replanCost) > 0.001f * replanCost)) {
+				throw GenericException("FAILED: D* Lite found a path of cost " + toString(incrementalCost) + ", but A* found one of cost " + toString(replanCost) + " for path " + toString(i) + " to the shared goal, in round " + toString(round) + ".");
+			}
+		}
+	}
+
+	// AStarLite, the search in util that other environments use, on the same grid:  it must find paths as cheap as A*'s.
+	GridDomainEnvironment environment(domain);
+	AStarLite aStarLite;
+	PerformanceProfiler aStarLiteTime;
+	aStarLiteTime.reset();
+	for (unsigned int i=0; i < NUM_PATHS; i++) {
+		aStarLiteTime.start();
+		aStarLite.findPath(environment, starts[i], goals[i]);
+		aStarLiteTime.stop();
+		// the path runs from the goal back to the start, or from the node closest to the goal if there is no complete path.
+		const std::vector<int> & cells = aStarLite.getPath();
+		bool aStarLiteComplete = (cells.front() == (int)goals[i]);
+		std::stack<unsigned int> aStarLitePath;
+		for (unsigned int j=0; j < cells.size(); j++) {
+			aStarLitePath.push(cells[j]);
+		}
+		float aStarLiteCost = _checkPath(grid, domain, aStarLitePath, i, otherPathLength);
+		if ((aStarLiteComplete != indexedComplete[i]) || (aStarLiteComplete && (fabsf(aStarLiteCost - indexedCosts[i]) > 0.001f * indexedCosts[i]))) {
+			throw GenericException("FAILED: AStarLite found a path of cost " + toString(aStarLiteCost) + ", but A* found one of cost " + toString(indexedCosts[i]) + " for path " + toString(i) + ".");
+		}
+	}
+	// node ids outside the environment must be rejected, not used to index the search's arrays.
+	bool rejectedInvalidNode = false;
+	try {
+		aStarLite.findPath(environment, starts[0], environment.getNumNodes());
+	}
+	catch (std::out_of_range &) {
+		rejectedInvalidNode = true;
+	}
+	if (!rejectedInvalidNode) {
+		throw GenericException("FAILED: AStarLite accepted a node id outside the environment.");
+	}
+
+	std::cout << numCellsPerSide << "x" << numCellsPerSide << " cells, " << obstacles.size() << " obstacles, " << NUM_PATHS << " paths (" << totalIndexedPathLength << " steps in total):\n";
+	if (useSetPlanner) {
+		std::cout << "   avg time per path, BestFirstSearchPlanner:        " << setTime.getAverageExecutionTime() << "\n";
+	}
+	std::cout << "   avg time per path, IndexedBestFirstSearchPlanner: " << indexedTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per path, jump point search:             " << jumpPointTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per path, HPA*:                          " << hierarchicalTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per path, AStarLite:                     " << aStarLiteTime.getAverageExecutionTime() << "\n";
+	if (useSetPlanner) {
+		std::cout << "   paths that the indexed planner found cheaper:     " << numCheaperPaths << "\n";
+	}
+	std::cout << "   HPA* path cost / optimal cost, avg and max:       " << totalHierarchicalRatio / std::max(numCompletePaths, 1u) << ", " << maxHierarchicalRatio << "\n";
+	std::cout << "   HPA* abstract graph (" << hierarchicalDomain.getNumAbstractNodes() << " nodes), build time:  " << hierarchicalBuildTime.getTotalTime() << "\n";
+	std::cout << "   HPA* repair time for one obstacle:                " << repairTime.getTotalTime() << "\n";
+	std::cout << "   avg time per path to a shared goal, indexed A*:   " << sharedGoalIndexedTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per path, path cache miss / hit:         " << cacheMissTime.getAverageExecutionTime() << " / " << cacheHitTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per path to a shared goal, flow field:   " << flowFieldTime.getAverageExecutionTime() << " (" << flowFieldTime.getMaxExecutionTime() << " for the first)\n";
+	std::cout << "   avg time per replanned path, A* from scratch:     " << replanIndexedTime.getAverageExecutionTime() << "\n";
+	std::cout << "   avg time per path, D* Lite (first / wall added / removed): " << incrementalTime[0].getAverageExecutionTime() << " / " << incrementalTime[1].getAverageExecutionTime() << " / " << incrementalTime[2].getAverageExecutionTime() << "\n";
+
+	for (unsigned int i=0; i < obstacles.size(); i++) {
+		delete obstacles[i];
+	}
+}
+
+
+/// Forwards queries to the engine's planner, and records the end point of every findPath() and findSmoothPath().
+class RecordingPlanningDomain : public PlanningDomainInterface
+{
+public:
+	RecordingPlanningDomain() : _planner(NULL) { }
+	void setPlanner(PlanningDomainInterface * planner) { _planner = planner; }
+	bool findPath(Point & startPosition, Point & endPosition, std::vector<Point> & path, unsigned int maxNodes) {
+		endPositions.push_back(endPosition);
+		return _planner->findPath(startPosition, endPosition, path, maxNodes);
+	}
+	bool findSmoothPath(Point & startPosition, Point & endPosition, std::vector<Point> & path, unsigned int maxNodes) {
+		endPositions.push_back(endPosition);
+		return _planner->findSmoothPath(startPosition, endPosition, path, maxNodes);
+	}
+	bool refresh() { return _planner->refresh(); }
+	void draw() { _planner->draw(); }
+	void addObstacle(ObstacleInterface * obstacle) { _planner->addObstacle(obstacle); }
+	void removeObstacle(ObstacleInterface * obstacle) { _planner->removeObstacle(obstacle); }
+
+	std::vector<Point> endPositions;
+protected:
+	PlanningDomainInterface * _planner;
+};
+
+/// Hands the agents a RecordingPlanningDomain; the PathPlanningService keeps planning with the engine's own planner, so its queries are not recorded.
+class PlanningRecordingEngine : public SimulationEngine
+{
+public:
+	PlanningDomainInterface * getPathPlanner() {
+		recordingPlanner.setPlanner(SimulationEngine::getPathPlanner());
+		return &recordingPlanner;
+	}
+	RecordingPlanningDomain recordingPlanner;
+};
+
+
+void AsyncPlanningTest::runTest()
+{
+	SimulationOptions options;
+	options.engineOptions.startupModules.insert("testCasePlayer");
+	options.engineOptions.numFramesToSimulate = NUM_FRAMES;
+	options.engineOptions.clockMode = "fixed-fast";
+	// one engine thread, so that the recording planner is not used by several agents at once.
+	options.engineOptions.numThreads = 1;
+	options.planningDomainOptions.asyncPlanning = true;
+	options.planningDomainOptions.asyncPlanningThreads = 2;
+	options.mergeModuleOptions("testCasePlayer", "ai=pprAI,testcase=basic-office");
+
+	PlanningRecordingEngine engine;
+	engine.init(&options, NULL);
+	engine.initializeSimulation();
+	engine.preprocessSimulation();
+
+	PathPlanningService * service = engine.getPathPlanningService();
+	if (service == NULL) {
+		throw GenericException("FAILED: the engine did not create a PathPlanningService with asyncPlanning enabled.");
+	}
+
+	unsigned int numFramesWithoutPaths = 0;
+	unsigned int numQueriesWithoutPaths = 0;
+	bool moreFrames = true;
+	while (moreFrames) {
+		bool pathsDelivered = (service->getNumDeliveredPaths() > 0);
+		engine.recordingPlanner.endPositions.clear();
+		moreFrames = engine.update(false);
+		if (pathsDelivered) {
+			continue;
+		}
+
+		// no agent has received a long-term path yet, so all of them are waiting for the request made in the first frame.
+		if (service->getNumDeliveredPaths() == 0 && service->getNumOutstandingRequests() == 0) {
+			throw GenericException("FAILED: the PPR agents did not request their long-term paths from the PathPlanningService.");
+		}
+		const std::vector<AgentInterface*> & agents = engine.getAgents();
+		for (unsigned int i=0; i < engine.recordingPlanner.endPositions.size(); i++) {
+			for (unsigned int j=0; j < agents.size(); j++) {
+				if (agents[j]->enabled() && (engine.recordingPlanner.endPositions[i] == agents[j]->currentGoal().targetLocation)) {
+					throw GenericException("FAILED: a PPR agent planned a path to its final goal while its long-term request was pending.");
+				}
+			}
+		}
+		numFramesWithoutPaths++;
+		numQueriesWithoutPaths += engine.recordingPlanner.endPositions.size();
+	}
+
+	if (service->getNumDeliveredPaths() == 0) {
+		throw GenericException("FAILED: no long-term path was delivered during the simulation.");
+	}
+
+	std::cout << "basic-office with pprAI, " << NUM_FRAMES << " frames:\n";
+	std::cout << "   frames before the first long-term path arrived:   " << numFramesWithoutPaths << "\n";
+	std::cout << "   synchronous planner queries in those frames:      " << numQueriesWithoutPaths << "\n";
+	std::cout << "   long-term paths delivered:                        " << service->getNumDeliveredPaths() << "\n";
+
+	engine.postprocessSimulation();
+	engine.cleanupSimulation();
+	engine.finish();
+}
+
+
 void StateMachineTest::runTest()
 {
 	std::cout << "Test 1: correct usage, no simulation loaded...\n";
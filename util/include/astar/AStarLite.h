@@ -31,6 +31,14 @@ private:
 
     static const int NO_NODE = -1;
 
+	/// Throws std::out_of_range if nodeId is negative, or not below numNodes when numNodes is known (non-zero).
+	static void checkNodeId(int nodeId, int numNodes);
+
 	vector<int> m_path;
 
+	// kept between calls to findPath(), so that repeated searches do not allocate
+	AStarLiteOpen m_openList;
+	AStarLiteClose m_closedList;
+	vector<Environment::Successor> m_successors;
+
 };
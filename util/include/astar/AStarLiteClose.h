@@ -7,11 +7,15 @@
 
 #include "astar/AStarLiteNode.h"
 
-#include <map>
 #include <vector>
 #include <cassert>
 #include <stdlib.h> // For definition of NULL
 
+/**
+ * The closed list of AStarLite:  the nodes are stored in an array indexed by node id, next to a flag for each id.
+ * Node ids must not be negative.  Like AStarLiteOpen, the arrays grow as needed and are kept by clear(), which only
+ * resets the ids that were closed.
+ */
 class AStarLiteClose
 {
 public:
@@ -19,6 +23,7 @@ public:
 	~AStarLiteClose();
 
 	void clear();
+	void reserve(int numNodes);
 	bool insert(const AStarLiteNode& node);
 	bool isEmpty() const;
 	int size() const;
@@ -28,8 +33,11 @@ public:
 	std::vector<int> constructPath(int start, int target);
 
 private:
-	typedef std::map<int,AStarLiteNode> NodeMap;
-	typedef NodeMap::iterator NodeMapIter;
+	void grow(int nodeId);
 
-	NodeMap m_nodeMap;
+	std::vector<AStarLiteNode> m_nodes;
+	std::vector<char> m_isClosed;
+	/// Every id closed since the last clear(), including removed ones; only these flags can be set.
+	std::vector<int> m_closedIds;
+	int m_size;
 };
@@ -7,9 +7,18 @@
 
 #include "astar/AStarLiteNode.h"
 
-#include <set>
-#include <map>
+#include <vector>
+#include <cassert>
+#include <stdlib.h> // For definition of NULL
 
+/**
+ * The open list of AStarLite:  a 4-ary heap of node ids, with the nodes and their heap positions stored in arrays
+ * indexed by node id.  Node ids must not be negative.  The arrays grow as needed and are kept by clear(), so a list
+ * that is re-used for many searches stops allocating memory; reserve() sizes them up front.
+ *
+ * Nodes come out in the same order as from a std::multiset with AStarLiteNode::Compare:  lowest f first, then highest
+ * g, then the node inserted first.
+ */
 class AStarLiteOpen
 {
 public:
@@ -17,6 +26,7 @@ public:
 	~AStarLiteOpen();
 
 	void clear();
+	void reserve(int numNodes);
 	bool insert(const AStarLiteNode& node);
 	bool isEmpty() const;
 	int size() const;
@@ -26,12 +36,33 @@ public:
 	const AStarLiteNode* search(int nodeId);
 
 private:
-	typedef std::multiset<AStarLiteNode, AStarLiteNode::Compare> NodeSet;
-	typedef NodeSet::iterator NodeSetIter;
+	static const int ARITY = 4;
+	static const int NOT_OPEN = -1;
 
-	typedef std::map<int,NodeSetIter> NodeMap;
-	typedef NodeMap::iterator NodeMapIter;
+	/// The sort key is copied into the heap, so that sifting does not touch the node array.
+	struct HeapEntry {
+		float f;
+		float g;
+		unsigned int order;
+		int nodeId;
+	};
 
-	NodeSet m_openSet;
-	NodeMap m_nodeMap;
+	inline static bool isBefore(const HeapEntry& entry1, const HeapEntry& entry2) {
+		if (entry1.f != entry2.f)
+			return (entry1.f < entry2.f);
+		if (entry1.g != entry2.g)
+			return (entry1.g > entry2.g);
+		return (entry1.order < entry2.order);
+	}
+
+	void grow(int nodeId);
+	void place(const HeapEntry& entry, int heapIndex);
+	void siftUp(int heapIndex);
+	void siftDown(int heapIndex);
+	void removeAt(int heapIndex);
+
+	std::vector<HeapEntry> m_heap;
+	std::vector<AStarLiteNode> m_nodes;
+	std::vector<int> m_heapIndex;
+	unsigned int m_nextOrder;
 };
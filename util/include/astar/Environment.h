@@ -17,7 +17,10 @@
 
 using namespace std;
 
-/** Interface to search environment. */
+/** Interface to search environment.
+Node ids must be dense and non-negative: AStarLite indexes flat arrays
+by node id, so their size follows the largest id it sees.
+*/
 class Environment
 {
 public:
@@ -54,6 +57,14 @@ public:
 		vector<Successor>& result) const = 0;
 
 	virtual bool isValidNodeId(int nodeId) const = 0;
+
+	/** Number of node ids; every id must be in [0, getNumNodes()).
+	Searches use it to size their arrays up front, and throw
+	std::out_of_range for ids outside it.
+	The default of 0 means unknown: the arrays then grow as ids are seen,
+	and only negative ids are rejected.
+	*/
+	virtual int getNumNodes() const { return 0; }
 };
 
 #endif
@@ -5,6 +5,8 @@
 
 #include "astar/AStarLite.h"
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 
 AStarLite::AStarLite()
 {
@@ -18,18 +20,23 @@ AStarLite::~AStarLite()
 bool AStarLite::findPath(const Environment& env, int start, int target)
 {
 	// input sanitize
+	int numNodes = env.getNumNodes();
+	checkNodeId(start, numNodes);
+	checkNodeId(target, numNodes);
 	assert(env.isValidNodeId(start));
 	assert(env.isValidNodeId(target));
 
-	// open and close lists
-	AStarLiteOpen openList;
-	AStarLiteClose closedList;
+	// open and close lists, re-used from the previous search
+	AStarLiteOpen& openList = m_openList;
+	AStarLiteClose& closedList = m_closedList;
+	vector<Environment::Successor>& successors = m_successors;
 
 	// initialize search
 	openList.clear();
 	closedList.clear();
+	openList.reserve(numNodes);
+	closedList.reserve(numNodes);
 	float heuristic = env.getHeuristic(start, target);
-	vector<Environment::Successor> successors;
 
 	// create start node
 	AStarLiteNode startNode(start, NO_NODE, 0, heuristic);
@@ -62,6 +69,7 @@ bool AStarLite::findPath(const Environment& env, int start, int target)
 			// successorId: the successor's id
 			float successorg = node.m_g + i->m_cost;
 			int successorId = i->m_target;
+			checkNodeId(successorId, numNodes);
 
 			// check if successor is in the open or closed lists
 			// if it is, and the new successor g is better than the old one, remove it from the open or closed list
@@ -109,6 +117,19 @@ bool AStarLite::findPath(const Environment& env, int start, int target)
 }
 
 
+void AStarLite::checkNodeId(int nodeId, int numNodes)
+{
+	if ((nodeId < 0) || ((numNodes > 0) && (nodeId >= numNodes)))
+	{
+		std::ostringstream message;
+		message << "AStarLite: node id " << nodeId << " is outside the environment's dense node ids";
+		if (numNodes > 0)
+			message << " [0, " << numNodes << ")";
+		throw std::out_of_range(message.str());
+	}
+}
+
+
 const vector<int>& AStarLite::getPath() const
 {
 	return m_path;
@@ -7,7 +7,7 @@
 
 AStarLiteClose::AStarLiteClose()
 {
-	clear();
+	m_size = 0;
 }
 
 AStarLiteClose::~AStarLiteClose()
@@ -16,19 +16,44 @@ AStarLiteClose::~AStarLiteClose()
 
 void AStarLiteClose::clear()
 {
-	m_nodeMap.clear();
+	for (unsigned int i = 0; i < m_closedIds.size(); i++)
+		m_isClosed[m_closedIds[i]] = false;
+	m_closedIds.clear();
+	m_size = 0;
+}
+
+void AStarLiteClose::reserve(int numNodes)
+{
+	if (numNodes > (int)m_isClosed.size())
+	{
+		m_nodes.resize(numNodes);
+		m_isClosed.resize(numNodes, false);
+	}
+}
+
+void AStarLiteClose::grow(int nodeId)
+{
+	int numNodes = (int)m_isClosed.size();
+	reserve((nodeId >= 2 * numNodes) ? nodeId + 1 : 2 * numNodes);
 }
 
 bool AStarLiteClose::insert(const AStarLiteNode& node)
 {
 	int nodeId = node.m_id;
+	assert(nodeId >= 0);
+
+	if (nodeId >= (int)m_isClosed.size())
+		grow(nodeId);
 
 	// check for duplicate insertion
-	if(hasNode(nodeId))
+	if (m_isClosed[nodeId])
 		return false;
 
 	// insert node
-	m_nodeMap[nodeId] = node;
+	m_nodes[nodeId] = node;
+	m_isClosed[nodeId] = true;
+	m_closedIds.push_back(nodeId);
+	m_size++;
 	return true;
 }
 
@@ -39,40 +64,35 @@ bool AStarLiteClose::isEmpty() const
 
 int AStarLiteClose::size() const
 {
-	return (int)m_nodeMap.size();
+	return m_size;
 }
 
 bool AStarLiteClose::hasNode(int nodeId)
 {
-	return (m_nodeMap.find(nodeId) != m_nodeMap.end());
+	return (nodeId >= 0) && (nodeId < (int)m_isClosed.size()) && m_isClosed[nodeId];
 }
 
 bool AStarLiteClose::remove(int nodeId)
 {
-	// get node
-	NodeMapIter nodeInfo = m_nodeMap.find(nodeId);
-
 	// check if node exists
-	if(nodeInfo == m_nodeMap.end())
+	if (!hasNode(nodeId))
 		return false;
 
-	// remove the node
-	m_nodeMap.erase(nodeInfo);
+	// remove the node; its id stays in m_closedIds, which is harmless
+	m_isClosed[nodeId] = false;
+	m_size--;
 
 	return true;
 }
 
 const AStarLiteNode* AStarLiteClose::search(int nodeId)
 {
-	// get node
-	NodeMapIter nodeInfo = m_nodeMap.find(nodeId);
-
 	// check if node exists
-	if(nodeInfo == m_nodeMap.end())
+	if (!hasNode(nodeId))
 		return NULL;
 
 	// return node
-	return &(nodeInfo->second);
+	return &m_nodes[nodeId];
 }
 
 vector<int> AStarLiteClose::constructPath(int start, int target)
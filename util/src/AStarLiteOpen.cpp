@@ -5,9 +5,11 @@
 
 #include "astar/AStarLiteOpen.h"
 
+const int AStarLiteOpen::NOT_OPEN;
+
 AStarLiteOpen::AStarLiteOpen()
 {
-	clear();
+	m_nextOrder = 0;
 }
 
 AStarLiteOpen::~AStarLiteOpen()
@@ -16,33 +18,62 @@ AStarLiteOpen::~AStarLiteOpen()
 
 void AStarLiteOpen::clear()
 {
-	m_openSet.clear();
-	m_nodeMap.clear();
+	// only the nodes still on the heap have a heap position to forget
+	for (unsigned int i = 0; i < m_heap.size(); i++)
+		m_heapIndex[m_heap[i].nodeId] = NOT_OPEN;
+	m_heap.clear();
+	m_nextOrder = 0;
+}
+
+void AStarLiteOpen::reserve(int numNodes)
+{
+	if (numNodes > (int)m_heapIndex.size())
+	{
+		m_nodes.resize(numNodes);
+		m_heapIndex.resize(numNodes, NOT_OPEN);
+	}
+}
+
+void AStarLiteOpen::grow(int nodeId)
+{
+	int numNodes = (int)m_heapIndex.size();
+	reserve((nodeId >= 2 * numNodes) ? nodeId + 1 : 2 * numNodes);
 }
 
 bool AStarLiteOpen::insert(const AStarLiteNode& node)
 {
 	int nodeId = node.m_id;
+	assert(nodeId >= 0);
+
+	if (nodeId >= (int)m_heapIndex.size())
+		grow(nodeId);
 
 	// can't have multiple nodes with same id
-	if(hasNode(nodeId))
+	if (m_heapIndex[nodeId] != NOT_OPEN)
 		return false;
 
 	// insert
-	NodeSetIter nodeIter = m_openSet.insert(node);
-	m_nodeMap[nodeId] = nodeIter;
+	m_nodes[nodeId] = node;
+	HeapEntry entry;
+	entry.f = node.m_f;
+	entry.g = node.m_g;
+	entry.order = m_nextOrder++;
+	entry.nodeId = nodeId;
+	m_heap.push_back(entry);
+	m_heapIndex[nodeId] = (int)m_heap.size() - 1;
+	siftUp((int)m_heap.size() - 1);
 
 	return true;
 }
 
 bool AStarLiteOpen::isEmpty() const
 {
-	return (size() == 0);
+	return m_heap.empty();
 }
 
 int AStarLiteOpen::size() const
 {
-	return (int)m_openSet.size();
+	return (int)m_heap.size();
 }
 
 AStarLiteNode AStarLiteOpen::pop()
@@ -50,44 +81,94 @@ AStarLiteNode AStarLiteOpen::pop()
 	// can't pop if there's nothing to pop
 	assert(!isEmpty());
 
-	// pop top of stack
-	AStarLiteNode node = *(m_openSet.begin());
-	m_openSet.erase(m_openSet.begin());
-	m_nodeMap.erase(node.m_id);
-
-	return node;
+	// pop top of heap
+	int nodeId = m_heap[0].nodeId;
+	removeAt(0);
+	return m_nodes[nodeId];
 }
 
 bool AStarLiteOpen::hasNode(int nodeId)
 {
-	return (m_nodeMap.find(nodeId) != m_nodeMap.end());
+	return (nodeId >= 0) && (nodeId < (int)m_heapIndex.size()) && (m_heapIndex[nodeId] != NOT_OPEN);
 }
 
 bool AStarLiteOpen::remove(int nodeId)
 {
-	// find node
-	NodeMapIter nodeInfo = m_nodeMap.find(nodeId);
-
 	// if node not found, return false
-	if(nodeInfo == m_nodeMap.end())
+	if (!hasNode(nodeId))
 		return false;
 
-	// clear out node
-	m_openSet.erase(nodeInfo->second);
-	m_nodeMap.erase(nodeInfo);
-
+	removeAt(m_heapIndex[nodeId]);
 	return true;
 }
 
 const AStarLiteNode* AStarLiteOpen::search(int nodeId)
 {
-	// find node
-	NodeMapIter nodeInfo = m_nodeMap.find(nodeId);
-
 	// if node not found, return NULL
-	if(nodeInfo == m_nodeMap.end())
+	if (!hasNode(nodeId))
 		return NULL;
 
-	// return node
-	return &(*(nodeInfo->second));
+	return &m_nodes[nodeId];
+}
+
+void AStarLiteOpen::removeAt(int heapIndex)
+{
+	m_heapIndex[m_heap[heapIndex].nodeId] = NOT_OPEN;
+
+	// move the last entry into the hole, and restore the heap in whichever direction it is out of order
+	HeapEntry last = m_heap.back();
+	m_heap.pop_back();
+	if (heapIndex < (int)m_heap.size())
+	{
+		place(last, heapIndex);
+		siftUp(heapIndex);
+		siftDown(m_heapIndex[last.nodeId]);
+	}
+}
+
+void AStarLiteOpen::place(const HeapEntry& entry, int heapIndex)
+{
+	m_heap[heapIndex] = entry;
+	m_heapIndex[entry.nodeId] = heapIndex;
+}
+
+void AStarLiteOpen::siftUp(int heapIndex)
+{
+	HeapEntry entry = m_heap[heapIndex];
+	while (heapIndex > 0)
+	{
+		int parent = (heapIndex - 1) / ARITY;
+		if (!isBefore(entry, m_heap[parent]))
+			break;
+		place(m_heap[parent], heapIndex);
+		heapIndex = parent;
+	}
+	place(entry, heapIndex);
+}
+
+void AStarLiteOpen::siftDown(int heapIndex)
+{
+	HeapEntry entry = m_heap[heapIndex];
+	int heapSize = (int)m_heap.size();
+	while (true)
+	{
+		int firstChild = ARITY * heapIndex + 1;
+		if (firstChild >= heapSize)
+			break;
+
+		// find the child that comes first
+		int bestChild = firstChild;
+		int lastChild = (firstChild + ARITY < heapSize) ? firstChild + ARITY : heapSize;
+		for (int child = firstChild + 1; child < lastChild; child++)
+		{
+			if (isBefore(m_heap[child], m_heap[bestChild]))
+				bestChild = child;
+		}
+
+		if (!isBefore(m_heap[bestChild], entry))
+			break;
+		place(m_heap[bestChild], heapIndex);
+		heapIndex = bestChild;
+	}
+	place(entry, heapIndex);
 }